@@ -30,14 +30,84 @@
 #import <XCTest/XCTest.h>
 
 #include "ANTLRInputStream.h"
+#include "ByteCharStream.h"
+#include "LineIndex.h"
 #include "Exceptions.h"
 #include "Interval.h"
 #include "UnbufferedTokenStream.h"
+#include "CommonToken.h"
+#include "CommonTokenFactory.h"
+#include "TokenSource.h"
 #include "StringUtils.h"
+#include "CommonTokenStream.h"
+#include "atn/LexerATNSimulator.h"
+#include "ParserRuleContext.h"
+
+#include "TestGrammar.h"
 
 using namespace antlrcpp;
 using namespace org::antlr::v4::runtime;
 using namespace org::antlr::v4::runtime::misc;
+using namespace antlrcpptest;
+
+// Hands out the tokens "t0", "t1", ... (with type = index + 1) and EOF after the given count.
+class CountingTokenSource : public TokenSource {
+public:
+  size_t produced = 0;
+
+  CountingTokenSource(size_t count) : _count(count) {}
+
+  virtual Ref<Token> nextToken() override {
+    if (produced == _count)
+      return std::make_shared<CommonToken>(Token::EOF, "<EOF>");
+    Ref<Token> token = std::make_shared<CommonToken>((int)produced + 1, "t" + std::to_string(produced));
+    ++produced;
+    return token;
+  }
+
+  virtual size_t getLine() const override { return 1; }
+  virtual int getCharPositionInLine() override { return 0; }
+  virtual CharStream* getInputStream() override { return nullptr; }
+  virtual std::string getSourceName() override { return "counting"; }
+  virtual Ref<TokenFactory<CommonToken>> getTokenFactory() override { return CommonTokenFactory::DEFAULT; }
+
+private:
+  size_t _count;
+};
+
+// The text of the tokens in the interval, concatenated one by one (what BufferedTokenStream::getText() must return).
+static std::string concatenateTokenText(BufferedTokenStream &tokens, const Interval &interval) {
+  std::string result;
+  for (ssize_t i = interval.a; i <= interval.b && i < (ssize_t)tokens.size(); ++i) {
+    if (tokens.get((size_t)i)->getType() != Token::EOF) {
+      result += tokens.get((size_t)i)->getText();
+    }
+  }
+  return result;
+}
+
+// Makes the channel lookups public for tests.
+class ChannelTokenStream : public CommonTokenStream {
+public:
+  using CommonTokenStream::CommonTokenStream;
+  using CommonTokenStream::LB;
+  using BufferedTokenStream::nextTokenOnChannel;
+  using BufferedTokenStream::previousTokenOnChannel;
+};
+
+// Type, char range, line, column and channel of all tokens the lexer produces for its input.
+static std::vector<std::string> describeTokens(Lexer &lexer) {
+  std::vector<std::string> result;
+  for (Ref<Token> token = lexer.nextToken(); ; token = lexer.nextToken()) {
+    result.push_back(std::to_string(token->getType()) + " " + std::to_string(token->getStartIndex()) + ":" +
+      std::to_string(token->getStopIndex()) + " @" + std::to_string(token->getLine()) + ":" +
+      std::to_string(token->getCharPositionInLine()) + " #" + std::to_string(token->getChannel()));
+    if (token->getType() == Token::EOF) {
+      break;
+    }
+  }
+  return result;
+}
 
 @interface InputHandlingTests : XCTestCase
 
@@ -165,8 +235,444 @@ using namespace org::antlr::v4::runtime::misc;
   XCTAssertEqual(stream.getSourceName(), "unit tests");
 }
 
+- (void)testByteCharStream {
+  ByteCharStream stream1;
+  XCTAssert(stream1.toString().empty());
+  XCTAssertEqual(stream1.index(), 0U);
+  XCTAssertEqual(stream1.size(), 0U);
+  XCTAssertEqual(stream1.LA(1), IntStream::EOF);
+  XCTAssertEqual(stream1.getSourceName(), IntStream::UNKNOWN_SOURCE_NAME);
+
+  // Must behave like ANTLRInputStream for ASCII input.
+  std::string text = "To be\nor not\nto be";
+  ByteCharStream stream2(text);
+  ANTLRInputStream reference(text);
+  XCTAssertEqual(stream2.size(), reference.size());
+  XCTAssertEqual(stream2.toString(), text);
+  XCTAssertEqual(stream2.LA(0), 0);
+  XCTAssertEqual(stream2.LA(-1), IntStream::EOF);
+  for (size_t i = 0; i < text.size(); ++i) {
+    XCTAssertEqual(stream2.index(), reference.index());
+    XCTAssertEqual(stream2.LA(1), reference.LA(1));
+    XCTAssertEqual(stream2.LA(3), reference.LA(3));
+    XCTAssertEqual(stream2.LA(-1), reference.LA(-1));
+    stream2.consume();
+    reference.consume();
+  }
+  XCTAssertEqual(stream2.LA(1), IntStream::EOF);
+  XCTAssertEqual(stream2.LA(-1), 'e');
+
+  try {
+    stream2.consume();
+    XCTFail();
+  } catch (IllegalStateException &e) {
+    // Expected.
+    std::string message = e.what();
+    XCTAssertEqual(message, "cannot consume EOF");
+  }
+
+  // Seeks are clamped to the end of the input, mark and release do nothing.
+  stream2.seek(1000);
+  XCTAssertEqual(stream2.index(), text.size());
+  stream2.seek(3);
+  XCTAssertEqual(stream2.index(), 3U);
+  XCTAssertEqual(stream2.LA(1), 'b');
+  XCTAssertEqual(stream2.mark(), -1);
+  stream2.release(-1);
+  XCTAssertEqual(stream2.index(), 3U);
+  stream2.reset();
+  XCTAssertEqual(stream2.index(), 0U);
+
+  XCTAssertEqual(stream2.getText(Interval(3, 4)), "be");
+  XCTAssertEqual(stream2.getText(Interval(3, 1000)), text.substr(3));
+  XCTAssert(stream2.getText(Interval(1000, 2000)).empty());
+  XCTAssert(stream2.getText(Interval(4, 3)).empty());
+
+  // Chars are bytes (Latin-1), text is returned as UTF-8.
+  const char data[] = "gr\xFC\xDF \x80!";
+  ByteCharStream stream3(data, sizeof(data) - 1); // Not copied.
+  XCTAssertEqual(stream3.size(), 7U);
+  XCTAssertEqual(stream3.getData(), data);
+  XCTAssertEqual(stream3.LA(3), 0xFC);
+  XCTAssertEqual(stream3.LA(4), 0xDF);
+  XCTAssertEqual(stream3.LA(6), 0x80);
+  XCTAssertEqual(stream3.toString(), u8"grüß \u0080!");
+  XCTAssertEqual(stream3.getText(Interval(2, 3)), u8"üß");
+
+  // load() replaces the content and starts over.
+  stream3.consume();
+  stream3.load("abc\ndef");
+  XCTAssertEqual(stream3.index(), 0U);
+  XCTAssertEqual(stream3.size(), 7U);
+  XCTAssert(stream3.getData() != data);
+  XCTAssertEqual(stream3.toString(), "abc\ndef");
+
+  Ref<LineIndex> lineIndex = stream3.getLineIndex();
+  XCTAssertEqual(lineIndex->getLineCount(), 2U);
+  XCTAssertEqual(lineIndex->findLine(5), 1U);
+  XCTAssertEqual(lineIndex->getLineStart(1), 4U);
+  XCTAssert(stream3.getLineIndex().get() == lineIndex.get()); // Computed only once.
+
+  stream3.name = "unit tests";
+  XCTAssertEqual(stream3.getSourceName(), "unit tests");
+}
+
 - (void)testUnbufferedTokenSteam {
-  //UnbufferedTokenStream stream;
+  // Without markers consumed tokens are dropped right away, so the ring wraps around many times
+  // while the buffer stays at its initial size.
+  CountingTokenSource source1(100);
+  UnbufferedTokenStream stream1(&source1, 4);
+  XCTAssertEqual(stream1.getBufferSize(), 1U); // Primed with one token.
+  for (size_t i = 0; i < 100; ++i) {
+    XCTAssertEqual(stream1.index(), i);
+    XCTAssertEqual(stream1.LA(1), (ssize_t)i + 1);
+    XCTAssertEqual(stream1.LT(3)->getText(), i + 2 < 100 ? "t" + std::to_string(i + 2) : std::string("<EOF>"));
+    XCTAssertEqual(stream1.get(i)->getTokenIndex(), (int)i);
+    if (i > 0) {
+      XCTAssertEqual(stream1.LT(-1)->getText(), "t" + std::to_string(i - 1));
+    }
+    stream1.consume();
+  }
+  XCTAssertEqual(stream1.LA(1), Token::EOF);
+  XCTAssertEqual(stream1.LA(5), Token::EOF);
+  XCTAssert(stream1.getHighWaterMark() <= 3U);
+
+  try {
+    stream1.consume();
+    XCTFail();
+  } catch (IllegalStateException &) {
+    // Expected.
+  }
+
+  try {
+    stream1.size();
+    XCTFail();
+  } catch (UnsupportedOperationException &) {
+    // Expected.
+  }
+
+  // With a marker nothing is dropped and the ring has to grow, keeping the buffered tokens in order.
+  CountingTokenSource source2(50);
+  UnbufferedTokenStream stream2(&source2, 4);
+  for (size_t i = 0; i < 3; ++i)
+    stream2.consume(); // Move the ring start away from slot 0.
+
+  ssize_t marker = stream2.mark();
+  XCTAssertEqual(marker, -1);
+  for (size_t i = 0; i < 20; ++i)
+    stream2.consume();
+  XCTAssertEqual(stream2.index(), 23U);
+  XCTAssertEqual(stream2.getBufferSize(), 21U);
+  for (size_t i = 3; i <= 23; ++i)
+    XCTAssertEqual(stream2.get(i)->getText(), "t" + std::to_string(i));
+  XCTAssertEqual(stream2.getText(Interval(3, 5)), "t3, t4, t5");
+
+  // Access outside of the window.
+  try {
+    stream2.get(2);
+    XCTFail();
+  } catch (IndexOutOfBoundsException &) {
+    // Expected.
+  }
+  try {
+    stream2.get(24);
+    XCTFail();
+  } catch (IndexOutOfBoundsException &) {
+    // Expected.
+  }
+  try {
+    stream2.getText(Interval(2, 5));
+    XCTFail();
+  } catch (UnsupportedOperationException &) {
+    // Expected.
+  }
+
+  // Seek backwards inside the window.
+  stream2.seek(3);
+  XCTAssertEqual(stream2.index(), 3U);
+  XCTAssertEqual(stream2.LA(1), 4);
+  XCTAssertEqual(stream2.LT(-1)->getText(), "t2");
+  stream2.seek(10);
+  XCTAssertEqual(stream2.LA(1), 11);
+  XCTAssertEqual(stream2.LT(-1)->getText(), "t9");
+
+  // Seek before the window.
+  try {
+    stream2.seek(2);
+    XCTFail();
+  } catch (IllegalArgumentException &) {
+    // Expected.
+  }
+  XCTAssertEqual(stream2.index(), 10U);
+
+  // Seek forward beyond the buffered tokens pulls in more tokens. Seeking past EOF stops at EOF.
+  stream2.seek(30);
+  XCTAssertEqual(stream2.index(), 30U);
+  XCTAssertEqual(stream2.LA(1), 31);
+  XCTAssertEqual(source2.produced, 31U);
+  stream2.seek(1000);
+  XCTAssertEqual(stream2.index(), 50U);
+  XCTAssertEqual(stream2.LA(1), Token::EOF);
+  stream2.seek(3);
+  XCTAssertEqual(stream2.LA(1), 4);
+
+  // Nested markers must be released in reverse order.
+  stream2.seek(5);
+  ssize_t marker2 = stream2.mark();
+  XCTAssertEqual(marker2, -2);
+  try {
+    stream2.release(marker);
+    XCTFail();
+  } catch (IllegalStateException &) {
+    // Expected.
+  }
+  stream2.release(marker2);
+  XCTAssertEqual(stream2.get(3)->getText(), "t3"); // Still buffered, the outer marker is active.
+
+  // Releasing the last marker drops everything before the current position.
+  stream2.release(marker);
+  XCTAssertEqual(stream2.index(), 5U);
+  XCTAssertEqual(stream2.LT(-1)->getText(), "t4");
+  XCTAssertEqual(stream2.get(5)->getText(), "t5");
+  try {
+    stream2.get(4);
+    XCTFail();
+  } catch (IndexOutOfBoundsException &) {
+    // Expected.
+  }
+  try {
+    stream2.seek(4);
+    XCTFail();
+  } catch (IllegalArgumentException &) {
+    // Expected.
+  }
+
+  // Mark after a forward seek starts the window at the current position.
+  CountingTokenSource source3(10);
+  UnbufferedTokenStream stream3(&source3, 4);
+  stream3.seek(4);
+  marker = stream3.mark();
+  XCTAssertEqual(stream3.get(4)->getText(), "t4");
+  XCTAssertEqual(stream3.LT(-1)->getText(), "t3");
+  stream3.consume();
+  stream3.seek(4);
+  XCTAssertEqual(stream3.LT(-1)->getText(), "t3");
+  stream3.release(marker);
+
+  // An exceeded buffer limit is reported.
+  CountingTokenSource source4(20);
+  UnbufferedTokenStream stream4(&source4, 4);
+  stream4.setMaxBufferSize(8);
+  marker = stream4.mark();
+  try {
+    for (size_t i = 0; i < 10; ++i)
+      stream4.consume();
+    XCTFail();
+  } catch (IllegalStateException &) {
+    // Expected.
+  }
+  stream4.release(marker);
+}
+
+- (void)testTokenStreamText {
+  // Long enough for several byte offset checkpoints in the input stream, with chars of all UTF-8 lengths.
+  std::string text;
+  for (size_t i = 0; i < 20; ++i) {
+    text += u8"grüße = " + std::to_string(12 + i) + u8" + \"🚧x\" * (ab); /* ∑ */ k ñ;\n";
+  }
+  ANTLRInputStream input(text);
+  std::u32string utf32 = utfConverter.from_bytes(text);
+  XCTAssertEqual(input.getUTF8Data(), text);
+  XCTAssertEqual(input.getByteOffset(input.size()), text.size());
+  for (size_t a = 0; a < utf32.size(); a += 37) {
+    for (size_t b = a; b < utf32.size(); b += 101) {
+      XCTAssertEqual(input.getText(Interval(a, b)), utfConverter.to_bytes(utf32.substr(a, b - a + 1)));
+      XCTAssertEqual(input.getByteOffset(a), utfConverter.to_bytes(utf32.substr(0, a)).size());
+    }
+  }
+
+  auto lexer = TestGrammar::createLexer(&input);
+  CommonTokenStream tokens(lexer.get());
+  tokens.fill();
+  XCTAssertEqual(tokens.getText(), text);
+  for (size_t a = 0; a < tokens.size(); a += 7) {
+    for (size_t b = a; b < tokens.size() + 2; b += 13) {
+      XCTAssertEqual(tokens.getText(Interval(a, b)), concatenateTokenText(tokens, Interval(a, b)));
+    }
+  }
+
+  auto parser = TestGrammar::createParser(&tokens);
+  Ref<ParserRuleContext> tree = parser->parse(TestGrammar::RuleProg);
+  XCTAssertEqual(parser->getNumberOfSyntaxErrors(), 0U);
+  XCTAssertEqual(tree->children.size(), 41U);
+  for (auto &child : tree->children) {
+    Ref<ParserRuleContext> stat = std::dynamic_pointer_cast<ParserRuleContext>(child);
+    if (stat != nullptr) {
+      XCTAssertEqual(tokens.getText(stat.get()), concatenateTokenText(tokens, stat->getSourceInterval()));
+    }
+  }
+  XCTAssertEqual(tokens.getText(std::static_pointer_cast<ParserRuleContext>(tree->children[0]).get()), u8"grüße = 12 + \"🚧x\" * (ab);");
+
+  // Text set on a token before it is fetched doesn't count as modification.
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    XCTAssertFalse(std::static_pointer_cast<CommonToken>(tokens.get(i))->isTextModified());
+  }
+
+  // Text and positions changed after the fetch are respected.
+  size_t modifiedCount = CommonToken::getTextModifiedCount();
+  Ref<CommonToken> name = std::static_pointer_cast<CommonToken>(tokens.get(0));
+  name->setText("renamed");
+  XCTAssert(name->isTextModified());
+  XCTAssertEqual(CommonToken::getTextModifiedCount(), modifiedCount + 1);
+  XCTAssertEqual(tokens.getText(std::static_pointer_cast<ParserRuleContext>(tree->children[0]).get()), u8"renamed = 12 + \"🚧x\" * (ab);");
+  XCTAssertEqual(tokens.getText(Interval(1, 4)), " = 12");
+
+  Ref<CommonToken> number = std::static_pointer_cast<CommonToken>(tokens.get(4));
+  XCTAssertEqual(number->getText(), "12");
+  number->setStopIndex(number->getStartIndex());
+  XCTAssertEqual(tokens.getText(Interval(2, 6)), "= 1 +");
+  XCTAssertEqual(CommonToken::getTextModifiedCount(), modifiedCount + 2);
+
+  // Other ranges are not affected.
+  XCTAssertEqual(tokens.getText(std::static_pointer_cast<ParserRuleContext>(tree->children[1]).get()), u8"k ñ;");
+  for (size_t a = 0; a < tokens.size(); a += 7) {
+    for (size_t b = a; b < tokens.size() + 2; b += 13) {
+      XCTAssertEqual(tokens.getText(Interval(a, b)), concatenateTokenText(tokens, Interval(a, b)));
+    }
+  }
+}
+
+- (void)testLexerLoopSkipping {
+  // Runs of comment and string chars are skipped in blocks of 16 bytes for a ByteCharStream. That must give the
+  // same tokens and positions as lexing char by char (as for ANTLRInputStream), wherever the runs start relative
+  // to a block and wherever they are interrupted by newlines or Latin-1 chars.
+  std::string run = "abcdefghijklmnopqrstuvwxyz" "abcdefghijklmnopqrstuvwxyz";
+  std::string latin1 = std::string("gr\xFC\xDF") + "e";
+  std::string body;
+  body += run + " = 1;\n";
+  body += run.substr(0, 17) + latin1 + run.substr(0, 30) + ";\r\n";
+  body += "  \t  \n\n      \t\t\t\t      \n    \r\n                                   k x;\n";
+  body += "/* " + run + " */ k x;\n";
+  body += "/*" + run.substr(0, 13) + "\n" + run.substr(0, 15) + "\n\n" + latin1 + run + " * / ** " + latin1 + "\n*/\n";
+  body += "/*" + run.substr(0, 14) + "\n" + run.substr(0, 15) + "\n" + run.substr(0, 16) + "\n" + latin1 + "*/";
+  body += "/*\n\n" + run.substr(0, 5) + "\n" + run.substr(0, 7) + "\n" + run.substr(0, 3) + " */ k x;\n";
+  body += "// " + run + run + "\n";
+  body += "//" + run.substr(0, 20) + latin1 + run.substr(0, 40) + "\r\n";
+  body += "\"" + run + "\" + \"" + run.substr(0, 9) + latin1 + run.substr(0, 31) + "\";\n";
+  body += "\"" + run + "\n\";\n"; // A newline ends the string run, for an error.
+  body += "/*" + run + "*"; // Unterminated.
+
+  for (size_t offset = 0; offset < 17; ++offset) {
+    std::string text = std::string(offset, ' ') + body;
+    std::string utf8;
+    for (unsigned char c : text) {
+      if (c < 0x80) {
+        utf8 += (char)c;
+      } else {
+        utf8 += (char)(0xC0 | (c >> 6));
+        utf8 += (char)(0x80 | (c & 0x3F));
+      }
+    }
+
+    ANTLRInputStream reference(utf8);
+    XCTAssertEqual(reference.size(), text.size());
+    auto referenceLexer = TestGrammar::createLexer(&reference);
+    referenceLexer->removeErrorListeners();
+    std::vector<std::string> expected = describeTokens(*referenceLexer);
+    XCTAssert(expected.size() > 30);
+
+    ByteCharStream input(text);
+    auto lexer = TestGrammar::createLexer(&input);
+    lexer->removeErrorListeners();
+    XCTAssert(describeTokens(*lexer) == expected);
+
+    // Again with a DFA which already has all loop states analyzed, and with lines looked up in the line index.
+    input.reset();
+    lexer->setInputStream(&input);
+    XCTAssert(describeTokens(*lexer) == expected);
+
+    input.reset();
+    lexer->setInputStream(&input);
+    lexer->getInterpreter<atn::LexerATNSimulator>()->setLazyLineTracking(true);
+    XCTAssert(describeTokens(*lexer) == expected);
+  }
+}
+- (void)testTokenStreamChannelLookup {
+  // Hidden tokens (comments and white space, channel 1) at the start, in runs and before EOF.
+  std::string text = "/* a */ // b\n x = 1 /* c */ + 2;\n\n\n k  foo ; /* d */ 3 ;  // e\n  ";
+
+  ANTLRInputStream referenceInput(text);
+  auto referenceLexer = TestGrammar::createLexer(&referenceInput);
+  CommonTokenStream all(referenceLexer.get());
+  all.fill();
+  std::vector<Ref<Token>> tokens;
+  for (size_t i = 0; i < all.size(); ++i) {
+    tokens.push_back(all.get(i));
+  }
+  XCTAssertEqual(tokens.back()->getType(), Token::EOF);
+
+  for (size_t channel : { 0, 1 }) {
+    // The indexes of the tokens on the channel, plus EOF.
+    std::vector<size_t> onChannel;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+      if (tokens[i]->getChannel() == channel || tokens[i]->getType() == Token::EOF) {
+        onChannel.push_back(i);
+      }
+    }
+
+    ANTLRInputStream input(text);
+    auto lexer = TestGrammar::createLexer(&input);
+    ChannelTokenStream stream(lexer.get(), (int)channel);
+
+    // Nothing before the first token, also before the stream is initialized.
+    XCTAssert(stream.LB(1) == nullptr);
+    XCTAssertEqual(stream.LA(1), (ssize_t)tokens[onChannel[0]]->getType());
+    XCTAssertEqual(stream.index(), onChannel[0]);
+    XCTAssert(stream.LT(-1) == nullptr);
+    XCTAssertEqual(stream.previousTokenOnChannel(onChannel[0] - (channel == 0 ? 1 : 0), channel),
+      channel == 0 ? -1 : 0);
+
+    // Walk over the stream (most lookups are served from the index for the default channel) and compare all
+    // lookups with the ones computed from the token list.
+    for (size_t position = 0; position < onChannel.size(); ++position) {
+      XCTAssertEqual(stream.index(), onChannel[position]);
+      for (ssize_t k = 1; k <= 4; ++k) {
+        size_t expected = onChannel[std::min(position + (size_t)k - 1, onChannel.size() - 1)];
+        XCTAssertEqual(stream.LT(k)->getTokenIndex(), (ssize_t)expected);
+        XCTAssertEqual(stream.LA(k), (ssize_t)tokens[expected]->getType());
+        if ((size_t)k <= position) {
+          XCTAssertEqual(stream.LB((size_t)k)->getTokenIndex(), (ssize_t)onChannel[position - (size_t)k]);
+          XCTAssertEqual(stream.LT(-k)->getTokenIndex(), (ssize_t)onChannel[position - (size_t)k]);
+        } else {
+          XCTAssert(stream.LB((size_t)k) == nullptr);
+        }
+      }
+      if (position + 1 < onChannel.size()) {
+        stream.consume();
+      }
+    }
+
+    for (size_t i = 0; i < tokens.size(); ++i) {
+      ssize_t previous = -1;
+      ssize_t next = -1;
+      for (size_t index : onChannel) {
+        if (index <= i) {
+          previous = (ssize_t)index;
+        }
+        if (index >= i && next < 0) {
+          next = (ssize_t)index;
+        }
+      }
+      XCTAssertEqual(stream.previousTokenOnChannel(i, channel), previous);
+      XCTAssertEqual(stream.nextTokenOnChannel(i, channel), next);
+    }
+  }
+
+  // The hidden tokens at the very start belong to the first on-channel token.
+  std::vector<Ref<Token>> hidden = all.getHiddenTokensToLeft(3);
+  XCTAssertEqual(hidden.size(), 3U);
+  XCTAssertEqual(hidden[0]->getText(), "/* a */");
+  XCTAssertEqual(hidden[2]->getText(), "// b");
 }
 
 @end
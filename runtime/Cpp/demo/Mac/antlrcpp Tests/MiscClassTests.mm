@@ -32,11 +32,16 @@
 #include "MurmurHash.h"
 #include "Interval.h"
 #include "IntervalSet.h"
+#include "LineIndex.h"
+#include "EpochManager.h"
+#include "ANTLRInputStream.h"
 #include "Token.h"
 #include "Exceptions.h"
 #include "Lexer.h"
 #include "CPPUtils.h"
 
+#include <thread>
+
 using namespace org::antlr::v4::runtime;
 using namespace org::antlr::v4::runtime::misc;
 using namespace antlrcpp;
@@ -407,4 +412,200 @@ using namespace antlrcpp;
   XCTAssert(IntervalSet::of(15, 20).subtract(IntervalSet::of(7, 55)) == IntervalSet::EMPTY_SET);
 }
 
+- (void)testIntervalSetToList {
+  XCTAssert(IntervalSet().toList().empty());
+  XCTAssert(IntervalSet().toSet().empty());
+
+  // Negative values (like EOF) must not be taken as huge unsigned ones, neither at the start of an interval nor at
+  // its end (which made the loop endless).
+  IntervalSet set = IntervalSet::of(Token::EOF);
+  set.add(0, 2);
+  set.add(10);
+  XCTAssert(set.toList() == std::vector<int>({ -1, 0, 1, 2, 10 }));
+  XCTAssert(set.toSet() == std::set<int>({ -1, 0, 1, 2, 10 }));
+
+  XCTAssert(IntervalSet::of(-3, -1).toList() == std::vector<int>({ -3, -2, -1 }));
+  XCTAssert(IntervalSet::of(-3, -1).toSet() == std::set<int>({ -3, -2, -1 }));
+}
+
+- (void)testLineIndex {
+  LineIndex empty("", 0);
+  XCTAssertEqual(empty.getLineCount(), 1U);
+  XCTAssertEqual(empty.getLineStart(0), 0U);
+  XCTAssertEqual(empty.findLine(0), 0U);
+
+  std::string text = "ab\n\ncd\n";
+  LineIndex index1(text.data(), text.size());
+  XCTAssertEqual(index1.getLineCount(), 4U); // The last line is empty.
+  XCTAssertEqual(index1.getLineStart(1), 3U);
+  XCTAssertEqual(index1.getLineStart(2), 4U);
+  XCTAssertEqual(index1.getLineStart(3), 7U);
+  XCTAssertEqual(index1.findLine(2), 0U); // A newline belongs to the line it ends.
+  XCTAssertEqual(index1.findLine(3), 1U);
+  XCTAssertEqual(index1.findLine(6), 2U);
+  XCTAssertEqual(index1.findLine(7), 3U);
+  XCTAssertEqual(index1.findLine(100), 3U);
+
+  // Compare with a plain scan, for sizes which end inside and outside of a vectorized block and with
+  // newlines at block boundaries.
+  unsigned int seed = 1;
+  for (size_t size = 0; size < 200; ++size) {
+    std::string input;
+    std::vector<size_t> lines;
+    size_t line = 0;
+    for (size_t i = 0; i < size; ++i) {
+      seed = seed * 1103515245 + 12345;
+      bool newline = (seed >> 16) % 5 == 0 || i % 16 == 15 || i % 16 == 0;
+      input += newline ? '\n' : (char)('a' + (seed >> 8) % 26);
+      lines.push_back(line);
+      if (newline)
+        ++line;
+    }
+    lines.push_back(line); // EOF position.
+
+    LineIndex index2(input.data(), input.size());
+    std::u32string wideInput(input.begin(), input.end());
+    LineIndex index3(wideInput);
+    XCTAssertEqual(index2.getLineCount(), line + 1);
+    XCTAssertEqual(index3.getLineCount(), line + 1);
+
+    size_t hint = 0;
+    for (size_t i = 0; i <= size; ++i) {
+      XCTAssertEqual(index2.findLine(i), lines[i]);
+      XCTAssertEqual(index3.findLine(i), lines[i]);
+      hint = index2.findLine(i, hint); // Sequential lookups with hint, as done by the lexer.
+      XCTAssertEqual(hint, lines[i]);
+      XCTAssertEqual(index2.findLine(i, line), lines[i]); // A wrong hint must not matter.
+      XCTAssert(index2.getLineStart(lines[i]) <= i);
+    }
+  }
+
+  // Char streams index their content once.
+  ANTLRInputStream stream(u8"ä\nö\nü");
+  Ref<LineIndex> streamIndex = stream.getLineIndex();
+  XCTAssertEqual(streamIndex->getLineCount(), 3U);
+  XCTAssertEqual(streamIndex->getLineStart(2), 4U); // Indexes are chars, not bytes.
+  XCTAssert(stream.getLineIndex().get() == streamIndex.get());
+}
+
+- (void)testEpochManager {
+  EpochManager manager;
+  size_t reclaimed = 0;
+  auto retire = [&manager, &reclaimed]() {
+    manager.retire([&reclaimed]() { ++reclaimed; });
+  };
+
+  // Without readers data is reclaimed right away.
+  EpochManager::Participant reader1(manager);
+  EpochManager::Participant reader2(manager);
+  retire();
+  XCTAssertEqual(reclaimed, 1U);
+  XCTAssertEqual(manager.getPendingCount(), 0U);
+
+  // A reader blocks reclamation until it leaves its outermost critical section.
+  reader1.enter();
+  reader1.enter();
+  XCTAssert(reader1.isActive());
+  retire();
+  XCTAssertEqual(reclaimed, 1U);
+  XCTAssertEqual(manager.getPendingCount(), 1U);
+  reader1.leave();
+  XCTAssert(reader1.isActive());
+  XCTAssertEqual(manager.collect(), 0U);
+  reader1.leave();
+  XCTAssert(!reader1.isActive());
+  XCTAssertEqual(reclaimed, 2U); // Collected by leave().
+  XCTAssertEqual(manager.getPendingCount(), 0U);
+  XCTAssertEqual(manager.getReclaimedCount(), 2U);
+
+  // Readers which enter after the retirement can't see the data and don't block it.
+  {
+    EpochManager::Guard guard1(reader1);
+    retire();
+    EpochManager::Guard guard2(reader2);
+    retire();
+    XCTAssertEqual(reclaimed, 2U);
+  }
+  XCTAssertEqual(reclaimed, 4U);
+
+  reader1.enter();
+  retire();
+  reader2.enter();
+  reader1.leave();
+  XCTAssertEqual(reclaimed, 5U);
+  retire();
+  XCTAssertEqual(reclaimed, 5U);
+  reader2.leave();
+  XCTAssertEqual(reclaimed, 6U);
+  XCTAssertEqual(manager.getReclaimedCount(), 6U);
+
+  // Slots of destroyed participants are reused and don't block anything.
+  {
+    EpochManager::Participant reader3(manager);
+    reader3.enter();
+    reader3.leave();
+  }
+  retire();
+  XCTAssertEqual(reclaimed, 7U);
+
+  // Readers must never see reclaimed data while a writer keeps replacing it. Reclaimed objects are only
+  // marked, so a violation is detected instead of reading freed memory.
+  struct Object {
+    std::atomic<bool> reclaimed;
+    size_t value;
+  };
+  std::vector<Object *> objects;
+  std::mutex objectsLock;
+  auto createObject = [&objects, &objectsLock](size_t value) {
+    Object *object = new Object();
+    object->reclaimed = false;
+    object->value = value;
+    std::lock_guard<std::mutex> lock(objectsLock);
+    objects.push_back(object);
+    return object;
+  };
+
+  std::atomic<Object *> current(createObject(0));
+  std::atomic<bool> stop(false);
+  std::atomic<size_t> violations(0);
+  std::vector<std::thread> readers;
+  for (size_t i = 0; i < 3; ++i) {
+    readers.emplace_back([&manager, &current, &stop, &violations]() {
+      EpochManager::Participant participant(manager);
+      while (!stop) {
+        EpochManager::Guard guard(participant);
+        Object *object = current.load(std::memory_order_acquire);
+        for (size_t j = 0; j < 10; ++j) {
+          if (object->reclaimed || object->value == (size_t)-1) {
+            ++violations;
+          }
+        }
+      }
+    });
+  }
+
+  for (size_t i = 1; i <= 10000; ++i) {
+    Object *old = current.exchange(createObject(i), std::memory_order_acq_rel);
+    manager.retire([old]() {
+      old->reclaimed = true;
+    });
+    if (i % 100 == 0) {
+      std::this_thread::yield();
+    }
+  }
+  stop = true;
+  for (auto &thread : readers) {
+    thread.join();
+  }
+  manager.collect();
+
+  XCTAssertEqual(violations.load(), 0U);
+  XCTAssertEqual(manager.getPendingCount(), 0U);
+  XCTAssertEqual(manager.getReclaimedCount(), 10007U);
+  for (auto object : objects) {
+    XCTAssertEqual(object->reclaimed.load(), object != current.load());
+    delete object;
+  }
+}
+
 @end
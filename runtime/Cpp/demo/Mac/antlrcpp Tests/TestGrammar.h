@@ -0,0 +1,781 @@
+/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "ANTLRErrorStrategy.h"
+#include "ATN.h"
+#include "ATNDeserializer.h"
+#include "CommonToken.h"
+#include "CommonTokenFactory.h"
+#include "DFA.h"
+#include "LexerInterpreter.h"
+#include "NoViableAltException.h"
+#include "ParserATNSimulator.h"
+#include "ParserInterpreter.h"
+#include "PredictionContext.h"
+#include "Token.h"
+#include "TokenSource.h"
+#include "VocabularyImpl.h"
+#include "CPPUtils.h"
+
+namespace antlrcpptest {
+
+  /// <summary>
+  /// A small grammar for tests which need real recognizers. The serialized ATNs are what the ANTLR tool creates for:
+  ///
+  /// <pre>
+  /// lexer grammar TestLexer;
+  /// KW: 'k';
+  /// ID: [a-z\u00C0-\uFFFF]+;
+  /// NUM: [0-9]+;
+  /// PLUS: '+'; STAR: '*'; LP: '('; RP: ')'; SEMI: ';'; EQ: '='; DOLLAR: '$'; AT: '@';
+  /// STRING: '"' ~["\n]* '"';
+  /// COMMENT: '/*' .*? '*/' -> channel(HIDDEN);
+  /// LINE_COMMENT: '//' ~[\n]* -> channel(HIDDEN);
+  /// WS: [ \t\r\n]+ -> channel(HIDDEN);
+  ///
+  /// parser grammar TestParser;
+  /// prog: stat* EOF;
+  /// stat: ID '=' expr ';' | expr ';' | KW ID ';' | '$' dollar ';' | '@' at ';';
+  /// expr: term ('+' term)*;
+  /// term: atom ('*' atom)*;
+  /// atom: ID | NUM | STRING | '(' expr ')';
+  /// dollar: opt ID;
+  /// at: opt NUM ID;
+  /// opt: NUM?; // SLL prediction takes the wrong alt for "@ 1 x;", only LL gets it right.
+  /// list: (ID '+')* ID '=' | (ID '+')* ID ';'; // The DFA of the decision loops.
+  /// </pre>
+  /// </summary>
+  class TestGrammar {
+  public:
+    enum {
+      KW = 1, ID = 2, NUM = 3, PLUS = 4, STAR = 5, LP = 6, RP = 7, SEMI = 8, EQ = 9, DOLLAR = 10, AT = 11,
+      STRING = 12, COMMENT = 13, LINE_COMMENT = 14, WS = 15
+    };
+
+    enum {
+      RuleProg = 0, RuleStat = 1, RuleExpr = 2, RuleTerm = 3, RuleAtom = 4, RuleDollar = 5, RuleAt = 6, RuleOpt = 7, RuleList = 8
+    };
+
+    static const org::antlr::v4::runtime::atn::ATN& getLexerATN() {
+      static org::antlr::v4::runtime::atn::ATN atn = org::antlr::v4::runtime::atn::ATNDeserializer().deserialize({
+        3, 1072, 54993, 33286, 44333, 17431, 44785, 36224, 43741, 2, 17, 112, 4, 2, 9, 2, 4, 3, 9, 3, 4, 4, 9, 4, 4, 5, 9,
+        5, 4, 6, 9, 6, 4, 7, 9, 7, 4, 8, 9, 8, 4, 9, 9, 9, 4, 10, 9, 10, 4, 11, 9, 11, 4, 12, 9, 12, 4, 13, 9, 13, 4, 14,
+        9, 14, 4, 15, 9, 15, 4, 16, 9, 16, 3, 2, 3, 2, 3, 3, 3, 3, 10, 3, 6, 3, 36, 13, 3, 14, 3, 38, 3, 4, 3, 4, 10, 4, 6,
+        4, 42, 13, 4, 14, 4, 44, 3, 5, 3, 5, 3, 6, 3, 6, 3, 7, 3, 7, 3, 8, 3, 8, 3, 9, 3, 9, 3, 10, 3, 10, 3, 11, 3, 11, 3,
+        12, 3, 12, 3, 13, 3, 13, 3, 13, 3, 13, 10, 13, 7, 13, 66, 12, 13, 11, 13, 14, 13, 69, 3, 13, 3, 13, 3, 14, 3, 14,
+        3, 14, 3, 14, 3, 14, 3, 14, 10, 14, 7, 14, 79, 12, 14, 11, 14, 14, 14, 82, 3, 14, 3, 14, 3, 14, 3, 14, 3, 14, 3,
+        14, 3, 15, 3, 15, 3, 15, 3, 15, 3, 15, 3, 15, 10, 15, 7, 15, 96, 12, 15, 11, 15, 14, 15, 99, 3, 15, 3, 15, 3, 16,
+        3, 16, 10, 16, 6, 16, 105, 13, 16, 14, 16, 107, 3, 16, 3, 16, 8, 1, 3, 81, 2, 17, 2, 3, 4, 4, 6, 5, 8, 6, 10, 7,
+        12, 8, 14, 9, 16, 10, 18, 11, 20, 12, 22, 13, 24, 14, 26, 15, 28, 16, 30, 17, 3, 111, 6, 4, 2, 99, 124, 194, 1, 4,
+        2, 36, 36, 12, 12, 3, 2, 12, 12, 5, 2, 11, 12, 15, 15, 34, 34, 117, 32, 33, 4, 109, 109, 2, 2, 32, 3, 2, 2, 2, 33,
+        3, 3, 2, 2, 2, 34, 35, 9, 2, 2, 2, 37, 34, 3, 2, 2, 2, 35, 36, 3, 2, 2, 2, 36, 38, 3, 2, 2, 2, 38, 37, 3, 2, 2, 2,
+        38, 39, 3, 2, 2, 2, 4, 37, 3, 2, 2, 2, 39, 5, 3, 2, 2, 2, 40, 41, 4, 50, 59, 2, 43, 40, 3, 2, 2, 2, 41, 42, 3, 2,
+        2, 2, 42, 44, 3, 2, 2, 2, 44, 43, 3, 2, 2, 2, 44, 45, 3, 2, 2, 2, 6, 43, 3, 2, 2, 2, 45, 7, 3, 2, 2, 2, 46, 47, 4,
+        45, 45, 2, 8, 46, 3, 2, 2, 2, 47, 9, 3, 2, 2, 2, 48, 49, 4, 44, 44, 2, 10, 48, 3, 2, 2, 2, 49, 11, 3, 2, 2, 2, 50,
+        51, 4, 42, 42, 2, 12, 50, 3, 2, 2, 2, 51, 13, 3, 2, 2, 2, 52, 53, 4, 43, 43, 2, 14, 52, 3, 2, 2, 2, 53, 15, 3, 2,
+        2, 2, 54, 55, 4, 61, 61, 2, 16, 54, 3, 2, 2, 2, 55, 17, 3, 2, 2, 2, 56, 57, 4, 63, 63, 2, 18, 56, 3, 2, 2, 2, 57,
+        19, 3, 2, 2, 2, 58, 59, 4, 38, 38, 2, 20, 58, 3, 2, 2, 2, 59, 21, 3, 2, 2, 2, 60, 61, 4, 66, 66, 2, 22, 60, 3, 2,
+        2, 2, 61, 23, 3, 2, 2, 2, 62, 63, 4, 36, 36, 2, 64, 65, 10, 3, 2, 2, 67, 64, 3, 2, 2, 2, 65, 66, 3, 2, 2, 2, 68,
+        67, 3, 2, 2, 2, 68, 70, 3, 2, 2, 2, 66, 69, 3, 2, 2, 2, 69, 68, 3, 2, 2, 2, 71, 72, 4, 36, 36, 2, 63, 68, 3, 2, 2,
+        2, 70, 71, 3, 2, 2, 2, 24, 62, 3, 2, 2, 2, 72, 25, 3, 2, 2, 2, 73, 74, 4, 49, 49, 2, 75, 76, 4, 44, 44, 2, 77, 78,
+        11, 2, 2, 2, 80, 77, 3, 2, 2, 2, 78, 79, 3, 2, 2, 2, 81, 83, 3, 2, 2, 2, 81, 80, 3, 2, 2, 2, 79, 82, 3, 2, 2, 2,
+        82, 81, 3, 2, 2, 2, 84, 85, 4, 44, 44, 2, 86, 87, 4, 49, 49, 2, 88, 89, 8, 14, 2, 2, 74, 75, 3, 2, 2, 2, 76, 81, 3,
+        2, 2, 2, 83, 84, 3, 2, 2, 2, 85, 86, 3, 2, 2, 2, 87, 88, 3, 2, 2, 2, 26, 73, 3, 2, 2, 2, 89, 27, 3, 2, 2, 2, 90,
+        91, 4, 49, 49, 2, 92, 93, 4, 49, 49, 2, 94, 95, 10, 4, 2, 2, 97, 94, 3, 2, 2, 2, 95, 96, 3, 2, 2, 2, 98, 97, 3, 2,
+        2, 2, 98, 100, 3, 2, 2, 2, 96, 99, 3, 2, 2, 2, 99, 98, 3, 2, 2, 2, 101, 102, 8, 15, 3, 2, 91, 92, 3, 2, 2, 2, 93,
+        98, 3, 2, 2, 2, 100, 101, 3, 2, 2, 2, 28, 90, 3, 2, 2, 2, 102, 29, 3, 2, 2, 2, 103, 104, 9, 5, 2, 2, 106, 103, 3,
+        2, 2, 2, 104, 105, 3, 2, 2, 2, 105, 107, 3, 2, 2, 2, 107, 106, 3, 2, 2, 2, 107, 108, 3, 2, 2, 2, 109, 110, 8, 16,
+        4, 2, 108, 109, 3, 2, 2, 2, 30, 106, 3, 2, 2, 2, 110, 31, 3, 2, 2, 2, 111, 2, 3, 2, 2, 2, 111, 4, 3, 2, 2, 2, 111,
+        6, 3, 2, 2, 2, 111, 8, 3, 2, 2, 2, 111, 10, 3, 2, 2, 2, 111, 12, 3, 2, 2, 2, 111, 14, 3, 2, 2, 2, 111, 16, 3, 2, 2,
+        2, 111, 18, 3, 2, 2, 2, 111, 20, 3, 2, 2, 2, 111, 22, 3, 2, 2, 2, 111, 24, 3, 2, 2, 2, 111, 26, 3, 2, 2, 2, 111,
+        28, 3, 2, 2, 2, 111, 30, 3, 2, 2, 2, 9, 38, 44, 68, 81, 98, 107, 111, 5, 2, 3, 2, 2, 3, 2, 2, 3, 2
+      });
+      return atn;
+    }
+
+    // Parsers need the serialized form for the ATN with rule bypass transitions (used for tree patterns).
+    static const std::vector<uint16_t>& getSerializedParserATN() {
+      static std::vector<uint16_t> serializedATN = {
+        3, 1072, 54993, 33286, 44333, 17431, 44785, 36224, 43741, 3, 17, 139, 4, 2, 9, 2, 4, 3, 9, 3, 4, 4, 9, 4, 4, 5, 9,
+        5, 4, 6, 9, 6, 4, 7, 9, 7, 4, 8, 9, 8, 4, 9, 9, 9, 4, 10, 9, 10, 3, 2, 3, 2, 10, 2, 7, 2, 22, 12, 2, 11, 2, 14, 2,
+        25, 3, 2, 3, 2, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+        3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 10, 3, 5, 3, 59, 3, 4, 3, 4, 3, 4,
+        3, 4, 3, 4, 3, 4, 10, 4, 7, 4, 67, 12, 4, 11, 4, 14, 4, 70, 3, 5, 3, 5, 3, 5, 3, 5, 3, 5, 3, 5, 10, 5, 7, 5, 78,
+        12, 5, 11, 5, 14, 5, 81, 3, 6, 3, 6, 3, 6, 3, 6, 3, 6, 3, 6, 3, 6, 3, 6, 3, 6, 3, 6, 3, 6, 3, 6, 10, 6, 5, 6, 95,
+        3, 7, 3, 7, 3, 7, 3, 7, 3, 8, 3, 8, 3, 8, 3, 8, 3, 8, 3, 8, 3, 9, 3, 9, 10, 9, 5, 9, 109, 3, 10, 3, 10, 3, 10, 3,
+        10, 10, 10, 7, 10, 115, 12, 10, 11, 10, 14, 10, 118, 3, 10, 3, 10, 3, 10, 3, 10, 3, 10, 3, 10, 3, 10, 3, 10, 10,
+        10, 7, 10, 128, 12, 10, 11, 10, 14, 10, 131, 3, 10, 3, 10, 3, 10, 3, 10, 10, 10, 5, 10, 137, 2, 2, 11, 2, 4, 6, 8,
+        10, 12, 14, 16, 18, 2, 2, 144, 20, 21, 5, 4, 3, 2, 23, 20, 3, 2, 2, 2, 21, 22, 3, 2, 2, 2, 24, 23, 3, 2, 2, 2, 24,
+        26, 3, 2, 2, 2, 22, 25, 3, 2, 2, 2, 25, 24, 3, 2, 2, 2, 27, 28, 7, 2, 2, 3, 26, 27, 3, 2, 2, 2, 2, 24, 3, 2, 2, 2,
+        28, 3, 3, 2, 2, 2, 29, 30, 7, 4, 2, 2, 31, 32, 7, 11, 2, 2, 33, 34, 5, 6, 4, 2, 35, 36, 7, 10, 2, 2, 30, 31, 3, 2,
+        2, 2, 32, 33, 3, 2, 2, 2, 34, 35, 3, 2, 2, 2, 37, 38, 5, 6, 4, 2, 39, 40, 7, 10, 2, 2, 38, 39, 3, 2, 2, 2, 41, 42,
+        7, 3, 2, 2, 43, 44, 7, 4, 2, 2, 45, 46, 7, 10, 2, 2, 42, 43, 3, 2, 2, 2, 44, 45, 3, 2, 2, 2, 47, 48, 7, 12, 2, 2,
+        49, 50, 5, 12, 7, 2, 51, 52, 7, 10, 2, 2, 48, 49, 3, 2, 2, 2, 50, 51, 3, 2, 2, 2, 53, 54, 7, 13, 2, 2, 55, 56, 5,
+        14, 8, 2, 57, 58, 7, 10, 2, 2, 54, 55, 3, 2, 2, 2, 56, 57, 3, 2, 2, 2, 60, 29, 3, 2, 2, 2, 36, 59, 3, 2, 2, 2, 60,
+        37, 3, 2, 2, 2, 40, 59, 3, 2, 2, 2, 60, 41, 3, 2, 2, 2, 46, 59, 3, 2, 2, 2, 60, 47, 3, 2, 2, 2, 52, 59, 3, 2, 2, 2,
+        60, 53, 3, 2, 2, 2, 58, 59, 3, 2, 2, 2, 4, 60, 3, 2, 2, 2, 59, 5, 3, 2, 2, 2, 61, 62, 5, 8, 5, 2, 63, 64, 7, 6, 2,
+        2, 65, 66, 5, 8, 5, 2, 64, 65, 3, 2, 2, 2, 68, 63, 3, 2, 2, 2, 66, 67, 3, 2, 2, 2, 69, 68, 3, 2, 2, 2, 69, 71, 3,
+        2, 2, 2, 67, 70, 3, 2, 2, 2, 70, 69, 3, 2, 2, 2, 62, 69, 3, 2, 2, 2, 6, 61, 3, 2, 2, 2, 71, 7, 3, 2, 2, 2, 72, 73,
+        5, 10, 6, 2, 74, 75, 7, 7, 2, 2, 76, 77, 5, 10, 6, 2, 75, 76, 3, 2, 2, 2, 79, 74, 3, 2, 2, 2, 77, 78, 3, 2, 2, 2,
+        80, 79, 3, 2, 2, 2, 80, 82, 3, 2, 2, 2, 78, 81, 3, 2, 2, 2, 81, 80, 3, 2, 2, 2, 73, 80, 3, 2, 2, 2, 8, 72, 3, 2, 2,
+        2, 82, 9, 3, 2, 2, 2, 83, 84, 7, 4, 2, 2, 85, 86, 7, 5, 2, 2, 87, 88, 7, 14, 2, 2, 89, 90, 7, 8, 2, 2, 91, 92, 5,
+        6, 4, 2, 93, 94, 7, 9, 2, 2, 90, 91, 3, 2, 2, 2, 92, 93, 3, 2, 2, 2, 96, 83, 3, 2, 2, 2, 84, 95, 3, 2, 2, 2, 96,
+        85, 3, 2, 2, 2, 86, 95, 3, 2, 2, 2, 96, 87, 3, 2, 2, 2, 88, 95, 3, 2, 2, 2, 96, 89, 3, 2, 2, 2, 94, 95, 3, 2, 2, 2,
+        10, 96, 3, 2, 2, 2, 95, 11, 3, 2, 2, 2, 97, 98, 5, 16, 9, 2, 99, 100, 7, 4, 2, 2, 98, 99, 3, 2, 2, 2, 12, 97, 3, 2,
+        2, 2, 100, 13, 3, 2, 2, 2, 101, 102, 5, 16, 9, 2, 103, 104, 7, 5, 2, 2, 105, 106, 7, 4, 2, 2, 102, 103, 3, 2, 2, 2,
+        104, 105, 3, 2, 2, 2, 14, 101, 3, 2, 2, 2, 106, 15, 3, 2, 2, 2, 107, 108, 7, 5, 2, 2, 110, 107, 3, 2, 2, 2, 108,
+        109, 3, 2, 2, 2, 110, 109, 3, 2, 2, 2, 16, 110, 3, 2, 2, 2, 109, 17, 3, 2, 2, 2, 111, 112, 7, 4, 2, 2, 113, 114, 7,
+        6, 2, 2, 112, 113, 3, 2, 2, 2, 116, 111, 3, 2, 2, 2, 114, 115, 3, 2, 2, 2, 117, 116, 3, 2, 2, 2, 117, 119, 3, 2, 2,
+        2, 115, 118, 3, 2, 2, 2, 118, 117, 3, 2, 2, 2, 120, 121, 7, 4, 2, 2, 122, 123, 7, 11, 2, 2, 119, 120, 3, 2, 2, 2,
+        121, 122, 3, 2, 2, 2, 124, 125, 7, 4, 2, 2, 126, 127, 7, 6, 2, 2, 125, 126, 3, 2, 2, 2, 129, 124, 3, 2, 2, 2, 127,
+        128, 3, 2, 2, 2, 130, 129, 3, 2, 2, 2, 130, 132, 3, 2, 2, 2, 128, 131, 3, 2, 2, 2, 131, 130, 3, 2, 2, 2, 133, 134,
+        7, 4, 2, 2, 135, 136, 7, 10, 2, 2, 132, 133, 3, 2, 2, 2, 134, 135, 3, 2, 2, 2, 138, 117, 3, 2, 2, 2, 123, 137, 3,
+        2, 2, 2, 138, 130, 3, 2, 2, 2, 136, 137, 3, 2, 2, 2, 18, 138, 3, 2, 2, 2, 137, 19, 3, 2, 2, 2, 11, 24, 60, 69, 80,
+        96, 110, 117, 130, 138
+      };
+      return serializedATN;
+    }
+
+    static const org::antlr::v4::runtime::atn::ATN& getParserATN() {
+      static org::antlr::v4::runtime::atn::ATN atn =
+        org::antlr::v4::runtime::atn::ATNDeserializer().deserialize(getSerializedParserATN());
+      return atn;
+    }
+
+    static Ref<org::antlr::v4::runtime::dfa::Vocabulary> getVocabulary() {
+      static Ref<org::antlr::v4::runtime::dfa::Vocabulary> vocabulary = std::make_shared<org::antlr::v4::runtime::dfa::VocabularyImpl>(
+        std::vector<std::string>{ "", "'k'", "", "", "'+'", "'*'", "'('", "')'", "';'", "'='", "'$'", "'@'" },
+        std::vector<std::string>{ "", "KW", "ID", "NUM", "PLUS", "STAR", "LP", "RP", "SEMI", "EQ", "DOLLAR", "AT", "STRING",
+          "COMMENT", "LINE_COMMENT", "WS" });
+      return vocabulary;
+    }
+
+    // The interpreters keep references to the name lists.
+    static const std::vector<std::string>& getLexerRuleNames() {
+      static std::vector<std::string> ruleNames = { "KW", "ID", "NUM", "PLUS", "STAR", "LP", "RP", "SEMI", "EQ", "DOLLAR",
+        "AT", "STRING", "COMMENT", "LINE_COMMENT", "WS" };
+      return ruleNames;
+    }
+
+    static const std::vector<std::string>& getModeNames() {
+      static std::vector<std::string> modeNames = { "DEFAULT_MODE" };
+      return modeNames;
+    }
+
+    static const std::vector<std::string>& getParserRuleNames() {
+      static std::vector<std::string> ruleNames = { "prog", "stat", "expr", "term", "atom", "dollar", "at", "opt",
+        "list" };
+      return ruleNames;
+    }
+
+    /// Each interpreter has its own DFA.
+    static Ref<org::antlr::v4::runtime::LexerInterpreter> createLexer(org::antlr::v4::runtime::CharStream *input) {
+      return std::make_shared<org::antlr::v4::runtime::LexerInterpreter>("TestLexer.g4", getVocabulary(),
+        getLexerRuleNames(), getModeNames(), getLexerATN(), input);
+    }
+
+    static Ref<org::antlr::v4::runtime::ParserInterpreter> createParser(org::antlr::v4::runtime::TokenStream *input) {
+      return std::make_shared<org::antlr::v4::runtime::ParserInterpreter>("TestParser.g4", getVocabulary(),
+        getParserRuleNames(), getParserATN(), input);
+    }
+  };
+
+  /// <summary>
+  /// The TestParser grammar (without the list rule) written the way the Cpp code generation templates write a
+  /// parser, for tests of the generated parser code paths (ParserInterpreter takes different ones).
+  /// </summary>
+  class TestParser : public org::antlr::v4::runtime::Parser {
+  public:
+    typedef org::antlr::v4::runtime::ParserRuleContext ParserRuleContext;
+    typedef org::antlr::v4::runtime::RecognitionException RecognitionException;
+    typedef org::antlr::v4::runtime::NoViableAltException NoViableAltException;
+
+    /// The generated contexts differ only in their rule index (and the getters for their children).
+    template<size_t ruleIndex>
+    class Context : public ParserRuleContext {
+    public:
+      Context(std::weak_ptr<ParserRuleContext> parent, int invokingState) : ParserRuleContext(parent, invokingState) {}
+
+      virtual ssize_t getRuleIndex() const override {
+        return ruleIndex;
+      }
+    };
+
+    typedef Context<TestGrammar::RuleProg> ProgContext;
+    typedef Context<TestGrammar::RuleStat> StatContext;
+    typedef Context<TestGrammar::RuleExpr> ExprContext;
+    typedef Context<TestGrammar::RuleTerm> TermContext;
+    typedef Context<TestGrammar::RuleAtom> AtomContext;
+    typedef Context<TestGrammar::RuleDollar> DollarContext;
+    typedef Context<TestGrammar::RuleAt> AtContext;
+    typedef Context<TestGrammar::RuleOpt> OptContext;
+
+    TestParser(org::antlr::v4::runtime::TokenStream *input) : Parser(input) {
+      const org::antlr::v4::runtime::atn::ATN &atn = getATN();
+      for (size_t i = 0; i < atn.maxTokenType; ++i) {
+        _tokenNames.push_back(getVocabulary()->getDisplayName(i));
+      }
+      for (int i = 0; i < atn.getNumberOfDecisions(); ++i) {
+        _decisionToDFA.push_back(org::antlr::v4::runtime::dfa::DFA(atn.getDecisionState(i), i));
+      }
+      _sharedContextCache = std::make_shared<org::antlr::v4::runtime::atn::PredictionContextCache>();
+      _interpreter = new org::antlr::v4::runtime::atn::ParserATNSimulator(this, atn, _decisionToDFA, _sharedContextCache);
+    }
+
+    ~TestParser() {
+      delete _interpreter;
+    }
+
+    virtual std::string getGrammarFileName() const override { return "TestParser.g4"; }
+    virtual const org::antlr::v4::runtime::atn::ATN& getATN() const override { return TestGrammar::getParserATN(); }
+    virtual const std::vector<std::string>& getTokenNames() const override { return _tokenNames; }
+    virtual const std::vector<std::string>& getRuleNames() const override { return TestGrammar::getParserRuleNames(); }
+    virtual Ref<org::antlr::v4::runtime::dfa::Vocabulary> getVocabulary() const override { return TestGrammar::getVocabulary(); }
+    virtual std::vector<uint16_t> getSerializedATN() override { return TestGrammar::getSerializedParserATN(); }
+
+    Ref<ProgContext> prog() {
+      Ref<ProgContext> _localctx = std::make_shared<ProgContext>(_ctx, getState());
+      enterRule(_localctx, 0, TestGrammar::RuleProg);
+      ssize_t _la;
+
+      auto onExit = antlrcpp::finally([=] {
+        exitRule();
+      });
+      try {
+        enterOuterAlt(_localctx, 1);
+        setState(22);
+        _errHandler->sync(this);
+        if (hasPendingError()) {
+          recoverFromPendingError(_localctx);
+          return _localctx;
+        }
+        _la = _input->LA(1);
+        while (((_la & ~(ssize_t)0x3f) == 0) &&
+          ((1L << _la) & ((1L << TestGrammar::KW) | (1L << TestGrammar::ID) | (1L << TestGrammar::NUM) |
+            (1L << TestGrammar::LP) | (1L << TestGrammar::DOLLAR) | (1L << TestGrammar::AT) |
+            (1L << TestGrammar::STRING))) != 0) {
+          setState(18);
+          stat();
+          setState(23);
+          _errHandler->sync(this);
+          if (hasPendingError()) {
+            recoverFromPendingError(_localctx);
+            return _localctx;
+          }
+          _la = _input->LA(1);
+        }
+        setState(25);
+        match(EOF);
+        if (hasPendingError()) {
+          recoverFromPendingError(_localctx);
+          return _localctx;
+        }
+      }
+      catch (RecognitionException &e) {
+        _errHandler->reportError(this, e);
+        _localctx->exception = std::current_exception();
+        _errHandler->recover(this, _localctx->exception);
+      }
+
+      return _localctx;
+    }
+
+    Ref<StatContext> stat() {
+      Ref<StatContext> _localctx = std::make_shared<StatContext>(_ctx, getState());
+      enterRule(_localctx, 2, TestGrammar::RuleStat);
+
+      auto onExit = antlrcpp::finally([=] {
+        exitRule();
+      });
+      try {
+        setState(58);
+        _errHandler->sync(this);
+        if (hasPendingError()) {
+          recoverFromPendingError(_localctx);
+          return _localctx;
+        }
+        switch (getInterpreter<org::antlr::v4::runtime::atn::ParserATNSimulator>()->adaptivePredict(_input, 1, _ctx)) {
+          case 1:
+            enterOuterAlt(_localctx, 1);
+            setState(27);
+            match(TestGrammar::ID);
+            if (hasPendingError()) {
+              recoverFromPendingError(_localctx);
+              return _localctx;
+            }
+            setState(29);
+            match(TestGrammar::EQ);
+            if (hasPendingError()) {
+              recoverFromPendingError(_localctx);
+              return _localctx;
+            }
+            setState(31);
+            expr();
+            setState(33);
+            match(TestGrammar::SEMI);
+            if (hasPendingError()) {
+              recoverFromPendingError(_localctx);
+              return _localctx;
+            }
+            break;
+
+          case 2:
+            enterOuterAlt(_localctx, 2);
+            setState(35);
+            expr();
+            setState(37);
+            match(TestGrammar::SEMI);
+            if (hasPendingError()) {
+              recoverFromPendingError(_localctx);
+              return _localctx;
+            }
+            break;
+
+          case 3:
+            enterOuterAlt(_localctx, 3);
+            setState(39);
+            match(TestGrammar::KW);
+            if (hasPendingError()) {
+              recoverFromPendingError(_localctx);
+              return _localctx;
+            }
+            setState(41);
+            match(TestGrammar::ID);
+            if (hasPendingError()) {
+              recoverFromPendingError(_localctx);
+              return _localctx;
+            }
+            setState(43);
+            match(TestGrammar::SEMI);
+            if (hasPendingError()) {
+              recoverFromPendingError(_localctx);
+              return _localctx;
+            }
+            break;
+
+          case 4:
+            enterOuterAlt(_localctx, 4);
+            setState(45);
+            match(TestGrammar::DOLLAR);
+            if (hasPendingError()) {
+              recoverFromPendingError(_localctx);
+              return _localctx;
+            }
+            setState(47);
+            dollar();
+            setState(49);
+            match(TestGrammar::SEMI);
+            if (hasPendingError()) {
+              recoverFromPendingError(_localctx);
+              return _localctx;
+            }
+            break;
+
+          case 5:
+            enterOuterAlt(_localctx, 5);
+            setState(51);
+            match(TestGrammar::AT);
+            if (hasPendingError()) {
+              recoverFromPendingError(_localctx);
+              return _localctx;
+            }
+            setState(53);
+            at();
+            setState(55);
+            match(TestGrammar::SEMI);
+            if (hasPendingError()) {
+              recoverFromPendingError(_localctx);
+              return _localctx;
+            }
+            break;
+        }
+        if (hasPendingError()) {
+          recoverFromPendingError(_localctx);
+          return _localctx;
+        }
+      }
+      catch (RecognitionException &e) {
+        _errHandler->reportError(this, e);
+        _localctx->exception = std::current_exception();
+        _errHandler->recover(this, _localctx->exception);
+      }
+
+      return _localctx;
+    }
+
+    Ref<ExprContext> expr() {
+      Ref<ExprContext> _localctx = std::make_shared<ExprContext>(_ctx, getState());
+      enterRule(_localctx, 4, TestGrammar::RuleExpr);
+      ssize_t _la;
+
+      auto onExit = antlrcpp::finally([=] {
+        exitRule();
+      });
+      try {
+        enterOuterAlt(_localctx, 1);
+        setState(59);
+        term();
+        setState(67);
+        _errHandler->sync(this);
+        if (hasPendingError()) {
+          recoverFromPendingError(_localctx);
+          return _localctx;
+        }
+        _la = _input->LA(1);
+        while (_la == TestGrammar::PLUS) {
+          setState(61);
+          match(TestGrammar::PLUS);
+          if (hasPendingError()) {
+            recoverFromPendingError(_localctx);
+            return _localctx;
+          }
+          setState(63);
+          term();
+          setState(68);
+          _errHandler->sync(this);
+          if (hasPendingError()) {
+            recoverFromPendingError(_localctx);
+            return _localctx;
+          }
+          _la = _input->LA(1);
+        }
+      }
+      catch (RecognitionException &e) {
+        _errHandler->reportError(this, e);
+        _localctx->exception = std::current_exception();
+        _errHandler->recover(this, _localctx->exception);
+      }
+
+      return _localctx;
+    }
+
+    Ref<TermContext> term() {
+      Ref<TermContext> _localctx = std::make_shared<TermContext>(_ctx, getState());
+      enterRule(_localctx, 6, TestGrammar::RuleTerm);
+      ssize_t _la;
+
+      auto onExit = antlrcpp::finally([=] {
+        exitRule();
+      });
+      try {
+        enterOuterAlt(_localctx, 1);
+        setState(70);
+        atom();
+        setState(78);
+        _errHandler->sync(this);
+        if (hasPendingError()) {
+          recoverFromPendingError(_localctx);
+          return _localctx;
+        }
+        _la = _input->LA(1);
+        while (_la == TestGrammar::STAR) {
+          setState(72);
+          match(TestGrammar::STAR);
+          if (hasPendingError()) {
+            recoverFromPendingError(_localctx);
+            return _localctx;
+          }
+          setState(74);
+          atom();
+          setState(79);
+          _errHandler->sync(this);
+          if (hasPendingError()) {
+            recoverFromPendingError(_localctx);
+            return _localctx;
+          }
+          _la = _input->LA(1);
+        }
+      }
+      catch (RecognitionException &e) {
+        _errHandler->reportError(this, e);
+        _localctx->exception = std::current_exception();
+        _errHandler->recover(this, _localctx->exception);
+      }
+
+      return _localctx;
+    }
+
+    Ref<AtomContext> atom() {
+      Ref<AtomContext> _localctx = std::make_shared<AtomContext>(_ctx, getState());
+      enterRule(_localctx, 8, TestGrammar::RuleAtom);
+
+      auto onExit = antlrcpp::finally([=] {
+        exitRule();
+      });
+      try {
+        setState(94);
+        _errHandler->sync(this);
+        if (hasPendingError()) {
+          recoverFromPendingError(_localctx);
+          return _localctx;
+        }
+        switch (_input->LA(1)) {
+          case TestGrammar::ID:
+            enterOuterAlt(_localctx, 1);
+            setState(81);
+            match(TestGrammar::ID);
+            if (hasPendingError()) {
+              recoverFromPendingError(_localctx);
+              return _localctx;
+            }
+            break;
+
+          case TestGrammar::NUM:
+            enterOuterAlt(_localctx, 2);
+            setState(83);
+            match(TestGrammar::NUM);
+            if (hasPendingError()) {
+              recoverFromPendingError(_localctx);
+              return _localctx;
+            }
+            break;
+
+          case TestGrammar::STRING:
+            enterOuterAlt(_localctx, 3);
+            setState(85);
+            match(TestGrammar::STRING);
+            if (hasPendingError()) {
+              recoverFromPendingError(_localctx);
+              return _localctx;
+            }
+            break;
+
+          case TestGrammar::LP:
+            enterOuterAlt(_localctx, 4);
+            setState(87);
+            match(TestGrammar::LP);
+            if (hasPendingError()) {
+              recoverFromPendingError(_localctx);
+              return _localctx;
+            }
+            setState(89);
+            expr();
+            setState(91);
+            match(TestGrammar::RP);
+            if (hasPendingError()) {
+              recoverFromPendingError(_localctx);
+              return _localctx;
+            }
+            break;
+
+          default:
+            signalError(NoViableAltException(this));
+            if (hasPendingError()) {
+              recoverFromPendingError(_localctx);
+              return _localctx;
+            }
+        }
+      }
+      catch (RecognitionException &e) {
+        _errHandler->reportError(this, e);
+        _localctx->exception = std::current_exception();
+        _errHandler->recover(this, _localctx->exception);
+      }
+
+      return _localctx;
+    }
+
+    Ref<DollarContext> dollar() {
+      Ref<DollarContext> _localctx = std::make_shared<DollarContext>(_ctx, getState());
+      enterRule(_localctx, 10, TestGrammar::RuleDollar);
+
+      auto onExit = antlrcpp::finally([=] {
+        exitRule();
+      });
+      try {
+        enterOuterAlt(_localctx, 1);
+        setState(95);
+        opt();
+        setState(97);
+        match(TestGrammar::ID);
+        if (hasPendingError()) {
+          recoverFromPendingError(_localctx);
+          return _localctx;
+        }
+      }
+      catch (RecognitionException &e) {
+        _errHandler->reportError(this, e);
+        _localctx->exception = std::current_exception();
+        _errHandler->recover(this, _localctx->exception);
+      }
+
+      return _localctx;
+    }
+
+    Ref<AtContext> at() {
+      Ref<AtContext> _localctx = std::make_shared<AtContext>(_ctx, getState());
+      enterRule(_localctx, 12, TestGrammar::RuleAt);
+
+      auto onExit = antlrcpp::finally([=] {
+        exitRule();
+      });
+      try {
+        enterOuterAlt(_localctx, 1);
+        setState(99);
+        opt();
+        setState(101);
+        match(TestGrammar::NUM);
+        if (hasPendingError()) {
+          recoverFromPendingError(_localctx);
+          return _localctx;
+        }
+        setState(103);
+        match(TestGrammar::ID);
+        if (hasPendingError()) {
+          recoverFromPendingError(_localctx);
+          return _localctx;
+        }
+      }
+      catch (RecognitionException &e) {
+        _errHandler->reportError(this, e);
+        _localctx->exception = std::current_exception();
+        _errHandler->recover(this, _localctx->exception);
+      }
+
+      return _localctx;
+    }
+
+    Ref<OptContext> opt() {
+      Ref<OptContext> _localctx = std::make_shared<OptContext>(_ctx, getState());
+      enterRule(_localctx, 14, TestGrammar::RuleOpt);
+
+      auto onExit = antlrcpp::finally([=] {
+        exitRule();
+      });
+      try {
+        enterOuterAlt(_localctx, 1);
+        setState(108);
+        _errHandler->sync(this);
+        if (hasPendingError()) {
+          recoverFromPendingError(_localctx);
+          return _localctx;
+        }
+
+        switch (getInterpreter<org::antlr::v4::runtime::atn::ParserATNSimulator>()->adaptivePredict(_input, 5, _ctx)) {
+          case 1:
+            setState(105);
+            match(TestGrammar::NUM);
+            if (hasPendingError()) {
+              recoverFromPendingError(_localctx);
+              return _localctx;
+            }
+            break;
+        }
+        if (hasPendingError()) {
+          recoverFromPendingError(_localctx);
+          return _localctx;
+        }
+      }
+      catch (RecognitionException &e) {
+        _errHandler->reportError(this, e);
+        _localctx->exception = std::current_exception();
+        _errHandler->recover(this, _localctx->exception);
+      }
+
+      return _localctx;
+    }
+
+  private:
+    std::vector<org::antlr::v4::runtime::dfa::DFA> _decisionToDFA;
+    Ref<org::antlr::v4::runtime::atn::PredictionContextCache> _sharedContextCache;
+    std::vector<std::string> _tokenNames;
+  };
+
+  /// <summary>
+  /// Passes on only the default channel tokens of a lexer, for token streams which don't filter channels
+  /// themselves (like the UnbufferedTokenStream).
+  /// </summary>
+  class DefaultChannelTokenSource : public org::antlr::v4::runtime::TokenSource {
+  public:
+    DefaultChannelTokenSource(org::antlr::v4::runtime::TokenSource *source) : _source(source) {}
+
+    virtual Ref<org::antlr::v4::runtime::Token> nextToken() override {
+      while (true) {
+        Ref<org::antlr::v4::runtime::Token> token = _source->nextToken();
+        if (token->getChannel() == org::antlr::v4::runtime::Token::DEFAULT_CHANNEL) {
+          return token;
+        }
+      }
+    }
+
+    virtual size_t getLine() const override { return _source->getLine(); }
+    virtual int getCharPositionInLine() override { return _source->getCharPositionInLine(); }
+    virtual org::antlr::v4::runtime::CharStream* getInputStream() override { return _source->getInputStream(); }
+    virtual std::string getSourceName() override { return _source->getSourceName(); }
+
+    virtual Ref<org::antlr::v4::runtime::TokenFactory<org::antlr::v4::runtime::CommonToken>> getTokenFactory() override {
+      return _source->getTokenFactory();
+    }
+
+  private:
+    org::antlr::v4::runtime::TokenSource *_source;
+  };
+
+  /// <summary>
+  /// Hands out tokens of the given types (with the type name as text) and EOF at the end, for feeding a parser
+  /// token sequences which the lexer can't produce. The char position of a token is its index.
+  /// </summary>
+  class TokenTypeSource : public org::antlr::v4::runtime::TokenSource {
+  public:
+    TokenTypeSource(const std::vector<size_t> &types) : _types(types), _index(0) {}
+
+    virtual Ref<org::antlr::v4::runtime::Token> nextToken() override {
+      int type = org::antlr::v4::runtime::Token::EOF;
+      std::string text = "<EOF>";
+      if (_index < _types.size()) {
+        type = (int)_types[_index];
+        text = TestGrammar::getVocabulary()->getSymbolicName(type);
+      }
+      Ref<org::antlr::v4::runtime::Token> token = org::antlr::v4::runtime::CommonTokenFactory::DEFAULT->create({ this, nullptr },
+        type, text, org::antlr::v4::runtime::Token::DEFAULT_CHANNEL, -1, -1, 1, (int)_index);
+      if (_index < _types.size()) {
+        ++_index;
+      }
+      return token;
+    }
+
+    virtual size_t getLine() const override { return 1; }
+    virtual int getCharPositionInLine() override { return (int)_index; }
+    virtual org::antlr::v4::runtime::CharStream* getInputStream() override { return nullptr; }
+    virtual std::string getSourceName() override { return "types"; }
+
+    virtual Ref<org::antlr::v4::runtime::TokenFactory<org::antlr::v4::runtime::CommonToken>> getTokenFactory() override {
+      return org::antlr::v4::runtime::CommonTokenFactory::DEFAULT;
+    }
+
+  private:
+    std::vector<size_t> _types;
+    size_t _index;
+  };
+
+} // namespace antlrcpptest
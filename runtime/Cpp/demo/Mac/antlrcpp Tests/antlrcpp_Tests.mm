@@ -30,13 +30,273 @@
 #import <Cocoa/Cocoa.h>
 #import <XCTest/XCTest.h>
 
+#include "ANTLRInputStream.h"
+#include "CommonTokenStream.h"
 #include "ParserATNSimulator.h"
 #include "DFA.h"
 #include "ATN.h"
+#include "CommonToken.h"
+#include "InterpreterRuleContext.h"
+#include "TerminalNodeImpl.h"
+#include "ParseTreeMatch.h"
+#include "ParseTreePattern.h"
+#include "ParseTreePatternSet.h"
+#include "ParseTreePatternMatcher.h"
+#include "RuleTagToken.h"
+#include "TokenTagToken.h"
+#include "CPPUtils.h"
+#include "BasicState.h"
+#include "ATNConfig.h"
+#include "ATNConfigSet.h"
+#include "PredictionMode.h"
+#include "SemanticContext.h"
+#include "SingletonPredictionContext.h"
+#include "BasicBlockStartState.h"
+#include "DFAState.h"
+#include "DecisionState.h"
+#include "RuleStartState.h"
+#include "Transition.h"
+#include "NoViableAltException.h"
+#include "DFAMemoryBudget.h"
+#include "EpochManager.h"
+#include "DFAWarmer.h"
+#include "DecisionReport.h"
+#include "UnbufferedTokenStream.h"
+#include "XPath.h"
+#include "XPathIndex.h"
+#include "Trees.h"
+#include "BaseErrorListener.h"
+#include "BailErrorStrategy.h"
+#include "InputMismatchException.h"
+#include "CodeCompletionCore.h"
+#include "ParseInfo.h"
+#include "Exceptions.h"
+#include "LexerActionExecutor.h"
+#include "LexerChannelAction.h"
+#include "LexerCustomAction.h"
+#include "LexerIndexedCustomAction.h"
+#include "LexerInterpreter.h"
+#include "TestRig.h"
+#include "ATNDeserializer.h"
+#include "ATNDeserializationOptions.h"
+#include "LL1Analyzer.h"
+#include "EpsilonTransition.h"
+#include "PredictionDiagnostics.h"
 
+
+#include <fstream>
+
+#include "TestGrammar.h"
+
+#include <thread>
 #include <vector>
 
 using namespace org::antlr::v4::runtime;
+using namespace org::antlr::v4::runtime::atn;
+using namespace org::antlr::v4::runtime::dfa;
+using namespace org::antlr::v4::runtime::tree;
+using namespace org::antlr::v4::runtime::tree::pattern;
+using namespace org::antlr::v4::runtime::tree::xpath;
+using namespace antlrcpp;
+using namespace antlrcpptest;
+
+// Creates random parse trees with rule indexes 0..7 and token types 1..10. Pattern trees additionally contain
+// rule and token tags.
+class RandomTreeBuilder {
+public:
+  RandomTreeBuilder(unsigned int seed) : _seed(seed) {}
+
+  Ref<ParseTree> build(size_t depth, bool withTags) {
+    auto context = std::make_shared<InterpreterRuleContext>(std::weak_ptr<ParserRuleContext>(), -1, next(8));
+    size_t count = 2 + next(3);
+    for (size_t i = 0; i < count; ++i) {
+      if (depth > 0 && next(3) > 0) {
+        if (withTags && next(4) == 0) {
+          auto tag = std::make_shared<InterpreterRuleContext>(std::weak_ptr<ParserRuleContext>(), -1, next(8));
+          tag->children.push_back(std::make_shared<TerminalNodeImpl>(std::make_shared<RuleTagToken>("r", 1000)));
+          context->children.push_back(tag);
+        } else {
+          context->children.push_back(build(depth - 1, withTags));
+        }
+      } else {
+        int type = 1 + (int)next(10);
+        if (withTags && next(4) == 0) {
+          context->children.push_back(std::make_shared<TerminalNodeImpl>(std::make_shared<TokenTagToken>("T", type, "t")));
+        } else {
+          context->children.push_back(std::make_shared<TerminalNodeImpl>(std::make_shared<CommonToken>(type,
+            std::to_string(type))));
+        }
+      }
+    }
+    return context;
+  }
+
+private:
+  unsigned int _seed;
+
+  size_t next(size_t limit) {
+    _seed = _seed * 1103515245 + 12345;
+    return (_seed >> 16) % limit;
+  }
+};
+
+// Adds a state with the given number of configs to the DFA, as the simulators do. Each state gets other alts,
+// as states with equal configs are merged.
+static DFAState* addState(DFA &dfa, BasicState *state, size_t configCount) {
+  static int nextAlt = 1;
+  auto configs = std::make_shared<ATNConfigSet>();
+  for (size_t i = 0; i < configCount; ++i) {
+    configs->add(std::make_shared<ATNConfig>(state, nextAlt++, PredictionContext::EMPTY));
+  }
+  DFAState *result = new DFAState(configs);
+  std::lock_guard<std::recursive_mutex> lock(dfa.getLock());
+  result->stateNumber = (int)dfa.states.size();
+  dfa.states[result] = result;
+  dfa.addMemoryUsage(result->getMemoryUsage());
+  return result;
+}
+
+// The DFA of the decision in the rule "list" of the test grammar.
+static DFA& getListDFA(ParserInterpreter &parser) {
+  ATNState *block = parser.getATN().ruleToStartState[TestGrammar::RuleList]->transition(0)->target;
+  return parser.getInterpreter<ParserATNSimulator>()->decisionToDFA[(size_t)static_cast<DecisionState *>(block)->decision];
+}
+
+// Predicts the alternative of the rule "list" for the given token types and returns the number of states in the DFA.
+static size_t predictList(ParserInterpreter &parser, const std::vector<size_t> &types) {
+  TokenTypeSource source(types);
+  CommonTokenStream tokens(&source);
+  tokens.fill();
+  parser.setTokenStream(&tokens);
+  DFA &dfa = getListDFA(parser);
+  try {
+    parser.getInterpreter<ParserATNSimulator>()->adaptivePredict(&tokens, dfa.decision, nullptr);
+  } catch (NoViableAltException &) {
+  }
+
+  std::lock_guard<std::recursive_mutex> lock(dfa.getLock());
+  return dfa.states.size();
+}
+
+// Describes the nodes found by the path as "<node text>@<start token index>", once evaluated directly and once with an
+// index (which must give the same result).
+static std::vector<std::string> findAll(Ref<ParseTree> tree, const std::string &path, Parser *parser) {
+  auto describe = [parser](const std::vector<Ref<ParseTree>> &nodes) {
+    std::vector<std::string> result;
+    for (auto &node : nodes) {
+      result.push_back(Trees::getNodeText(node, parser) + "@" + std::to_string(node->getSourceInterval().a));
+    }
+    return result;
+  };
+
+  XPath xpath(parser, path);
+  std::vector<std::string> result = describe(xpath.evaluate(tree));
+  XCTAssert(describe(xpath.evaluate(tree, XPathIndex(tree))) == result);
+
+  return result;
+}
+
+// Records the syntax errors reported to it as "<line>:<column> <message>".
+class ErrorCollector : public BaseErrorListener {
+public:
+  std::vector<std::string> errors;
+
+  virtual void syntaxError(IRecognizer * /*recognizer*/, Ref<Token> /*offendingSymbol*/, size_t line,
+    int charPositionInLine, const std::string &msg, std::exception_ptr /*e*/) override {
+    errors.push_back(std::to_string(line) + ":" + std::to_string(charPositionInLine) + " " + msg);
+  }
+};
+
+// Parses the input with the generated style parser (or the interpreter) and returns the resulting tree followed by the
+// reported errors and the syntax error count, one per line.
+static std::string parseWithErrors(const std::string &text, bool interpreted, bool exceptionFree) {
+  ANTLRInputStream input(text);
+  auto lexer = TestGrammar::createLexer(&input);
+  lexer->setExceptionFreeErrorHandling(exceptionFree);
+  CommonTokenStream tokens(lexer.get());
+
+  Ref<Parser> parser;
+  if (interpreted) {
+    parser = TestGrammar::createParser(&tokens);
+  } else {
+    parser = std::make_shared<TestParser>(&tokens);
+  }
+  parser->setExceptionFreeErrorHandling(exceptionFree);
+
+  ErrorCollector collector;
+  lexer->removeErrorListeners();
+  lexer->addErrorListener(&collector);
+  parser->removeErrorListeners();
+  parser->addErrorListener(&collector);
+
+  Ref<ParserRuleContext> tree;
+  if (interpreted) {
+    tree = std::static_pointer_cast<ParserInterpreter>(parser)->parse(TestGrammar::RuleProg);
+  } else {
+    tree = std::static_pointer_cast<TestParser>(parser)->prog();
+  }
+  XCTAssertFalse(parser->hasPendingError());
+
+  std::string result = tree->toStringTree(parser.get());
+  for (auto &error : collector.errors) {
+    result += "\n" + error;
+  }
+  return result + "\n" + std::to_string(parser->getNumberOfSyntaxErrors());
+}
+
+// Lists the candidate tokens (by name, with their following tokens in parentheses) and rules (with their rule stack).
+static std::string describeCandidates(const CodeCompletionCore::CandidatesCollection &candidates) {
+  Ref<dfa::Vocabulary> vocabulary = TestGrammar::getVocabulary();
+  const std::vector<std::string> &ruleNames = TestGrammar::getParserRuleNames();
+
+  std::string result;
+  for (auto &candidate : candidates.tokens) {
+    if (!result.empty()) {
+      result += " ";
+    }
+    result += candidate.first == Token::EOF ? "EOF" : vocabulary->getSymbolicName(candidate.first);
+    if (!candidate.second.empty()) {
+      std::string following;
+      for (ssize_t type : candidate.second) {
+        following += (following.empty() ? "" : " ") + vocabulary->getSymbolicName(type);
+      }
+      result += "(" + following + ")";
+    }
+  }
+  for (auto &candidate : candidates.rules) {
+    std::string stack;
+    for (size_t rule : candidate.second) {
+      stack += ruleNames[rule] + ">";
+    }
+    result += (result.empty() ? "" : " ") + stack + ruleNames[candidate.first];
+  }
+  return result;
+}
+
+// Records the input position at which each custom action is executed.
+class ActionRecordingLexer : public LexerInterpreter {
+public:
+  std::vector<std::string> actions;
+
+  ActionRecordingLexer(CharStream *input)
+    : LexerInterpreter("TestLexer.g4", TestGrammar::getVocabulary(), TestGrammar::getLexerRuleNames(),
+                       TestGrammar::getModeNames(), TestGrammar::getLexerATN(), input) {
+  }
+
+  virtual void action(Ref<RuleContext> /*localctx*/, int ruleIndex, int actionIndex) override {
+    actions.push_back(std::to_string(ruleIndex) + "." + std::to_string(actionIndex) + "@" +
+      std::to_string(getInputStream()->index()));
+  }
+};
+
+static void collectNodes(Ref<ParseTree> tree, std::vector<Ref<ParseTree>> &nodes) {
+  nodes.push_back(tree);
+  if (is<ParserRuleContext>(tree)) {
+    for (auto &child : std::static_pointer_cast<ParserRuleContext>(tree)->children) {
+      collectNodes(child, nodes);
+    }
+  }
+}
 
 @interface antlrcpp_Tests : XCTestCase
 
@@ -68,4 +328,1390 @@ using namespace org::antlr::v4::runtime;
     XCTAssert(YES, @"Pass");
 }
 
+// N patterns x M nodes, once with a pattern set (a single tree walk) and once testing each pattern on each node.
+- (void)testPatternSetPerformance {
+  RandomTreeBuilder builder(42);
+  Ref<ParseTree> tree = builder.build(14, false);
+  std::vector<Ref<ParseTree>> nodes;
+  collectNodes(tree, nodes);
+
+  ParseTreePatternSet set(nullptr);
+  std::vector<ParseTreePattern> patterns;
+  for (size_t i = 0; i < 500; ++i) {
+    Ref<ParseTree> patternTree = builder.build(2, true);
+    ParseTreePattern pattern(nullptr, "", (int)std::static_pointer_cast<ParserRuleContext>(patternTree)->getRuleIndex(),
+                             patternTree);
+    patterns.push_back(pattern);
+    set.add(pattern);
+  }
+
+  size_t expected = 0;
+  for (auto &node : nodes) {
+    for (auto &pattern : patterns) {
+      if (pattern.matches(node)) {
+        ++expected;
+      }
+    }
+  }
+  NSLog(@"%lu nodes, %lu patterns, %lu matches", nodes.size(), patterns.size(), expected);
+  XCTAssertEqual(set.findAll(tree).size(), expected);
+
+  ParseTreePatternSet *patternSet = &set; // Blocks copy captured C++ objects.
+  [self measureBlock: ^{
+    patternSet->findAll(tree);
+  }];
+}
+
+- (void)testSinglePatternPerformance {
+  RandomTreeBuilder builder(42);
+  Ref<ParseTree> tree = builder.build(14, false);
+  std::vector<Ref<ParseTree>> nodes;
+  collectNodes(tree, nodes);
+
+  std::vector<ParseTreePattern> patterns;
+  for (size_t i = 0; i < 500; ++i) {
+    Ref<ParseTree> patternTree = builder.build(2, true);
+    patterns.push_back(ParseTreePattern(nullptr, "",
+      (int)std::static_pointer_cast<ParserRuleContext>(patternTree)->getRuleIndex(), patternTree));
+  }
+
+  std::vector<ParseTreePattern> *patternList = &patterns; // Blocks copy captured C++ objects.
+  [self measureBlock: ^{
+    for (auto &node : nodes) {
+      for (auto &pattern : *patternList) {
+        pattern.matches(node);
+      }
+    }
+  }];
+}
+
+- (void)testConflictAnalysis {
+  std::vector<Ref<BasicState>> states;
+  for (int i = 0; i < 5; ++i) {
+    states.push_back(std::make_shared<BasicState>());
+    states.back()->stateNumber = i;
+  }
+
+  // Contexts 0 - 3 are distinct objects, but equal in pairs, which must not make a difference.
+  std::vector<Ref<PredictionContext>> contexts;
+  for (int i = 0; i < 8; ++i) {
+    contexts.push_back(SingletonPredictionContext::create(PredictionContext::EMPTY, 100 + (i < 4 ? i / 2 : i)));
+  }
+
+  // Compare with the alt subsets built pairwise from the configs.
+  unsigned int seed = 7;
+  auto next = [&seed](size_t limit) {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 16) % limit;
+  };
+  ConflictAnalysis analysis;
+  for (size_t round = 0; round < 500; ++round) {
+    auto configs = std::make_shared<ATNConfigSet>(false);
+    size_t count = 1 + next(12);
+    for (size_t i = 0; i < count; ++i) {
+      configs->add(std::make_shared<ATNConfig>(states[next(3)].get(), 1 + (int)next(4), contexts[next(6)]));
+    }
+
+    std::vector<std::pair<ATNConfig *, antlrcpp::BitSet>> expected;
+    for (auto &config : configs->configs) {
+      auto iterator = std::find_if(expected.begin(), expected.end(), [&config](const std::pair<ATNConfig *, antlrcpp::BitSet> &entry) {
+        return entry.first->state == config->state && *entry.first->context == *config->context;
+      });
+      if (iterator == expected.end()) {
+        expected.push_back({ config.get(), antlrcpp::BitSet() });
+        iterator = expected.end() - 1;
+      }
+      iterator->second.set((size_t)config->alt);
+    }
+    std::vector<antlrcpp::BitSet> expectedSubsets;
+    for (auto &entry : expected) {
+      expectedSubsets.push_back(entry.second);
+    }
+
+    analysis.compute(*configs);
+    std::vector<antlrcpp::BitSet> subsets = analysis.getAltSubsets();
+    XCTAssertEqual(subsets.size(), expectedSubsets.size());
+    for (auto &subset : expectedSubsets) {
+      XCTAssert(std::find(subsets.begin(), subsets.end(), subset) != subsets.end());
+    }
+    XCTAssertEqual(analysis.getSubsetCount(), subsets.size());
+    XCTAssertEqual(analysis.hasConflictingAltSet(), PredictionModeClass::hasConflictingAltSet(expectedSubsets));
+    XCTAssertEqual(analysis.hasNonConflictingAltSet(), PredictionModeClass::hasNonConflictingAltSet(expectedSubsets));
+    XCTAssertEqual(analysis.allSubsetsConflict(), PredictionModeClass::allSubsetsConflict(expectedSubsets));
+    XCTAssertEqual(analysis.allSubsetsEqual(), PredictionModeClass::allSubsetsEqual(expectedSubsets));
+    XCTAssertEqual(analysis.getSingleViableAlt(), PredictionModeClass::getSingleViableAlt(expectedSubsets));
+    XCTAssertEqual(analysis.getUniqueAlt(), PredictionModeClass::getUniqueAlt(expectedSubsets));
+    XCTAssert(analysis.getAlts() == PredictionModeClass::getAlts(expectedSubsets));
+
+    bool stateWithOneAlt = false;
+    for (auto &entry : PredictionModeClass::getStateToAltMap(configs)) {
+      if (entry.second.count() == 1)
+        stateWithOneAlt = true;
+    }
+    XCTAssertEqual(analysis.hasStateAssociatedWithOneAlt(), stateWithOneAlt);
+  }
+
+  // Configs which differ only in their semantic context. With the predicates alt 1 conflicts with alt 2 in
+  // (s, x), while stripping them in SLL mode merges (s, 1, x) and (s, 1, y) into (s, 1, x + y), leaving no conflict.
+  auto predicated = std::make_shared<ATNConfigSet>(false);
+  predicated->add(std::make_shared<ATNConfig>(states[0].get(), 1, contexts[4], std::make_shared<SemanticContext::Predicate>(0, 0, false)));
+  predicated->add(std::make_shared<ATNConfig>(states[0].get(), 1, contexts[5], std::make_shared<SemanticContext::Predicate>(0, 1, false)));
+  predicated->add(std::make_shared<ATNConfig>(states[0].get(), 2, contexts[4]));
+  XCTAssert(predicated->hasSemanticContext);
+  XCTAssertEqual(predicated->size(), 3U);
+
+  XCTAssert(PredictionModeClass::hasSLLConflictTerminatingPrediction(PredictionMode::LL, predicated));
+  XCTAssert(!PredictionModeClass::hasSLLConflictTerminatingPrediction(PredictionMode::SLL, predicated));
+  XCTAssert(!PredictionModeClass::hasSLLConflictTerminatingPrediction(PredictionMode::SLL, predicated.get(), analysis));
+  XCTAssertEqual(analysis.getSubsetCount(), 2U);
+  XCTAssert(!analysis.hasConflictingAltSet());
+  XCTAssert(analysis.getAlts() == PredictionModeClass::getAlts(predicated));
+
+  // Once alt 2 is viable in both contexts too, both modes find the conflict.
+  predicated->add(std::make_shared<ATNConfig>(states[0].get(), 2, contexts[5], std::make_shared<SemanticContext::Predicate>(0, 2, false)));
+  XCTAssertEqual(predicated->size(), 4U);
+  XCTAssert(PredictionModeClass::hasSLLConflictTerminatingPrediction(PredictionMode::LL, predicated));
+  XCTAssert(PredictionModeClass::hasSLLConflictTerminatingPrediction(PredictionMode::SLL, predicated));
+}
+
+- (void)testDFAMemoryBudget {
+  BasicState state;
+  std::vector<Ref<BasicBlockStartState>> decisionStates;
+  std::vector<DFA> decisionToDFA;
+  for (int i = 0; i < 3; ++i) {
+    decisionStates.push_back(std::make_shared<BasicBlockStartState>());
+    decisionToDFA.push_back(DFA(decisionStates.back().get(), i));
+  }
+
+  // Decision 0 gets the largest DFA, decision 2 none.
+  for (size_t i = 0; i < 4; ++i) {
+    addState(decisionToDFA[0], &state, 8);
+  }
+  addState(decisionToDFA[1], &state, 2);
+  addState(decisionToDFA[1], &state, 2);
+
+  size_t usage0 = decisionToDFA[0].getMemoryUsage();
+  size_t usage1 = decisionToDFA[1].getMemoryUsage();
+  XCTAssert(usage0 > usage1);
+  XCTAssert(usage1 > 0);
+  XCTAssertEqual(decisionToDFA[2].getMemoryUsage(), 0U);
+
+  DFAMemoryBudget budget(decisionToDFA, usage0 + usage1);
+  XCTAssertEqual(budget.getMemoryUsage(), usage0 + usage1);
+  std::vector<size_t> perDecision = budget.getMemoryUsagePerDecision();
+  XCTAssertEqual(perDecision.size(), 3U);
+  XCTAssertEqual(perDecision[0], usage0);
+  XCTAssertEqual(perDecision[1], usage1);
+
+  // Within the limit nothing happens.
+  XCTAssertEqual(budget.enforce(), 0U);
+  XCTAssertEqual(budget.getPeakMemoryUsage(), usage0 + usage1);
+  XCTAssertEqual(decisionToDFA[0].states.size(), 4U);
+
+  // Over the limit the largest DFA goes first, which is enough to get below the low water mark here.
+  DFAState *state1 = addState(decisionToDFA[1], &state, 2);
+  size_t usage = budget.getMemoryUsage();
+  XCTAssertEqual(budget.enforce(), 1U);
+  XCTAssertEqual(budget.getPeakMemoryUsage(), usage);
+  XCTAssertEqual(budget.getEvictions(), 1U);
+  XCTAssertEqual(budget.getEvictedStates(), 4U);
+  XCTAssertEqual(budget.getEvictedBytes(), usage0);
+  XCTAssertEqual(decisionToDFA[0].states.size(), 0U);
+  XCTAssert(decisionToDFA[0].s0 == nullptr);
+  XCTAssertEqual(decisionToDFA[0].getMemoryUsage(), 0U);
+  XCTAssertEqual(decisionToDFA[1].states.size(), 3U);
+  XCTAssert(decisionToDFA[1].states.find(state1) != decisionToDFA[1].states.end());
+
+  // A lower limit evicts everything. Empty DFAs are left alone.
+  budget.setLimit(1);
+  XCTAssertEqual(budget.getLimit(), 1U);
+  XCTAssertEqual(budget.enforce(), 1U);
+  XCTAssertEqual(budget.getMemoryUsage(), 0U);
+  XCTAssertEqual(budget.getEvictions(), 2U);
+  XCTAssertEqual(budget.getEvictedStates(), 7U);
+  XCTAssertEqual(budget.enforce(), 0U);
+
+  // The context cache counts too and is emptied on eviction.
+  auto contextCache = std::make_shared<PredictionContextCache>();
+  XCTAssertEqual(contextCache->getMemoryUsage(), 0U);
+  std::vector<Ref<PredictionContext>> contexts;
+  for (size_t i = 0; i < 10; ++i) {
+    contexts.push_back(SingletonPredictionContext::create(PredictionContext::EMPTY, 100 + i));
+    contextCache->add(contexts.back());
+  }
+  size_t cacheUsage = contextCache->getMemoryUsage();
+  XCTAssert(cacheUsage > 0);
+  contextCache->add(SingletonPredictionContext::create(PredictionContext::EMPTY, 100)); // Already cached.
+  XCTAssertEqual(contextCache->size(), 10U);
+  XCTAssertEqual(contextCache->getMemoryUsage(), cacheUsage);
+
+  addState(decisionToDFA[2], &state, 4);
+  usage = decisionToDFA[2].getMemoryUsage();
+  DFAMemoryBudget cacheBudget(decisionToDFA, usage + cacheUsage, 0, contextCache);
+  XCTAssertEqual(cacheBudget.getMemoryUsage(), usage + cacheUsage);
+  XCTAssertEqual(cacheBudget.getMemoryUsagePerDecision()[2], usage);
+  XCTAssertEqual(cacheBudget.enforce(), 0U);
+
+  contextCache->add(SingletonPredictionContext::create(PredictionContext::EMPTY, 200));
+  XCTAssertEqual(cacheBudget.enforce(), 1U);
+  XCTAssertEqual(contextCache->size(), 0U);
+  XCTAssertEqual(contextCache->getMemoryUsage(), 0U);
+  XCTAssertEqual(cacheBudget.getMemoryUsage(), 0U);
+  XCTAssertEqual(cacheBudget.getEvictedStates(), 1U);
+  XCTAssert(cacheBudget.getEvictedBytes() > usage + cacheUsage);
+  XCTAssert(contexts[0]->getReturnState(0) == 100U); // Still valid, the cache didn't own them.
+
+  // The cleared states are freed once no prediction can use them anymore.
+  misc::EpochManager::getDefault().collect();
+}
+
+- (void)testEdgeTable {
+  std::vector<DFAState *> targets;
+  for (int i = 0; i < 300; ++i) {
+    targets.push_back(new DFAState(i));
+  }
+
+  EdgeTable table;
+  XCTAssert(table.empty());
+  XCTAssertEqual(table.count(), 0U);
+  XCTAssert(table.get(0) == nullptr);
+
+  XCTAssertEqual(table.resize(10), 10 * sizeof(std::atomic<DFAState *>));
+  XCTAssertEqual(table.size(), 10U);
+  XCTAssertEqual(table.resize(5), 0U); // Tables never shrink.
+  XCTAssertEqual(table.size(), 10U);
+  for (size_t i = 0; i < 10; ++i) {
+    XCTAssert(table[i] == nullptr);
+  }
+  XCTAssert(table.get(10) == nullptr);
+
+  table.set(3, targets[3]);
+  table.set(9, targets[9]);
+  table.set(9, targets[9]);
+  table.set(0, nullptr);
+  XCTAssert(table.get(3) == targets[3]);
+  XCTAssert(table[9] == targets[9]);
+  XCTAssertEqual(table.count(), 2U);
+
+  // Growing keeps the existing edges.
+  XCTAssertEqual(table.resize(100), 90 * sizeof(std::atomic<DFAState *>));
+  XCTAssertEqual(table.size(), 100U);
+  XCTAssert(table.get(3) == targets[3]);
+  XCTAssert(table.get(9) == targets[9]);
+  XCTAssert(table.get(50) == nullptr);
+  XCTAssertEqual(table.count(), 2U);
+
+  // Readers see either no edge or the right one while the table grows. The writer is the only thread
+  // changing the table, which the DFA lock ensures otherwise.
+  EdgeTable shared;
+  std::atomic<bool> stop(false);
+  std::atomic<size_t> errors(0);
+  std::vector<std::thread> readers;
+  for (size_t i = 0; i < 3; ++i) {
+    readers.emplace_back([&shared, &targets, &stop, &errors]() {
+      misc::EpochManager::Participant participant;
+      while (!stop) {
+        misc::EpochManager::Guard guard(participant);
+        size_t size = shared.size();
+        for (size_t j = 0; j < size; ++j) {
+          DFAState *target = shared.get(j);
+          if (target != nullptr && target != targets[j]) {
+            ++errors;
+          }
+        }
+        if (shared.get(size + 1000) != nullptr) {
+          ++errors;
+        }
+      }
+    });
+  }
+
+  for (size_t size = 1; size <= targets.size(); ++size) {
+    shared.resize(size);
+    shared.set(size - 1, targets[size - 1]);
+    if (size % 10 == 0) {
+      std::this_thread::yield();
+    }
+  }
+  stop = true;
+  for (auto &thread : readers) {
+    thread.join();
+  }
+
+  XCTAssertEqual(errors.load(), 0U);
+  XCTAssertEqual(shared.size(), targets.size());
+  XCTAssertEqual(shared.count(), targets.size());
+  for (size_t i = 0; i < targets.size(); ++i) {
+    XCTAssert(shared[i] == targets[i]);
+  }
+
+  // The replaced tables are freed by the epoch manager.
+  misc::EpochManager::getDefault().collect();
+  for (auto target : targets) {
+    delete target;
+  }
+}
+
+- (void)testDFAWarmer {
+  auto createWarmer = []() {
+    auto warmer = std::make_shared<DFAWarmer>([](CharStream *input) { return TestGrammar::createLexer(input); },
+      [](TokenStream *input) { return TestGrammar::createParser(input); }, "prog");
+    warmer->addInput("x = 1 + 2 * (ab); k foo; \"s\"; $ 1 y; $ y; @ 34 abc; @ 2 3 z;");
+    warmer->addInput("a = (b + c) * d; /* comment */ e;");
+    warmer->addInput("a = ;"); // A syntax error.
+    return warmer;
+  };
+
+  auto warmer = createWarmer();
+  DFAWarmer::Coverage coverage = warmer->run();
+  XCTAssert(warmer->isReady());
+  XCTAssertEqual(coverage.inputs, 3U);
+  XCTAssertEqual(coverage.failedInputs, 1U);
+  XCTAssertEqual(coverage.passes, 2U);
+  XCTAssertEqual(coverage.parserDecisions.size(), TestGrammar::getParserATN().decisionToState.size());
+  XCTAssert(coverage.getStates() > 0);
+  XCTAssertEqual(warmer->getCoverage().getStates(), coverage.getStates());
+
+  // A warmer runs only once at a time. The ready callback keeps the background run from finishing.
+  warmer = createWarmer();
+  std::atomic<bool> inCallback(false);
+  std::atomic<bool> release(false);
+  warmer->setReadyCallback([&](const DFAWarmer::Coverage &) {
+    inCallback = true;
+    while (!release) {
+      std::this_thread::yield();
+    }
+    throw IllegalStateException("ignored for background runs");
+  });
+  warmer->start();
+  while (!inCallback) {
+    std::this_thread::yield();
+  }
+  XCTAssertFalse(warmer->isReady());
+  try {
+    warmer->run();
+    XCTFail(@"run() must not work while the warmer is running");
+  } catch (IllegalStateException &) {
+  }
+  try {
+    warmer->start();
+    XCTFail(@"start() must not work while the warmer is running");
+  } catch (IllegalStateException &) {
+  }
+  release = true;
+  warmer->wait();
+  XCTAssert(warmer->isReady());
+  XCTAssertEqual(warmer->getCoverage().inputs, 3U);
+
+  // run() passes exceptions from the callback on.
+  warmer = createWarmer();
+  warmer->setReadyCallback([](const DFAWarmer::Coverage &) { throw IllegalStateException("callback"); });
+  try {
+    warmer->run();
+    XCTFail(@"The callback exception must be passed on");
+  } catch (IllegalStateException &e) {
+    XCTAssertEqual(std::string(e.what()), "callback");
+  }
+  XCTAssert(warmer->isReady());
+
+  // The coverage can be read while other threads parse with and clear the DFAs.
+  ANTLRInputStream input("x = 1 + 2 * (ab); k foo; @ 34 abc; @ 2 3 z;");
+  auto lexer = TestGrammar::createLexer(&input);
+  CommonTokenStream tokens(lexer.get());
+  auto parser = TestGrammar::createParser(&tokens);
+  std::vector<DFA> &decisionToDFA = parser->getInterpreter<ParserATNSimulator>()->decisionToDFA;
+  std::atomic<bool> stop(false);
+  std::thread parsing([&]() {
+    while (!stop) {
+      input.reset();
+      lexer->setInputStream(&input);
+      tokens.setTokenSource(lexer.get());
+      parser->setTokenStream(&tokens);
+      parser->parse(TestGrammar::RuleProg);
+      for (auto &dfa : decisionToDFA) {
+        dfa.clear();
+      }
+    }
+  });
+  for (size_t i = 0; i < 200; ++i) {
+    for (auto &decision : DFAWarmer::getCoverage(decisionToDFA)) {
+      XCTAssert(!decision.hasStartState || decision.states > 0);
+    }
+  }
+  stop = true;
+  parsing.join();
+  misc::EpochManager::getDefault().collect();
+}
+
+- (void)testDecisionReport {
+  // The report keeps the example spans, so it works for unbuffered streams and after the stream is gone.
+  std::unique_ptr<DecisionReport> report;
+  {
+    ANTLRInputStream input("x = 1 + 2 * (ab);\n@ 34 abc;\n  @ 2 3 z; $ 1 y;\n@ 1 ;");
+    auto lexer = TestGrammar::createLexer(&input);
+    DefaultChannelTokenSource source(lexer.get());
+    UnbufferedTokenStream tokens(&source);
+    auto parser = TestGrammar::createParser(&tokens);
+    parser->removeErrorListeners();
+    parser->setProfile(true);
+    parser->parse(TestGrammar::RuleProg);
+    XCTAssertEqual(parser->getNumberOfSyntaxErrors(), 1U);
+    report.reset(new DecisionReport(parser.get(), 5));
+  }
+
+  const std::vector<DecisionReport::Entry> &entries = report->getEntries();
+  XCTAssertFalse(entries.empty());
+  std::vector<std::string> examples;
+  for (auto &entry : entries) {
+    XCTAssert(entry.invocations > 0);
+    XCTAssert(entry.examples.size() <= 5);
+    examples.insert(examples.end(), entry.examples.begin(), entry.examples.end());
+  }
+
+  // "@ 34 abc" needs the full input of the stat to decide whether opt matches 34.
+  auto contains = [&examples](const std::string &text) {
+    for (auto &example : examples) {
+      if (example.find(text) != std::string::npos) {
+        return true;
+      }
+    }
+    return false;
+  };
+  XCTAssert(contains("max LL lookahead at 2:2 (2 tokens) \"34abc\""));
+  XCTAssert(contains("context sensitivity at 2:2 (2 tokens) \"34abc\""));
+  XCTAssert(contains("error at 4:2"));
+  XCTAssert(report->toString().find("opt, block with 2 alternatives") != std::string::npos);
+}
+
+- (void)testDFAStateDeduplication {
+  TokenTypeSource dummy({});
+  CommonTokenStream dummyTokens(&dummy);
+  auto parser = TestGrammar::createParser(&dummyTokens);
+
+  // Predict all token types at the start and after the first ID (errors included), so that the edges of both
+  // states are complete and their configs get released.
+  predictList(*parser, {});
+  for (size_t type = TestGrammar::KW; type <= TestGrammar::WS; ++type) {
+    predictList(*parser, { type });
+  }
+  for (size_t type = TestGrammar::KW; type <= TestGrammar::WS; ++type) {
+    if (type != TestGrammar::PLUS) {
+      predictList(*parser, { TestGrammar::ID, type });
+    }
+  }
+  size_t states = predictList(*parser, { TestGrammar::ID });
+
+  // After "ID '+'" the decision is in the same configuration as at the start. The states with the released
+  // configs must still be found, so the DFA loops instead of growing with the length of the list.
+  XCTAssertEqual(predictList(*parser, { TestGrammar::ID, TestGrammar::PLUS, TestGrammar::ID, TestGrammar::EQ }), states);
+  XCTAssertEqual(predictList(*parser, { TestGrammar::ID, TestGrammar::PLUS, TestGrammar::ID, TestGrammar::EQ }), states);
+  XCTAssertEqual(predictList(*parser, { TestGrammar::ID, TestGrammar::PLUS, TestGrammar::ID, TestGrammar::PLUS,
+    TestGrammar::ID, TestGrammar::PLUS, TestGrammar::ID, TestGrammar::SEMI }), states);
+
+  size_t frozenEdges = 0;
+  for (auto state : getListDFA(*parser).getStates()) {
+    if (state->hasFrozenEdges()) {
+      ++frozenEdges;
+    }
+  }
+  XCTAssertEqual(frozenEdges, 2U);
+}
+
+- (void)testSemanticContextInterning {
+  typedef SemanticContext::Predicate Predicate;
+
+  XCTAssert(SemanticContext::intern(std::make_shared<Predicate>(-1, -1, false)).get() == SemanticContext::NONE.get());
+
+  Ref<SemanticContext> a = SemanticContext::intern(std::make_shared<Predicate>(1000, 1, false));
+  Ref<SemanticContext> b = SemanticContext::intern(std::make_shared<Predicate>(1000, 2, false));
+  XCTAssert(SemanticContext::intern(std::make_shared<Predicate>(1000, 1, false)).get() == a.get());
+  XCTAssert(a.get() != b.get());
+
+  Ref<SemanticContext> andResult = SemanticContext::And(a, b);
+  Ref<SemanticContext> orResult = SemanticContext::Or(a, b);
+  XCTAssert(SemanticContext::And(a, b).get() == andResult.get());
+  XCTAssert(SemanticContext::Or(a, b).get() == orResult.get());
+  XCTAssert(SemanticContext::And(a, SemanticContext::NONE).get() == a.get());
+  XCTAssert(SemanticContext::Or(a, SemanticContext::NONE).get() == SemanticContext::NONE.get());
+
+  // Contexts which nobody else uses don't pile up, nor do the combinations.
+  size_t initialSize = SemanticContext::getInternTableSize();
+  for (int i = 0; i < 300000; ++i) {
+    Ref<SemanticContext> p = SemanticContext::intern(std::make_shared<Predicate>(2000, i, false));
+    SemanticContext::And(p, a);
+  }
+  XCTAssert(SemanticContext::getInternTableSize() < initialSize + 200000);
+  SemanticContext::purgeInternTable();
+  XCTAssert(SemanticContext::getInternTableSize() <= initialSize);
+
+  // Contexts still in use are kept, so they stay the canonical instances. This includes combinations, which are
+  // computed again, but end up with the same instance.
+  XCTAssert(SemanticContext::intern(std::make_shared<Predicate>(1000, 1, false)).get() == a.get());
+  XCTAssert(SemanticContext::intern(std::make_shared<Predicate>(-1, -1, false)).get() == SemanticContext::NONE.get());
+  XCTAssert(SemanticContext::And(a, b).get() == andResult.get());
+  XCTAssert(SemanticContext::Or(a, b).get() == orResult.get());
+
+  std::weak_ptr<SemanticContext> unused = SemanticContext::intern(std::make_shared<Predicate>(1000, 3, false));
+  XCTAssertFalse(unused.expired());
+  SemanticContext::purgeInternTable();
+  XCTAssert(unused.expired());
+}
+
+- (void)testXPath {
+  ANTLRInputStream input("x = 1 + 2 * (ab); k foo; \"s\";");
+  auto lexer = TestGrammar::createLexer(&input);
+  CommonTokenStream tokens(lexer.get());
+  auto parser = TestGrammar::createParser(&tokens);
+  Ref<ParseTree> tree = parser->parse(TestGrammar::RuleProg);
+  XCTAssertEqual(parser->getNumberOfSyntaxErrors(), 0U);
+
+  typedef std::vector<std::string> Nodes;
+
+  // Nodes are described by their start token index, which counts the hidden whitespace tokens too.
+
+  // Root and child steps.
+  XCTAssert(findAll(tree, "/prog", parser.get()) == Nodes({ "prog@0" }));
+  XCTAssert(findAll(tree, "/stat", parser.get()).empty());
+  XCTAssert(findAll(tree, "/prog/stat", parser.get()) == Nodes({ "stat@0", "stat@17", "stat@22" }));
+  XCTAssert(findAll(tree, "/prog/stat/ID", parser.get()) == Nodes({ "x@0", "foo@19" }));
+  XCTAssert(findAll(tree, "/prog/stat/expr/term", parser.get()) == Nodes({ "term@4", "term@8", "term@22" }));
+
+  // Anywhere steps, token and rule names, literals.
+  XCTAssert(findAll(tree, "//ID", parser.get()) == Nodes({ "x@0", "ab@13", "foo@19" }));
+  XCTAssert(findAll(tree, "//atom", parser.get()) == Nodes({ "atom@4", "atom@8", "atom@12", "atom@13", "atom@22" }));
+  XCTAssert(findAll(tree, "//expr//atom", parser.get()) == findAll(tree, "//atom", parser.get()));
+  XCTAssert(findAll(tree, "//atom/expr", parser.get()) == Nodes({ "expr@13" }));
+  XCTAssert(findAll(tree, "//'='", parser.get()) == Nodes({ "=@2" }));
+  XCTAssert(findAll(tree, "//STRING", parser.get()) == Nodes({ "\"s\"@22" }));
+  XCTAssert(findAll(tree, "//KW", parser.get()) == Nodes({ "k@17" }));
+  XCTAssert(findAll(tree, "//dollar", parser.get()).empty());
+
+  // Wildcards.
+  XCTAssert(findAll(tree, "/prog/*", parser.get()) == Nodes({ "stat@0", "stat@17", "stat@22", "<EOF>@24" }));
+  XCTAssert(findAll(tree, "/prog/stat/*", parser.get()) == Nodes({ "x@0", "=@2", "expr@4", ";@15", "k@17", "foo@19",
+    ";@20", "expr@22", ";@23" }));
+  XCTAssertEqual(findAll(tree, "//*", parser.get()).size(), 32U);
+
+  // Inversion only selects rule nodes (or only tokens, for an inverted token name).
+  XCTAssert(findAll(tree, "/prog/!stat", parser.get()).empty());
+  XCTAssert(findAll(tree, "/prog/stat/!expr", parser.get()).empty());
+  XCTAssert(findAll(tree, "/prog/stat/!ID", parser.get()) == Nodes({ "=@2", ";@15", "k@17", ";@20", ";@23" }));
+  XCTAssertEqual(findAll(tree, "//!atom", parser.get()).size(), 11U);
+
+  // Invalid paths.
+  for (auto path : { "//unknown", "//UNKNOWN", "/prog/", "//", "/!", "/prog#", "//'unterminated", "/prog//!" }) {
+    try {
+      XPath(parser.get(), path);
+      XCTFail(@"Invalid path accepted");
+    } catch (IllegalArgumentException &) {
+    }
+  }
+
+  // The index is for a single tree.
+  XPathIndex index(tree);
+  try {
+    XPath(parser.get(), "//ID").evaluate(std::make_shared<ParserRuleContext>(), index);
+    XCTFail(@"Node outside the index accepted");
+  } catch (IllegalArgumentException &) {
+  }
+}
+
+- (void)testExceptionFreeErrorHandling {
+  // Each kind of error: missing and extra tokens (single token recovery), a failed match which needs resync,
+  // no viable alternatives in adaptivePredict and in an LL(1) decision, a lexer error and a premature EOF.
+  std::vector<std::string> inputs = {
+    "x = 1 + 2; k foo; \"s\";",
+    "x = 1 + ; y = 2;",
+    "x = 1 2; y = 3;",
+    "x = (1 + 2; k k k; z;",
+    "x = 1 ) ; @ 34 abc ; $ 5 ;",
+    "x = 1 # 2; y;",
+    "k foo; = = ; (((",
+  };
+
+  // Both modes report the same errors and recover the same way, in generated code and in the interpreter.
+  for (auto &input : inputs) {
+    XCTAssertEqual(parseWithErrors(input, false, true), parseWithErrors(input, false, false));
+    XCTAssertEqual(parseWithErrors(input, true, true), parseWithErrors(input, true, false));
+  }
+
+  XCTAssertEqual(parseWithErrors(inputs[0], false, true), "(prog (stat x = (expr (term (atom 1)) + (term (atom 2))) ;) "
+    "(stat k foo ;) (stat (expr (term (atom \"s\"))) ;) <EOF>)\n0");
+  XCTAssertEqual(parseWithErrors(inputs[2], false, true), "(prog (stat x = (expr (term (atom 1) 2)) ;) "
+    "(stat y = (expr (term (atom 3))) ;) <EOF>)\n"
+    "1:6 extraneous input '2' expecting {'+', '*', ';'}\n1");
+  XCTAssertEqual(parseWithErrors(inputs[5], true, true), "(prog (stat x = (expr (term (atom 1) 2)) ;) "
+    "(stat (expr (term (atom y))) ;) <EOF>)\n"
+    "1:6 token recognition error at: '#'\n"
+    "1:8 extraneous input '2' expecting {'+', '*', ';'}\n1");
+  XCTAssertEqual(parseWithErrors(inputs[6], false, true), "(prog (stat k foo ;) = = ; (stat (expr (term (atom ( "
+    "(expr (term (atom ( (expr (term (atom ( (expr (term atom))))) <EOF>))) <EOF>))) <missing\\n';'>) <EOF>)\n"
+    "1:7 extraneous input '=' expecting {<EOF>, 'k', ID, NUM, '(', '$', '@', STRING}\n"
+    "1:16 no viable alternative at input '<EOF>'\n2");
+
+  // No exception escapes match() in exception free mode; the error is left pending.
+  ANTLRInputStream input("; ;");
+  auto lexer = TestGrammar::createLexer(&input);
+  CommonTokenStream tokens(lexer.get());
+  TestParser parser(&tokens);
+  XCTAssertFalse(parser.isExceptionFreeErrorHandling());
+  parser.removeErrorListeners();
+  parser.setExceptionFreeErrorHandling(true);
+  auto context = std::make_shared<TestParser::StatContext>(std::weak_ptr<ParserRuleContext>(), -1);
+  parser.enterRule(context, 2, TestGrammar::RuleStat);
+  parser.setState(29);
+  XCTAssert(parser.match(TestGrammar::EQ) == nullptr);
+  XCTAssert(parser.hasPendingError());
+  XCTAssert(is<InputMismatchException>(parser.getPendingError()));
+  parser.recoverFromPendingError(context);
+  XCTAssertFalse(parser.hasPendingError());
+  XCTAssert(context->exception != nullptr);
+
+  // The default mode throws, as before.
+  parser.reset();
+  parser.setExceptionFreeErrorHandling(false);
+  parser.enterRule(context, 2, TestGrammar::RuleStat);
+  parser.setState(29);
+  try {
+    parser.match(TestGrammar::EQ);
+    XCTFail(@"Mismatched token accepted");
+  } catch (InputMismatchException &) {
+  }
+  XCTAssertFalse(parser.hasPendingError());
+
+  // Error strategies which throw in recover() still do so.
+  for (bool exceptionFree : { false, true }) {
+    for (bool interpreted : { false, true }) {
+      ANTLRInputStream input("x = 1 + ; y = 2;");
+      auto lexer = TestGrammar::createLexer(&input);
+      CommonTokenStream tokens(lexer.get());
+      Ref<Parser> parser;
+      if (interpreted) {
+        parser = TestGrammar::createParser(&tokens);
+      } else {
+        parser = std::make_shared<TestParser>(&tokens);
+      }
+      parser->setExceptionFreeErrorHandling(exceptionFree);
+      parser->setErrorHandler(std::make_shared<BailErrorStrategy>());
+      parser->removeErrorListeners();
+      try {
+        if (interpreted) {
+          std::static_pointer_cast<ParserInterpreter>(parser)->parse(TestGrammar::RuleProg);
+        } else {
+          std::static_pointer_cast<TestParser>(parser)->prog();
+        }
+        XCTFail(@"Bail error strategy didn't bail out");
+      } catch (ParseCancellationException &) {
+      }
+    }
+  }
+}
+
+- (void)testCodeCompletion {
+  // Token indices: x = 1 + y ; k foo ; EOF are 0, 2, 4, 6, 8, 9, 11, 13, 14, 15 (the others are whitespace).
+  ANTLRInputStream input("x = 1 + y; k foo;");
+  auto lexer = TestGrammar::createLexer(&input);
+  CommonTokenStream tokens(lexer.get());
+  tokens.fill();
+  auto parser = TestGrammar::createParser(&tokens);
+  CodeCompletionCore core(parser.get());
+
+  const std::string statStart = "EOF KW(ID SEMI) ID NUM LP DOLLAR AT STRING";
+
+  // Caret at the start, in the middle and at the end (EOF) of the input.
+  XCTAssertEqual(describeCandidates(core.collectCandidates(0)), statStart);
+  XCTAssertEqual(describeCandidates(core.collectCandidates(2)), "PLUS STAR SEMI EQ");
+  XCTAssertEqual(describeCandidates(core.collectCandidates(4)), "ID NUM LP STRING");
+  XCTAssertEqual(describeCandidates(core.collectCandidates(6)), "PLUS STAR SEMI");
+  XCTAssertEqual(describeCandidates(core.collectCandidates(8)), "ID NUM LP STRING");
+  XCTAssertEqual(describeCandidates(core.collectCandidates(11)), statStart);
+  XCTAssertEqual(describeCandidates(core.collectCandidates(13)), "ID(SEMI)");
+  XCTAssertEqual(describeCandidates(core.collectCandidates(14)), "SEMI");
+  XCTAssertEqual(describeCandidates(core.collectCandidates(15)), statStart);
+
+  // A caret on a hidden token means the next on-channel token.
+  XCTAssertEqual(describeCandidates(core.collectCandidates(1)), "PLUS STAR SEMI EQ");
+  XCTAssertEqual(tokens.index(), 0U);
+
+  // Preferred rules replace the tokens they match.
+  core.preferredRules = { TestGrammar::RuleAtom };
+  XCTAssertEqual(describeCandidates(core.collectCandidates(0)), "EOF KW(ID SEMI) ID(EQ) DOLLAR AT prog>stat>expr>term>atom");
+  XCTAssertEqual(describeCandidates(core.collectCandidates(8)), "prog>stat>expr>term>atom");
+  XCTAssertEqual(describeCandidates(core.collectCandidates(13)), "ID(SEMI)");
+  core.preferredRules.clear();
+
+  // Ignored tokens are left out.
+  core.ignoredTokens = { TestGrammar::PLUS, TestGrammar::STAR, Token::EOF };
+  XCTAssertEqual(describeCandidates(core.collectCandidates(0)), "KW(ID SEMI) ID NUM LP DOLLAR AT STRING");
+  XCTAssertEqual(describeCandidates(core.collectCandidates(6)), "SEMI");
+  XCTAssertEqual(describeCandidates(core.collectCandidates(15)), "KW(ID SEMI) ID NUM LP DOLLAR AT STRING");
+  core.ignoredTokens.clear();
+
+  // Starting at a context gives the same candidates as starting at the first token.
+  Ref<ParserRuleContext> tree = parser->parse(TestGrammar::RuleProg);
+  Ref<ParserRuleContext> secondStat = std::static_pointer_cast<ParserRuleContext>(tree->children[1]);
+  XCTAssertEqual(describeCandidates(core.collectCandidates(13, secondStat)), "ID(SEMI)");
+  XCTAssertEqual(describeCandidates(core.collectCandidates(14, secondStat)), "SEMI");
+}
+
+- (void)testDFAStringsWhileParsing {
+  // The DFA dumps and sizes lock each DFA, so they can be taken while another thread parses with and clears them.
+  ANTLRInputStream input("x = 1 + 2 * (ab); k foo; @ 34 abc; @ 2 3 z;");
+  auto lexer = TestGrammar::createLexer(&input);
+  CommonTokenStream tokens(lexer.get());
+  auto parser = TestGrammar::createParser(&tokens);
+  parser->setProfile(true);
+  Ref<ParseInfo> parseInfo = parser->getParseInfo();
+  std::vector<DFA> &decisionToDFA = parser->getInterpreter<ParserATNSimulator>()->decisionToDFA;
+
+  parser->parse(TestGrammar::RuleProg);
+  std::vector<std::string> dfaStrings = parser->getDFAStrings();
+  XCTAssertEqual(dfaStrings.size(), decisionToDFA.size());
+  XCTAssertFalse(dfaStrings[1].empty()); // The alternatives of stat.
+  size_t dfaSize = parseInfo->getDFASize();
+  XCTAssert(dfaSize > 0);
+
+  std::atomic<bool> stop(false);
+  std::thread parsing([&]() {
+    while (!stop) {
+      input.reset();
+      lexer->setInputStream(&input);
+      tokens.setTokenSource(lexer.get());
+      parser->setTokenStream(&tokens);
+      parser->parse(TestGrammar::RuleProg);
+      for (auto &dfa : decisionToDFA) {
+        dfa.clear();
+      }
+    }
+  });
+  for (size_t i = 0; i < 200; ++i) {
+    XCTAssertEqual(parser->getDFAStrings().size(), decisionToDFA.size());
+    XCTAssert(parseInfo->getDFASize() <= dfaSize);
+  }
+  stop = true;
+  parsing.join();
+  misc::EpochManager::getDefault().collect();
+}
+- (void)testLexerActionOffsetFixup {
+  auto channel = std::make_shared<LexerChannelAction>(1);
+  auto custom1 = std::make_shared<LexerCustomAction>(2, 0);
+  auto custom2 = std::make_shared<LexerCustomAction>(2, 1);
+  auto indexed = std::make_shared<LexerIndexedCustomAction>(1, custom2);
+
+  // Actions which don't depend on the position are left alone.
+  auto channelOnly = LexerActionExecutor::append(nullptr, channel);
+  XCTAssert(channelOnly->fixOffsetBeforeMatch(3) == channelOnly);
+
+  // Only position-dependent actions without an offset are wrapped, with the offset they appear at.
+  auto executor = LexerActionExecutor::append(LexerActionExecutor::append(channelOnly, custom1), indexed);
+  auto fixed = executor->fixOffsetBeforeMatch(3);
+  XCTAssert(fixed != executor);
+  std::vector<Ref<LexerAction>> actions = fixed->getLexerActions();
+  XCTAssertEqual(actions.size(), 3U);
+  XCTAssert(actions[0] == channel);
+  Ref<LexerIndexedCustomAction> wrapped = std::dynamic_pointer_cast<LexerIndexedCustomAction>(actions[1]);
+  XCTAssert(wrapped != nullptr);
+  XCTAssertEqual(wrapped->getOffset(), 3);
+  XCTAssert(wrapped->getAction() == custom1);
+  XCTAssert(actions[2] == indexed);
+
+  // Fixed executors are shared and need no further fixup.
+  XCTAssert(executor->fixOffsetBeforeMatch(3) == fixed);
+  XCTAssert(fixed->fixOffsetBeforeMatch(5) == fixed);
+
+  // Offsets stay correct (and shared) when the cache is emptied after many different offsets.
+  for (int offset = 0; offset < 200; ++offset) {
+    auto current = executor->fixOffsetBeforeMatch(offset);
+    wrapped = std::dynamic_pointer_cast<LexerIndexedCustomAction>(current->getLexerActions()[1]);
+    XCTAssertEqual(wrapped->getOffset(), offset);
+    XCTAssert(wrapped->getAction() == custom1);
+    XCTAssert(current->getLexerActions()[2] == indexed);
+    XCTAssert(executor->fixOffsetBeforeMatch(offset) == current);
+  }
+  XCTAssert(executor->fixOffsetBeforeMatch(3) != fixed); // Dropped from the cache, but equal.
+  XCTAssertEqual(executor->fixOffsetBeforeMatch(3)->hashCode(), fixed->hashCode());
+
+  // Each action runs at the token start plus its offset, unwrapped ones at the token end. The input is
+  // restored afterwards.
+  ANTLRInputStream input("abcdefghij");
+  ActionRecordingLexer lexer(&input);
+  input.seek(8);
+  fixed->execute(&lexer, &input, 2);
+  XCTAssertEqual(input.index(), 8U);
+  XCTAssertEqual(lexer.channel, 1U);
+  XCTAssertEqual(lexer.actions.size(), 2U);
+  XCTAssertEqual(lexer.actions[0], "2.0@5");
+  XCTAssertEqual(lexer.actions[1], "2.1@3");
+
+  lexer.actions.clear();
+  executor->execute(&lexer, &input, 2);
+  XCTAssertEqual(input.index(), 8U);
+  XCTAssertEqual(lexer.actions.size(), 2U);
+  XCTAssertEqual(lexer.actions[0], "2.0@8");
+  XCTAssertEqual(lexer.actions[1], "2.1@3");
+}
+- (void)testCachedPatternMatching {
+  ANTLRInputStream input("x = 1 + 2; k foo; y = (ab);");
+  auto lexer = TestGrammar::createLexer(&input);
+  CommonTokenStream tokens(lexer.get());
+  TestParser parser(&tokens);
+  Ref<ParserRuleContext> tree = parser.prog();
+  XCTAssertEqual(parser.getNumberOfSyntaxErrors(), 0U);
+  Ref<ParseTree> assignment = tree->children[0];
+  Ref<ParseTree> declaration = tree->children[1];
+  Ref<ParseTree> nested = tree->children[2];
+
+  ParseTreePatternMatcher matcher(lexer.get(), &parser);
+  XCTAssert(matcher.matches(assignment, "<ID> = <expr>;", TestGrammar::RuleStat));
+  XCTAssert(matcher.matches(nested, "<ID> = <expr>;", TestGrammar::RuleStat));
+  XCTAssert(matcher.matches(nested, "y = (<ID>);", TestGrammar::RuleStat));
+  XCTAssertFalse(matcher.matches(declaration, "<ID> = <expr>;", TestGrammar::RuleStat));
+  XCTAssert(matcher.matches(declaration, "k <ID>;", TestGrammar::RuleStat));
+  XCTAssertFalse(matcher.matches(declaration, "k bar;", TestGrammar::RuleStat));
+
+  ParseTreeMatch match = matcher.match(assignment, "<name:ID> = <expr>;", TestGrammar::RuleStat);
+  XCTAssert(match.succeeded());
+  XCTAssertEqual(match.get("name")->getText(), "x");
+  XCTAssertEqual(match.get("expr")->getText(), "1, +, 2");
+
+  ParseTreeMatch mismatch = matcher.match(nested, "<ID> = (<NUM>);", TestGrammar::RuleStat);
+  XCTAssertFalse(mismatch.succeeded());
+  XCTAssertEqual(mismatch.getMismatchedNode()->getText(), "ab");
+
+  // The cache is bounded. Matches keep their patterns alive when they are dropped from it, and the results stay
+  // the same.
+  for (size_t i = 0; i < 600; ++i) {
+    XCTAssert(matcher.matches(assignment, "<ID> = " + std::to_string(i) + " + <term>;", TestGrammar::RuleStat) == (i == 1));
+    XCTAssertFalse(matcher.matches(assignment, std::string(i % 20 + 1, 'a' + i % 10) + " = <expr>;", TestGrammar::RuleStat));
+  }
+  XCTAssertEqual(match.getPattern().getPattern(), "<name:ID> = <expr>;");
+  XCTAssert(match.succeeded());
+  XCTAssertEqual(match.get("name")->getText(), "x");
+  XCTAssertFalse(mismatch.succeeded());
+  XCTAssertEqual(mismatch.getPattern().getPattern(), "<ID> = (<NUM>);");
+  XCTAssert(matcher.match(assignment, "<name:ID> = <expr>;", TestGrammar::RuleStat).succeeded());
+}
+- (void)testTestRig {
+  std::string fileName = std::string(P_tmpdir) + "/TestRigInput.txt";
+  std::string missingFileName = std::string(P_tmpdir) + "/TestRigMissing.txt";
+  std::remove(missingFileName.c_str());
+  auto writeInput = [&](const std::string &text) {
+    std::ofstream stream(fileName, std::ios::binary);
+    stream << text;
+  };
+
+  misc::TestRig::LexerFactory lexerFactory = misc::TestRig::createLexerInterpreterFactory("TestLexer.g4", TestGrammar::getVocabulary(),
+    TestGrammar::getLexerRuleNames(), TestGrammar::getModeNames(), TestGrammar::getLexerATN());
+  misc::TestRig::ParserFactory parserFactory = misc::TestRig::createParserInterpreterFactory("TestParser.g4",
+    TestGrammar::getVocabulary(), TestGrammar::getParserRuleNames(), TestGrammar::getParserATN());
+  auto run = [&](const std::vector<std::string> &args, misc::TestRig::ParserFactory parser, misc::TestRig::RuleInvoker invoker,
+                 std::string &output, std::string &errors) {
+    std::stringstream outputStream;
+    std::stringstream errorStream;
+    misc::TestRig rig(args, lexerFactory, parser, invoker, outputStream, errorStream);
+    int result = rig.isValid() ? rig.process() : -1;
+    output = outputStream.str();
+    errors = errorStream.str();
+    return result;
+  };
+
+  std::string output;
+  std::string errors;
+  writeInput("x = 1;");
+  XCTAssertEqual(run({ "tokens", "-tokens", fileName }, nullptr, nullptr, output, errors), 0);
+  XCTAssertEqual(output, "[@0,0:0='x',<2>,1:0]\n[@1,1:1=' ',<15>,channel=1,1:1]\n[@2,2:2='=',<9>,1:2]\n"
+    "[@3,3:3=' ',<15>,channel=1,1:3]\n[@4,4:4='1',<3>,1:4]\n[@5,5:5=';',<8>,1:5]\n[@6,6:5='<EOF>',<-1>,1:6]\n");
+  XCTAssertEqual(errors, "");
+
+  XCTAssertEqual(run({ "prog", "-tree", fileName }, parserFactory, nullptr, output, errors), 0);
+  XCTAssertEqual(output, "(prog (stat x = (expr (term (atom 1))) ;) <EOF>)\n");
+
+  // A parser written like generated code needs the rule invoker and gives the same tree.
+  misc::TestRig::RuleInvoker invoker = [](Parser *parser, size_t ruleIndex) -> Ref<ParserRuleContext> {
+    switch (ruleIndex) {
+      case TestGrammar::RuleProg: return static_cast<TestParser *>(parser)->prog();
+      default: return nullptr;
+    }
+  };
+  misc::TestRig::ParserFactory testParserFactory = [](TokenStream *input) { return std::make_shared<TestParser>(input); };
+  XCTAssertEqual(run({ "prog", "-tree", fileName }, testParserFactory, invoker, output, errors), 0);
+  XCTAssertEqual(output, "(prog (stat x = (expr (term (atom 1))) ;) <EOF>)\n");
+  XCTAssertEqual(run({ "stat", "-tree", fileName }, testParserFactory, invoker, output, errors), 1);
+  XCTAssertEqual(errors, "No method for rule stat or it has arguments\n");
+
+  XCTAssertEqual(run({ "prog", "-benchmark", "-repeat", "3", "-cold", fileName }, parserFactory, nullptr, output,
+                     errors), 0);
+  XCTAssert(output.find(fileName + ": 7 tokens, 3 run(s), cold DFA\n") == 0);
+  XCTAssert(output.find("  parse ") != std::string::npos);
+  XCTAssert(output.find("DFA states: lexer ") != std::string::npos);
+
+  // Failures give exit code 1, bad arguments leave the rig invalid.
+  XCTAssertEqual(run({ "foo", fileName }, parserFactory, nullptr, output, errors), 1);
+  XCTAssertEqual(errors, "No rule foo\n");
+  XCTAssertEqual(run({ "prog", missingFileName }, parserFactory, nullptr, output, errors), 1);
+  XCTAssertEqual(errors, "Can't open " + missingFileName + "\n");
+  XCTAssertEqual(run({ "prog", "-repeat" }, parserFactory, nullptr, output, errors), -1);
+  XCTAssertEqual(errors, "missing count on -repeat\n");
+  XCTAssertEqual(run({ "prog", "-repeat", "0" }, parserFactory, nullptr, output, errors), -1);
+  XCTAssertEqual(run({ "prog", "-gui" }, parserFactory, nullptr, output, errors), -1);
+  XCTAssertEqual(errors, "unknown option -gui\n");
+  XCTAssertEqual(run({ "prog" }, nullptr, nullptr, output, errors), -1);
+  XCTAssertEqual(run({}, parserFactory, nullptr, output, errors), -1);
+  XCTAssert(errors.find("driver startRuleName") == 0);
+
+  writeInput("x = ;");
+  XCTAssertEqual(run({ "prog", fileName }, parserFactory, nullptr, output, errors), 1);
+
+  std::remove(fileName.c_str());
+}
+- (void)testParserInterpreter {
+  // The interpreter builds the same trees as the generated style parser.
+  std::vector<std::string> inputs = {
+    "", "x = 1 + 2 * (ab);", "k foo; \"s\"; $ 1 y; $ y; @ 34 abc; @ 2 3 z;", "a = (b + c) * d; /* comment */ e;",
+    "((((1)))) * 2 + 3 * (4 + 5);", "$ $ y;", ")"
+  };
+  for (auto &text : inputs) {
+    XCTAssertEqual(parseWithErrors(text, true, false), parseWithErrors(text, false, false));
+  }
+
+  // It reports the same errors. Where recovery consumes no input the interpreter adds an error node for the offending
+  // token (as the Java interpreter does), so only the errors are compared.
+  auto withoutTree = [](const std::string &result) { return result.substr(result.find('\n')); };
+  inputs = { "a = ;", "k 1;", "x = (1 + 2;", "@ 34 ;", "x = 1 y = 2;" };
+  for (auto &text : inputs) {
+    XCTAssertEqual(withoutTree(parseWithErrors(text, true, false)), withoutTree(parseWithErrors(text, false, false)));
+  }
+
+
+  // Trees stay valid when the interpreter is reused, including the rule context fields.
+  auto describeTree = [](Ref<ParserRuleContext> tree) {
+    std::vector<Ref<ParseTree>> nodes;
+    collectNodes(tree, nodes);
+    std::string result;
+    for (auto &node : nodes) {
+      if (is<ParserRuleContext>(node)) {
+        Ref<ParserRuleContext> context = std::static_pointer_cast<ParserRuleContext>(node);
+        result += std::to_string(context->getRuleIndex()) + ":" + std::to_string(context->start->getTokenIndex()) +
+          "-" + (context->stop == nullptr ? "?" : std::to_string(context->stop->getTokenIndex())) + " ";
+      }
+    }
+    return result;
+  };
+  ANTLRInputStream input("x = 1 + 2 * (ab); k foo; @ 34 abc;");
+  auto lexer = TestGrammar::createLexer(&input);
+  CommonTokenStream tokens(lexer.get());
+  TestParser parser(&tokens);
+  Ref<ParserRuleContext> expected = parser.prog();
+  std::string expectedTree = expected->toStringTree(&parser);
+  std::string expectedDescription = describeTree(expected);
+
+  auto interpreter = TestGrammar::createParser(&tokens);
+  std::vector<Ref<ParserRuleContext>> trees;
+  for (size_t i = 0; i < 6; ++i) {
+    tokens.seek(0);
+    interpreter->reset();
+    Ref<ParserRuleContext> tree = interpreter->parse(TestGrammar::RuleProg);
+    XCTAssertEqual(tree->toStringTree(interpreter.get()), expectedTree);
+    XCTAssertEqual(describeTree(tree), expectedDescription);
+    if (i % 2 == 0) {
+      trees.push_back(tree); // Others are dropped, so their memory can be reused.
+    }
+  }
+  for (auto &tree : trees) {
+    XCTAssertEqual(tree->toStringTree(interpreter.get()), expectedTree);
+    XCTAssertEqual(describeTree(tree), expectedDescription);
+  }
+}
+- (void)testLL1DecisionTables {
+  // The same ATN without the tables, so all decisions are predicted through the DFA.
+  ATNDeserializationOptions options;
+  options.setGenerateLL1DecisionTables(false);
+  ATN plainATN = ATNDeserializer(options).deserialize(TestGrammar::getSerializedParserATN());
+  const ATN &atn = TestGrammar::getParserATN();
+
+  std::vector<int> tableDecisions;
+  for (DecisionState *state : atn.decisionToState) {
+    XCTAssert(plainATN.decisionToState[(size_t)state->decision]->ll1Table.empty());
+    if (!state->ll1Table.empty()) {
+      tableDecisions.push_back(state->decision);
+    }
+  }
+  XCTAssert(!tableDecisions.empty());
+  XCTAssert(tableDecisions.size() < atn.decisionToState.size()); // The decision in "list" needs more lookahead.
+
+  TokenTypeSource dummy({});
+  CommonTokenStream dummyTokens(&dummy);
+  ParserInterpreter tableParser("TestParser.g4", TestGrammar::getVocabulary(), TestGrammar::getParserRuleNames(), atn,
+    &dummyTokens);
+  ParserInterpreter plainParser("TestParser.g4", TestGrammar::getVocabulary(), TestGrammar::getParserRuleNames(),
+    plainATN, &dummyTokens);
+
+  // Returns the predicted alt and the input position afterwards (which must not have moved).
+  auto predict = [](ParserInterpreter &parser, int decision, const std::vector<size_t> &types) -> std::string {
+    TokenTypeSource source(types);
+    CommonTokenStream tokens(&source);
+    tokens.fill();
+    parser.setTokenStream(&tokens);
+    try {
+      size_t alt = parser.getInterpreter<ParserATNSimulator>()->adaptivePredict(&tokens, decision, nullptr);
+      return std::to_string(alt) + "@" + std::to_string(tokens.index());
+    } catch (NoViableAltException &) {
+      return "no viable alt";
+    }
+  };
+
+  // Every decision predicts the same alternatives with and without tables, for all token types, EOF and an unknown
+  // token type (which both aren't in any table).
+  for (size_t decision = 0; decision < atn.decisionToState.size(); ++decision) {
+    std::vector<std::vector<size_t>> inputs = { {}, { TestGrammar::WS + 1 }, { TestGrammar::WS + 1, TestGrammar::SEMI } };
+    for (size_t type = TestGrammar::KW; type <= TestGrammar::WS; ++type) {
+      inputs.push_back({ type });
+      inputs.push_back({ type, TestGrammar::ID, TestGrammar::SEMI });
+      inputs.push_back({ type, TestGrammar::NUM, TestGrammar::ID, TestGrammar::SEMI });
+    }
+    for (auto &types : inputs) {
+      XCTAssertEqual(predict(tableParser, (int)decision, types), predict(plainParser, (int)decision, types));
+    }
+  }
+
+  // Table decisions only use their DFA for symbols not in the table.
+  for (int decision : tableDecisions) {
+    const std::vector<int> &table = atn.decisionToState[(size_t)decision]->ll1Table;
+    XCTAssert(table.size() <= TestGrammar::WS + 1);
+    DFA &dfa = tableParser.getInterpreter<ParserATNSimulator>()->decisionToDFA[(size_t)decision];
+    dfa.clear();
+    for (size_t type = TestGrammar::KW; type < table.size(); ++type) {
+      if (table[type] != ATN::INVALID_ALT_NUMBER) {
+        XCTAssertEqual(predict(tableParser, decision, { type }), std::to_string(table[type]) + "@0");
+      }
+    }
+    XCTAssert(dfa.s0 == nullptr);
+    predict(tableParser, decision, {});
+    XCTAssert(dfa.s0 != nullptr);
+  }
+
+  // Complete parses give the same trees and errors.
+  for (std::string text : { "x = 1 + 2 * (ab); k foo; \"s\"; $ 1 y; $ y; @ 34 abc; @ 2 3 z;", "a = ;", "x = (1 + 2;",
+                            "@ 34 ;", "$ $ y;", "k 1;", "" }) {
+    ANTLRInputStream input(text);
+    auto lexer = TestGrammar::createLexer(&input);
+    CommonTokenStream tokens(lexer.get());
+    tokens.fill();
+    std::string results[2];
+    for (size_t i = 0; i < 2; ++i) {
+      ParserInterpreter &parser = i == 0 ? tableParser : plainParser;
+      tokens.seek(0);
+      parser.setTokenStream(&tokens);
+      parser.removeErrorListeners();
+      Ref<ParserRuleContext> tree = parser.parse(TestGrammar::RuleProg);
+      results[i] = tree->toStringTree(&parser) + " " + std::to_string(parser.getNumberOfSyntaxErrors());
+    }
+    XCTAssertEqual(results[0], results[1]);
+  }
+}
+- (void)testLookCache {
+  // A private ATN, so the cache starts out empty.
+  ATN atn = ATNDeserializer().deserialize(TestGrammar::getSerializedParserATN());
+
+  // Deeply nested expressions give many different rule invocation chains.
+  std::string text = "x = 1; k foo; $ 1 y; @ 34 abc; a = ";
+  for (size_t i = 0; i < 25; ++i) {
+    text += i % 2 == 0 ? "(b + " : "(c * ";
+  }
+  text += "d" + std::string(25, ')') + ";";
+  ANTLRInputStream input(text);
+  auto lexer = TestGrammar::createLexer(&input);
+  CommonTokenStream tokens(lexer.get());
+  TestParser parser(&tokens);
+  Ref<ParserRuleContext> tree = parser.prog();
+  XCTAssertEqual(parser.getNumberOfSyntaxErrors(), 0U);
+
+  std::vector<Ref<ParseTree>> nodes;
+  collectNodes(tree, nodes);
+  std::vector<Ref<RuleContext>> contexts;
+  for (auto &node : nodes) {
+    if (is<ParserRuleContext>(node)) {
+      contexts.push_back(std::static_pointer_cast<RuleContext>(node));
+    }
+  }
+  XCTAssert(contexts.size() * atn.states.size() > 10000); // More than the cache holds.
+
+  // Cached results equal fresh LOOK results, on the first query, on repeated queries and after the cache was
+  // cleared because it became too large.
+  LL1Analyzer analyzer(atn);
+  for (size_t pass = 0; pass < 2; ++pass) {
+    for (auto &context : contexts) {
+      for (ATNState *state : atn.states) {
+        std::string expected = analyzer.LOOK(state, context).toString();
+        XCTAssertEqual(atn.nextTokens(state, context).toString(), expected);
+        XCTAssertEqual(atn.nextTokens(state, context).toString(), expected);
+      }
+    }
+  }
+  for (ATNState *state : atn.states) {
+    XCTAssertEqual(atn.nextTokens(state, nullptr).toString(), analyzer.LOOK(state, nullptr).toString());
+  }
+}
+- (void)testBypassAltsATN {
+  // Parsers sharing one ATN share its bypass ATN, also when they compile patterns concurrently.
+  const std::string text = "x = 1 + 2; k foo;";
+  const size_t threadCount = 4;
+  std::vector<const ATN *> bypassATNs(threadCount);
+  std::vector<std::string> results(threadCount);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < threadCount; ++i) {
+    threads.push_back(std::thread([&, i]() {
+      ANTLRInputStream input(text);
+      auto lexer = TestGrammar::createLexer(&input);
+      CommonTokenStream tokens(lexer.get());
+      TestParser parser(&tokens);
+      Ref<ParserRuleContext> tree = parser.prog();
+      ParseTreePatternMatcher matcher(lexer.get(), &parser);
+      for (size_t j = 0; j < 20; ++j) {
+        std::string pattern = "<ID> = <term> + " + std::to_string(j) + ";"; // Not cached by the matcher.
+        results[i] += matcher.matches(tree->children[0], pattern, TestGrammar::RuleStat) ? "1" : "0";
+        results[i] += matcher.matches(tree->children[1], pattern, TestGrammar::RuleStat) ? "1" : "0";
+      }
+      ParseTreePattern pattern = parser.compileParseTreePattern("k <ID>;", TestGrammar::RuleStat);
+      results[i] += " " + pattern.getPatternTree()->toStringTree(&parser);
+
+      bypassATNs[i] = &parser.getATNWithBypassAlts();
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  const ATN &atn = TestGrammar::getParserATN();
+  const ATN &bypassATN = Parser::getATNWithBypassAlts(atn, TestGrammar::getSerializedParserATN());
+  for (size_t i = 0; i < threadCount; ++i) {
+    XCTAssertEqual(results[i], "000010" + std::string(34, '0') + " (stat k <ID> ;)");
+    XCTAssert(bypassATNs[i] == &bypassATN);
+  }
+
+  // Another ATN for the same grammar has its own bypass ATN.
+  ATN otherATN = ATNDeserializer().deserialize(TestGrammar::getSerializedParserATN());
+  const ATN &otherBypassATN = Parser::getATNWithBypassAlts(otherATN, TestGrammar::getSerializedParserATN());
+  XCTAssert(&otherBypassATN != &bypassATN);
+  XCTAssert(&Parser::getATNWithBypassAlts(otherATN, {}) == &otherBypassATN);
+
+  // The transitions of each rule start state were moved to the bypass block start state.
+  XCTAssert(bypassATN.states.size() > atn.states.size());
+  for (size_t i = 0; i < atn.ruleToStartState.size(); ++i) {
+    ATNState *start = bypassATN.ruleToStartState[i];
+    XCTAssertEqual(start->getNumberOfTransitions(), 1U);
+    XCTAssert(is<BasicBlockStartState *>(start->transition(0)->target));
+
+    ATNState *block = start->transition(0)->target;
+    ATNState *original = atn.ruleToStartState[i];
+    XCTAssertEqual(block->getNumberOfTransitions(), original->getNumberOfTransitions() + 1);
+    for (size_t j = 0; j < original->getNumberOfTransitions(); ++j) {
+      XCTAssertEqual(block->transition(j)->target->stateNumber, original->transition(j)->target->stateNumber);
+    }
+  }
+}
+
+- (void)testRemoveTransition {
+  BasicState state;
+  BasicState targets[3];
+  std::vector<Transition *> transitions;
+  for (auto &target : targets) {
+    transitions.push_back(new EpsilonTransition(&target));
+    state.addTransition(transitions.back());
+  }
+
+  Transition *removed = state.removeTransition(1);
+  XCTAssert(removed == transitions[1]);
+  XCTAssertEqual(state.getNumberOfTransitions(), 2U);
+  XCTAssert(state.transition(0) == transitions[0]);
+  XCTAssert(state.transition(1) == transitions[2]);
+  delete removed; // The caller owns it now.
+
+  removed = state.removeTransition(1);
+  XCTAssert(removed == transitions[2]);
+  state.addTransition(0, removed);
+  XCTAssert(state.transition(0) == transitions[2]);
+  XCTAssert(state.transition(1) == transitions[0]);
+}
+- (void)testPredictionDiagnostics {
+  const std::string text = "x = 1 + 2;\n@ 34 abc;\n  @ 2 3 z; $ 1 y;\n@ 5 def; @ 6 ghi;";
+  const ATN &atn = TestGrammar::getParserATN();
+  size_t optDecision = (size_t)static_cast<DecisionState *>(atn.ruleToStartState[TestGrammar::RuleOpt]->transition(0)->target)->decision;
+
+  // Parses the text and returns the number of syntax errors. Uses an unbuffered token stream if asked for.
+  auto parse = [&text](Ref<PredictionDiagnostics> diagnostics, bool unbuffered) {
+    ANTLRInputStream input(text);
+    input.name = "diagnostics";
+    auto lexer = TestGrammar::createLexer(&input);
+    DefaultChannelTokenSource source(lexer.get());
+    std::unique_ptr<TokenStream> tokens;
+    if (unbuffered) {
+      tokens.reset(new UnbufferedTokenStream(&source));
+    } else {
+      tokens.reset(new CommonTokenStream(lexer.get()));
+    }
+    auto parser = TestGrammar::createParser(tokens.get());
+    parser->getInterpreter<ParserATNSimulator>()->setDiagnostics(diagnostics);
+    parser->parse(TestGrammar::RuleProg);
+    return parser->getNumberOfSyntaxErrors();
+  };
+  auto describeSamples = [](const PredictionDiagnostics &diagnostics, size_t decision) {
+    std::string result;
+    for (auto &sample : diagnostics.getSamples(decision)) {
+      result += std::to_string(sample.kind) + " " + sample.sourceName + ":" + std::to_string(sample.line) + ":" +
+        std::to_string(sample.charPositionInLine) + " \"" + sample.text + "\"\n";
+    }
+    return result;
+  };
+
+  // "@ <n> <id>" and "$ <n> <id>" can't be decided by SLL, since opt is followed by NUM in one rule and by ID in the
+  // other. Only the first 2 events of each kind are sampled.
+  auto diagnostics = std::make_shared<PredictionDiagnostics>(atn, 2);
+  XCTAssertEqual(parse(diagnostics, false), 0U);
+  std::vector<PredictionDiagnostics::DecisionCounts> decisions = diagnostics->getDecisions();
+  XCTAssertEqual(decisions.size(), 1U);
+  XCTAssertEqual(decisions[0].decision, optDecision);
+  XCTAssertEqual(decisions[0].counts[PredictionDiagnostics::SLL_CONFLICT], 4U);
+  XCTAssertEqual(decisions[0].counts[PredictionDiagnostics::LL_FALLBACK], 4U);
+  XCTAssertEqual(decisions[0].counts[PredictionDiagnostics::CONTEXT_SENSITIVITY], 4U);
+  XCTAssertEqual(decisions[0].counts[PredictionDiagnostics::AMBIGUITY], 0U);
+  XCTAssertEqual(decisions[0].exactAmbiguities, 0U);
+  XCTAssertEqual(diagnostics->getCounts(0).counts[PredictionDiagnostics::LL_FALLBACK], 0U);
+  XCTAssertEqual(describeSamples(*diagnostics, optDecision),
+    "0 diagnostics:2:2 \"34 abc;\"\n1 diagnostics:2:2 \"34 abc;\"\n2 diagnostics:2:2 \"34 abc\"\n"
+    "0 diagnostics:3:13 \"1 y;\"\n1 diagnostics:3:13 \"1 y;\"\n2 diagnostics:3:13 \"1\"\n");
+  std::string report = diagnostics->toString(TestGrammar::getParserRuleNames());
+  XCTAssert(report.find("decision " + std::to_string(optDecision) + " (rule opt): 4 SLL conflicts, 4 LL fallbacks, "
+    "4 context sensitivities, 0 ambiguities (0 exact)") == 0);
+  XCTAssert(report.find("  context sensitivity at diagnostics 3:13 \"1\"") != std::string::npos);
+
+  diagnostics->reset();
+  XCTAssert(diagnostics->getDecisions().empty());
+  XCTAssert(diagnostics->getSamples(optDecision).empty());
+
+  // An unbuffered stream has no size and only a window of tokens, but the samples are complete (regression test: the
+  // first sample used to abort the parse). Its getText() separates the tokens with commas.
+  diagnostics = std::make_shared<PredictionDiagnostics>(atn, 2);
+  try {
+    XCTAssertEqual(parse(diagnostics, true), 0U);
+  } catch (...) {
+    XCTFail(@"Diagnostics must work with unbuffered token streams");
+  }
+  XCTAssertEqual(diagnostics->getCounts(optDecision).counts[PredictionDiagnostics::LL_FALLBACK], 4U);
+  XCTAssertEqual(describeSamples(*diagnostics, optDecision),
+    "0 diagnostics:2:2 \"34, abc, ;\"\n1 diagnostics:2:2 \"34, abc, ;\"\n2 diagnostics:2:2 \"34, abc\"\n"
+    "0 diagnostics:3:13 \"1, y, ;\"\n1 diagnostics:3:13 \"1, y, ;\"\n2 diagnostics:3:13 \"1\"\n");
+
+
+  // Spans which the stream doesn't have anymore give samples without position.
+  {
+    ANTLRInputStream input(text);
+    auto lexer = TestGrammar::createLexer(&input);
+    DefaultChannelTokenSource source(lexer.get());
+    UnbufferedTokenStream tokens(&source);
+    for (size_t i = 0; i < 10; ++i) {
+      tokens.consume();
+    }
+    diagnostics->reset();
+    diagnostics->record(PredictionDiagnostics::AMBIGUITY, optDecision, &tokens, 2, 4, true);
+    diagnostics->record(PredictionDiagnostics::AMBIGUITY, optDecision, &tokens, 12, 14);
+    XCTAssertEqual(describeSamples(*diagnostics, optDecision), "3 <unknown>:0:-1 \"\"\n");
+    XCTAssertEqual(diagnostics->getCounts(optDecision).counts[PredictionDiagnostics::AMBIGUITY], 2U);
+    XCTAssertEqual(diagnostics->getCounts(optDecision).exactAmbiguities, 1U);
+  }
+
+  // Parsers in several threads can share a collector. Each span is sampled once.
+  diagnostics = std::make_shared<PredictionDiagnostics>(atn, 3);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < 4; ++i) {
+    threads.push_back(std::thread([&, i]() { parse(diagnostics, i % 2 == 0); }));
+
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  XCTAssertEqual(diagnostics->getCounts(optDecision).counts[PredictionDiagnostics::SLL_CONFLICT], 16U);
+  XCTAssertEqual(diagnostics->getCounts(optDecision).counts[PredictionDiagnostics::CONTEXT_SENSITIVITY], 16U);
+  std::vector<PredictionDiagnostics::Sample> samples = diagnostics->getSamples(optDecision);
+  XCTAssert(samples.size() <= 9);
+  for (size_t i = 0; i < samples.size(); ++i) {
+    for (size_t j = i + 1; j < samples.size(); ++j) {
+      XCTAssertFalse(samples[i].kind == samples[j].kind && samples[i].line == samples[j].line &&
+                     samples[i].charPositionInLine == samples[j].charPositionInLine);
+    }
+  }
+}
+- (void)testTwoStageParsing {
+  // Parses the text in two stages (or with full LL only) and returns the tree and the number of syntax errors.
+  auto parse = [](const std::string &text, bool twoStage, Parser::TwoStageStatistics *statistics) {
+    ANTLRInputStream input(text);
+    auto lexer = TestGrammar::createLexer(&input);
+    CommonTokenStream tokens(lexer.get());
+    TestParser parser(&tokens);
+    parser.removeErrorListeners();
+    Ref<ANTLRErrorStrategy> handler = parser.getErrorHandler();
+    Ref<TestParser::ProgContext> tree = twoStage ? parser.parseTwoStage(&TestParser::prog) : parser.prog();
+    XCTAssert(parser.getErrorHandler().get() == handler.get());
+
+    XCTAssert(parser.getInterpreter<ParserATNSimulator>()->getPredictionMode() == PredictionMode::LL);
+    if (statistics != nullptr) {
+      *statistics = parser.getTwoStageStatistics();
+    }
+    return tree->toStringTree(&parser) + " " + std::to_string(parser.getNumberOfSyntaxErrors());
+  };
+
+  // SLL handles this input, so there is no second stage.
+  Parser::TwoStageStatistics statistics;
+  std::string text = "x = 1 + 2; k foo; @ 2 3 z; $ 1 y;";
+  XCTAssertEqual(parse(text, true, &statistics), parse(text, false, nullptr));
+  XCTAssertEqual(statistics.sllParses, 1U);
+  XCTAssertEqual(statistics.llFallbacks, 0U);
+
+  // SLL predicts the wrong alternative for opt in "@ 34 abc" (it can't tell that at follows opt with NUM), which
+  // gives a syntax error in the first stage. The second stage parses it correctly.
+  text = "x = 1; @ 34 abc;";
+  XCTAssertEqual(parse(text, true, &statistics),
+                 "(prog (stat x = (expr (term (atom 1))) ;) (stat @ (at opt 34 abc) ;) <EOF>) 0");
+  XCTAssertEqual(parse(text, true, nullptr), parse(text, false, nullptr));
+  XCTAssertEqual(statistics.sllParses, 1U);
+  XCTAssertEqual(statistics.llFallbacks, 1U);
+
+  // Syntax errors are only reported once, from the second stage.
+  text = "x = ; @ 34 abc;";
+  std::string result = parse(text, true, &statistics);
+  XCTAssertEqual(result, parse(text, false, nullptr));
+  XCTAssertEqual(result.substr(result.size() - 2), " 1");
+  XCTAssertEqual(statistics.llFallbacks, 1U);
+
+  // The statistics add up over runs. With SLL set, the second stage uses LL and SLL is restored afterwards.
+  ANTLRInputStream input("@ 34 abc; $ 1 y;");
+  auto lexer = TestGrammar::createLexer(&input);
+  CommonTokenStream tokens(lexer.get());
+  auto interpreter = TestGrammar::createParser(&tokens);
+  interpreter->getInterpreter<ParserATNSimulator>()->setPredictionMode(PredictionMode::SLL);
+  for (size_t i = 0; i < 3; ++i) {
+    interpreter->reset();
+    Ref<ParserRuleContext> tree = interpreter->parseTwoStage([&]() {
+      return interpreter->parse(TestGrammar::RuleProg);
+    });
+    XCTAssertEqual(tree->toStringTree(interpreter.get()),
+                   "(prog (stat @ (at opt 34 abc) ;) (stat $ (dollar (opt 1) y) ;) <EOF>)");
+
+    XCTAssertEqual(interpreter->getNumberOfSyntaxErrors(), 0U);
+    XCTAssert(interpreter->getInterpreter<ParserATNSimulator>()->getPredictionMode() == PredictionMode::SLL);
+  }
+  XCTAssertEqual(interpreter->getTwoStageStatistics().sllParses, 3U);
+  XCTAssertEqual(interpreter->getTwoStageStatistics().llFallbacks, 3U);
+  interpreter->resetTwoStageStatistics();
+  XCTAssertEqual(interpreter->getTwoStageStatistics().sllParses, 0U);
+
+  // The start rule must belong to the parser.
+  try {
+    interpreter->parseTwoStage(&TestParser::prog);
+    XCTFail(@"A start rule of another parser class must be rejected");
+  } catch (IllegalArgumentException &) {
+  }
+  XCTAssertEqual(interpreter->getTwoStageStatistics().sllParses, 0U);
+}
+
 @end
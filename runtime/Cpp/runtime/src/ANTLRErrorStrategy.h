@@ -81,7 +81,9 @@ namespace runtime {
      *
      * @param recognizer the parser instance
      * @throws RecognitionException if the error strategy was not able to
-     * recover from the unexpected input symbol
+     * recover from the unexpected input symbol. With exception free error
+     * handling the error is passed to {@link Parser#signalError} instead and
+     * {@code nullptr} is returned.
      */
     virtual Ref<Token> recoverInline(Parser *recognizer) = 0;
 
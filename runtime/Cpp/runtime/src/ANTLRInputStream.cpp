@@ -31,6 +31,7 @@
 
 #include "Exceptions.h"
 #include "misc/Interval.h"
+#include "misc/LineIndex.h"
 #include "IntStream.h"
 
 #include "support/StringUtils.h"
@@ -59,6 +60,7 @@ ANTLRInputStream::ANTLRInputStream(std::wistream &stream) {
 void ANTLRInputStream::load(const std::string &input) {
   data = utfConverter.from_bytes(input);
   p = 0;
+  computeByteOffsets();
 }
 
 void ANTLRInputStream::load(std::wistream &stream) {
@@ -80,6 +82,8 @@ void ANTLRInputStream::load(std::wistream &stream) {
 
   for ( ; stream >> c; )
     data += c;
+
+  computeByteOffsets();
 }
 
 void ANTLRInputStream::reset() {
@@ -157,12 +161,12 @@ std::string ANTLRInputStream::getText(const Interval &interval) {
     stop = data.size() - 1;
   }
 
-  size_t count = stop - start + 1;
-  if (start >= data.size()) {
+  if (start >= data.size() || start > stop) {
     return "";
   }
 
-  return utfConverter.to_bytes(data.substr(start, count));
+  size_t byteStart = getByteOffset(start);
+  return _utf8Data.substr(byteStart, getByteOffset(stop + 1) - byteStart);
 }
 
 std::string ANTLRInputStream::getSourceName() const {
@@ -173,9 +177,65 @@ std::string ANTLRInputStream::getSourceName() const {
 }
 
 std::string ANTLRInputStream::toString() const {
-  return utfConverter.to_bytes(data);
+  return _utf8Data;
+}
+
+const std::string& ANTLRInputStream::getUTF8Data() const {
+  return _utf8Data;
+}
+
+size_t ANTLRInputStream::getByteOffset(size_t index) const {
+  if (_byteCheckpoints.empty()) {
+    return index; // ASCII
+  }
+
+  size_t offset = _byteCheckpoints[index / BYTE_CHECKPOINT_INTERVAL];
+  for (size_t i = index % BYTE_CHECKPOINT_INTERVAL; i > 0; --i) {
+    // Skip one code point, the length of which is given by its lead byte.
+    unsigned char lead = (unsigned char)_utf8Data[offset];
+    if (lead < 0x80) {
+      offset += 1;
+    } else if (lead < 0xE0) {
+      offset += 2;
+    } else if (lead < 0xF0) {
+      offset += 3;
+    } else {
+      offset += 4;
+    }
+  }
+  return offset;
+}
+
+Ref<misc::LineIndex> ANTLRInputStream::getLineIndex() {
+  if (_lineIndex == nullptr) {
+    _lineIndex = std::make_shared<misc::LineIndex>(data);
+  }
+  return _lineIndex;
 }
 
 void ANTLRInputStream::InitializeInstanceFields() {
   p = 0;
 }
+
+void ANTLRInputStream::computeByteOffsets() {
+  // Encode the converted data again (instead of keeping the loaded bytes), so offsets always match it.
+  _utf8Data = utfConverter.to_bytes(data);
+  _byteCheckpoints.clear();
+  _lineIndex.reset();
+  if (_utf8Data.size() == data.size()) {
+    return;
+  }
+
+  _byteCheckpoints.reserve(data.size() / BYTE_CHECKPOINT_INTERVAL + 1);
+  size_t offset = 0;
+  for (size_t i = 0; i < data.size(); ++i) {
+    if (i % BYTE_CHECKPOINT_INTERVAL == 0) {
+      _byteCheckpoints.push_back(offset);
+    }
+    char32_t c = data[i];
+    offset += c < 0x80 ? 1 : c < 0x800 ? 2 : c < 0x10000 ? 3 : 4;
+  }
+  if (data.size() % BYTE_CHECKPOINT_INTERVAL == 0) {
+    _byteCheckpoints.push_back(offset);
+  }
+}
@@ -49,6 +49,17 @@ namespace runtime {
     /// 0..n-1 index into string of next char </summary>
     size_t p;
 
+    /// The data in its original UTF-8 form, so that getText() can return a slice of it
+    /// instead of converting back from UTF-32 each time.
+    std::string _utf8Data;
+
+    /// Byte offsets into _utf8Data of every BYTE_CHECKPOINT_INTERVAL-th char. Empty if the
+    /// input is pure ASCII, in which case char indexes and byte offsets are the same.
+    std::vector<size_t> _byteCheckpoints;
+
+    /// Created on first request.
+    Ref<misc::LineIndex> _lineIndex;
+
   public:
     /// What is name or source of this char stream?
     std::string name;
@@ -90,8 +101,22 @@ namespace runtime {
     virtual std::string getSourceName() const override;
     virtual std::string toString() const override;
 
+    /// The input as UTF-8 (without a BOM). Together with getByteOffset() this allows to access
+    /// the text of a token or a rule context in place, without creating a copy.
+    const std::string& getUTF8Data() const;
+
+    /// Returns the offset in getUTF8Data() of the char with the given index. The index may be
+    /// size(), which gives the length of the UTF-8 data. This is O(1) for ASCII input and needs
+    /// at most BYTE_CHECKPOINT_INTERVAL steps otherwise.
+    size_t getByteOffset(size_t index) const;
+
+    virtual Ref<misc::LineIndex> getLineIndex() override;
+
   private:
+    static const size_t BYTE_CHECKPOINT_INTERVAL = 64;
+
     void InitializeInstanceFields();
+    void computeByteOffsets();
   };
 
 } // namespace runtime
@@ -30,6 +30,7 @@
  */
 
 #include "WritableToken.h"
+#include "CommonToken.h"
 #include "Lexer.h"
 #include "RuleContext.h"
 #include "misc/Interval.h"
@@ -122,7 +123,26 @@ size_t BufferedTokenStream::fetch(size_t n) {
     if (is<WritableToken>(t)) {
       (std::dynamic_pointer_cast<WritableToken>(t))->setTokenIndex((int)_tokens.size());
     }
+
+    CommonToken *commonToken = dynamic_cast<CommonToken *>(t.get());
+    if (commonToken == nullptr || commonToken->hasOwnText() || t->getType() == Token::EOF ||
+        t->getInputStream() == nullptr) {
+      _textRunStarts.push_back((size_t)-1);
+    } else {
+      size_t runStart = _tokens.size();
+      if (!_tokens.empty() && _textRunStarts.back() != (size_t)-1) {
+        const Ref<Token> &previous = _tokens.back();
+        if (previous->getInputStream() == t->getInputStream() && previous->getStopIndex() + 1 == t->getStartIndex()) {
+          runStart = _textRunStarts.back();
+        }
+      }
+      _textRunStarts.push_back(runStart);
+    }
+
     _tokens.push_back(t);
+    if (t->getType() == Token::EOF || t->getChannel() == Lexer::DEFAULT_TOKEN_CHANNEL) {
+      _defaultChannelTokens.push_back(_tokens.size() - 1);
+    }
     if (t->getType() == Token::EOF) {
       _fetchedEOF = true;
       return i + 1;
@@ -213,6 +233,9 @@ void BufferedTokenStream::setup() {
 void BufferedTokenStream::setTokenSource(TokenSource *tokenSource) {
   _tokenSource = tokenSource;
   _tokens.clear();
+  _defaultChannelTokens.clear();
+  _textRunStarts.clear();
+  _channelCursor = 0;
   _fetchedEOF = false;
   _needSetup = true;
 }
@@ -260,6 +283,14 @@ std::vector<Ref<Token>> BufferedTokenStream::getTokens(int start, int stop, int
 }
 
 ssize_t BufferedTokenStream::nextTokenOnChannel(size_t i, size_t channel) {
+  if (channel == Lexer::DEFAULT_TOKEN_CHANNEL) {
+    size_t position = defaultChannelPosition(i);
+    if (position < _defaultChannelTokens.size()) {
+      return (ssize_t)_defaultChannelTokens[position];
+    }
+    return (ssize_t)size() - 1;
+  }
+
   sync(i);
   if (i >= size()) {
     return size() - 1;
@@ -284,6 +315,15 @@ ssize_t BufferedTokenStream::previousTokenOnChannel(size_t i, size_t channel) {
     return size() - 1;
   }
 
+  if (channel == Lexer::DEFAULT_TOKEN_CHANNEL) {
+    // Token i is buffered, so all on-channel tokens up to i are in the index.
+    auto iterator = std::upper_bound(_defaultChannelTokens.begin(), _defaultChannelTokens.end(), i);
+    if (iterator == _defaultChannelTokens.begin()) {
+      return -1;
+    }
+    return (ssize_t)*(iterator - 1);
+  }
+
   while (true) {
     Ref<Token> token = _tokens[i];
     if (token->getType() == Token::EOF || token->getChannel() == channel) {
@@ -291,10 +331,9 @@ ssize_t BufferedTokenStream::previousTokenOnChannel(size_t i, size_t channel) {
     }
 
     if (i == 0)
-      return i;
+      return -1;
     i--;
   }
-  return i;
 }
 
 std::vector<Ref<Token>> BufferedTokenStream::getHiddenTokensToRight(size_t tokenIndex, size_t channel) {
@@ -364,6 +403,29 @@ std::vector<Ref<Token>> BufferedTokenStream::filterForChannel(size_t from, size_
   return hidden;
 }
 
+size_t BufferedTokenStream::defaultChannelPosition(size_t i) {
+  while ((_defaultChannelTokens.empty() || _defaultChannelTokens.back() < i) && !_fetchedEOF) {
+    fetch(1);
+  }
+
+  // Sequential access (consume, LT) almost always asks for the last position or the one after it.
+  size_t count = _defaultChannelTokens.size();
+  if (_channelCursor < count && _defaultChannelTokens[_channelCursor] >= i) {
+    if (_channelCursor == 0 || _defaultChannelTokens[_channelCursor - 1] < i) {
+      return _channelCursor;
+    }
+  } else if (_channelCursor + 1 < count && _defaultChannelTokens[_channelCursor + 1] >= i) {
+    return ++_channelCursor;
+  }
+
+  size_t position = (size_t)(std::lower_bound(_defaultChannelTokens.begin(), _defaultChannelTokens.end(), i) -
+    _defaultChannelTokens.begin());
+  if (position < count) {
+    _channelCursor = position;
+  }
+  return position;
+}
+
 bool BufferedTokenStream::isInitialized() const {
   return !_needSetup;
 }
@@ -392,16 +454,42 @@ std::string BufferedTokenStream::getText(const misc::Interval &interval) {
   if (stop >= (int)_tokens.size()) {
     stop = (int)_tokens.size() - 1;
   }
+  if (stop >= 0 && _tokens[(size_t)stop]->getType() == Token::EOF) {
+    --stop; // EOF can only be the last token and has no text.
+  }
+  if (start > stop) {
+    return "";
+  }
+
+  // Tokens which directly follow each other in the input can be returned as one piece. Text or positions
+  // can be changed after the tokens were fetched (e.g. by parser actions), which is rare enough that the
+  // tokens are only checked if it happened to any token.
+  size_t runStart = _textRunStarts[(size_t)stop];
+  if (runStart != (size_t)-1 && runStart <= (size_t)start &&
+      (CommonToken::getTextModifiedCount() == 0 || !isTextModified((size_t)start, (size_t)stop))) {
+    const Ref<Token> &first = _tokens[(size_t)start];
+    return first->getInputStream()->getText(misc::Interval(first->getStartIndex(), _tokens[(size_t)stop]->getStopIndex()));
+  }
 
-  std::stringstream ss;
+  std::string result;
   for (size_t i = (size_t)start; i <= (size_t)stop; i++) {
     Ref<Token> t = _tokens[i];
     if (t->getType() == Token::EOF) {
       break;
     }
-    ss << t->getText();
+    result += t->getText();
+  }
+  return result;
+}
+
+bool BufferedTokenStream::isTextModified(size_t start, size_t stop) const {
+  // Only CommonTokens are recorded in _textRunStarts.
+  for (size_t i = start; i <= stop; ++i) {
+    if (static_cast<const CommonToken *>(_tokens[i].get())->isTextModified()) {
+      return true;
+    }
   }
-  return ss.str();
+  return false;
 }
 
 std::string BufferedTokenStream::getText(RuleContext *ctx) {
@@ -428,6 +516,8 @@ void BufferedTokenStream::fill() {
 }
 
 void BufferedTokenStream::InitializeInstanceFields() {
+  _p = 0;
   _needSetup = true;
   _fetchedEOF = false;
+  _channelCursor = 0;
 }
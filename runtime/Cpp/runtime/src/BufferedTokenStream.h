@@ -163,6 +163,36 @@ namespace runtime {
      * <ul>
      */
     bool _fetchedEOF;
+
+    /**
+     * The indexes into {@link #tokens} of all tokens on the default channel, plus
+     * the EOF token (which is treated as being on every channel), in ascending
+     * order. This list is filled by {@link #fetch} and lets the lookahead methods
+     * and the hidden token queries find on-channel tokens without rescanning the
+     * off-channel tokens between them.
+     * <p>
+     * The channel of a token is read when it is fetched. Changing the channel of
+     * a token which is already in the buffer is not reflected here.</p>
+     */
+    std::vector<size_t> _defaultChannelTokens;
+
+    /**
+     * For each token in {@link #tokens} the index of the first token of the run
+     * ending at it, in which every token takes its text from the input stream and
+     * starts right after the previous one ends. {@code -1} for tokens which carry
+     * their own text (and for EOF). For a range within one run
+     * {@link #getText(Interval)} returns a single slice of the input instead of
+     * concatenating the text of each token.
+     * <p>
+     * This is computed when a token is fetched. Tokens changed later (e.g. by
+     * {@link CommonToken#setText} in a parser action) are marked by
+     * {@link CommonToken#isTextModified}, which {@link #getText(Interval)}
+     * checks only if any token was changed at all.</p>
+     */
+    std::vector<size_t> _textRunStarts;
+
+    /// True if any of the tokens in [start, stop] was changed after it was fetched.
+    bool isTextModified(size_t start, size_t stop) const;
     
     /// <summary>
     /// Make sure index {@code i} in tokens has a token.
@@ -217,10 +247,18 @@ namespace runtime {
     
     virtual std::vector<Ref<Token>> filterForChannel(size_t from, size_t to, ssize_t channel);
 
+    /// Returns the position in _defaultChannelTokens of the first on-channel token at or after
+    /// token index {@code i}, fetching tokens as needed. Returns _defaultChannelTokens.size() if
+    /// {@code i} is beyond the EOF token.
+    size_t defaultChannelPosition(size_t i);
+
     bool isInitialized() const;
 
   private:
     bool _needSetup;
+
+    // The position in _defaultChannelTokens returned last, to make sequential lookups O(1).
+    size_t _channelCursor;
     void InitializeInstanceFields();
   };
 
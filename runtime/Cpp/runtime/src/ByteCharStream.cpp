@@ -0,0 +1,121 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Exceptions.h"
+#include "misc/Interval.h"
+#include "misc/LineIndex.h"
+
+#include "ByteCharStream.h"
+
+using namespace org::antlr::v4::runtime;
+
+using misc::Interval;
+
+ByteCharStream::ByteCharStream(const std::string &input) {
+  load(input);
+}
+
+ByteCharStream::ByteCharStream(const char *data, size_t length) : _data(data), _size(length), _p(0) {
+}
+
+void ByteCharStream::load(const std::string &input) {
+  _ownedData = input;
+  _data = _ownedData.data();
+  _size = _ownedData.size();
+  _p = 0;
+  _lineIndex.reset();
+}
+
+void ByteCharStream::reset() {
+  _p = 0;
+}
+
+ssize_t ByteCharStream::mark() {
+  return -1;
+}
+
+void ByteCharStream::release(ssize_t /* marker */) {
+}
+
+void ByteCharStream::seek(size_t index) {
+  _p = std::min(index, _size);
+}
+
+std::string ByteCharStream::getText(const Interval &interval) {
+  if (interval.a < 0 || interval.b < interval.a) {
+    return "";
+  }
+
+  size_t start = (size_t)interval.a;
+  size_t stop = (size_t)interval.b;
+  if (start >= _size) {
+    return "";
+  }
+  if (stop >= _size) {
+    stop = _size - 1;
+  }
+
+  std::string result;
+  result.reserve(stop - start + 1);
+  for (size_t i = start; i <= stop; ++i) {
+    unsigned char c = (unsigned char)_data[i];
+    if (c < 0x80) {
+      result += (char)c;
+    } else {
+      // Latin-1 to UTF-8.
+      result += (char)(0xC0 | (c >> 6));
+      result += (char)(0x80 | (c & 0x3F));
+    }
+  }
+  return result;
+}
+
+std::string ByteCharStream::getSourceName() const {
+  if (name.empty()) {
+    return IntStream::UNKNOWN_SOURCE_NAME;
+  }
+  return name;
+}
+
+std::string ByteCharStream::toString() const {
+  return const_cast<ByteCharStream *>(this)->getText(Interval(0, (int)_size - 1));
+}
+
+Ref<misc::LineIndex> ByteCharStream::getLineIndex() {
+  if (_lineIndex == nullptr) {
+    _lineIndex = std::make_shared<misc::LineIndex>(_data, _size);
+  }
+  return _lineIndex;
+}
+
+void ByteCharStream::throwConsumeEOF() const {
+  throw IllegalStateException("cannot consume EOF");
+}
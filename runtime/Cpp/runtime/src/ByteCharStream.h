@@ -0,0 +1,128 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "CharStream.h"
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+
+  /// A char stream over a buffer of bytes, for grammars which only deal with 8 bit input (ASCII or Latin-1).
+  /// Each byte is one char (0..255), so there's no conversion to UTF-32 when loading and LA() is a plain
+  /// array access. The class is final and its hot methods are inline, so code which knows the stream type
+  /// (like the LexerATNSimulator match loop) can use them without virtual calls.
+  ///
+  /// Text returned by getText() and toString() is UTF-8 encoded, like that of ANTLRInputStream.
+  class ANTLR4CPP_PUBLIC ByteCharStream final : public CharStream {
+  public:
+    /// What is name or source of this char stream?
+    std::string name;
+
+    /// Creates a stream over a copy of the given input.
+    ByteCharStream(const std::string &input = "");
+
+    /// Creates a stream directly over the given buffer, without copying it. The buffer must stay alive
+    /// and unchanged as long as the stream (and any token referring to it) is in use.
+    ByteCharStream(const char *data, size_t length);
+
+    ByteCharStream(const ByteCharStream &) = delete;
+    ByteCharStream& operator = (const ByteCharStream &) = delete;
+
+    virtual void load(const std::string &input);
+
+    /// Reset the stream so that it's in the same state it was
+    /// when the object was created *except* the data array is not
+    /// touched.
+    virtual void reset();
+
+    virtual void consume() override {
+      if (_p >= _size) {
+        throwConsumeEOF();
+      }
+      ++_p;
+    }
+
+    virtual ssize_t LA(ssize_t i) override {
+      if (i > 0) {
+        size_t index = _p + (size_t)i - 1;
+        return index < _size ? (ssize_t)(unsigned char)_data[index] : IntStream::EOF;
+      }
+      if (i == 0) {
+        return 0; // undefined
+      }
+      ssize_t index = (ssize_t)_p + i; // LA(-1) is the char before p
+      return index < 0 ? IntStream::EOF : (ssize_t)(unsigned char)_data[index];
+    }
+
+    virtual size_t index() override {
+      return _p;
+    }
+
+    virtual size_t size() override {
+      return _size;
+    }
+
+    /// The raw bytes of the stream, size() of them.
+    const char* getData() const {
+      return _data;
+    }
+
+    /// mark/release do nothing; we have entire buffer
+    virtual ssize_t mark() override;
+    virtual void release(ssize_t marker) override;
+    virtual void seek(size_t index) override;
+
+    virtual std::string getText(const misc::Interval &interval) override;
+    virtual std::string getSourceName() const override;
+    virtual std::string toString() const override;
+
+    virtual Ref<misc::LineIndex> getLineIndex() override;
+
+  private:
+    std::string _ownedData;
+    const char *_data;
+    size_t _size;
+
+    /// 0..n-1 index into the data of next char
+    size_t _p;
+
+    Ref<misc::LineIndex> _lineIndex;
+
+    void throwConsumeEOF() const;
+  };
+
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
@@ -35,3 +35,7 @@ using namespace org::antlr::v4::runtime;
 
 CharStream::~CharStream() {
 }
+
+Ref<misc::LineIndex> CharStream::getLineIndex() {
+  return nullptr;
+}
@@ -61,6 +61,10 @@ namespace runtime {
     virtual std::string getText(const misc::Interval &interval) = 0;
 
     virtual std::string toString() const = 0;
+
+    /// Returns an index of the line starts in this stream, which is shared by all users of the stream.
+    /// Streams which don't hold their entire input return null (the default).
+    virtual Ref<misc::LineIndex> getLineIndex();
   };
 
 } // namespace runtime
@@ -0,0 +1,402 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Parser.h"
+#include "ParserRuleContext.h"
+#include "Token.h"
+#include "TokenStream.h"
+#include "atn/ATN.h"
+#include "atn/RuleStartState.h"
+#include "atn/RuleTransition.h"
+#include "atn/PredicateTransition.h"
+#include "atn/PrecedencePredicateTransition.h"
+#include "atn/SemanticContext.h"
+#include "misc/MurmurHash.h"
+
+#include "CodeCompletionCore.h"
+
+using namespace org::antlr::v4::runtime;
+using namespace org::antlr::v4::runtime::atn;
+
+CodeCompletionCore::CodeCompletionCore(Parser *parser)
+  : _parser(parser), _atn(parser->getATN()), _statesProcessed(0) {
+}
+
+CodeCompletionCore::CandidatesCollection CodeCompletionCore::collectCandidates(size_t caretTokenIndex,
+  Ref<ParserRuleContext> context) {
+  _shortcutMap.clear();
+  _candidates.tokens.clear();
+  _candidates.rules.clear();
+  _precedenceStack.clear();
+  _tokens.clear();
+  _statesProcessed = 0;
+
+  // Collect the on-channel token types from the start token up to the caret.
+  size_t tokenStartIndex = 0;
+  if (context != nullptr && context->start != nullptr) {
+    tokenStartIndex = (size_t)context->start->getTokenIndex();
+  }
+  TokenStream *tokenStream = _parser->getTokenStream();
+  size_t currentIndex = tokenStream->index();
+  tokenStream->seek(tokenStartIndex);
+  while (true) {
+    Ref<Token> token = tokenStream->LT(1);
+    _tokens.push_back(token->getType());
+    if ((size_t)token->getTokenIndex() >= caretTokenIndex || token->getType() == Token::EOF) {
+      break;
+    }
+    tokenStream->consume();
+  }
+  tokenStream->seek(currentIndex);
+
+  std::vector<size_t> callStack;
+  size_t startRule = context != nullptr ? (size_t)context->getRuleIndex() : 0;
+  processRule(_atn.ruleToStartState[startRule], 0, callStack, 0);
+
+  return _candidates;
+}
+
+size_t CodeCompletionCore::ShortcutKeyHasher::operator()(const ShortcutKey &key) const {
+  size_t hash = misc::MurmurHash::initialize();
+  hash = misc::MurmurHash::update(hash, key.state);
+  hash = misc::MurmurHash::update(hash, key.tokenListIndex);
+  hash = misc::MurmurHash::update(hash, (size_t)key.precedence);
+  return misc::MurmurHash::finish(hash, 3);
+}
+
+size_t CodeCompletionCore::getStatesProcessed() const {
+  return _statesProcessed;
+}
+
+bool CodeCompletionCore::checkPredicate(PredicateTransition *transition) {
+  return transition->getPredicate()->eval(_parser, ParserRuleContext::EMPTY);
+}
+
+bool CodeCompletionCore::translateStackToRuleIndex(const std::vector<size_t> &ruleStack) {
+  if (preferredRules.empty()) {
+    return false;
+  }
+
+  // The outermost preferred rule wins.
+  for (size_t i = 0; i < ruleStack.size(); ++i) {
+    if (preferredRules.count(ruleStack[i]) > 0) {
+      _candidates.rules[ruleStack[i]] = std::vector<size_t>(ruleStack.begin(), ruleStack.begin() + (ssize_t)i);
+      return true;
+    }
+  }
+  return false;
+}
+
+void CodeCompletionCore::addTokenCandidates(const misc::IntervalSet &set, const std::vector<ssize_t> &following) {
+  for (int symbol : set.toList()) {
+    if (symbol == Token::EPSILON || ignoredTokens.count(symbol) > 0) {
+      continue;
+    }
+
+    auto iterator = _candidates.tokens.find(symbol);
+    if (iterator == _candidates.tokens.end()) {
+      _candidates.tokens[symbol] = following;
+    } else if (iterator->second != following) {
+      // Different following tokens for the same symbol, so none of them always follows.
+      iterator->second.clear();
+    }
+  }
+}
+
+std::vector<ssize_t> CodeCompletionCore::getFollowingTokens(Transition *transition) {
+  // Single tokens which always follow the given transition, e.g. a keyword sequence.
+  std::vector<ssize_t> result;
+  std::vector<ATNState *> pipeline = { transition->target };
+  while (!pipeline.empty()) {
+    ATNState *state = pipeline.back();
+    pipeline.pop_back();
+
+    // Sequences are glued together by single epsilon transitions, so look through them. Anything
+    // with more than one way out ends the sequence.
+    if (state->getNumberOfTransitions() != 1) {
+      continue;
+    }
+
+    Transition *outgoing = state->transition(0);
+    if (outgoing->getSerializationType() == Transition::EPSILON) {
+      if (outgoing->target->getStateType() != ATNState::RULE_STOP) {
+        pipeline.push_back(outgoing->target);
+      }
+    } else if (outgoing->getSerializationType() == Transition::ATOM) {
+      std::vector<int> list = outgoing->label().toList();
+      if (list.size() == 1 && ignoredTokens.count(list[0]) == 0) {
+        result.push_back(list[0]);
+        pipeline.push_back(outgoing->target);
+      }
+    }
+  }
+  return result;
+}
+
+const CodeCompletionCore::FollowSetsHolder& CodeCompletionCore::getFollowSets(ATNState *startState) {
+  auto iterator = _followSetsByState.find((size_t)startState->stateNumber);
+  if (iterator != _followSetsByState.end()) {
+    return iterator->second;
+  }
+
+  FollowSetsHolder &holder = _followSetsByState[(size_t)startState->stateNumber];
+  std::set<std::pair<ATNState *, ATNState *>> seen;
+  std::vector<size_t> ruleStack;
+  std::vector<ATNState *> followStack;
+  collectFollowSets(startState, holder.sets, seen, ruleStack, followStack);
+
+  // The sets are split by path to allow translating them to preferred rules. For a quick check if a rule
+  // can match a token all symbols are combined too.
+  for (auto &set : holder.sets) {
+    holder.combined.addAll(set.intervals);
+  }
+  return holder;
+}
+
+void CodeCompletionCore::collectFollowSets(ATNState *s, std::vector<FollowSetWithPath> &followSets,
+  std::set<std::pair<ATNState *, ATNState *>> &seen, std::vector<size_t> &ruleStack,
+  std::vector<ATNState *> &followStack) {
+
+  ATNState *returnState = followStack.empty() ? nullptr : followStack.back();
+  if (!seen.insert({ s, returnState }).second) {
+    return;
+  }
+
+  if (s->getStateType() == ATNState::RULE_STOP) {
+    if (returnState == nullptr) {
+      // The end of the rule can be reached without matching a token.
+      followSets.push_back({ misc::IntervalSet::of((int)Token::EPSILON), ruleStack, {} });
+      return;
+    }
+
+    // Continue after the invocation of the rule just left.
+    size_t ruleIndex = ruleStack.back();
+    followStack.pop_back();
+    ruleStack.pop_back();
+    collectFollowSets(returnState, followSets, seen, ruleStack, followStack);
+    ruleStack.push_back(ruleIndex);
+    followStack.push_back(returnState);
+    return;
+  }
+
+  for (size_t i = 0; i < s->getNumberOfTransitions(); ++i) {
+    Transition *transition = s->transition(i);
+    switch (transition->getSerializationType()) {
+      case Transition::RULE: {
+        RuleTransition *ruleTransition = static_cast<RuleTransition *>(transition);
+        size_t ruleIndex = (size_t)ruleTransition->target->ruleIndex;
+        if (std::find(ruleStack.begin(), ruleStack.end(), ruleIndex) != ruleStack.end()) {
+          continue;
+        }
+
+        ruleStack.push_back(ruleIndex);
+        followStack.push_back(ruleTransition->followState);
+        collectFollowSets(transition->target, followSets, seen, ruleStack, followStack);
+        followStack.pop_back();
+        ruleStack.pop_back();
+        break;
+      }
+
+      case Transition::PREDICATE:
+        if (checkPredicate(static_cast<PredicateTransition *>(transition))) {
+          collectFollowSets(transition->target, followSets, seen, ruleStack, followStack);
+        }
+        break;
+
+      case Transition::WILDCARD:
+        followSets.push_back({ misc::IntervalSet::of((int)Token::MIN_USER_TOKEN_TYPE, (int)_atn.maxTokenType),
+          ruleStack, {} });
+        break;
+
+      default:
+        if (transition->isEpsilon()) {
+          collectFollowSets(transition->target, followSets, seen, ruleStack, followStack);
+        } else {
+          misc::IntervalSet label = transition->label();
+          if (!label.isEmpty()) {
+            if (transition->getSerializationType() == Transition::NOT_SET) {
+              misc::IntervalSet complemented = label.complement(misc::IntervalSet::of((int)Token::MIN_USER_TOKEN_TYPE,
+                (int)_atn.maxTokenType));
+              followSets.push_back({ complemented, ruleStack, getFollowingTokens(transition) });
+            } else {
+              followSets.push_back({ label, ruleStack, getFollowingTokens(transition) });
+            }
+          }
+        }
+        break;
+    }
+  }
+}
+
+CodeCompletionCore::RuleEndStatus CodeCompletionCore::processRule(ATNState *startState, size_t tokenListIndex,
+  std::vector<size_t> &callStack, int precedence) {
+
+  // Check first if we've taken this path with the same input before.
+  ShortcutKey key = { (size_t)startState->stateNumber, tokenListIndex, precedence };
+  auto cached = _shortcutMap.find(key);
+  if (cached != _shortcutMap.end()) {
+    return cached->second;
+  }
+
+  RuleEndStatus result;
+  const FollowSetsHolder &followSets = getFollowSets(startState);
+  bool isLeftRecursive = static_cast<RuleStartState *>(startState)->isLeftRecursiveRule;
+  if (isLeftRecursive) {
+    _precedenceStack.push_back(precedence);
+  }
+  callStack.push_back((size_t)startState->ruleIndex);
+
+  auto finish = [&]() {
+    callStack.pop_back();
+    if (isLeftRecursive) {
+      _precedenceStack.pop_back();
+    }
+    _shortcutMap[key] = result;
+    return result;
+  };
+
+  if (tokenListIndex >= _tokens.size() - 1) { // At the caret?
+    if (preferredRules.count((size_t)startState->ruleIndex) > 0) {
+      // No need to go deeper for a rule we collect anyway.
+      translateStackToRuleIndex(callStack);
+    } else {
+      for (auto &set : followSets.sets) {
+        std::vector<size_t> fullPath = callStack;
+        fullPath.insert(fullPath.end(), set.path.begin(), set.path.end());
+        if (!translateStackToRuleIndex(fullPath)) {
+          addTokenCandidates(set.intervals, set.following);
+        }
+      }
+    }
+
+    // If the rule can be left without matching a token, the caller continues at the caret.
+    if (followSets.combined.contains((int)Token::EPSILON)) {
+      result.push_back(tokenListIndex);
+    }
+    return finish();
+  }
+
+  // Process the rule only if it can be left without consuming anything or the current token can be matched in it.
+  ssize_t currentSymbol = _tokens[tokenListIndex];
+  if (!followSets.combined.contains((int)Token::EPSILON) && !followSets.combined.contains((int)currentSymbol)) {
+    return finish();
+  }
+
+  // The states yet to be processed in this rule, each with the token index at which it is reached. A state
+  // reached again at the same token index has the same outcome, so that is skipped.
+  std::vector<PipelineEntry> statePipeline = { { startState, tokenListIndex } };
+  std::unordered_set<size_t> processed;
+  while (!statePipeline.empty()) {
+    PipelineEntry currentEntry = statePipeline.back();
+    statePipeline.pop_back();
+    size_t processedKey = currentEntry.tokenListIndex * _atn.states.size() + (size_t)currentEntry.state->stateNumber;
+    if (!processed.insert(processedKey).second) {
+      continue;
+    }
+    ++_statesProcessed;
+
+    currentSymbol = _tokens[currentEntry.tokenListIndex];
+    bool atCaret = currentEntry.tokenListIndex >= _tokens.size() - 1;
+
+    if (currentEntry.state->getStateType() == ATNState::RULE_STOP) {
+      // Record the token index we are at, to report it to the caller.
+      if (std::find(result.begin(), result.end(), currentEntry.tokenListIndex) == result.end()) {
+        result.push_back(currentEntry.tokenListIndex);
+      }
+      continue;
+    }
+
+    for (size_t i = 0; i < currentEntry.state->getNumberOfTransitions(); ++i) {
+      Transition *transition = currentEntry.state->transition(i);
+      switch (transition->getSerializationType()) {
+        case Transition::RULE: {
+          RuleTransition *ruleTransition = static_cast<RuleTransition *>(transition);
+          RuleEndStatus endStatus = processRule(transition->target, currentEntry.tokenListIndex, callStack,
+            ruleTransition->precedence);
+          for (size_t position : endStatus) {
+            statePipeline.push_back({ ruleTransition->followState, position });
+          }
+          break;
+        }
+
+        case Transition::PREDICATE:
+          if (checkPredicate(static_cast<PredicateTransition *>(transition))) {
+            statePipeline.push_back({ transition->target, currentEntry.tokenListIndex });
+          }
+          break;
+
+        case Transition::PRECEDENCE: {
+          PrecedencePredicateTransition *predicate = static_cast<PrecedencePredicateTransition *>(transition);
+          if (_precedenceStack.empty() || predicate->precedence >= _precedenceStack.back()) {
+            statePipeline.push_back({ transition->target, currentEntry.tokenListIndex });
+          }
+          break;
+        }
+
+        case Transition::WILDCARD:
+          if (atCaret) {
+            if (!translateStackToRuleIndex(callStack)) {
+              addTokenCandidates(misc::IntervalSet::of((int)Token::MIN_USER_TOKEN_TYPE, (int)_atn.maxTokenType), {});
+            }
+          } else {
+            statePipeline.push_back({ transition->target, currentEntry.tokenListIndex + 1 });
+          }
+          break;
+
+        default: {
+          if (transition->isEpsilon()) {
+            statePipeline.push_back({ transition->target, currentEntry.tokenListIndex });
+            break;
+          }
+
+          misc::IntervalSet label = transition->label();
+          if (label.isEmpty()) {
+            break;
+          }
+          misc::IntervalSet set = transition->getSerializationType() == Transition::NOT_SET
+            ? label.complement(misc::IntervalSet::of((int)Token::MIN_USER_TOKEN_TYPE, (int)_atn.maxTokenType))
+            : label;
+
+          if (atCaret) {
+            if (!translateStackToRuleIndex(callStack)) {
+              addTokenCandidates(set, set.size() == 1 ? getFollowingTokens(transition) : std::vector<ssize_t>());
+            }
+          } else if (set.contains((int)currentSymbol)) {
+            statePipeline.push_back({ transition->target, currentEntry.tokenListIndex + 1 });
+          }
+          break;
+        }
+      }
+    }
+  }
+
+  return finish();
+}
@@ -0,0 +1,145 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "misc/IntervalSet.h"
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+
+  /// <summary>
+  /// Collects the tokens and rules which can appear at a given token position (the caret), for code completion.
+  /// Starting with the start rule of the grammar (or the rule of a given context) the parser's ATN is walked over
+  /// the tokens up to the caret, and everything which can match the token at the caret is collected: token types
+  /// and "preferred" rules. Preferred rules are reported instead of the tokens they match, e.g. to offer symbol
+  /// names in place of the identifier token.
+  /// <p/>
+  /// The walk uses the same shortcuts as the prediction: rules are only entered if their first set (computed once
+  /// per rule and kept for the lifetime of the instance) contains the next token, and the end positions of a rule
+  /// walked from a given token are reused within a query. Keep one instance per parser to make use of the first set
+  /// cache. Predicates are evaluated without a context, actions are ignored.
+  /// </summary>
+  class ANTLR4CPP_PUBLIC CodeCompletionCore {
+  public:
+    struct CandidatesCollection {
+      /// Candidate token types, each with the tokens which always follow it (e.g. for keyword sequences).
+      std::map<ssize_t, std::vector<ssize_t>> tokens;
+
+      /// Candidate rules (from the preferred rules), each with the rule invocation stack leading to it.
+      std::map<size_t, std::vector<size_t>> rules;
+    };
+
+    /// Rules which are reported as candidates instead of the tokens they match.
+    std::set<size_t> preferredRules;
+
+    /// Token types which are never reported (e.g. operators).
+    std::set<ssize_t> ignoredTokens;
+
+    CodeCompletionCore(Parser *parser);
+    virtual ~CodeCompletionCore() {};
+
+    /// <summary>
+    /// Collects the candidates for the first on-channel token at or after {@code caretTokenIndex} in the parser's
+    /// token stream. If {@code context} is given the walk starts at its start token with its rule, otherwise at the
+    /// first token with rule 0. The position of the token stream is restored afterwards.
+    /// </summary>
+    virtual CandidatesCollection collectCandidates(size_t caretTokenIndex, Ref<ParserRuleContext> context = nullptr);
+
+    /// The number of ATN states processed by the last collectCandidates() call.
+    size_t getStatesProcessed() const;
+
+  protected:
+    virtual bool checkPredicate(atn::PredicateTransition *transition);
+
+  private:
+    struct FollowSetWithPath {
+      misc::IntervalSet intervals;
+      std::vector<size_t> path; // The rules entered to reach the tokens (not including the rule itself).
+      std::vector<ssize_t> following;
+    };
+
+    struct FollowSetsHolder {
+      std::vector<FollowSetWithPath> sets;
+      misc::IntervalSet combined;
+    };
+
+    struct PipelineEntry {
+      atn::ATNState *state;
+      size_t tokenListIndex;
+    };
+
+    // The token indices at which a rule walk ends.
+    using RuleEndStatus = std::vector<size_t>;
+
+    struct ShortcutKey {
+      size_t state;
+      size_t tokenListIndex;
+      int precedence;
+
+      bool operator == (const ShortcutKey &other) const {
+        return state == other.state && tokenListIndex == other.tokenListIndex && precedence == other.precedence;
+      }
+    };
+
+    struct ShortcutKeyHasher {
+      size_t operator()(const ShortcutKey &key) const;
+    };
+
+    Parser *_parser;
+    const atn::ATN &_atn;
+
+    std::unordered_map<size_t, FollowSetsHolder> _followSetsByState;
+
+    // Per query.
+    std::vector<ssize_t> _tokens;
+    std::vector<int> _precedenceStack;
+    std::unordered_map<ShortcutKey, RuleEndStatus, ShortcutKeyHasher> _shortcutMap;
+    CandidatesCollection _candidates;
+    size_t _statesProcessed;
+
+    bool translateStackToRuleIndex(const std::vector<size_t> &ruleStack);
+    void addTokenCandidates(const misc::IntervalSet &set, const std::vector<ssize_t> &following);
+    std::vector<ssize_t> getFollowingTokens(atn::Transition *transition);
+    const FollowSetsHolder& getFollowSets(atn::ATNState *startState);
+    void collectFollowSets(atn::ATNState *s, std::vector<FollowSetWithPath> &followSets,
+      std::set<std::pair<atn::ATNState *, atn::ATNState *>> &seen, std::vector<size_t> &ruleStack,
+      std::vector<atn::ATNState *> &followStack);
+    RuleEndStatus processRule(atn::ATNState *startState, size_t tokenListIndex, std::vector<size_t> &callStack,
+      int precedence);
+  };
+
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
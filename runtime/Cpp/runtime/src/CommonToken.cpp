@@ -41,6 +41,7 @@ using namespace org::antlr::v4::runtime;
 using namespace antlrcpp;
 
 const std::pair<TokenSource*, CharStream*> CommonToken::EMPTY_SOURCE;
+std::atomic<size_t> CommonToken::_textModifiedCount(0);
 
 CommonToken::CommonToken(int type) {
   InitializeInstanceFields();
@@ -112,7 +113,27 @@ std::string CommonToken::getText() const {
   }
 }
 
+bool CommonToken::hasOwnText() const {
+  return !_text.empty();
+}
+
+bool CommonToken::isTextModified() const {
+  return _textModified;
+}
+
+size_t CommonToken::getTextModifiedCount() {
+  return _textModifiedCount;
+}
+
+void CommonToken::markTextModified() {
+  if (_index != -1 && !_textModified) {
+    _textModified = true;
+    ++_textModifiedCount;
+  }
+}
+
 void CommonToken::setText(const std::string &text) {
+  markTextModified();
   _text = text;
 }
 
@@ -145,6 +166,7 @@ int CommonToken::getStartIndex() const {
 }
 
 void CommonToken::setStartIndex(int start) {
+  markTextModified();
   _start = start;
 }
 
@@ -153,6 +175,7 @@ int CommonToken::getStopIndex() const {
 }
 
 void CommonToken::setStopIndex(int stop) {
+  markTextModified();
   _stop = stop;
 }
 
@@ -202,5 +225,6 @@ void CommonToken::InitializeInstanceFields() {
   _index = -1;
   _start = 0;
   _stop = 0;
+  _textModified = false;
   _source = EMPTY_SOURCE;
 }
@@ -107,6 +107,19 @@ namespace runtime {
      */
     int _stop;
 
+    /**
+     * Set by {@link #markTextModified}, see {@link #isTextModified}.
+     */
+    bool _textModified;
+
+    /**
+     * Records that the text or the input range of this token changes. Only
+     * changes made after the token got its index in a token stream count.
+     * Subclasses which override {@link #setText}, {@link #setStartIndex} or
+     * {@link #setStopIndex} must call this.
+     */
+    void markTextModified();
+
   public:
     /**
      * Constructs a new {@link CommonToken} with the specified token type.
@@ -154,6 +167,19 @@ namespace runtime {
     virtual void setText(const std::string &text) override;
     virtual std::string getText() const override;
 
+    /// Returns true if this token carries its own text (set explicitly or copied by the token factory),
+    /// false if {@link #getText} reads the text from the input stream.
+    virtual bool hasOwnText() const;
+
+    /// Returns true if the text or the input range of this token were changed after it was added to a token
+    /// stream (e.g. by a parser action). Token streams return the text of a range of unchanged tokens as one
+    /// slice of the input.
+    bool isTextModified() const;
+
+    /// The number of tokens for which isTextModified() became true so far. While this is 0, which is the
+    /// normal case, token streams don't need to check their tokens one by one.
+    static size_t getTextModifiedCount();
+
     virtual void setLine(int line) override;
     virtual int getLine() const override;
 
@@ -180,6 +206,8 @@ namespace runtime {
     virtual std::string toString() const override;
     
   private:
+    static std::atomic<size_t> _textModifiedCount;
+
     void InitializeInstanceFields();
   };
 
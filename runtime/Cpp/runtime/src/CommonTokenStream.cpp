@@ -52,15 +52,23 @@ Ref<Token> CommonTokenStream::LB(size_t k) {
     return Ref<Token>();
   }
 
+  if (channel == Token::DEFAULT_CHANNEL) {
+    size_t position = defaultChannelPosition(_p);
+    if (k > position) {
+      return nullptr;
+    }
+    return _tokens[_defaultChannelTokens[position - k]];
+  }
+
   ssize_t i = (ssize_t)_p;
   size_t n = 1;
   // find k good tokens looking backwards
-  while (n <= k) {
+  while (n <= k && i > 0) {
     // skip off-channel tokens
-    i = previousTokenOnChannel(i - 1, channel);
+    i = previousTokenOnChannel((size_t)i - 1, channel);
     n++;
   }
-  if (i < 0) {
+  if (i < 0 || n <= k) {
     return nullptr;
   }
 
@@ -75,6 +83,19 @@ Ref<Token> CommonTokenStream::LT(ssize_t k) {
   if (k < 0) {
     return LB((size_t)-k);
   }
+
+  if (channel == Token::DEFAULT_CHANNEL) {
+    // The on-channel tokens are indexed, so the k-th one can be located directly.
+    size_t position = defaultChannelPosition(_p) + (size_t)k - 1;
+    while (position >= _defaultChannelTokens.size() && !_fetchedEOF) {
+      fetch(position - _defaultChannelTokens.size() + 1);
+    }
+    if (position >= _defaultChannelTokens.size()) {
+      return _tokens[_defaultChannelTokens.back()]; // EOF
+    }
+    return _tokens[_defaultChannelTokens[position]];
+  }
+
   size_t i = _p;
   ssize_t n = 1; // we know tokens[p] is a good one
                  // find k good tokens
@@ -92,6 +113,15 @@ Ref<Token> CommonTokenStream::LT(ssize_t k) {
 int CommonTokenStream::getNumberOfOnChannelTokens() {
   int n = 0;
   fill();
+  if (channel == Token::DEFAULT_CHANNEL) {
+    // The index ends with the EOF token, which counts only if it is on our channel.
+    n = (int)_defaultChannelTokens.size();
+    if (n > 0 && _tokens[_defaultChannelTokens.back()]->getChannel() != channel) {
+      n--;
+    }
+    return n;
+  }
+
   for (size_t i = 0; i < _tokens.size(); i++) {
     Ref<Token> t = _tokens[i];
     if (t->getChannel() == channel) {
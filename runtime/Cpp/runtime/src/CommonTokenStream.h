@@ -61,6 +61,11 @@ namespace runtime {
    * {@link Lexer#skip} do not produce tokens at all, so input text matched by
    * such a rule will not be available as part of the token stream, regardless of
    * channel.</p>
+   *
+   * <p>
+   * When filtering on the default channel, the lookahead methods use the index of
+   * on-channel tokens kept by {@link BufferedTokenStream}, so {@link #LT} and
+   * {@link #LB} don't depend on the number of hidden tokens in between.</p>
    */
   class ANTLR4CPP_PUBLIC CommonTokenStream : public BufferedTokenStream {
   protected:
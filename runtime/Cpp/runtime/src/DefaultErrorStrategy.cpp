@@ -135,7 +135,8 @@ void DefaultErrorStrategy::sync(Parser *recognizer) {
         return;
       }
 
-      throw InputMismatchException(recognizer);
+      recognizer->signalError(InputMismatchException(recognizer));
+      return;
 
     case atn::ATNState::PLUS_LOOP_BACK:
     case atn::ATNState::STAR_LOOP_BACK: {
@@ -226,8 +227,9 @@ Ref<Token> DefaultErrorStrategy::recoverInline(Parser *recognizer) {
     return getMissingSymbol(recognizer);
   }
 
-  // even that didn't work; must throw the exception
-  throw InputMismatchException(recognizer);
+  // even that didn't work; must throw the exception (or leave it pending)
+  recognizer->signalError(InputMismatchException(recognizer));
+  return nullptr;
 }
 
 bool DefaultErrorStrategy::singleTokenInsertion(Parser *recognizer) {
@@ -55,7 +55,9 @@ Lexer::Lexer(CharStream *input) : Recognizer(), _input(input) {
 
 void Lexer::reset() {
   // wack Lexer state variables
-  _input->seek(0); // rewind the input
+  if (_input != nullptr) {
+    _input->seek(0); // rewind the input
+  }
 
   token.reset();
   type = Token::INVALID_TYPE;
@@ -64,7 +64,7 @@ LexerInterpreter::LexerInterpreter(const std::string &grammarFileName, Ref<dfa::
   for (size_t i = 0; i < (size_t)atn.getNumberOfDecisions(); ++i) {
     _decisionToDFA.push_back(dfa::DFA(_atn.getDecisionState((int)i), (int)i));
   }
-  _interpreter = new atn::LexerATNSimulator(_atn, _decisionToDFA, _sharedContextCache); /* mem-check: deleted in d-tor */
+  _interpreter = new atn::LexerATNSimulator(this, _atn, _decisionToDFA, _sharedContextCache); /* mem-check: deleted in d-tor */
 }
 
 LexerInterpreter::~LexerInterpreter()
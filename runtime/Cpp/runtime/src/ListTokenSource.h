@@ -106,7 +106,8 @@ namespace runtime {
     /// </param>
     /// <exception cref="NullPointerException"> if {@code tokens} is {@code null} </exception>
     template<typename T1>
-    ListTokenSource(std::vector<T1> tokens, const std::string &/*sourceName*/) {
+    ListTokenSource(std::vector<T1> tokens, const std::string &sourceName)
+      : tokens(tokens.begin(), tokens.end()), sourceName(sourceName) {
       InitializeInstanceFields();
       if (tokens.empty()) {
         throw "tokens cannot be nul";
@@ -39,10 +39,12 @@
 #include "misc/IntervalSet.h"
 #include "atn/RuleStartState.h"
 #include "DefaultErrorStrategy.h"
+#include "BailErrorStrategy.h"
 #include "atn/ATNDeserializer.h"
 #include "atn/RuleTransition.h"
 #include "atn/ATN.h"
 #include "Exceptions.h"
+#include "RecognitionException.h"
 #include "ANTLRErrorListener.h"
 #include "tree/pattern/ParseTreePattern.h"
 
@@ -54,7 +56,18 @@
 using namespace org::antlr::v4::runtime;
 using namespace antlrcpp;
 
-std::map<std::vector<uint16_t>, atn::ATN> Parser::bypassAltsAtnCache;
+
+namespace {
+
+  // The error strategy for the first stage in parseTwoStage(). Errors are not reported from here as the
+  // input is parsed again in the second stage, which does the reporting then.
+  class SLLStageErrorStrategy : public BailErrorStrategy {
+  public:
+    virtual void reportError(Parser * /*recognizer*/, const RecognitionException &/*e*/) override {
+    }
+  };
+
+}
 
 Parser::TraceListener::TraceListener(Parser *outerInstance) : outerInstance(outerInstance) {
 }
@@ -107,7 +120,12 @@ void Parser::reset() {
   }
   _errHandler->reset(this); // Watch out, this is not shared_ptr.reset().
 
+  _ctx.reset();
   _syntaxErrors = 0;
+  _matchedEOF = false;
+
+  _pendingError.reset();
+  _pendingException = nullptr;
   setTrace(false);
   _precedenceStack.clear();
   _precedenceStack.push_back(0);
@@ -126,8 +144,8 @@ Ref<Token> Parser::match(int ttype) {
     _errHandler->reportMatch(this);
     consume();
   } else {
-    t = _errHandler->recoverInline(this);
-    if (_buildParseTrees && t->getTokenIndex() == -1) {
+    t = _errHandler->recoverInline(this); // Null if the error is pending (exception free error handling).
+    if (_buildParseTrees && t != nullptr && t->getTokenIndex() == -1) {
       // we must have conjured up a new token during single token insertion
       // if it's not the current symbol
       _ctx->addErrorNode(t);
@@ -142,8 +160,8 @@ Ref<Token> Parser::matchWildcard() {
     _errHandler->reportMatch(this);
     consume();
   } else {
-    t = _errHandler->recoverInline(this);
-    if (_buildParseTrees && t->getTokenIndex() == -1) {
+    t = _errHandler->recoverInline(this); // Null if the error is pending (exception free error handling).
+    if (_buildParseTrees && t != nullptr && t->getTokenIndex() == -1) {
       // we must have conjured up a new token during single token insertion
       // if it's not the current symbol
       _ctx->addErrorNode(t);
@@ -226,25 +244,36 @@ Ref<TokenFactory<CommonToken>> Parser::getTokenFactory() {
 
 
 const atn::ATN& Parser::getATNWithBypassAlts() {
+  const atn::ATN &atn = getATN();
+  {
+    std::lock_guard<std::mutex> lck(atn._bypassAltsAtnLock);
+    if (atn._bypassAltsAtn != nullptr) {
+      return *atn._bypassAltsAtn;
+    }
+  }
+
   std::vector<uint16_t> serializedAtn = getSerializedATN();
   if (serializedAtn.empty()) {
     throw UnsupportedOperationException("The current parser does not support an ATN with bypass alternatives.");
   }
 
-  std::lock_guard<std::recursive_mutex> lck(mtx);
+  return getATNWithBypassAlts(atn, serializedAtn);
+}
 
-  // XXX: using the entire serialized ATN as key into the map is a big resource waste.
-  //      How large can that thing become?
-  if (bypassAltsAtnCache.find(serializedAtn) == bypassAltsAtnCache.end())
-  {
+const atn::ATN& Parser::getATNWithBypassAlts(const atn::ATN &atn, const std::vector<uint16_t> &serializedAtn) {
+  // Deserialize while holding the lock, so concurrent callers for the same grammar don't do the work twice.
+  std::lock_guard<std::mutex> lck(atn._bypassAltsAtnLock);
+  if (atn._bypassAltsAtn == nullptr) {
     atn::ATNDeserializationOptions deserializationOptions;
     deserializationOptions.setGenerateRuleBypassTransitions(true);
 
     atn::ATNDeserializer deserializer(deserializationOptions);
-    bypassAltsAtnCache[serializedAtn] = deserializer.deserialize(serializedAtn);
+    Ref<atn::ATN> result = std::make_shared<atn::ATN>();
+    *result = deserializer.deserialize(serializedAtn);
+    atn._bypassAltsAtn = result;
   }
 
-  return bypassAltsAtnCache[serializedAtn];
+  return *atn._bypassAltsAtn;
 }
 
 tree::pattern::ParseTreePattern Parser::compileParseTreePattern(const std::string &pattern, int patternRuleIndex) {
@@ -484,28 +513,30 @@ bool Parser::isExpectedToken(int symbol) {
   const atn::ATN &atn = getInterpreter<atn::ParserATNSimulator>()->atn;
   Ref<ParserRuleContext> ctx = _ctx;
   atn::ATNState *s = atn.states[(size_t)getState()];
-  misc::IntervalSet following = atn.nextTokens(s);
 
-  if (following.contains(symbol)) {
+  // The sets are cached in the ATN states, no need to copy them.
+  const misc::IntervalSet *following = &atn.nextTokens(s);
+
+  if (following->contains(symbol)) {
     return true;
   }
 
-  if (!following.contains(Token::EPSILON)) {
+  if (!following->contains(Token::EPSILON)) {
     return false;
   }
 
-  while (ctx && ctx->invokingState >= 0 && following.contains(Token::EPSILON)) {
+  while (ctx && ctx->invokingState >= 0 && following->contains(Token::EPSILON)) {
     atn::ATNState *invokingState = atn.states[(size_t)ctx->invokingState];
     atn::RuleTransition *rt = static_cast<atn::RuleTransition*>(invokingState->transition(0));
-    following = atn.nextTokens(rt->followState);
-    if (following.contains(symbol)) {
+    following = &atn.nextTokens(rt->followState);
+    if (following->contains(symbol)) {
       return true;
     }
 
     ctx = std::dynamic_pointer_cast<ParserRuleContext>(ctx->parent.lock());
   }
 
-  if (following.contains(Token::EPSILON) && symbol == EOF) {
+  if (following->contains(Token::EPSILON) && symbol == EOF) {
     return true;
   }
 
@@ -564,11 +595,12 @@ std::vector<std::string> Parser::getRuleInvocationStack(Ref<RuleContext> p) {
 std::vector<std::string> Parser::getDFAStrings() {
   atn::ParserATNSimulator *simulator = getInterpreter<atn::ParserATNSimulator>();
   if (!simulator->decisionToDFA.empty()) {
-    std::lock_guard<std::recursive_mutex> lck(mtx);
-
     std::vector<std::string> s;
     for (size_t d = 0; d < simulator->decisionToDFA.size(); d++) {
       dfa::DFA &dfa = simulator->decisionToDFA[d];
+
+      // The DFA lock keeps other parsers from adding states or clearing the DFA while it is serialized.
+      std::lock_guard<std::recursive_mutex> lock(dfa.getLock());
       s.push_back(dfa.toString(getVocabulary()));
     }
     return s;
@@ -579,10 +611,10 @@ std::vector<std::string> Parser::getDFAStrings() {
 void Parser::dumpDFA() {
   atn::ParserATNSimulator *simulator = getInterpreter<atn::ParserATNSimulator>();
   if (!simulator->decisionToDFA.empty()) {
-    std::lock_guard<std::recursive_mutex> lck(mtx);
     bool seenOne = false;
     for (size_t d = 0; d < simulator->decisionToDFA.size(); d++) {
       dfa::DFA &dfa = simulator->decisionToDFA[d];
+      std::lock_guard<std::recursive_mutex> lock(dfa.getLock());
       if (!dfa.states.empty()) {
         if (seenOne) {
           std::cout << std::endl;
@@ -609,7 +641,7 @@ Ref<atn::ParseInfo> Parser::getParseInfo() const {
 }
 
 void Parser::setProfile(bool profile) {
-  atn::ParserATNSimulator *interp = getInterpreter<atn::ProfilingATNSimulator>();
+  atn::ParserATNSimulator *interp = getInterpreter<atn::ParserATNSimulator>();
   atn::PredictionMode saveMode = interp->getPredictionMode();
   if (profile) {
     if (!is<atn::ProfilingATNSimulator *>(interp)) {
@@ -640,6 +672,83 @@ bool Parser::isTrace() const {
   return _tracer != nullptr;
 }
 
+Ref<ParserRuleContext> Parser::parseTwoStage(const std::function<Ref<ParserRuleContext>()> &startRule) {
+  atn::ParserATNSimulator *interpreter = getInterpreter<atn::ParserATNSimulator>();
+  if (interpreter == nullptr) {
+    throw IllegalStateException("Two-stage parsing requires a parser ATN simulator.");
+  }
+
+  atn::PredictionMode savedMode = interpreter->getPredictionMode();
+  Ref<ANTLRErrorStrategy> savedHandler = _errHandler;
+
+  // Make sure the token stream is initialized before taking its index (a fresh stream has none yet).
+  _input->LA(1);
+  size_t startIndex = _input->index();
+  int startState = getState();
+
+  auto onExit = finally([this, savedMode, savedHandler] {
+    getInterpreter<atn::ParserATNSimulator>()->setPredictionMode(savedMode);
+    _errHandler = savedHandler;
+  });
+
+  ++_twoStageStatistics.sllParses;
+
+  // Stage 1: SLL prediction, no error recovery.
+  interpreter->setPredictionMode(atn::PredictionMode::SLL);
+  _errHandler = std::make_shared<SLLStageErrorStrategy>();
+  try {
+    return startRule();
+  } catch (ParseCancellationException &) {
+    // Syntax error or an input which is not SLL. Fall through to the second stage.
+  }
+
+  ++_twoStageStatistics.llFallbacks;
+
+  // Stage 2: rewind and parse again with full LL prediction and the caller's error strategy.
+  _input->seek(startIndex);
+  _ctx.reset();
+  _precedenceStack.clear();
+  _precedenceStack.push_back(0);
+  _matchedEOF = false;
+  setState(startState);
+
+  interpreter->setPredictionMode(savedMode == atn::PredictionMode::SLL ? atn::PredictionMode::LL : savedMode);
+  _errHandler = savedHandler;
+  _errHandler->reset(this);
+
+  return startRule();
+}
+
+const Parser::TwoStageStatistics& Parser::getTwoStageStatistics() const {
+  return _twoStageStatistics;
+}
+
+void Parser::resetTwoStageStatistics() {
+  _twoStageStatistics = TwoStageStatistics();
+}
+
+Ref<RecognitionException> Parser::getPendingError() const {
+  return _pendingError;
+}
+
+void Parser::recoverFromPendingError(Ref<ParserRuleContext> localctx) {
+  Ref<RecognitionException> error = _pendingError;
+  std::exception_ptr exception = _pendingException;
+  _pendingError.reset();
+  _pendingException = nullptr;
+
+  _errHandler->reportError(this, *error);
+  localctx->exception = exception;
+  _errHandler->recover(this, exception);
+}
+
+void Parser::rethrowPendingError() {
+  std::exception_ptr exception = _pendingException;
+  _pendingError.reset();
+  _pendingException = nullptr;
+  std::rethrow_exception(exception);
+}
+
 void Parser::InitializeInstanceFields() {
   _errHandler = std::make_shared<DefaultErrorStrategy>();
   _precedenceStack.clear();
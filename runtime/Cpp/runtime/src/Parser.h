@@ -36,6 +36,7 @@
 #include "TokenStream.h"
 #include "TokenSource.h"
 #include "misc/Interval.h"
+#include "Exceptions.h"
 
 namespace org {
 namespace antlr {
@@ -230,9 +231,15 @@ namespace runtime {
     }
 
     /// The ATN with bypass alternatives is expensive to create so we create it
-    /// lazily. The ATN is owned by us.
+    /// lazily. The ATN is owned by us and shared between all parsers for the same grammar.
     virtual const atn::ATN& getATNWithBypassAlts();
 
+    /// Returns the ATN with bypass alternatives for the grammar with the given ATN, deserializing it
+    /// from serializedAtn on first use. The result is owned by (and lives as long as) the given ATN, which generated
+    /// parsers keep in a static member.
+    /// Generated parsers can call this from their static initializer to create the bypass ATN eagerly.
+    static const atn::ATN& getATNWithBypassAlts(const atn::ATN &atn, const std::vector<uint16_t> &serializedAtn);
+
     /// <summary>
     /// The preferred method of getting a tree pattern. For example, here's a
     /// sample use:
@@ -407,6 +414,82 @@ namespace runtime {
      */
     bool isTrace() const;
 
+    /// Counters collected by parseTwoStage(). They are not touched by reset(), so a parser instance
+    /// reused for many inputs accumulates them over all its parse runs.
+    struct TwoStageStatistics {
+      size_t sllParses = 0;   // Number of two-stage parse runs.
+      size_t llFallbacks = 0; // Number of those runs which needed the second (full LL) stage.
+    };
+
+    /// <summary>
+    /// Runs {@code startRule} using two-stage parsing (see ParserATNSimulator for the details).
+    /// The first stage uses pure SLL prediction together with a bail-out error strategy. Because SLL
+    /// prediction can only fail on input for which full LL would fail too or which is not SLL (which is rare),
+    /// this is all that is needed for the vast majority of inputs. Only if that stage ends with a syntax
+    /// error the token stream is rewound to where the first stage started and {@code startRule} is run again,
+    /// this time with full LL prediction and the error strategy which was set on entry. Syntax errors
+    /// are only reported from the second stage.
+    ///
+    /// The prediction mode and error strategy active on entry are restored before returning. Note that parse
+    /// listeners get events from both stages if the fallback is taken.
+    /// </summary>
+    /// <param name="startRule"> a callable that invokes the start rule on this parser </param>
+    /// <returns> the parse tree returned by the stage which completed the parse </returns>
+    virtual Ref<ParserRuleContext> parseTwoStage(const std::function<Ref<ParserRuleContext>()> &startRule);
+
+    /// Convenience overload for generated parsers, e.g.
+    /// <pre>
+    /// Ref<MyParser::UnitContext> tree = parser.parseTwoStage(&MyParser::unit);
+    /// </pre>
+    /// Throws an IllegalArgumentException if this parser is not a {@code ParserType}.
+    template<typename ParserType, typename ContextType>
+    Ref<ContextType> parseTwoStage(Ref<ContextType> (ParserType::*startRule)()) {
+      ParserType *parser = dynamic_cast<ParserType *>(this);
+      if (parser == nullptr) {
+        throw IllegalArgumentException("The start rule doesn't belong to this parser.");
+      }
+      return
+ std::static_pointer_cast<ContextType>(parseTwoStage([parser, startRule]() -> Ref<ParserRuleContext> {
+        return (parser->*startRule)();
+      }));
+    }
+
+    const TwoStageStatistics& getTwoStageStatistics() const;
+    void resetTwoStageStatistics();
+
+    /// <summary>
+    /// Signals the syntax error {@code e}. Normally this throws {@code e}. With exception free error handling
+    /// (see <seealso cref="Recognizer#setExceptionFreeErrorHandling"/>) the error is recorded as pending error
+    /// instead and the caller returns normally. Generated rule functions check <seealso cref="#hasPendingError"/>
+    /// after each step that can fail and leave the rule like the default catch clause would.
+    /// </summary>
+    template<typename T>
+    void signalError(const T &e) {
+      if (!isExceptionFreeErrorHandling()) {
+        throw e;
+      }
+      _pendingError = std::make_shared<T>(e);
+      _pendingException = std::make_exception_ptr(e);
+    }
+
+    bool hasPendingError() const {
+      return _pendingError != nullptr;
+    }
+
+    Ref<RecognitionException> getPendingError() const;
+
+    /// <summary>
+    /// Handles the pending error like the default catch clause of a rule function: reports it,
+    /// stores it in {@code localctx} and lets the error strategy recover. The pending error is
+    /// cleared before the strategy runs, which may still throw (e.g. <seealso cref="BailErrorStrategy"/>).
+    /// </summary>
+    virtual void recoverFromPendingError(Ref<ParserRuleContext> localctx);
+
+    /// <summary>
+    /// Clears the pending error and throws it. Used by rules which have their own catch clauses.
+    /// </summary>
+    void rethrowPendingError();
+
   protected:
     /// The ParserRuleContext object for the currently executing rule.
     /// This is always non-null during the parsing process.
@@ -451,16 +534,15 @@ namespace runtime {
     
     /** Indicates parser has match()ed EOF token. See {@link #exitRule()}. */
     bool _matchedEOF;
+
+    /// The error recorded by signalError() in exception free mode, not yet handled by the rule which caused it.
+    /// The exception pointer holds the same error (as ParserRuleContext::exception and the error strategies expect it).
+    Ref<RecognitionException> _pendingError;
+    std::exception_ptr _pendingException;
     
     virtual void addContextToParseTree();
 
   private:
-    /// This field maps from the serialized ATN string to the deserialized <seealso cref="ATN"/> with
-    /// bypass alternatives.
-    ///
-    /// <seealso cref= ATNDeserializationOptions#isGenerateRuleBypassTransitions() </seealso>
-    static std::map<std::vector<uint16_t>, atn::ATN> bypassAltsAtnCache;
-
     /// When setTrace(true) is called, a reference to the
     /// TraceListener is stored here so it can be easily removed in a
     /// later call to setTrace(false). The listener itself is
@@ -468,6 +550,8 @@ namespace runtime {
     /// other parser methods.
     Ref<TraceListener> _tracer;
 
+    TwoStageStatistics _twoStageStatistics;
+
     void InitializeInstanceFields();
   };
 
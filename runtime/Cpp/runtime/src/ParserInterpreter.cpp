@@ -57,6 +57,91 @@ using namespace org::antlr::v4::runtime;
 using namespace org::antlr::v4::runtime::atn;
 using namespace antlrcpp;
 
+/// Bump allocator for rule contexts. Memory is only released when the arena is destroyed, which happens
+/// when the interpreter and all contexts allocated from it are gone (each allocation holds a reference to
+/// the arena via its allocator).
+class ParserInterpreter::ContextArena {
+public:
+  static const size_t BLOCK_SIZE = 64 * 1024;
+  static const size_t ALIGNMENT = 16; // Enough for any type a context (or its shared_ptr control block) contains.
+
+  void* allocate(size_t size) {
+    size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    if (size > BLOCK_SIZE) {
+      _largeBlocks.push_back(std::unique_ptr<char[]>(new char[size]));
+      return _largeBlocks.back().get();
+    }
+
+    if (_blocks.empty() || _used + size > BLOCK_SIZE) {
+      if (_current + 1 < _blocks.size()) {
+        ++_current;
+      } else {
+        _blocks.push_back(std::unique_ptr<char[]>(new char[BLOCK_SIZE]));
+        _current = _blocks.size() - 1;
+      }
+      _used = 0;
+    }
+
+    void *result = _blocks[_current].get() + _used;
+    _used += size;
+    return result;
+  }
+
+  /// Makes all memory available again. Only allowed when no allocation from this arena is in use anymore.
+  void reset() {
+    _largeBlocks.clear();
+    _current = 0;
+    _used = 0;
+  }
+
+private:
+  std::vector<std::unique_ptr<char[]>> _blocks;
+  std::vector<std::unique_ptr<char[]>> _largeBlocks;
+  size_t _current = 0;
+  size_t _used = 0;
+};
+
+template<typename T>
+class ParserInterpreter::ArenaAllocator {
+public:
+  typedef T value_type;
+
+  template<typename U> friend class ArenaAllocator;
+
+  template<typename U>
+  struct rebind {
+    typedef ArenaAllocator<U> other;
+  };
+
+  ArenaAllocator(Ref<ContextArena> arena) : _arena(arena) {
+  }
+
+  template<typename U>
+  ArenaAllocator(const ArenaAllocator<U> &other) : _arena(other._arena) {
+  }
+
+  T* allocate(size_t n) {
+    return static_cast<T *>(_arena->allocate(n * sizeof(T)));
+  }
+
+  void deallocate(T *, size_t) {
+    // Released with the arena.
+  }
+
+  template<typename U>
+  bool operator == (const ArenaAllocator<U> &other) const {
+    return _arena == other._arena;
+  }
+
+  template<typename U>
+  bool operator != (const ArenaAllocator<U> &other) const {
+    return _arena != other._arena;
+  }
+
+private:
+  Ref<ContextArena> _arena;
+};
+
 ParserInterpreter::ParserInterpreter(const std::string &grammarFileName, const std::vector<std::string>& tokenNames,
   const std::vector<std::string>& ruleNames, const atn::ATN &atn, TokenStream *input)
   : ParserInterpreter(grammarFileName, dfa::VocabularyImpl::fromTokenNames(tokenNames), ruleNames, atn, input) {
@@ -79,6 +164,8 @@ ParserInterpreter::ParserInterpreter(const std::string &grammarFileName, Ref<dfa
 
   // get atn simulator that knows how to do predictions
   _interpreter = new atn::ParserATNSimulator(this, atn, _decisionToDFA, _sharedContextCache); /* mem-check: deleted in d-tor */
+
+  prepareSteps();
 }
 
 ParserInterpreter::~ParserInterpreter() {
@@ -114,6 +201,16 @@ std::string ParserInterpreter::getGrammarFileName() const {
 Ref<ParserRuleContext> ParserInterpreter::parse(int startRuleIndex) {
   atn::RuleStartState *startRuleStartState = _atn.ruleToStartState[(size_t)startRuleIndex];
 
+  // Reuse the context memory of the previous parse, unless its tree is still in use.
+  _rootContext.reset();
+  _overrideDecisionRoot.reset();
+  _parentContextStack = decltype(_parentContextStack)();
+  if (_contextArena != nullptr && _contextArena.use_count() == 1) {
+    _contextArena->reset();
+  } else {
+    _contextArena = std::make_shared<ContextArena>();
+  }
+
   _rootContext = createInterpreterRuleContext(std::weak_ptr<ParserRuleContext>(), atn::ATNState::INVALID_STATE_NUMBER, startRuleIndex);
   
   if (startRuleStartState->isLeftRecursiveRule) {
@@ -153,7 +250,19 @@ Ref<ParserRuleContext> ParserInterpreter::parse(int startRuleIndex) {
           getContext()->exception = std::current_exception();
           recover(e);
         }
-        
+
+        if (hasPendingError()) {
+          // Same as above, for an error recorded with exception free error handling.
+          Ref<RecognitionException> e = _pendingError;
+          std::exception_ptr exception = _pendingException;
+          _pendingError.reset();
+          _pendingException = nullptr;
+
+          setState(_atn.ruleToStopState[p->ruleIndex]->stateNumber);
+          getErrorHandler()->reportError(this, *e);
+          getContext()->exception = exception;
+          recover(*e);
+        }
         break;
     }
   }
@@ -183,96 +292,96 @@ atn::ATNState* ParserInterpreter::getATNState() {
 }
 
 void ParserInterpreter::visitState(atn::ATNState *p) {
+  const StateSteps &stateSteps = _stateSteps[(size_t)p->stateNumber];
   int predictedAlt = 1;
-  if (is<DecisionState *>(p)) {
-    predictedAlt = visitDecisionState(dynamic_cast<DecisionState *>(p));
+  if (stateSteps.isDecision) {
+    predictedAlt = visitDecisionState(static_cast<DecisionState *>(p));
+    if (hasPendingError()) {
+      return;
+    }
   }
 
-  atn::Transition *transition = p->transition(predictedAlt - 1);
-  switch (transition->getSerializationType()) {
-    case atn::Transition::EPSILON:
-      if (p->getStateType() == ATNState::STAR_LOOP_ENTRY &&
-        (dynamic_cast<StarLoopEntryState *>(p))->isPrecedenceDecision &&
-        !is<LoopEndState *>(transition->target)) {
-        // We are at the start of a left recursive rule's (...)* loop
-        // and we're not taking the exit branch of loop.
-        Ref<InterpreterRuleContext> localctx = createInterpreterRuleContext(_parentContextStack.top().first,
-          _parentContextStack.top().second, (int)_ctx->getRuleIndex());
-        pushNewRecursionContext(localctx, _atn.ruleToStartState[p->ruleIndex]->stateNumber, (int)_ctx->getRuleIndex());
-      }
+  const Step &step = _steps[stateSteps.firstStep + (size_t)predictedAlt - 1];
+  switch (step.kind) {
+    case StepKind::Epsilon:
+      break;
+
+    case StepKind::PushRecursionContext:
+    {
+      // We are at the start of a left recursive rule's (...)* loop
+      // and we're not taking the exit branch of loop.
+      Ref<InterpreterRuleContext> localctx = createInterpreterRuleContext(_parentContextStack.top().first,
+        _parentContextStack.top().second, (int)_ctx->getRuleIndex());
+      pushNewRecursionContext(localctx, _atn.ruleToStartState[p->ruleIndex]->stateNumber, (int)_ctx->getRuleIndex());
+    }
       break;
 
-    case atn::Transition::ATOM:
-      match((int)((atn::AtomTransition*)(transition))->_label);
+    case StepKind::Atom:
+      match(step.arg1);
       break;
 
-    case atn::Transition::RANGE:
-    case atn::Transition::SET:
-    case atn::Transition::NOT_SET:
-      if (!transition->matches((int)_input->LA(1), Token::MIN_USER_TOKEN_TYPE, 65535)) {
+    case StepKind::Set:
+      if (!step.transition->matches((int)_input->LA(1), Token::MIN_USER_TOKEN_TYPE, 65535)) {
         recoverInline();
+        if (hasPendingError()) {
+          return;
+        }
       }
       matchWildcard();
       break;
 
-    case atn::Transition::WILDCARD:
+    case StepKind::Wildcard:
       matchWildcard();
       break;
 
-    case atn::Transition::RULE:
+    case StepKind::Rule:
     {
-      atn::RuleStartState *ruleStartState = (atn::RuleStartState*)(transition->target);
-      int ruleIndex = ruleStartState->ruleIndex;
-      Ref<InterpreterRuleContext> newctx = createInterpreterRuleContext(_ctx, p->stateNumber, ruleIndex);
-      if (ruleStartState->isLeftRecursiveRule) {
-        enterRecursionRule(newctx, ruleStartState->stateNumber, ruleIndex, ((atn::RuleTransition*)(transition))->precedence);
+      Ref<InterpreterRuleContext> newctx = createInterpreterRuleContext(_ctx, p->stateNumber, step.arg1);
+      if (step.leftRecursiveRule) {
+        enterRecursionRule(newctx, step.target, step.arg1, step.arg2);
       } else {
-        enterRule(newctx, transition->target->stateNumber, ruleIndex);
+        enterRule(newctx, step.target, step.arg1);
       }
     }
       break;
 
-    case atn::Transition::PREDICATE:
-    {
-      atn::PredicateTransition *predicateTransition = (atn::PredicateTransition*)(transition);
-      if (!sempred(_ctx, predicateTransition->ruleIndex, predicateTransition->predIndex)) {
-        throw FailedPredicateException(this);
+    case StepKind::Predicate:
+      if (!sempred(_ctx, step.arg1, step.arg2)) {
+        signalError(FailedPredicateException(this));
       }
-    }
       break;
 
-    case atn::Transition::ACTION:
-    {
-      atn::ActionTransition *actionTransition = (atn::ActionTransition*)(transition);
-      action(_ctx, actionTransition->ruleIndex, actionTransition->actionIndex);
-    }
+    case StepKind::Action:
+      action(_ctx, step.arg1, step.arg2);
       break;
 
-    case atn::Transition::PRECEDENCE:
-    {
-      if (!precpred(_ctx, ((atn::PrecedencePredicateTransition*)(transition))->precedence)) {
-        throw FailedPredicateException(this, "precpred(_ctx, " + std::to_string(((atn::PrecedencePredicateTransition*)(transition))->precedence) +  ")");
+    case StepKind::Precedence:
+      if (!precpred(_ctx, step.arg1)) {
+        signalError(FailedPredicateException(this, "precpred(_ctx, " + std::to_string(step.arg1) +  ")"));
       }
-    }
       break;
 
     default:
       throw UnsupportedOperationException("Unrecognized ATN transition type.");
   }
 
-  setState(transition->target->stateNumber);
+  setState(step.target);
 }
 
 int ParserInterpreter::visitDecisionState(DecisionState *p) {
   int predictedAlt = 1;
   if (p->getNumberOfTransitions() > 1) {
     getErrorHandler()->sync(this);
+    if (hasPendingError()) {
+      return ATN::INVALID_ALT_NUMBER;
+    }
     int decision = p->decision;
     if (decision == _overrideDecision && (int)_input->index() == _overrideDecisionInputIndex && !_overrideDecisionReached) {
       predictedAlt = _overrideDecisionAlt;
       _overrideDecisionReached = true;
     } else {
-      predictedAlt = getInterpreter<ParserATNSimulator>()->adaptivePredict(_input, decision, _ctx);
+      // The interpreter is always a ParserATNSimulator (or a subclass of it) here, no need for a dynamic cast.
+      predictedAlt = static_cast<ParserATNSimulator *>(_interpreter)->adaptivePredict(_input, decision, _ctx);
     }
   }
   return predictedAlt;
@@ -280,7 +389,11 @@ int ParserInterpreter::visitDecisionState(DecisionState *p) {
 
 Ref<InterpreterRuleContext> ParserInterpreter::createInterpreterRuleContext(std::weak_ptr<ParserRuleContext> parent,
   int invokingStateNumber, int ruleIndex) {
-  return std::make_shared<InterpreterRuleContext>(parent, invokingStateNumber, ruleIndex);
+  if (_contextArena == nullptr) {
+    _contextArena = std::make_shared<ContextArena>();
+  }
+  return std::allocate_shared<InterpreterRuleContext>(ArenaAllocator<InterpreterRuleContext>(_contextArena), parent,
+    invokingStateNumber, ruleIndex);
 }
 
 void ParserInterpreter::visitRuleStopState(atn::ATNState *p) {
@@ -327,3 +440,81 @@ void ParserInterpreter::recover(RecognitionException &e) {
 Ref<Token> ParserInterpreter::recoverInline() {
   return _errHandler->recoverInline(this);
 }
+
+void ParserInterpreter::prepareSteps() {
+  _stateSteps.resize(_atn.states.size());
+  for (atn::ATNState *state : _atn.states) {
+    if (state == nullptr) {
+      continue;
+    }
+
+    StateSteps &stateSteps = _stateSteps[(size_t)state->stateNumber];
+    stateSteps.firstStep = _steps.size();
+    stateSteps.count = state->getNumberOfTransitions();
+    stateSteps.isDecision = is<DecisionState *>(state);
+
+    for (size_t i = 0; i < stateSteps.count; ++i) {
+      atn::Transition *transition = state->transition(i);
+      Step step = { StepKind::Unsupported, false, transition->target->stateNumber, 0, 0, transition };
+      switch (transition->getSerializationType()) {
+        case atn::Transition::EPSILON:
+          step.kind = StepKind::Epsilon;
+          if (state->getStateType() == ATNState::STAR_LOOP_ENTRY &&
+            static_cast<StarLoopEntryState *>(state)->isPrecedenceDecision &&
+            !is<LoopEndState *>(transition->target)) {
+            step.kind = StepKind::PushRecursionContext;
+          }
+          break;
+
+        case atn::Transition::ATOM:
+          step.kind = StepKind::Atom;
+          step.arg1 = (int)static_cast<atn::AtomTransition *>(transition)->_label;
+          break;
+
+        case atn::Transition::RANGE:
+        case atn::Transition::SET:
+        case atn::Transition::NOT_SET:
+          step.kind = StepKind::Set;
+          break;
+
+        case atn::Transition::WILDCARD:
+          step.kind = StepKind::Wildcard;
+          break;
+
+        case atn::Transition::RULE: {
+          atn::RuleStartState *ruleStartState = static_cast<atn::RuleStartState *>(transition->target);
+          step.kind = StepKind::Rule;
+          step.leftRecursiveRule = ruleStartState->isLeftRecursiveRule;
+          step.arg1 = ruleStartState->ruleIndex;
+          step.arg2 = static_cast<atn::RuleTransition *>(transition)->precedence;
+          break;
+        }
+
+        case atn::Transition::PREDICATE: {
+          atn::PredicateTransition *predicateTransition = static_cast<atn::PredicateTransition *>(transition);
+          step.kind = StepKind::Predicate;
+          step.arg1 = predicateTransition->ruleIndex;
+          step.arg2 = predicateTransition->predIndex;
+          break;
+        }
+
+        case atn::Transition::ACTION: {
+          atn::ActionTransition *actionTransition = static_cast<atn::ActionTransition *>(transition);
+          step.kind = StepKind::Action;
+          step.arg1 = actionTransition->ruleIndex;
+          step.arg2 = actionTransition->actionIndex;
+          break;
+        }
+
+        case atn::Transition::PRECEDENCE:
+          step.kind = StepKind::Precedence;
+          step.arg1 = static_cast<atn::PrecedencePredicateTransition *>(transition)->precedence;
+          break;
+
+        default:
+          break;
+      }
+      _steps.push_back(step);
+    }
+  }
+}
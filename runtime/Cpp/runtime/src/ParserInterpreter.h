@@ -54,6 +54,11 @@ namespace runtime {
   ///  transitions to make left recursive rules work.
   ///
   ///  See TestParserInterpreter for examples.
+  ///
+  ///  To keep the per token overhead low the interpreter prepares a flat form of the ATN when it is created
+  ///  (one step per transition, with everything needed to execute it), so that visiting a state needs no type
+  ///  checks or casts. Rule contexts are allocated from an arena which lives as long as any context of a parse
+  ///  tree allocated from it.
   /// </summary>
   class ANTLR4CPP_PUBLIC ParserInterpreter : public Parser {
   public:
@@ -159,7 +164,7 @@ namespace runtime {
      *  Those values are used to create new recursive rule invocation contexts
      *  associated with left operand of an alt like "expr '*' expr".
      */
-    std::stack<std::pair<Ref<ParserRuleContext>, int>> _parentContextStack;
+    std::stack<std::pair<Ref<ParserRuleContext>, int>, std::vector<std::pair<Ref<ParserRuleContext>, int>>> _parentContextStack;
     
     /** We need a map from (decision,inputIndex)->forced alt for computing ambiguous
      *  parse trees. For now, we allow exactly one override.
@@ -201,7 +206,45 @@ namespace runtime {
     Ref<Token> recoverInline();
 
   private:
+    class ContextArena;
+    template<typename T> class ArenaAllocator;
+
+    enum class StepKind : unsigned char {
+      Epsilon,
+      PushRecursionContext, // Epsilon transition into a left recursive rule's (...)* loop.
+      Atom,
+      Set,                  // Range, set and not set transitions.
+      Wildcard,
+      Rule,
+      Predicate,
+      Action,
+      Precedence,
+      Unsupported
+    };
+
+    /// One transition of the ATN, prepared for execution in visitState().
+    struct Step {
+      StepKind kind;
+      bool leftRecursiveRule; // For rule steps: if the invoked rule is left recursive.
+      int target;             // The target state number.
+      int arg1;               // Token type (atom), rule index (rule, predicate, action) or precedence.
+      int arg2;               // Predicate or action index, or the precedence of a rule invocation.
+      atn::Transition *transition;
+    };
+
+    /// The steps of a state are _steps[firstStep, firstStep + count), in transition order.
+    struct StateSteps {
+      size_t firstStep;
+      size_t count;
+      bool isDecision;
+    };
+
     Ref<dfa::Vocabulary> _vocabulary;
+    std::vector<Step> _steps;
+    std::vector<StateSteps> _stateSteps;
+    Ref<ContextArena> _contextArena;
+
+    void prepareSteps();
   };
 
 } // namespace runtime
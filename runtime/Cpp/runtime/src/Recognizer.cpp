@@ -187,8 +187,17 @@ void Recognizer::setState(int atnState) {
   //		if ( traceATNStates ) _ctx.trace(atnState);
 }
 
+void Recognizer::setExceptionFreeErrorHandling(bool enable) {
+  _exceptionFreeErrorHandling = enable;
+}
+
+bool Recognizer::isExceptionFreeErrorHandling() const {
+  return _exceptionFreeErrorHandling;
+}
+
 void Recognizer::InitializeInstanceFields() {
   _stateNumber = -1;
+  _exceptionFreeErrorHandling = false;
   _interpreter = nullptr;
 }
 
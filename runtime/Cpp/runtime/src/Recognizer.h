@@ -165,6 +165,21 @@ namespace runtime {
     /// </summary>
     void setState(int atnState);
 
+    /**
+     * Syntax errors are normally signalled by throwing a {@link RecognitionException}
+     * which is caught by the enclosing rule (or by {@link Lexer#nextToken}).
+     * With exception free error handling the error is recorded instead and
+     * handled where it was detected (lexer) or when the generated rule code
+     * checks for it (parser, see {@link Parser#signalError}). This avoids the
+     * costs of unwinding on inputs with many errors. The exception types are
+     * still used to report errors to the error listeners and strategies.
+     *
+     * <p>Parsers require code generated by a tool version which emits the
+     * pending error checks.</p>
+     */
+    void setExceptionFreeErrorHandling(bool enable);
+    bool isExceptionFreeErrorHandling() const;
+
     virtual IntStream* getInputStream() = 0;
 
     virtual void setInputStream(IntStream *input) = 0;
@@ -187,6 +202,8 @@ namespace runtime {
     std::recursive_mutex mtx;
 
     int _stateNumber;
+
+    bool _exceptionFreeErrorHandling;
     
     void InitializeInstanceFields();
 
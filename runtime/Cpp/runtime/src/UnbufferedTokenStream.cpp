@@ -45,9 +45,16 @@ using namespace org::antlr::v4::runtime;
 UnbufferedTokenStream::UnbufferedTokenStream(TokenSource *tokenSource) : UnbufferedTokenStream(tokenSource, 256) {
 }
 
-UnbufferedTokenStream::UnbufferedTokenStream(TokenSource *tokenSource, int /*bufferSize*/) : _tokenSource(tokenSource)
+UnbufferedTokenStream::UnbufferedTokenStream(TokenSource *tokenSource, int bufferSize) : _tokenSource(tokenSource)
 {
   InitializeInstanceFields();
+
+  size_t capacity = 1;
+  while (bufferSize > 0 && capacity < (size_t)bufferSize) {
+    capacity <<= 1;
+  }
+  _buffer.resize(capacity);
+
   fill(1); // prime the pump
 }
 
@@ -57,11 +64,11 @@ UnbufferedTokenStream::~UnbufferedTokenStream() {
 Ref<Token> UnbufferedTokenStream::get(size_t i) const
 { // get absolute index
   size_t bufferStartIndex = getBufferStartIndex();
-  if (i < bufferStartIndex || i >= bufferStartIndex + _tokens.size()) {
+  if (i < bufferStartIndex || i >= bufferStartIndex + _tokenCount) {
     throw IndexOutOfBoundsException(std::string("get(") + std::to_string(i) + std::string(") outside buffer: ")
-      + std::to_string(bufferStartIndex) + std::string("..") + std::to_string(bufferStartIndex + _tokens.size()));
+      + std::to_string(bufferStartIndex) + std::string("..") + std::to_string(bufferStartIndex + _tokenCount));
   }
-  return _tokens[i - bufferStartIndex];
+  return tokenAt(i - bufferStartIndex);
 }
 
 Ref<Token> UnbufferedTokenStream::LT(ssize_t i)
@@ -76,12 +83,12 @@ Ref<Token> UnbufferedTokenStream::LT(ssize_t i)
     throw IndexOutOfBoundsException(std::string("LT(") + std::to_string(i) + std::string(") gives negative index"));
   }
 
-  if (index >= (ssize_t)_tokens.size()) {
-    assert(_tokens.size() > 0 && _tokens.back()->getType() == EOF);
-    return _tokens.back();
+  if (index >= (ssize_t)_tokenCount) {
+    assert(_tokenCount > 0 && tokenAt(_tokenCount - 1)->getType() == EOF);
+    return tokenAt(_tokenCount - 1);
   }
 
-  return _tokens[(size_t)index];
+  return tokenAt((size_t)index);
 }
 
 ssize_t UnbufferedTokenStream::LA(ssize_t i)
@@ -116,11 +123,11 @@ void UnbufferedTokenStream::consume()
   }
 
   // buf always has at least tokens[p==0] in this method due to ctor
-  _lastToken = _tokens[_p]; // track last token for LT(-1)
+  _lastToken = tokenAt(_p); // track last token for LT(-1)
 
-  // if we're at last token and no markers, opportunity to flush buffer
-  if (_p == _tokens.size() - 1 && _numMarkers == 0) {
-    _tokens.clear();
+  // without markers nobody can seek back, so the consumed token can go right away
+  if (_numMarkers == 0) {
+    dropTokens(_p + 1);
     _p = 0;
     _lastTokenBufferStart = _lastToken;
   } else {
@@ -138,7 +145,7 @@ void UnbufferedTokenStream::consume()
 /// </summary>
 void UnbufferedTokenStream::sync(ssize_t want)
 {
-  ssize_t need = ((ssize_t)_p + want - 1) - (ssize_t)_tokens.size() + 1; // how many more elements we need?
+  ssize_t need = ((ssize_t)_p + want - 1) - (ssize_t)_tokenCount + 1; // how many more elements we need?
   if (need > 0) {
     fill((size_t)need);
   }
@@ -152,10 +159,15 @@ void UnbufferedTokenStream::sync(ssize_t want)
 size_t UnbufferedTokenStream::fill(size_t n)
 {
   for (size_t i = 0; i < n; i++) {
-    if (_tokens.size() > 0 && _tokens.back()->getType() == EOF) {
+    if (_tokenCount > 0 && tokenAt(_tokenCount - 1)->getType() == EOF) {
       return i;
     }
 
+    if (_maxBufferSize > 0 && _tokenCount >= _maxBufferSize) {
+      throw IllegalStateException("token buffer limit of " + std::to_string(_maxBufferSize) + " tokens exceeded at token index " +
+        std::to_string(getBufferStartIndex() + _tokenCount));
+    }
+
     Ref<Token> t = _tokenSource->nextToken();
     add(t);
   }
@@ -167,10 +179,23 @@ void UnbufferedTokenStream::add(Ref<Token> t)
 {
   Ref<WritableToken> writable = std::dynamic_pointer_cast<WritableToken>(t);
   if (writable) {
-    writable->setTokenIndex(int(getBufferStartIndex() + _tokens.size()));
+    writable->setTokenIndex(int(getBufferStartIndex() + _tokenCount));
+  }
+
+  if (_tokenCount == _buffer.size()) {
+    // Full, double the capacity and unroll the ring while copying.
+    std::vector<Ref<Token>> buffer(_buffer.size() * 2);
+    for (size_t i = 0; i < _tokenCount; ++i) {
+      buffer[i] = std::move(tokenAt(i));
+    }
+    _buffer.swap(buffer);
+    _bufferStart = 0;
   }
 
-  _tokens.push_back(t);
+  tokenAt(_tokenCount++) = t;
+  if (_tokenCount > _highWaterMark) {
+    _highWaterMark = _tokenCount;
+  }
 }
 
 /// <summary>
@@ -183,6 +208,8 @@ void UnbufferedTokenStream::add(Ref<Token> t)
 ssize_t UnbufferedTokenStream::mark()
 {
   if (_numMarkers == 0) {
+    dropTokens(_p); // in case we were moved forward by seek()
+    _p = 0;
     _lastTokenBufferStart = _lastToken;
   }
 
@@ -201,9 +228,8 @@ void UnbufferedTokenStream::release(ssize_t marker)
   _numMarkers--;
   if (_numMarkers == 0) { // can we release buffer?
     if (_p > 0) {
-      // Copy tokens[p]..tokens[n-1] to tokens[0]..tokens[(n-1)-p], reset ptrs
-      // p is last valid token; move nothing if p==n as we have no valid char
-      std::vector<Ref<Token>>(_tokens.begin() + (ssize_t)_p, _tokens.end()).swap(_tokens);
+      // Drop tokens[0]..tokens[p-1], which only moves the start of the ring.
+      dropTokens(_p);
       _p = 0;
     }
 
@@ -223,8 +249,8 @@ void UnbufferedTokenStream::seek(size_t index)
   }
 
   if (index > _currentTokenIndex) {
-    sync(ssize_t(index - _currentTokenIndex));
-    index = std::min(index, getBufferStartIndex() + _tokens.size() - 1);
+    sync(ssize_t(index - _currentTokenIndex) + 1);
+    index = std::min(index, getBufferStartIndex() + _tokenCount - 1);
   }
 
   size_t bufferStartIndex = getBufferStartIndex();
@@ -233,9 +259,9 @@ void UnbufferedTokenStream::seek(size_t index)
   }
 
   size_t i = index - bufferStartIndex;
-  if (i >= _tokens.size()) {
+  if (i >= _tokenCount) {
     throw UnsupportedOperationException(std::string("seek to index outside buffer: ") + std::to_string(index) +
-      " not in " + std::to_string(bufferStartIndex) + ".." + std::to_string(bufferStartIndex + _tokens.size()));
+      " not in " + std::to_string(bufferStartIndex) + ".." + std::to_string(bufferStartIndex + _tokenCount));
   }
 
   _p = i;
@@ -243,7 +269,7 @@ void UnbufferedTokenStream::seek(size_t index)
   if (_p == 0) {
     _lastToken = _lastTokenBufferStart;
   } else {
-    _lastToken = _tokens[_p - 1];
+    _lastToken = tokenAt(_p - 1);
   }
 }
 
@@ -260,7 +286,7 @@ std::string UnbufferedTokenStream::getSourceName() const
 std::string UnbufferedTokenStream::getText(const misc::Interval &interval)
 {
   size_t bufferStartIndex = getBufferStartIndex();
-  size_t bufferStopIndex = bufferStartIndex + _tokens.size() - 1;
+  size_t bufferStopIndex = bufferStartIndex + _tokenCount - 1;
 
   size_t start = (size_t)interval.a;
   size_t stop = (size_t)interval.b;
@@ -274,7 +300,7 @@ std::string UnbufferedTokenStream::getText(const misc::Interval &interval)
 
   std::stringstream ss;
   for (size_t i = a; i <= b; i++) {
-    Ref<Token> t = _tokens[i];
+    const Ref<Token> &t = tokenAt(i);
     if (i > 0)
       ss << ", ";
     ss << t->getText();
@@ -283,14 +309,62 @@ std::string UnbufferedTokenStream::getText(const misc::Interval &interval)
   return ss.str();
 }
 
+void UnbufferedTokenStream::setMaxBufferSize(size_t maxBufferSize)
+{
+  _maxBufferSize = maxBufferSize;
+}
+
+size_t UnbufferedTokenStream::getMaxBufferSize() const
+{
+  return _maxBufferSize;
+}
+
+size_t UnbufferedTokenStream::getBufferSize() const
+{
+  return _tokenCount;
+}
+
+size_t UnbufferedTokenStream::getHighWaterMark() const
+{
+  return _highWaterMark;
+}
+
+void UnbufferedTokenStream::resetHighWaterMark()
+{
+  _highWaterMark = _tokenCount;
+}
+
 size_t UnbufferedTokenStream::getBufferStartIndex() const
 {
   return _currentTokenIndex - _p;
 }
 
+Ref<Token>& UnbufferedTokenStream::tokenAt(size_t i)
+{
+  return _buffer[(_bufferStart + i) & (_buffer.size() - 1)];
+}
+
+const Ref<Token>& UnbufferedTokenStream::tokenAt(size_t i) const
+{
+  return _buffer[(_bufferStart + i) & (_buffer.size() - 1)];
+}
+
+void UnbufferedTokenStream::dropTokens(size_t count)
+{
+  for (size_t i = 0; i < count; ++i) {
+    _buffer[_bufferStart].reset();
+    _bufferStart = (_bufferStart + 1) & (_buffer.size() - 1);
+  }
+  _tokenCount -= count;
+}
+
 void UnbufferedTokenStream::InitializeInstanceFields()
 {
   _p = 0;
   _numMarkers = 0;
   _currentTokenIndex = 0;
+  _bufferStart = 0;
+  _tokenCount = 0;
+  _maxBufferSize = 0;
+  _highWaterMark = 0;
 }
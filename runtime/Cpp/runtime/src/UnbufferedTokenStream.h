@@ -38,9 +38,20 @@ namespace antlr {
 namespace v4 {
 namespace runtime {
 
+  /// <summary>
+  /// A token stream which only keeps the tokens it needs: those after the first mark and the lookahead
+  /// requested via LT(). The tokens are held in a ring buffer, which grows (in powers of two) only while
+  /// a marker (e.g. during prediction) or a deep lookahead needs more tokens than it can hold, so consume()
+  /// and release() are amortized O(1) and memory use stays flat for endless input.
+  /// <p/>
+  /// Use <seealso cref="#setMaxBufferSize"/> to put an upper limit on the number of buffered tokens. If a
+  /// lookahead would exceed it an IllegalStateException is thrown instead of growing the buffer further.
+  /// </summary>
   class ANTLR4CPP_PUBLIC UnbufferedTokenStream : public TokenStream {
   public:
     UnbufferedTokenStream(TokenSource *tokenSource);
+
+    /// bufferSize is the initial capacity of the token buffer (rounded up to a power of two).
     UnbufferedTokenStream(TokenSource *tokenSource, int bufferSize);
     virtual ~UnbufferedTokenStream();
 
@@ -71,6 +82,18 @@ namespace runtime {
     virtual size_t size() override;
     virtual std::string getSourceName() const override;
 
+    /// The maximum number of tokens held in the buffer (0 means no limit, which is the default).
+    virtual void setMaxBufferSize(size_t maxBufferSize);
+    virtual size_t getMaxBufferSize() const;
+
+    /// The number of tokens currently buffered.
+    virtual size_t getBufferSize() const;
+
+    /// The largest number of tokens which were buffered at the same time, since the stream was created or
+    /// since the last call to resetHighWaterMark().
+    virtual size_t getHighWaterMark() const;
+    virtual void resetHighWaterMark();
+
   protected:
     /// Make sure we have 'need' elements from current position p. Last valid
     /// p index is tokens.length - 1.  p + need - 1 is the tokens index 'need' elements
@@ -78,17 +101,23 @@ namespace runtime {
     TokenSource *_tokenSource;
 
     /// <summary>
-    /// A moving window buffer of the data being scanned. While there's a marker,
-    /// we keep adding to buffer. Otherwise, <seealso cref="#consume consume()"/> resets so
-    /// we start filling at index 0 again.
+    /// A moving window of the data being scanned, stored as a ring buffer. Its size is always a power
+    /// of two and the buffered tokens are {@code _buffer[(_bufferStart + i) & (_buffer.size() - 1)]} for
+    /// {@code i} in {@code 0.._tokenCount - 1} (see <seealso cref="#tokenAt"/>). While there's a marker,
+    /// we keep adding to the buffer. Otherwise, <seealso cref="#consume consume()"/> drops tokens from its start.
     /// </summary>
+    std::vector<Ref<Token>> _buffer;
 
-    std::vector<Ref<Token>> _tokens;
+    /// The position in _buffer of the first buffered token.
+    size_t _bufferStart;
+
+    /// The number of buffered tokens.
+    size_t _tokenCount;
 
     /// <summary>
-    /// 0..n-1 index into <seealso cref="#tokens tokens"/> of next token.
+    /// 0..n-1 index of the next token in the window, where n is {@code _tokenCount}.
     /// <p/>
-    /// The {@code LT(1)} token is {@code tokens[p]}. If {@code p == n}, we are
+    /// The {@code LT(1)} token is {@code tokenAt(p)}. If {@code p == n}, we are
     /// out of buffered tokens.
     /// </summary>
     size_t _p;
@@ -96,11 +125,13 @@ namespace runtime {
     /// <summary>
     /// Count up with <seealso cref="#mark mark()"/> and down with
     /// <seealso cref="#release release()"/>. When we {@code release()} the last mark,
-    /// {@code numMarkers} reaches 0 and we reset the buffer. Copy
-    /// {@code tokens[p]..tokens[n-1]} to {@code tokens[0]..tokens[(n-1)-p]}.
+    /// {@code numMarkers} reaches 0 and the tokens before {@code p} are dropped.
     /// </summary>
     int _numMarkers;
 
+    size_t _maxBufferSize;
+    size_t _highWaterMark;
+
     /// <summary>
     /// This is the {@code LT(-1)} token for the current position.
     /// </summary>
@@ -134,6 +165,13 @@ namespace runtime {
 
     size_t getBufferStartIndex() const;
 
+    /// Returns the i-th token in the window (0 is the oldest buffered token).
+    Ref<Token>& tokenAt(size_t i);
+    const Ref<Token>& tokenAt(size_t i) const;
+
+    /// Removes the given number of tokens from the start of the window.
+    void dropTokens(size_t count);
+
   private:
     void InitializeInstanceFields();
   };
@@ -34,6 +34,7 @@
 #include <codecvt>
 #include <chrono>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <limits.h>
 #include <list>
@@ -52,6 +53,7 @@
 #include <utility>
 #include <vector>
 #include <mutex>
+#include <atomic>
 #include <exception>
 #include <bitset>
 
@@ -40,7 +40,9 @@
 #include "BailErrorStrategy.h"
 #include "BaseErrorListener.h"
 #include "BufferedTokenStream.h"
+#include "ByteCharStream.h"
 #include "CharStream.h"
+#include "CodeCompletionCore.h"
 #include "CommonToken.h"
 #include "CommonTokenFactory.h"
 #include "CommonTokenStream.h"
@@ -99,6 +101,7 @@
 #include "atn/ContextSensitivityInfo.h"
 #include "atn/DecisionEventInfo.h"
 #include "atn/DecisionInfo.h"
+#include "atn/DecisionReport.h"
 #include "atn/DecisionState.h"
 #include "atn/EmptyPredictionContext.h"
 #include "atn/EpsilonTransition.h"
@@ -130,6 +133,7 @@
 #include "atn/PredicateEvalInfo.h"
 #include "atn/PredicateTransition.h"
 #include "atn/PredictionContext.h"
+#include "atn/PredictionDiagnostics.h"
 #include "atn/PredictionMode.h"
 #include "atn/ProfilingATNSimulator.h"
 #include "atn/RangeTransition.h"
@@ -146,13 +150,18 @@
 #include "atn/Transition.h"
 #include "atn/WildcardTransition.h"
 #include "dfa/DFA.h"
+#include "dfa/DFAMemoryBudget.h"
 #include "dfa/DFASerializer.h"
 #include "dfa/DFAState.h"
+#include "dfa/DFAWarmer.h"
 #include "dfa/LexerDFASerializer.h"
+#include "misc/EpochManager.h"
 #include "misc/Interval.h"
 #include "misc/IntervalSet.h"
+#include "misc/LineIndex.h"
 #include "misc/MurmurHash.h"
 #include "misc/Predicate.h"
+#include "misc/RecognizerDriver.h"
 #include "misc/TestRig.h"
 #include "support/Arrays.h"
 #include "support/BitSet.h"
@@ -177,8 +186,18 @@
 #include "tree/pattern/ParseTreeMatch.h"
 #include "tree/pattern/ParseTreePattern.h"
 #include "tree/pattern/ParseTreePatternMatcher.h"
+#include "tree/pattern/ParseTreePatternSet.h"
 #include "tree/pattern/RuleTagToken.h"
 #include "tree/pattern/TagChunk.h"
 #include "tree/pattern/TextChunk.h"
 #include "tree/pattern/TokenTagToken.h"
+#include "tree/xpath/XPath.h"
+#include "tree/xpath/XPathElement.h"
+#include "tree/xpath/XPathIndex.h"
 #include "tree/xpath/XPathLexer.h"
+#include "tree/xpath/XPathRuleAnywhereElement.h"
+#include "tree/xpath/XPathRuleElement.h"
+#include "tree/xpath/XPathTokenAnywhereElement.h"
+#include "tree/xpath/XPathTokenElement.h"
+#include "tree/xpath/XPathWildcardAnywhereElement.h"
+#include "tree/xpath/XPathWildcardElement.h"
@@ -39,6 +39,7 @@
 #include "atn/ATNType.h"
 #include "Exceptions.h"
 #include "support/CPPUtils.h"
+#include "misc/MurmurHash.h"
 
 #include "atn/ATN.h"
 
@@ -46,6 +47,11 @@ using namespace org::antlr::v4::runtime;
 using namespace org::antlr::v4::runtime::atn;
 using namespace antlrcpp;
 
+const int ATN::INVALID_ALT_NUMBER;
+
+// The look cache is dropped when it grows beyond this number of entries.
+static const size_t MAX_LOOK_CACHE_SIZE = 10000;
+
 ATN::ATN() : ATN(ATNType::LEXER, 0) {
 }
 
@@ -83,6 +89,8 @@ ATN& ATN::operator = (ATN &other) NOEXCEPT {
   ruleToTokenType = other.ruleToTokenType;
   lexerActions = other.lexerActions;
   modeToStartState = other.modeToStartState;
+  _lookCache.clear();
+  _bypassAltsAtn.reset();
 
   return *this;
 }
@@ -101,14 +109,45 @@ ATN& ATN::operator = (ATN &&other) NOEXCEPT {
   ruleToTokenType = std::move(other.ruleToTokenType);
   lexerActions = std::move(other.lexerActions);
   modeToStartState = std::move(other.modeToStartState);
+  _lookCache.clear();
+  _bypassAltsAtn.reset();
 
   return *this;
 }
 
 misc::IntervalSet ATN::nextTokens(ATNState *s, Ref<RuleContext> ctx) const {
+  if (ctx == nullptr) {
+    LL1Analyzer analyzer(*this);
+    return analyzer.LOOK(s, ctx);
+  }
+
+  // Same walk as in PredictionContext::fromRuleContext.
+  std::vector<size_t> key;
+  key.push_back((size_t)s->stateNumber);
+  for (Ref<RuleContext> context = ctx; context.get() != RuleContext::EMPTY.get() && !context->parent.expired();
+       context = context->parent.lock()) {
+    ATNState *invokingState = states.at((size_t)context->invokingState);
+    RuleTransition *transition = static_cast<RuleTransition *>(invokingState->transition(0));
+    key.push_back((size_t)transition->followState->stateNumber);
+  }
+
+  {
+    std::lock_guard<std::mutex> lck(_lookCacheLock);
+    auto iterator = _lookCache.find(key);
+    if (iterator != _lookCache.end()) {
+      return iterator->second;
+    }
+  }
+
   LL1Analyzer analyzer(*this);
-  return analyzer.LOOK(s, ctx);
+  misc::IntervalSet result = analyzer.LOOK(s, ctx);
 
+  std::lock_guard<std::mutex> lck(_lookCacheLock);
+  if (_lookCache.size() >= MAX_LOOK_CACHE_SIZE) {
+    _lookCache.clear();
+  }
+  _lookCache.emplace(std::move(key), result);
+  return result;
 }
 
 misc::IntervalSet& ATN::nextTokens(ATNState *s) const {
@@ -185,6 +224,14 @@ misc::IntervalSet ATN::getExpectedTokens(int stateNumber, Ref<RuleContext> conte
   return expected;
 }
 
+size_t ATN::LookKeyHasher::operator()(const std::vector<size_t> &key) const {
+  size_t hash = misc::MurmurHash::initialize();
+  for (size_t value : key) {
+    hash = misc::MurmurHash::update(hash, value);
+  }
+  return misc::MurmurHash::finish(hash, key.size());
+}
+
 std::string ATN::toString() const {
   std::stringstream ss;
   std::string type;
@@ -32,6 +32,7 @@
 #pragma once
 
 #include "RuleContext.h"
+#include "misc/IntervalSet.h"
 
 namespace org {
 namespace antlr {
@@ -91,6 +92,7 @@ namespace atn {
     ///  If {@code ctx} is null, the set of tokens will not include what can follow
     ///  the rule surrounding {@code s}. In other words, the set will be
     ///  restricted to tokens reachable staying within {@code s}'s rule.
+    ///  Results for a non-null context are cached per state and rule invocation chain.
     /// </summary>
     virtual misc::IntervalSet nextTokens(ATNState *s, Ref<RuleContext> ctx) const;
 
@@ -132,6 +134,22 @@ namespace atn {
     virtual misc::IntervalSet getExpectedTokens(int stateNumber, Ref<RuleContext> context) const;
 
     std::string toString() const;
+
+  private:
+    struct LookKeyHasher {
+      size_t operator()(const std::vector<size_t> &key) const;
+    };
+
+    // Results of nextTokens(s, ctx), keyed by the number of s followed by the follow states of the rule
+    // invocations in ctx (which is all LL1Analyzer::LOOK takes from the context). Shared by all parsers using this ATN.
+    mutable std::mutex _lookCacheLock;
+    mutable std::unordered_map<std::vector<size_t>, misc::IntervalSet, LookKeyHasher> _lookCache;
+
+    // The deserialized ATN with bypass alternatives for this parser ATN (see Parser::getATNWithBypassAlts and
+    // ATNDeserializationOptions::isGenerateRuleBypassTransitions), created on first use.
+    friend class runtime::Parser;
+    mutable std::mutex _bypassAltsAtnLock;
+    mutable Ref<ATN> _bypassAltsAtn;
   };
   
 } // namespace atn
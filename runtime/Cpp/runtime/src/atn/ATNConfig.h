@@ -113,6 +113,11 @@ namespace atn {
       size_t operator()(const ATNConfig &k) const {
         return k.hashCode();
       }
+
+      // Without this overload set lookups would convert the key to a temporary config copy.
+      size_t operator()(const Ref<ATNConfig> &k) const {
+        return k->hashCode();
+      }
     };
 
     struct ATNConfigComparer {
@@ -120,6 +125,11 @@ namespace atn {
       {
         return lhs == rhs;
       }
+
+      bool operator()(const Ref<ATNConfig> &lhs, const Ref<ATNConfig> &rhs) const
+      {
+        return *lhs == *rhs;
+      }
     };
 
     /**
@@ -134,7 +144,7 @@ namespace atn {
     /// An ATN configuration is equal to another if both have
     /// the same state, they predict the same alternative, and
     /// syntactic/semantic contexts are the same.
-    bool operator == (const ATNConfig &other) const;
+    virtual bool operator == (const ATNConfig &other) const;
 
     virtual std::string toString();
     std::string toString(bool showAlt);
@@ -187,7 +187,7 @@ bool ATNConfigSet::operator == (const ATNConfigSet &other) {
         configEquals = false;
         break;
       }
-      if (configs[i] != other.configs[i]) {
+      if (configs[i] != other.configs[i] && !(*configs[i] == *other.configs[i])) {
         configEquals = false;
         break;
       }
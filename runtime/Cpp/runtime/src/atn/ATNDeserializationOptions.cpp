@@ -42,6 +42,7 @@ ATNDeserializationOptions::ATNDeserializationOptions() {
 ATNDeserializationOptions::ATNDeserializationOptions(ATNDeserializationOptions *options) : ATNDeserializationOptions() {
   this->verifyATN = options->verifyATN;
   this->generateRuleBypassTransitions = options->generateRuleBypassTransitions;
+  this->generateLL1DecisionTables = options->generateLL1DecisionTables;
 }
 
 const ATNDeserializationOptions& ATNDeserializationOptions::getDefaultOptions() {
@@ -74,6 +75,15 @@ void ATNDeserializationOptions::setGenerateRuleBypassTransitions(bool generateRu
   this->generateRuleBypassTransitions = generateRuleBypassTransitions;
 }
 
+bool ATNDeserializationOptions::isGenerateLL1DecisionTables() {
+  return generateLL1DecisionTables;
+}
+
+void ATNDeserializationOptions::setGenerateLL1DecisionTables(bool generateLL1DecisionTables) {
+  throwIfReadOnly();
+  this->generateLL1DecisionTables = generateLL1DecisionTables;
+}
+
 void ATNDeserializationOptions::throwIfReadOnly() {
   if (isReadOnly()) {
     throw "The object is read only.";
@@ -84,4 +94,5 @@ void ATNDeserializationOptions::InitializeInstanceFields() {
   readOnly = false;
   verifyATN = true;
   generateRuleBypassTransitions = false;
+  generateLL1DecisionTables = true;
 }
@@ -46,6 +46,7 @@ namespace atn {
     bool readOnly;
     bool verifyATN;
     bool generateRuleBypassTransitions;
+    bool generateLL1DecisionTables;
 
   public:
     ATNDeserializationOptions();
@@ -66,6 +67,12 @@ namespace atn {
 
     void setGenerateRuleBypassTransitions(bool generateRuleBypassTransitions);
 
+    bool isGenerateLL1DecisionTables();
+
+    /// Determines if the token type -> alt lookup tables for LL(1) decisions (see DecisionState::ll1Table)
+    /// are computed when deserializing a parser ATN. They allow adaptivePredict to skip the DFA for such decisions.
+    void setGenerateLL1DecisionTables(bool generateLL1DecisionTables);
+
   protected:
     virtual void throwIfReadOnly();
 
@@ -74,6 +74,7 @@
 #include "atn/LexerPushModeAction.h"
 #include "atn/LexerSkipAction.h"
 #include "atn/LexerTypeAction.h"
+#include "atn/LL1Analyzer.h"
 
 #include "atn/ATNDeserializer.h"
 
@@ -511,6 +512,10 @@ ATN ATNDeserializer::deserialize(const std::vector<uint16_t>& input) {
     }
   }
 
+  if (deserializationOptions.isGenerateLL1DecisionTables() && atn.grammarType == ATNType::PARSER) {
+    markLL1Decisions(atn);
+  }
+
   return atn;
 }
 
@@ -542,6 +547,61 @@ void ATNDeserializer::markPrecedenceDecisions(const ATN &atn) {
   }
 }
 
+/**
+ * Fill the {@link DecisionState#ll1Table} of all decisions whose alternatives
+ * can be told apart by the next input symbol alone. The lookahead is computed
+ * the same way SLL prediction sees it (following global FOLLOW links when
+ * falling off a rule end), so a symbol in exactly one of the sets predicts
+ * the same alternative {@link ParserATNSimulator#adaptivePredict} would.
+ * EOF is never put into a table, because configurations reaching the end of
+ * the start rule can match it too and their lookahead isn't known here.
+ *
+ * @param atn The ATN.
+ */
+void ATNDeserializer::markLL1Decisions(const ATN &atn) {
+  LL1Analyzer analyzer(atn);
+  for (DecisionState *state : atn.decisionToState) {
+    state->ll1Table.clear();
+
+    std::vector<misc::IntervalSet> look = analyzer.getDecisionLookahead(state);
+    if (look.size() < 2) {
+      continue;
+    }
+
+    std::vector<int> table;
+    bool isLL1 = true;
+    for (size_t alt = 0; alt < look.size() && isLL1; ++alt) {
+      // An empty set means the alt hit a predicate or has no lookahead at all.
+      if (look[alt].isEmpty()) {
+        isLL1 = false;
+        break;
+      }
+
+      for (const misc::Interval &interval : look[alt].getIntervals()) {
+        for (int t = std::max(interval.a, 1); t <= interval.b; ++t) {
+          if ((size_t)t >= table.size()) {
+            table.resize((size_t)t + 1, ATN::INVALID_ALT_NUMBER);
+          }
+
+          if (table[(size_t)t] != ATN::INVALID_ALT_NUMBER) {
+            isLL1 = false; // Lookahead sets are not disjoint.
+            break;
+          }
+          table[(size_t)t] = (int)alt + 1;
+        }
+
+        if (!isLL1) {
+          break;
+        }
+      }
+    }
+
+    if (isLL1) {
+      state->ll1Table = std::move(table);
+    }
+  }
+}
+
 void ATNDeserializer::verifyATN(const ATN &atn) {
   // verify assumptions
   for (ATNState *state : atn.states) {
@@ -79,6 +79,7 @@ namespace atn {
     /// introduced; otherwise, {@code false}. </returns>
     virtual bool isFeatureSupported(const Guid &feature, const Guid &actualUuid);
     void markPrecedenceDecisions(const ATN &atn);
+    void markLL1Decisions(const ATN &atn);
     Ref<LexerAction> lexerActionFactory(LexerActionType type, int data1, int data2);
 
   private:
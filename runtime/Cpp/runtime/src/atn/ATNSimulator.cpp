@@ -34,6 +34,7 @@
 #include "dfa/DFAState.h"
 #include "atn/ATNDeserializer.h"
 #include "atn/EmptyPredictionContext.h"
+#include "dfa/DFAMemoryBudget.h"
 
 #include "atn/ATNSimulator.h"
 
@@ -44,7 +45,7 @@ using namespace org::antlr::v4::runtime::atn;
 const Ref<DFAState> ATNSimulator::ERROR = std::make_shared<DFAState>(INT32_MAX);
 
 ATNSimulator::ATNSimulator(const ATN &atn, Ref<PredictionContextCache> sharedContextCache)
-: atn(atn), _sharedContextCache(sharedContextCache) {
+: atn(atn), _sharedContextCache(sharedContextCache), _dfaGrew(false) {
 }
 
 void ATNSimulator::clearDFA() {
@@ -55,8 +56,25 @@ Ref<PredictionContextCache> ATNSimulator::getSharedContextCache() {
   return _sharedContextCache;
 }
 
+void ATNSimulator::setMemoryBudget(Ref<dfa::DFAMemoryBudget> budget) {
+  _memoryBudget = budget;
+}
+
+Ref<dfa::DFAMemoryBudget> ATNSimulator::getMemoryBudget() const {
+  return _memoryBudget;
+}
+
+void ATNSimulator::checkMemoryBudget() {
+  if (_dfaGrew) {
+    _dfaGrew = false;
+    if (_memoryBudget != nullptr) {
+      _memoryBudget->enforce();
+    }
+  }
+}
+
 Ref<PredictionContext> ATNSimulator::getCachedContext(Ref<PredictionContext> context) {
-  std::lock_guard<std::recursive_mutex> lck(mtx);
+  // The cache is shared with other simulators, so it locks itself.
   std::map<Ref<PredictionContext>, Ref<PredictionContext>> visited;
   return PredictionContext::getCachedContext(context, _sharedContextCache, visited);
 }
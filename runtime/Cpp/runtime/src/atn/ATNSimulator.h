@@ -34,6 +34,7 @@
 #include "atn/ATN.h"
 #include "misc/IntervalSet.h"
 #include "atn/PredictionContext.h"
+#include "misc/EpochManager.h"
 
 namespace org {
 namespace antlr {
@@ -65,6 +66,12 @@ namespace atn {
      */
     virtual void clearDFA();
     virtual Ref<PredictionContextCache> getSharedContextCache();
+
+    /// Sets the memory budget for the DFAs used by this simulator (see dfa::DFAMemoryBudget). All recognizers
+    /// of a grammar should use the same budget. nullptr (the default) means no limit.
+    void setMemoryBudget(Ref<dfa::DFAMemoryBudget> budget);
+    Ref<dfa::DFAMemoryBudget> getMemoryBudget() const;
+
     virtual Ref<PredictionContext> getCachedContext(Ref<PredictionContext> context);
 
     /// @deprecated Use <seealso cref="ATNDeserializer#deserialize"/> instead.
@@ -109,7 +116,17 @@ namespace atn {
     ///  so it's not worth the complexity.
     /// </summary>
     Ref<PredictionContextCache> _sharedContextCache;
-    
+
+    /// Keeps the DFA states used during a prediction from being freed when the DFA is cleared meanwhile.
+    misc::EpochManager::Participant _epochParticipant;
+
+    Ref<dfa::DFAMemoryBudget> _memoryBudget;
+
+    /// Set when states were added to the DFA, so the budget is checked once the prediction is done.
+    /// Not earlier, as the simulator holds pointers to states while predicting.
+    bool _dfaGrew;
+
+    void checkMemoryBudget();
   };
 
 } // namespace atn
@@ -120,8 +120,9 @@ void ATNState::setTransition(size_t i, Transition *e) {
 }
 
 Transition *ATNState::removeTransition(int index) {
+  Transition *result = transitions[(size_t)index];
   transitions.erase(transitions.begin() + index);
-  return nullptr;
+  return result;
 }
 
 bool ATNState::onlyHasEpsilonTransitions() {
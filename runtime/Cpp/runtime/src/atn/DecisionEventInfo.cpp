@@ -1,4 +1,4 @@
-/*
+﻿/*
  * [The "BSD license"]
  *  Copyright (c) 2016 Mike Lischke
  *  Copyright (c) 2014 Terence Parr
@@ -29,12 +29,61 @@
  *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include "Exceptions.h"
+#include "Token.h"
+#include "TokenStream.h"
+
 #include "atn/DecisionEventInfo.h"
 
 using namespace org::antlr::v4::runtime;
 using namespace org::antlr::v4::runtime::atn;
 
+namespace {
+
+  // Collects the text of the span token by token, as not all streams know their size or can return the text of
+  // an interval. Tokens which aren't available (anymore) end the span.
+  std::string getSpanText(TokenStream *input, size_t startIndex, size_t stopIndex) {
+    std::string text;
+    for (size_t i = startIndex; i <= stopIndex; ++i) {
+      Ref<Token> token;
+      try {
+        token = input->get(i);
+      } catch (IndexOutOfBoundsException &) {
+        break;
+      }
+      if (token->getType() == Token::EOF) {
+        break;
+      }
+
+      text += token->getText();
+      if (text.size() > DecisionEventInfo::MAX_TEXT_LENGTH) {
+        return text.substr(0, DecisionEventInfo::MAX_TEXT_LENGTH) + "...";
+      }
+    }
+    return text;
+  }
+
+  Ref<Token> getStartToken(TokenStream *input, size_t startIndex) {
+    if (input == nullptr) {
+      return nullptr;
+    }
+    try {
+      return input->get(startIndex);
+    } catch (IndexOutOfBoundsException &) {
+      return nullptr;
+    }
+  }
+
+}
+
 DecisionEventInfo::DecisionEventInfo(int decision, Ref<ATNConfigSet> configs, TokenStream *input, size_t startIndex,
   size_t stopIndex, bool fullCtx)
-  : decision(decision), configs(configs), input(input), startIndex(startIndex), stopIndex(stopIndex), fullCtx(fullCtx) {
+  : DecisionEventInfo(decision, configs, startIndex, stopIndex, fullCtx, input, getStartToken(input, startIndex)) {
+}
+
+DecisionEventInfo::DecisionEventInfo(int decision, Ref<ATNConfigSet> configs, size_t startIndex, size_t stopIndex,
+  bool fullCtx, TokenStream *input, Ref<Token> start)
+  : decision(decision), configs(configs), startIndex(startIndex), stopIndex(stopIndex), fullCtx(fullCtx),
+    text(start == nullptr ? "" : getSpanText(input, startIndex, stopIndex)), line(start == nullptr ? 0 : start->getLine()),
+    charPositionInLine(start == nullptr ? 0 : start->getCharPositionInLine()) {
 }
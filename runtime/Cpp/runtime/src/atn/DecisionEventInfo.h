@@ -1,4 +1,4 @@
-/*
+﻿/*
  * [The "BSD license"]
  *  Copyright (c) 2016 Mike Lischke
  *  Copyright (c) 2014 Terence Parr
@@ -69,11 +69,6 @@ namespace atn {
     /// </summary>
     const Ref<ATNConfigSet> configs;
 
-    /// <summary>
-    /// The input token stream which is being parsed.
-    /// </summary>
-    const TokenStream *input;
-
     /// <summary>
     /// The token index in the input stream at which the current prediction was
     /// originally invoked.
@@ -91,8 +86,28 @@ namespace atn {
     /// </summary>
     const bool fullCtx;
 
+    /// <summary>
+    /// The text of the tokens startIndex..stopIndex, shortened to MAX_TEXT_LENGTH characters (plus "...").
+    /// The input stream is not kept, as it may be gone (or may have dropped the tokens, like the
+    /// <seealso cref="UnbufferedTokenStream"/>) when the event is examined.
+    /// </summary>
+    const std::string text;
+
+    /// <summary>
+    /// The position of the token at startIndex, line 0 if the token was not available.
+    /// </summary>
+    const int line;
+    const int charPositionInLine;
+
+    static const size_t MAX_TEXT_LENGTH = 60;
+
+    /// The span is read from the input right away, it must still hold the tokens startIndex..stopIndex.
     DecisionEventInfo(int decision, Ref<ATNConfigSet> configs, TokenStream *input, size_t startIndex, size_t stopIndex,
                       bool fullCtx);
+
+  private:
+    DecisionEventInfo(int decision, Ref<ATNConfigSet> configs, size_t startIndex, size_t stopIndex, bool fullCtx,
+                      TokenStream *input, Ref<Token> start);
   };
 
 } // namespace atn
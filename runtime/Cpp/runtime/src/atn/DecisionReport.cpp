@@ -0,0 +1,241 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Parser.h"
+#include "Exceptions.h"
+#include "atn/ATN.h"
+#include "atn/BlockStartState.h"
+#include "atn/DecisionEventInfo.h"
+#include "atn/DecisionInfo.h"
+#include "atn/LookaheadEventInfo.h"
+#include "atn/ParseInfo.h"
+#include "atn/RuleStartState.h"
+#include "atn/RuleTransition.h"
+#include "atn/StarLoopEntryState.h"
+#include "support/CPPUtils.h"
+
+#include <iomanip>
+
+#include "atn/DecisionReport.h"
+
+using namespace org::antlr::v4::runtime;
+using namespace org::antlr::v4::runtime::atn;
+using namespace antlrcpp;
+
+namespace {
+
+  std::string describeSpan(const char *what, const DecisionEventInfo &event) {
+    if (event.line == 0) {
+      return "";
+    }
+
+    std::string text = event.text;
+    for (auto &c : text) {
+      if (c == '\n' || c == '\r' || c == '\t') {
+        c = ' ';
+      }
+    }
+
+    std::stringstream ss;
+    ss << what << " at " << event.line << ":" << event.charPositionInLine << " (" << event.stopIndex - event.startIndex + 1
+      << " tokens) \"" << text << "\"";
+    return ss.str();
+  }
+
+}
+
+double DecisionReport::Entry::getFallbackRate() const {
+  return invocations == 0 ? 0 : (double)LL_Fallback / (double)invocations;
+}
+
+DecisionReport::DecisionReport(Parser *parser, size_t maxExamples) {
+  Ref<ParseInfo> parseInfo = parser->getParseInfo();
+  if (parseInfo == nullptr) {
+    throw IllegalStateException("A decision report needs a parser with profiling enabled.");
+  }
+
+  const ATN &atn = parser->getATN();
+  const std::vector<std::string> &ruleNames = parser->getRuleNames();
+  std::vector<DecisionInfo> decisions = parseInfo->getDecisionInfo();
+  for (auto &info : decisions) {
+    if (info.invocations == 0) {
+      continue;
+    }
+
+    Entry entry;
+    entry.decision = info.decision;
+    DecisionState *state = atn.decisionToState[info.decision];
+    entry.ruleIndex = (size_t)state->ruleIndex;
+    entry.ruleName = entry.ruleIndex < ruleNames.size() ? ruleNames[entry.ruleIndex] : std::to_string(entry.ruleIndex);
+    entry.ruleAlternative = getRuleAlternative(atn, state);
+    entry.construct = getConstruct(state);
+    entry.invocations = info.invocations;
+    entry.timeInPrediction = info.timeInPrediction;
+    entry.SLL_MaxLook = info.SLL_MaxLook;
+    entry.LL_MaxLook = info.LL_MaxLook;
+    entry.LL_Fallback = info.LL_Fallback;
+    entry.dfaSize = parseInfo->getDFASize(info.decision);
+    entry.ambiguities = info.ambiguities.size();
+    entry.contextSensitivities = info.contextSensitivities.size();
+    entry.errors = info.errors.size();
+
+    std::vector<std::string> examples;
+    if (info.SLL_MaxLookEvent != nullptr && info.SLL_MaxLook > 1) {
+      examples.push_back(describeSpan("max SLL lookahead", *info.SLL_MaxLookEvent));
+    }
+    if (info.LL_MaxLookEvent != nullptr) {
+      examples.push_back(describeSpan("max LL lookahead", *info.LL_MaxLookEvent));
+    }
+    for (auto &event : info.ambiguities) {
+      examples.push_back(describeSpan("ambiguity", event));
+    }
+    for (auto &event : info.contextSensitivities) {
+      examples.push_back(describeSpan("context sensitivity", event));
+    }
+    for (auto &event : info.errors) {
+      examples.push_back(describeSpan("error", event));
+    }
+    for (auto &example : examples) {
+      if (entry.examples.size() == maxExamples) {
+        break;
+      }
+      if (!example.empty()) {
+        entry.examples.push_back(example);
+      }
+    }
+
+    _entries.push_back(entry);
+  }
+
+  std::stable_sort(_entries.begin(), _entries.end(), [](const Entry &lhs, const Entry &rhs) {
+    return lhs.timeInPrediction > rhs.timeInPrediction;
+  });
+}
+
+const std::vector<DecisionReport::Entry>& DecisionReport::getEntries() const {
+  return _entries;
+}
+
+std::string DecisionReport::toString(size_t maxEntries) const {
+  std::stringstream ss;
+  ss << std::left << std::setw(10) << "decision" << std::right << std::setw(12) << "time (ms)" << std::setw(12) << "calls"
+    << std::setw(8) << "SLL k" << std::setw(8) << "LL k" << std::setw(16) << "LL fallbacks" << std::setw(8) << "DFA"
+    << "  location" << std::endl;
+
+  size_t count = 0;
+  for (auto &entry : _entries) {
+    if (maxEntries > 0 && count++ == maxEntries) {
+      break;
+    }
+
+    std::stringstream fallbacks;
+    fallbacks << entry.LL_Fallback << " (" << std::fixed << std::setprecision(1) << entry.getFallbackRate() * 100 << "%)";
+    ss << std::left << std::setw(10) << entry.decision << std::right << std::fixed << std::setprecision(3)
+      << std::setw(12) << (double)entry.timeInPrediction / 1000000 << std::setw(12) << entry.invocations
+      << std::setw(8) << entry.SLL_MaxLook << std::setw(8) << entry.LL_MaxLook << std::setw(16) << fallbacks.str()
+      << std::setw(8) << entry.dfaSize << "  " << entry.ruleName;
+    if (entry.ruleAlternative > 0) {
+      ss << ", alt " << entry.ruleAlternative;
+    }
+    ss << ", " << entry.construct << std::endl;
+
+    for (auto &example : entry.examples) {
+      ss << "          " << example << std::endl;
+    }
+  }
+  return ss.str();
+}
+
+size_t DecisionReport::getRuleAlternative(const ATN &atn, ATNState *decisionState) {
+  if ((size_t)decisionState->ruleIndex >= atn.ruleToStartState.size()) {
+    return 0;
+  }
+
+  // A rule with several alternatives starts with a block, one transition per alternative. Search each
+  // alternative for the decision state, stepping over rule invocations and stopping at the block end.
+  ATNState *ruleStart = atn.ruleToStartState[(size_t)decisionState->ruleIndex];
+  if (ruleStart->getNumberOfTransitions() == 0) {
+    return 0;
+  }
+  ATNState *block = ruleStart->transition(0)->target;
+  if (block == decisionState || !is<BlockStartState *>(block) || block->getNumberOfTransitions() < 2) {
+    return 0;
+  }
+
+  ATNState *blockEnd = (ATNState *)static_cast<BlockStartState *>(block)->endState;
+  for (size_t alt = 0; alt < block->getNumberOfTransitions(); ++alt) {
+    std::vector<ATNState *> pipeline = { block->transition(alt)->target };
+    std::unordered_set<ATNState *> visited;
+    while (!pipeline.empty()) {
+      ATNState *state = pipeline.back();
+      pipeline.pop_back();
+      if (state == decisionState) {
+        return alt + 1;
+      }
+      if (state == blockEnd || !visited.insert(state).second) {
+        continue;
+      }
+
+      for (size_t i = 0; i < state->getNumberOfTransitions(); ++i) {
+        Transition *transition = state->transition(i);
+        if (transition->getSerializationType() == Transition::RULE) {
+          pipeline.push_back(static_cast<RuleTransition *>(transition)->followState);
+        } else {
+          pipeline.push_back(transition->target);
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+std::string DecisionReport::getConstruct(ATNState *decisionState) {
+  size_t alternatives = decisionState->getNumberOfTransitions();
+  switch (decisionState->getStateType()) {
+    case ATNState::BLOCK_START:
+      return "block with " + std::to_string(alternatives) + " alternatives";
+    case ATNState::STAR_BLOCK_START:
+      return "(...)* block with " + std::to_string(alternatives) + " alternatives";
+    case ATNState::PLUS_BLOCK_START:
+      return "(...)+ block with " + std::to_string(alternatives) + " alternatives";
+    case ATNState::STAR_LOOP_ENTRY:
+      if (static_cast<StarLoopEntryState *>(decisionState)->isPrecedenceDecision) {
+        return "left recursion loop";
+      }
+      return "(...)* loop";
+    case ATNState::PLUS_LOOP_BACK:
+      return "(...)+ loop";
+    case ATNState::TOKEN_START:
+      return "token rule selection";
+    default:
+      return "decision";
+  }
+}
@@ -0,0 +1,107 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "antlr4-common.h"
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+namespace atn {
+
+  /// <summary>
+  /// Ranks the decisions of a profiled parser (see <seealso cref="Parser#setProfile"/>) by the time spent
+  /// in prediction and maps each of them back to the grammar: the rule it belongs to, the outer alternative
+  /// of that rule which contains it and the kind of construct (block, loop etc.) it was generated for.
+  /// Together with the lookahead depth, the LL fallback rate and the DFA size this shows which parts of a
+  /// grammar are worth optimizing.
+  /// <p/>
+  /// The example input spans are taken from the events recorded by the <seealso cref="ProfilingATNSimulator"/>,
+  /// which keep the text of their span, so the report works for any token stream, even after it is gone.
+  /// </summary>
+  class ANTLR4CPP_PUBLIC DecisionReport {
+  public:
+    struct Entry {
+      size_t decision;
+      size_t ruleIndex;
+      std::string ruleName;
+
+      /// The outer alternative (1-based) of the rule which contains the decision, 0 if the decision selects
+      /// among the outer alternatives itself or the rule has only one alternative.
+      size_t ruleAlternative;
+
+      /// The grammar construct of the decision, e.g. "block" or "(...)* loop".
+      std::string construct;
+
+      long long invocations;
+      long long timeInPrediction; // Nanoseconds.
+      long long SLL_MaxLook;
+      long long LL_MaxLook;
+      long long LL_Fallback;
+      size_t dfaSize;
+      size_t ambiguities;
+      size_t contextSensitivities;
+      size_t errors;
+
+      /// Input spans with the deepest lookahead and those which caused ambiguities, context sensitivities or errors.
+      std::vector<std::string> examples;
+
+      double getFallbackRate() const;
+    };
+
+    /// Creates the report from the current profiling data of the parser. Throws an IllegalStateException if
+    /// profiling isn't enabled. Decisions which were never invoked are left out.
+    DecisionReport(Parser *parser, size_t maxExamples = 3);
+    virtual ~DecisionReport() {};
+
+    /// The entries, most expensive (time in prediction) first.
+    const std::vector<Entry>& getEntries() const;
+
+    /// A table of the first maxEntries entries (all if 0) including the example spans.
+    std::string toString(size_t maxEntries = 20) const;
+
+    /// The 1-based outer alternative of its rule which contains the given decision state (see Entry::ruleAlternative).
+    static size_t getRuleAlternative(const ATN &atn, ATNState *decisionState);
+
+    /// A short description of the grammar construct for which the given decision state was generated.
+    static std::string getConstruct(ATNState *decisionState);
+
+  private:
+    std::vector<Entry> _entries;
+  };
+
+} // namespace atn
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
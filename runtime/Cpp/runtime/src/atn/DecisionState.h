@@ -44,6 +44,12 @@ namespace atn {
     int decision;
     bool nonGreedy;
 
+    /// For decisions which can be made by looking at the next token only (the lookahead sets of all alts are
+    /// disjoint and no predicate is involved) this maps a token type to the predicted alternative.
+    /// Token types not covered (including EOF) have ATN::INVALID_ALT_NUMBER. Empty for all other decisions.
+    /// Set up by the ATNDeserializer for parser ATNs.
+    std::vector<int> ll1Table;
+
   private:
     void InitializeInstanceFields();
 
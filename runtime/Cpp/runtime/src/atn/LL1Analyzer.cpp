@@ -62,7 +62,7 @@ std::vector<misc::IntervalSet> LL1Analyzer::getDecisionLookahead(ATNState *s) co
   for (size_t alt = 0; alt < s->getNumberOfTransitions(); alt++) {
     bool seeThruPreds = false; // fail to get lookahead upon pred
 
-    ATNConfig::Set lookBusy;
+    LookBusySet lookBusy(_atn.states.size());
     antlrcpp::BitSet callRuleStack;
     _LOOK(s->transition(alt)->target, nullptr, PredictionContext::EMPTY,
           look[alt], lookBusy, callRuleStack, seeThruPreds, false);
@@ -85,7 +85,7 @@ misc::IntervalSet LL1Analyzer::LOOK(ATNState *s, ATNState *stopState, Ref<RuleCo
   bool seeThruPreds = true; // ignore preds; get all lookahead
   Ref<PredictionContext> lookContext = ctx != nullptr ? PredictionContext::fromRuleContext(_atn, ctx) : nullptr;
 
-  ATNConfig::Set lookBusy;
+  LookBusySet lookBusy(_atn.states.size());
   antlrcpp::BitSet callRuleStack;
   _LOOK(s, stopState, lookContext, r, lookBusy, callRuleStack, seeThruPreds, true);
 
@@ -93,14 +93,11 @@ misc::IntervalSet LL1Analyzer::LOOK(ATNState *s, ATNState *stopState, Ref<RuleCo
 }
 
 void LL1Analyzer::_LOOK(ATNState *s, ATNState *stopState, Ref<PredictionContext> ctx, misc::IntervalSet &look,
-  ATNConfig::Set &lookBusy, antlrcpp::BitSet &calledRuleStack, bool seeThruPreds, bool addEOF) const {
-  
-  Ref<ATNConfig> c = std::make_shared<ATNConfig>(s, 0, ctx);
+  LookBusySet &lookBusy, antlrcpp::BitSet &calledRuleStack, bool seeThruPreds, bool addEOF) const {
 
-  if (lookBusy.count(c) > 0) // Keep in mind comparison is based on members of the class, not the actual instance.
+  if (!lookBusy.add(s, ctx)) {
     return;
-
-  lookBusy.insert(c);
+  }
 
   if (stopState != nullptr && s == stopState) {
     if (ctx == nullptr) {
@@ -178,3 +175,35 @@ void LL1Analyzer::_LOOK(ATNState *s, ATNState *stopState, Ref<PredictionContext>
     }
   }
 }
+
+//----------------- LookBusySet ----------------------------------------------------------------------------------------
+
+LL1Analyzer::LookBusySet::LookBusySet(size_t stateCount)
+  : _stateCount(stateCount), _lastContext(nullptr), _lastVisited(nullptr) {
+}
+
+bool LL1Analyzer::LookBusySet::add(ATNState *state, const Ref<PredictionContext> &context) {
+  std::vector<bool> *visited;
+  if (context == nullptr) {
+    visited = &_withoutContext;
+  } else if (context.get() == _lastContext) {
+    visited = _lastVisited;
+  } else {
+    // Remember the context object stored in the map, which is kept alive by it (unlike the one passed in).
+    auto iterator = _visited.emplace(context, std::vector<bool>()).first;
+    _lastContext = iterator->first.get();
+    _lastVisited = &iterator->second;
+    visited = _lastVisited;
+  }
+
+  if (visited->empty()) {
+    visited->resize(_stateCount);
+  }
+
+  size_t index = (size_t)state->stateNumber;
+  if ((*visited)[index]) {
+    return false;
+  }
+  (*visited)[index] = true;
+  return true;
+}
@@ -117,8 +117,8 @@ namespace atn {
     /// not be used. </param>
     /// <param name="look"> The result lookahead set. </param>
     /// <param name="lookBusy"> A set used for preventing epsilon closures in the ATN
-    /// from causing a stack overflow. Outside code should pass
-    /// {@code new HashSet<ATNConfig>} for this argument. </param>
+    /// from causing a stack overflow. Outside code should pass a new
+    /// <seealso cref="LookBusySet"/> for this argument. </param>
     /// <param name="calledRuleStack"> A set used for preventing left recursion in the
     /// ATN from causing a stack overflow. Outside code should pass
     /// {@code new BitSet()} for this argument. </param>
@@ -130,8 +130,39 @@ namespace atn {
     /// outermost context is reached. This parameter has no effect if {@code ctx}
     /// is {@code null}. </param>
   protected:
+    /// The (state, context) pairs visited by _LOOK, as one bitmap indexed by state number per distinct
+    /// context. Contexts are compared by value, like the configs the set replaces.
+    class ANTLR4CPP_PUBLIC LookBusySet {
+    public:
+      LookBusySet(size_t stateCount);
+
+      /// Marks the pair as visited. Returns false if it was visited before.
+      bool add(ATNState *state, const Ref<PredictionContext> &context);
+
+    private:
+      struct ContextHasher {
+        size_t operator()(const Ref<PredictionContext> &k) const {
+          return k->hashCode();
+        }
+      };
+
+      struct ContextComparer {
+        bool operator()(const Ref<PredictionContext> &lhs, const Ref<PredictionContext> &rhs) const {
+          return lhs.get() == rhs.get() || *lhs == *rhs;
+        }
+      };
+
+      size_t _stateCount;
+      std::vector<bool> _withoutContext;
+      std::unordered_map<Ref<PredictionContext>, std::vector<bool>, ContextHasher, ContextComparer> _visited;
+
+      // The last looked up context (owned by _visited) and its bitmap.
+      const PredictionContext *_lastContext;
+      std::vector<bool> *_lastVisited;
+    };
+
     virtual void _LOOK(ATNState *s, ATNState *stopState, Ref<PredictionContext> ctx, misc::IntervalSet &look,
-      ATNConfig::Set &lookBusy, antlrcpp::BitSet &calledRuleStack, bool seeThruPreds, bool addEOF) const;
+      LookBusySet &lookBusy, antlrcpp::BitSet &calledRuleStack, bool seeThruPreds, bool addEOF) const;
   };
 
 } // namespace atn
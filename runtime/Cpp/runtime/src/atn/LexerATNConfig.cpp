@@ -92,13 +92,28 @@ bool LexerATNConfig::operator == (const LexerATNConfig& other) const
   if (_passedThroughNonGreedyDecision != other._passedThroughNonGreedyDecision)
     return false;
 
-  if (_lexerActionExecutor != other._lexerActionExecutor) {
+  if (_lexerActionExecutor != other._lexerActionExecutor &&
+      (_lexerActionExecutor == nullptr || other._lexerActionExecutor == nullptr ||
+       !(*_lexerActionExecutor == *other._lexerActionExecutor))) {
     return false;
   }
 
   return ATNConfig::operator == (other);
 }
 
+bool LexerATNConfig::operator == (const ATNConfig& other) const {
+  if (this == &other) {
+    return true;
+  }
+
+  const LexerATNConfig *lexerOther = dynamic_cast<const LexerATNConfig *>(&other);
+  if (lexerOther == nullptr) {
+    return false;
+  }
+
+  return *this == *lexerOther;
+}
+
 bool LexerATNConfig::checkNonGreedyDecision(Ref<LexerATNConfig> source, ATNState *target) {
   return source->_passedThroughNonGreedyDecision ||
     (is<DecisionState*>(target) && (static_cast<DecisionState*>(target))->nonGreedy);
@@ -58,6 +58,7 @@ namespace atn {
     virtual size_t hashCode() const override;
 
     bool operator == (const LexerATNConfig& other) const;
+    virtual bool operator == (const ATNConfig& other) const override;
 
   private:
     /**
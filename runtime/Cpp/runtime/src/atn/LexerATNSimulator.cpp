@@ -39,8 +39,11 @@
 #include "atn/PredicateTransition.h"
 #include "atn/ActionTransition.h"
 #include "misc/Interval.h"
+#include "misc/LineIndex.h"
 #include "dfa/DFA.h"
 #include "Lexer.h"
+#include "ByteCharStream.h"
+#include "support/SIMD.h"
 
 #include "dfa/DFAState.h"
 #include "atn/LexerATNConfig.h"
@@ -53,6 +56,64 @@ using namespace org::antlr::v4::runtime;
 using namespace org::antlr::v4::runtime::atn;
 using namespace antlrcpp;
 
+namespace {
+
+  // A loop state is only worth skipping with a few exit chars, as each one costs a compare per 16 bytes.
+  const size_t MAX_LOOP_EXITS = 4;
+
+  /// Returns the index of the first byte in data[start..size) which is either outside the ASCII range or one of
+  /// the given exit chars (or size if there is none). Also counts the newlines before it and records the index of
+  /// the last one in lastNewline (untouched if there's none).
+  size_t findLoopExit(const char *data, size_t start, size_t size, const std::vector<unsigned char> &exits,
+    size_t &newlines, size_t &lastNewline) {
+    size_t i = start;
+
+#ifdef ANTLR4CPP_USE_SSE2
+    __m128i exitVectors[MAX_LOOP_EXITS];
+    size_t exitCount = exits.size();
+    for (size_t j = 0; j < exitCount; ++j) {
+      exitVectors[j] = _mm_set1_epi8((char)exits[j]);
+    }
+    const __m128i newline = _mm_set1_epi8('\n');
+
+    for (; i + 16 <= size; i += 16) {
+      __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+      unsigned int stop = (unsigned int)_mm_movemask_epi8(chunk); // Bytes >= 0x80.
+      for (size_t j = 0; j < exitCount; ++j) {
+        stop |= (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, exitVectors[j]));
+      }
+      unsigned int lines = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline));
+
+      size_t length = 16;
+      if (stop != 0) {
+        length = (size_t)countTrailingZeros(stop);
+        lines &= (1u << length) - 1;
+      }
+      if (lines != 0) {
+        newlines += countBits(lines);
+        lastNewline = i + (size_t)highestBit(lines);
+      }
+      if (stop != 0) {
+        return i + length;
+      }
+    }
+#endif
+
+    for (; i < size; ++i) {
+      unsigned char c = (unsigned char)data[i];
+      if (c >= 0x80 || std::find(exits.begin(), exits.end(), c) != exits.end()) {
+        break;
+      }
+      if (c == '\n') {
+        ++newlines;
+        lastNewline = i;
+      }
+    }
+    return i;
+  }
+
+}
+
 void LexerATNSimulator::SimState::reset() {
   index = -1;
   line = 0;
@@ -92,20 +153,27 @@ int LexerATNSimulator::match(CharStream *input, size_t mode) {
   _mode = mode;
   ssize_t mark = input->mark();
 
+  misc::EpochManager::Guard epochGuard(_epochParticipant);
+
   auto onExit = finally([input, mark] {
     input->release(mark);
   });
 
   _startIndex = (int)input->index();
   _prevAccept.reset();
-  const dfa::DFA &dfa = _decisionToDFA[mode];
-  if (dfa.s0 == nullptr) {
-    return matchATN(input);
-  } else {
-    return execATN(input, dfa.s0);
+  if (_lazyLineTracking && input != _lineInput) {
+    updateLineIndex(input);
   }
 
-  return -1;
+  // Read s0 only once, the DFA might be cleared meanwhile.
+  dfa::DFAState *s0 = _decisionToDFA[mode].s0.load(std::memory_order_acquire);
+  int result = s0 == nullptr ? matchATN(input) : execATN(input, s0);
+
+  // Not part of onExit, as a bigger capture would make it allocate. If an exception is thrown the budget
+  // is checked after the next token.
+  checkMemoryBudget();
+
+  return result;
 }
 
 void LexerATNSimulator::reset() {
@@ -115,13 +183,15 @@ void LexerATNSimulator::reset() {
   _line = 1;
   _charPositionInLine = 0;
   _mode = Lexer::DEFAULT_MODE;
+  _lineInput = nullptr;
+  _lineIndex.reset();
+  _countLines = true;
 }
 
 void LexerATNSimulator::clearDFA() {
-  int size = (int)_decisionToDFA.size();
-  _decisionToDFA.clear();
-  for (int d = 0; d < size; ++d) {
-    _decisionToDFA.push_back(dfa::DFA(atn.getDecisionState(d), d));
+  // Cleared in place, so lexers which are matching meanwhile can go on.
+  for (auto &dfa : _decisionToDFA) {
+    dfa.clear();
   }
 }
 
@@ -138,9 +208,13 @@ int LexerATNSimulator::matchATN(CharStream *input) {
   bool suppressEdge = s0_closure->hasSemanticContext;
   s0_closure->hasSemanticContext = false;
 
-  dfa::DFAState *next = addDFAState(s0_closure);
-  if (!suppressEdge) {
-    _decisionToDFA[_mode].s0 = next;
+  dfa::DFAState *next;
+  {
+    std::lock_guard<std::recursive_mutex> lck(_decisionToDFA[_mode].getLock());
+    next = addDFAState(s0_closure);
+    if (!suppressEdge) {
+      _decisionToDFA[_mode].s0.store(next, std::memory_order_release);
+    }
   }
 
   int predict = execATN(input, next);
@@ -153,6 +227,17 @@ int LexerATNSimulator::matchATN(CharStream *input) {
 }
 
 int LexerATNSimulator::execATN(CharStream *input, dfa::DFAState *ds0) {
+  if (typeid(*this) == typeid(LexerATNSimulator)) {
+    ByteCharStream *bytes = dynamic_cast<ByteCharStream *>(input);
+    if (bytes != nullptr) {
+      return execATNLoop(bytes, ds0);
+    }
+  }
+  return execATNLoop(input, ds0);
+}
+
+template<typename T>
+int LexerATNSimulator::execATNLoop(T *input, dfa::DFAState *ds0) {
   //System.out.println("enter exec index "+input.index()+" from "+ds0.configs);
   if (debug) {
     std::cout << "start state closure=" << ds0->configs << std::endl;
@@ -161,7 +246,7 @@ int LexerATNSimulator::execATN(CharStream *input, dfa::DFAState *ds0) {
   if (ds0->isAcceptState) {
     // allow zero-length tokens
     // ml: in Java code this method uses 3 params. The first is a member var of the class anyway (_prevAccept), so why pass it here?
-    captureSimState(input, ds0);
+    captureState(input, ds0);
   }
 
   ssize_t t = input->LA(1);
@@ -203,16 +288,20 @@ int LexerATNSimulator::execATN(CharStream *input, dfa::DFAState *ds0) {
     // position accurately reflect the state of the interpreter at the
     // end of the token.
     if (t != Token::EOF) {
-      consume(input);
+      consumeChar(input);
     }
     
     if (target->isAcceptState) {
-      captureSimState(input, target);
+      captureState(input, target);
       if (t == Token::EOF) {
         break;
       }
     }
 
+    if (target == s) {
+      skipLoop(input, s);
+    }
+
     t = input->LA(1);
     s = target; // flip; current DFA target becomes new src/from state
   }
@@ -221,11 +310,11 @@ int LexerATNSimulator::execATN(CharStream *input, dfa::DFAState *ds0) {
 }
 
 dfa::DFAState *LexerATNSimulator::getExistingTargetState(dfa::DFAState *s, ssize_t t) {
-  if (s->edges.size() == 0 || t < MIN_DFA_EDGE || t > MAX_DFA_EDGE) {
+  if (t < MIN_DFA_EDGE || t > MAX_DFA_EDGE) {
     return nullptr;
   }
 
-  dfa::DFAState *target = s->edges[(size_t)(t - MIN_DFA_EDGE)];
+  dfa::DFAState *target = s->edges.get((size_t)(t - MIN_DFA_EDGE));
   if (debug && target != nullptr) {
     std::cout << std::string("reuse state ") << s->stateNumber << std::string(" edge to ") << target->stateNumber << std::endl;
   }
@@ -266,7 +355,15 @@ int LexerATNSimulator::failOrAccept(CharStream *input, Ref<ATNConfigSet> reach,
       return Token::EOF;
     }
 
-    throw LexerNoViableAltException(_recog, input, (size_t)_startIndex, reach);
+    LexerNoViableAltException e(_recog, input, (size_t)_startIndex, reach);
+    if (_recog == nullptr || !_recog->isExceptionFreeErrorHandling()) {
+      throw e;
+    }
+
+    // Handle the error right here, as Lexer::nextToken() would, and let it skip the erroneous input.
+    _recog->notifyListeners(e);
+    _recog->recover(e);
+    return Lexer::SKIP;
   }
 }
 
@@ -543,6 +640,8 @@ dfa::DFAState *LexerATNSimulator::addDFAEdge(dfa::DFAState *from, ssize_t t, Ref
   bool suppressEdge = q->hasSemanticContext;
   q->hasSemanticContext = false;
 
+  // Adding the state and the edge to it must not be interrupted by clearing the DFA.
+  std::lock_guard<std::recursive_mutex> lck(_decisionToDFA[_mode].getLock());
   dfa::DFAState *to = addDFAState(q);
 
   if (suppressEdge) {
@@ -563,12 +662,13 @@ void LexerATNSimulator::addDFAEdge(dfa::DFAState *p, ssize_t t, dfa::DFAState *q
     std::cerr << std::string("EDGE ") << p << std::string(" -> ") << q << std::string(" upon ") << (static_cast<char>(t)) << std::endl;
   }
 
-  std::lock_guard<std::recursive_mutex> lck(mtx);
+  dfa::DFA &dfa = _decisionToDFA[_mode];
+  std::lock_guard<std::recursive_mutex> lck(dfa.getLock());
   if (p->edges.empty()) {
     //  make room for tokens 1..n and -1 masquerading as index 0
-    p->edges.resize(MAX_DFA_EDGE - MIN_DFA_EDGE + 1);
+    dfa.addMemoryUsage(p->edges.resize(MAX_DFA_EDGE - MIN_DFA_EDGE + 1));
   }
-  p->edges[(size_t)(t - MIN_DFA_EDGE)] = q; // connect
+  p->edges.set((size_t)(t - MIN_DFA_EDGE), q); // connect
 }
 
 dfa::DFAState *LexerATNSimulator::addDFAState(Ref<ATNConfigSet> configs) {
@@ -595,8 +695,8 @@ dfa::DFAState *LexerATNSimulator::addDFAState(Ref<ATNConfigSet> configs) {
   dfa::DFA &dfa = _decisionToDFA[_mode];
 
   {
-    std::lock_guard<std::recursive_mutex> lck(mtx);
-    
+    std::lock_guard<std::recursive_mutex> lck(dfa.getLock());
+
     auto iterator = dfa.states.find(proposed);
     if (iterator != dfa.states.end()) {
       delete proposed;
@@ -609,6 +709,8 @@ dfa::DFAState *LexerATNSimulator::addDFAState(Ref<ATNConfigSet> configs) {
     configs->setReadonly(true);
     newState->configs = configs;
     dfa.states[newState] = newState;
+    dfa.addMemoryUsage(newState->getMemoryUsage());
+    _dfaGrew = true;
     return newState;
   }
 }
@@ -623,6 +725,11 @@ std::string LexerATNSimulator::getText(CharStream *input) {
 }
 
 size_t LexerATNSimulator::getLine() const {
+  size_t line;
+  int charPositionInLine;
+  if (lookupPosition(line, charPositionInLine)) {
+    return line;
+  }
   return _line;
 }
 
@@ -631,6 +738,11 @@ void LexerATNSimulator::setLine(size_t line) {
 }
 
 int LexerATNSimulator::getCharPositionInLine() {
+  size_t line;
+  int charPositionInLine;
+  if (lookupPosition(line, charPositionInLine)) {
+    return charPositionInLine;
+  }
   return _charPositionInLine;
 }
 
@@ -638,7 +750,162 @@ void LexerATNSimulator::setCharPositionInLine(int charPositionInLine) {
   _charPositionInLine = charPositionInLine;
 }
 
+void LexerATNSimulator::consumeChar(CharStream *input) {
+  consume(input);
+}
+
+void LexerATNSimulator::consumeChar(ByteCharStream *input) {
+  if (!_countLines) {
+    input->consume();
+    return;
+  }
+
+  if (input->LA(1) == '\n') {
+    _line++;
+    _charPositionInLine = 0;
+  } else {
+    _charPositionInLine++;
+  }
+  input->consume();
+}
+
+void LexerATNSimulator::captureState(CharStream *input, dfa::DFAState *dfaState) {
+  captureSimState(input, dfaState);
+}
+
+void LexerATNSimulator::captureState(ByteCharStream *input, dfa::DFAState *dfaState) {
+  _prevAccept.index = (int)input->index();
+  _prevAccept.line = _line;
+  _prevAccept.charPos = _charPositionInLine;
+  _prevAccept.dfaState = dfaState;
+}
+
+void LexerATNSimulator::skipLoop(CharStream * /*input*/, dfa::DFAState * /*s*/) {
+}
+
+void LexerATNSimulator::skipLoop(ByteCharStream *input, dfa::DFAState *s) {
+  if (s->loopState == dfa::DFAState::LOOP_UNKNOWN) {
+    analyzeLoop(input, s);
+  }
+  if (s->loopState != dfa::DFAState::LOOP_SKIPPABLE) {
+    return;
+  }
+
+  size_t start = input->index();
+  size_t newlines = 0;
+  size_t lastNewline = 0;
+  size_t end = findLoopExit(input->getData(), start, input->size(), s->loopExitChars, newlines, lastNewline);
+  if (end == start) {
+    return;
+  }
+
+  // The same as calling consume() for each char.
+  if (!_countLines) {
+    // Positions are looked up in the line index.
+  } else if (newlines > 0) {
+    _line += newlines;
+    _charPositionInLine = (int)(end - lastNewline - 1);
+  } else {
+    _charPositionInLine += (int)(end - start);
+  }
+  input->seek(end);
+
+  if (s->isAcceptState) {
+    captureState(input, s);
+  }
+}
+
+void LexerATNSimulator::analyzeLoop(CharStream *input, dfa::DFAState *s) {
+  dfa::DFA &dfa = _decisionToDFA[_mode];
+  std::lock_guard<std::recursive_mutex> lck(dfa.getLock());
+  if (s->loopState != dfa::DFAState::LOOP_UNKNOWN) {
+    return;
+  }
+
+  // Completing the edges of the state below computes transitions for chars which are not actually in the input.
+  // That's fine for the ATN simulation, but predicates would be run with the wrong input.
+  if (_hasPredicates < 0) {
+    _hasPredicates = 0;
+    for (ATNState *state : atn.states) {
+      for (size_t i = 0; i < state->getNumberOfTransitions(); ++i) {
+        if (state->transition(i)->getSerializationType() == Transition::PREDICATE) {
+          _hasPredicates = 1;
+        }
+      }
+    }
+  }
+
+  if (_hasPredicates > 0) {
+    s->loopState = dfa::DFAState::LOOP_NONE;
+    return;
+  }
+
+  std::vector<unsigned char> exits;
+  for (ssize_t c = MIN_DFA_EDGE; c <= MAX_DFA_EDGE; ++c) {
+    if (getExistingTargetState(s, c) == nullptr) {
+      computeTargetState(input, s, c);
+    }
+    if (getExistingTargetState(s, c) != s) {
+      exits.push_back((unsigned char)c);
+      if (exits.size() > MAX_LOOP_EXITS) {
+        s->loopState = dfa::DFAState::LOOP_NONE;
+        return;
+      }
+    }
+  }
+
+  s->loopExitChars = exits;
+  s->loopState = dfa::DFAState::LOOP_SKIPPABLE;
+  dfa.addMemoryUsage(exits.size());
+}
+
+void LexerATNSimulator::setLazyLineTracking(bool enable) {
+  _lazyLineTracking = enable;
+  _lineInput = nullptr;
+  _lineIndex.reset();
+  _countLines = true;
+}
+
+bool LexerATNSimulator::isLazyLineTracking() const {
+  return _lazyLineTracking;
+}
+
+void LexerATNSimulator::updateLineIndex(CharStream *input) const {
+  _lineInput = input;
+  _lineIndex = input->getLineIndex();
+  _lineHint = 0;
+  _countLines = _lineIndex == nullptr;
+}
+
+bool LexerATNSimulator::lookupPosition(size_t &line, int &charPositionInLine) const {
+  if (!_lazyLineTracking) {
+    return false;
+  }
+
+  CharStream *input = _recog != nullptr ? _recog->getInputStream() : _lineInput;
+  if (input == nullptr) {
+    return false;
+  }
+  if (input != _lineInput) {
+    updateLineIndex(input);
+  }
+  if (_lineIndex == nullptr) {
+    return false;
+  }
+
+  size_t index = input->index();
+  _lineHint = _lineIndex->findLine(index, _lineHint);
+  line = _lineHint + 1;
+  charPositionInLine = (int)(index - _lineIndex->getLineStart(_lineHint));
+  return true;
+}
+
 void LexerATNSimulator::consume(CharStream *input) {
+  if (!_countLines) {
+    input->consume();
+    return;
+  }
+
   ssize_t curChar = input->LA(1);
   if (curChar == '\n') {
     _line++;
@@ -662,4 +929,9 @@ void LexerATNSimulator::InitializeInstanceFields() {
   _line = 1;
   _charPositionInLine = 0;
   _mode = org::antlr::v4::runtime::Lexer::DEFAULT_MODE;
+  _hasPredicates = -1;
+  _lazyLineTracking = false;
+  _countLines = true;
+  _lineInput = nullptr;
+  _lineHint = 0;
 }
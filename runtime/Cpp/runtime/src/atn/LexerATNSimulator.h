@@ -132,6 +132,10 @@ namespace atn {
     
   protected:
     virtual int matchATN(CharStream *input);
+
+    /// Runs the match loop. For a ByteCharStream the loop is instantiated for that (final) type, so reading
+    /// and consuming chars doesn't involve virtual calls. This fast path is only taken if consume() and
+    /// captureSimState() aren't overridden.
     virtual int execATN(CharStream *input, dfa::DFAState *ds0);
 
     /// <summary>
@@ -236,9 +240,44 @@ namespace atn {
     virtual int getCharPositionInLine();
     virtual void setCharPositionInLine(int charPositionInLine);
     virtual void consume(CharStream *input);
+
+    /// In lazy line tracking mode the simulator doesn't count lines and columns while consuming chars. Instead
+    /// getLine() and getCharPositionInLine() look up the current input position in the line index of the input
+    /// (see CharStream::getLineIndex), which is built once per input. Inputs which don't provide an index are
+    /// tracked as usual. setLine() and setCharPositionInLine() have no effect while an index is used.
+    /// Enable this before lexing starts.
+    virtual void setLazyLineTracking(bool enable);
+    virtual bool isLazyLineTracking() const;
     virtual std::string getTokenName(int t);
 
   private:
+    template<typename T>
+    int execATNLoop(T *input, dfa::DFAState *ds0);
+
+    // Non virtual variants of consume() and captureSimState(), resolved by the stream type in execATNLoop.
+    void consumeChar(CharStream *input);
+    void consumeChar(ByteCharStream *input);
+    void captureState(CharStream *input, dfa::DFAState *dfaState);
+    void captureState(ByteCharStream *input, dfa::DFAState *dfaState);
+
+    // Called after a DFA state looped back to itself. For byte input this skips the whole run of chars
+    // which keep the lexer in that state (see DFAState::loopExitChars).
+    void skipLoop(CharStream *input, dfa::DFAState *s);
+    void skipLoop(ByteCharStream *input, dfa::DFAState *s);
+    void analyzeLoop(CharStream *input, dfa::DFAState *s);
+
+    int _hasPredicates; // -1 until computed by analyzeLoop.
+
+    // Lazy line tracking. The input the index was taken from is kept to notice input changes.
+    bool _lazyLineTracking;
+    mutable bool _countLines;
+    mutable CharStream *_lineInput;
+    mutable Ref<misc::LineIndex> _lineIndex;
+    mutable size_t _lineHint;
+
+    void updateLineIndex(CharStream *input) const;
+    bool lookupPosition(size_t &line, int &charPositionInLine) const;
+
     void InitializeInstanceFields();
   };
 
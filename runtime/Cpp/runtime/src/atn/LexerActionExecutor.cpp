@@ -31,6 +31,14 @@
 
 #include "misc/MurmurHash.h"
 #include "atn/LexerIndexedCustomAction.h"
+#include "atn/LexerChannelAction.h"
+#include "atn/LexerModeAction.h"
+#include "atn/LexerMoreAction.h"
+#include "atn/LexerPopModeAction.h"
+#include "atn/LexerPushModeAction.h"
+#include "atn/LexerSkipAction.h"
+#include "atn/LexerTypeAction.h"
+#include "Lexer.h"
 #include "support/CPPUtils.h"
 #include "support/Arrays.h"
 
@@ -41,8 +49,25 @@ using namespace org::antlr::v4::runtime::atn;
 using namespace org::antlr::v4::runtime::misc;
 using namespace antlrcpp;
 
+namespace {
+
+  // The offset cache gets a new entry for each position in a token at which a position-dependent action can
+  // end up (which is unbounded for actions after a loop). It only saves the construction of an executor,
+  // so it is simply emptied when it gets full.
+  const size_t MAX_OFFSET_CACHE_SIZE = 64;
+
+}
+
 LexerActionExecutor::LexerActionExecutor(const std::vector<Ref<LexerAction>> &lexerActions)
   : _lexerActions(lexerActions), _hashCode(generateHashCode()) {
+  _isPositionDependent = false;
+  _instructions.reserve(_lexerActions.size());
+  for (auto &lexerAction : _lexerActions) {
+    _instructions.push_back(lower(lexerAction));
+    if (_instructions.back().isPositionDependent) {
+      _isPositionDependent = true;
+    }
+  }
 }
 
 Ref<LexerActionExecutor> LexerActionExecutor::append(Ref<LexerActionExecutor> lexerActionExecutor, Ref<LexerAction> lexerAction) {
@@ -50,28 +75,46 @@ Ref<LexerActionExecutor> LexerActionExecutor::append(Ref<LexerActionExecutor> le
     return std::make_shared<LexerActionExecutor>(std::vector<Ref<LexerAction>> { lexerAction });
   }
 
-  std::vector<Ref<LexerAction>> lexerActions = lexerActionExecutor->_lexerActions; // Make a copy.
-  lexerActions.push_back(lexerAction);
-  return std::make_shared<LexerActionExecutor>(lexerActions);
+  std::lock_guard<std::mutex> lck(lexerActionExecutor->_cacheLock);
+  Ref<LexerActionExecutor> &result = lexerActionExecutor->_appendCache[lexerAction.get()];
+  if (result == nullptr) {
+    std::vector<Ref<LexerAction>> lexerActions = lexerActionExecutor->_lexerActions; // Make a copy.
+    lexerActions.push_back(lexerAction);
+    result = std::make_shared<LexerActionExecutor>(lexerActions);
+  }
+  return result;
 }
 
 Ref<LexerActionExecutor> LexerActionExecutor::fixOffsetBeforeMatch(int offset) {
-  std::vector<Ref<LexerAction>> updatedLexerActions;
-  for (size_t i = 0; i < _lexerActions.size(); i++) {
-    if (_lexerActions[i]->isPositionDependent() && !is<LexerIndexedCustomAction>(_lexerActions[i])) {
-      if (updatedLexerActions.empty()) {
-        updatedLexerActions = _lexerActions; // Make a copy.
-      }
-
-      updatedLexerActions[i] = std::make_shared<LexerIndexedCustomAction>(offset, _lexerActions[i]);
+  // Only position-dependent actions without an assigned offset are updated, so there is nothing to do
+  // if no action depends on the position or all of them are already wrapped.
+  bool needsUpdate = false;
+  for (auto &instruction : _instructions) {
+    if (instruction.isPositionDependent && instruction.offset < 0) {
+      needsUpdate = true;
+      break;
     }
   }
 
-  if (updatedLexerActions.empty()) {
+  if (!needsUpdate) {
     return shared_from_this();
   }
 
-  return std::make_shared<LexerActionExecutor>(updatedLexerActions);
+  std::lock_guard<std::mutex> lck(_cacheLock);
+  if (_offsetCache.size() >= MAX_OFFSET_CACHE_SIZE && _offsetCache.count(offset) == 0) {
+    _offsetCache.clear();
+  }
+  Ref<LexerActionExecutor> &result = _offsetCache[offset];
+  if (result == nullptr) {
+    std::vector<Ref<LexerAction>> updatedLexerActions = _lexerActions; // Make a copy.
+    for (size_t i = 0; i < _instructions.size(); i++) {
+      if (_instructions[i].isPositionDependent && _instructions[i].offset < 0) {
+        updatedLexerActions[i] = std::make_shared<LexerIndexedCustomAction>(offset, _lexerActions[i]);
+      }
+    }
+    result = std::make_shared<LexerActionExecutor>(updatedLexerActions);
+  }
+  return result;
 }
 
 std::vector<Ref<LexerAction>> LexerActionExecutor::getLexerActions() const {
@@ -79,26 +122,37 @@ std::vector<Ref<LexerAction>> LexerActionExecutor::getLexerActions() const {
 }
 
 void LexerActionExecutor::execute(Lexer *lexer, CharStream *input, int startIndex) {
-  bool requiresSeek = false;
+  if (!_isPositionDependent) {
+    // The common case. The input position doesn't matter, so there's nothing to seek and restore.
+    for (auto &instruction : _instructions) {
+      execute(lexer, instruction);
+    }
+    return;
+  }
+
   size_t stopIndex = input->index();
+  size_t position = stopIndex;
 
-  auto onExit = finally([requiresSeek, input, stopIndex]() {
-    if (requiresSeek) {
+  auto onExit = finally([input, &position, stopIndex]() {
+    if (position != stopIndex) {
       input->seek(stopIndex);
     }
   });
-  for (auto lexerAction : _lexerActions) {
-    if (is<LexerIndexedCustomAction>(lexerAction)) {
-      int offset = (std::static_pointer_cast<LexerIndexedCustomAction>(lexerAction))->getOffset();
-      input->seek(startIndex + offset);
-      lexerAction = std::static_pointer_cast<LexerIndexedCustomAction>(lexerAction)->getAction();
-      requiresSeek = (size_t)(startIndex + offset) != stopIndex;
-    } else if (lexerAction->isPositionDependent()) {
+
+  for (auto &instruction : _instructions) {
+    // Seek only if the input is not already at the position the action expects.
+    if (instruction.offset >= 0) {
+      size_t target = (size_t)(startIndex + instruction.offset);
+      if (position != target) {
+        input->seek(target);
+        position = target;
+      }
+    } else if (instruction.isPositionDependent && position != stopIndex) {
       input->seek(stopIndex);
-      requiresSeek = false;
+      position = stopIndex;
     }
 
-    lexerAction->execute(lexer);
+    execute(lexer, instruction);
   }
 }
 
@@ -123,3 +177,70 @@ size_t LexerActionExecutor::generateHashCode() const {
   
   return hash;
 }
+
+LexerActionExecutor::Instruction LexerActionExecutor::lower(const Ref<LexerAction> &lexerAction) const {
+  Instruction instruction = { lexerAction->getActionType(), 0, -1, lexerAction->isPositionDependent(), nullptr };
+
+  LexerAction *action = lexerAction.get();
+  if (is<LexerIndexedCustomAction>(lexerAction)) {
+    LexerIndexedCustomAction *indexedAction = static_cast<LexerIndexedCustomAction *>(action);
+    instruction.offset = indexedAction->getOffset();
+    action = indexedAction->getAction().get();
+  }
+
+  // Only the command classes of the runtime are executed inline. Their execute() implementation
+  // does nothing but forwarding a single value to the lexer. Everything else is called as is.
+  if (LexerChannelAction *channelAction = dynamic_cast<LexerChannelAction *>(action)) {
+    instruction.operand = channelAction->getChannel();
+  } else if (LexerModeAction *modeAction = dynamic_cast<LexerModeAction *>(action)) {
+    instruction.operand = modeAction->getMode();
+  } else if (LexerPushModeAction *pushModeAction = dynamic_cast<LexerPushModeAction *>(action)) {
+    instruction.operand = pushModeAction->getMode();
+  } else if (LexerTypeAction *typeAction = dynamic_cast<LexerTypeAction *>(action)) {
+    instruction.operand = typeAction->getType();
+  } else if (!is<LexerMoreAction *>(action) && !is<LexerPopModeAction *>(action) && !is<LexerSkipAction *>(action)) {
+    instruction.action = action;
+  }
+
+  return instruction;
+}
+
+void LexerActionExecutor::execute(Lexer *lexer, const Instruction &instruction) {
+  if (instruction.action != nullptr) {
+    instruction.action->execute(lexer);
+    return;
+  }
+
+  switch (instruction.type) {
+    case LexerActionType::CHANNEL:
+      lexer->setChannel(instruction.operand);
+      break;
+
+    case LexerActionType::MODE:
+      lexer->setMode((size_t)instruction.operand);
+      break;
+
+    case LexerActionType::MORE:
+      lexer->more();
+      break;
+
+    case LexerActionType::POP_MODE:
+      lexer->popMode();
+      break;
+
+    case LexerActionType::PUSH_MODE:
+      lexer->pushMode((size_t)instruction.operand);
+      break;
+
+    case LexerActionType::SKIP:
+      lexer->skip();
+      break;
+
+    case LexerActionType::TYPE:
+      lexer->setType(instruction.operand);
+      break;
+
+    default:
+      break;
+  }
+}
@@ -129,13 +129,46 @@ namespace atn {
     virtual bool operator == (const LexerActionExecutor &obj) const;
 
   private:
+    /// A lexer action lowered to a plain opcode/operand pair, so that the common lexer commands
+    /// can be executed without virtual dispatch or a type check per action.
+    struct Instruction {
+      LexerActionType type;
+
+      /// The channel, mode or token type for the respective commands. Unused for all others.
+      int operand;
+
+      /// The offset relative to the token start for actions wrapped in a LexerIndexedCustomAction,
+      /// otherwise -1.
+      int offset;
+
+      bool isPositionDependent;
+
+      /// The action to execute if it cannot be handled inline (custom actions and unknown
+      /// action classes), otherwise nullptr. Owned by _lexerActions.
+      LexerAction *action;
+    };
+
     const std::vector<Ref<LexerAction>> _lexerActions;
+    std::vector<Instruction> _instructions;
+
+    /// Set if any of the actions depends on the input position, which is the only case where
+    /// execute() has to touch the input stream.
+    bool _isPositionDependent;
+
+    /// Executors derived from this one via append() and fixOffsetBeforeMatch(). These are requested
+    /// over and over again during ATN simulation, so we create them only once and share them.
+    /// The offset cache is emptied when it gets full, as there can be an entry for every offset in a token.
+    std::unordered_map<LexerAction *, Ref<LexerActionExecutor>> _appendCache;
+    std::unordered_map<int, Ref<LexerActionExecutor>> _offsetCache;
+    std::mutex _cacheLock;
 
     /// Caches the result of <seealso cref="#hashCode"/> since the hash code is an element
     /// of the performance-critical <seealso cref="LexerATNConfig#hashCode"/> operation.
     const size_t _hashCode;
 
     size_t generateHashCode() const;
+    Instruction lower(const Ref<LexerAction> &lexerAction) const;
+    void execute(Lexer *lexer, const Instruction &instruction);
   };
 
 } // namespace atn
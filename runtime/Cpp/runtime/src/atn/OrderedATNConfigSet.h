@@ -50,7 +50,7 @@ namespace atn {
   struct OrderedATNConfigComparer {
     bool operator()(const Ref<ATNConfig> &lhs, const Ref<ATNConfig> &rhs) const
     {
-      return lhs == rhs;
+      return lhs == rhs || *lhs == *rhs;
     }
   };
   
@@ -112,7 +112,7 @@ long long ParseInfo::getTotalATNLookaheadOps() {
 
 size_t ParseInfo::getDFASize() {
   size_t n = 0;
-  std::vector<dfa::DFA> decisionToDFA = _atnSimulator->decisionToDFA;
+  std::vector<dfa::DFA> &decisionToDFA = _atnSimulator->decisionToDFA; // Not a copy, that would free the DFA states.
   for (size_t i = 0; i < decisionToDFA.size(); ++i) {
     n += getDFASize(i);
   }
@@ -121,5 +121,6 @@ size_t ParseInfo::getDFASize() {
 
 size_t ParseInfo::getDFASize(size_t decision) {
   dfa::DFA &decisionToDFA = _atnSimulator->decisionToDFA[decision];
+  std::lock_guard<std::recursive_mutex> lock(decisionToDFA.getLock());
   return decisionToDFA.states.size();
 }
@@ -57,6 +57,7 @@
 #include "VocabularyImpl.h"
 
 #include "support/Arrays.h"
+#include "atn/PredictionDiagnostics.h"
 
 #include "atn/ParserATNSimulator.h"
 
@@ -80,10 +81,14 @@ void ParserATNSimulator::reset() {
 }
 
 void ParserATNSimulator::clearDFA() {
-  int size = (int)decisionToDFA.size();
-  decisionToDFA.clear();
-  for (int d = 0; d < size; ++d) {
-    decisionToDFA.push_back(dfa::DFA(atn.getDecisionState(d), d));
+  // Cleared in place, so parsers which are predicting meanwhile can go on.
+  for (auto &dfa : decisionToDFA) {
+    dfa.clear();
+  }
+
+  // Only the cleared states used the cached contexts.
+  if (_sharedContextCache != nullptr) {
+    _sharedContextCache->clear();
   }
 }
 
@@ -93,6 +98,17 @@ int ParserATNSimulator::adaptivePredict(TokenStream *input, int decision, Ref<Pa
       << input->LT(1)->getLine() << ":" << input->LT(1)->getCharPositionInLine() << std::endl;
   }
 
+  // LL(1) decisions are answered directly from the precomputed table, without touching the DFA
+  // or marking the input. Symbols not in the table (e.g. EOF or errors) take the normal route.
+  const std::vector<int> &ll1Table = decisionToDFA[(size_t)decision].atnStartState->ll1Table;
+  if (!ll1Table.empty()) {
+    ssize_t t = input->LA(1);
+    if (t > 0 && (size_t)t < ll1Table.size() && ll1Table[(size_t)t] != ATN::INVALID_ALT_NUMBER) {
+      _startIndex = (int)input->index();
+      return ll1Table[(size_t)t];
+    }
+  }
+
   _input = input;
   _startIndex = (int)input->index();
   _outerContext = outerContext;
@@ -102,13 +118,19 @@ int ParserATNSimulator::adaptivePredict(TokenStream *input, int decision, Ref<Pa
   ssize_t m = input->mark();
   size_t index = _startIndex;
 
+  misc::EpochManager::Guard epochGuard(_epochParticipant);
+
   // Now we are certain to have a specific decision's DFA
   // But, do we still need an initial state?
   auto onExit = finally([this, input, index, m] {
     mergeCache.clear(); // wack cache after each prediction
+    if (!_predicateEvaluations.empty()) {
+      _predicateEvaluations.clear();
+    }
     _dfa = nullptr;
     input->seek(index);
     input->release(m);
+    checkMemoryBudget();
   });
 
   dfa::DFAState *s0;
@@ -119,7 +141,7 @@ int ParserATNSimulator::adaptivePredict(TokenStream *input, int decision, Ref<Pa
   }
   else {
     // the start state for a "regular" DFA is just s0
-    s0 = dfa.s0;
+    s0 = dfa.s0.load(std::memory_order_acquire);
   }
 
   if (s0 == nullptr) {
@@ -139,10 +161,14 @@ int ParserATNSimulator::adaptivePredict(TokenStream *input, int decision, Ref<Pa
        * appropriate start state for the precedence level rather
        * than simply setting DFA.s0.
        */
-      dfa.s0->configs = s0_closure; // not used for prediction but useful to know start configs anyway
+      Ref<ATNConfigSet> startConfigs = s0_closure;
       s0_closure = applyPrecedenceFilter(s0_closure);
 
       dfa::DFAState *newState = new dfa::DFAState(s0_closure); /* mem-check: managed by the DFA or deleted below */
+
+      // Adding the state and linking it must not be interrupted by clearing the DFA.
+      std::lock_guard<std::recursive_mutex> lck(dfa.getLock());
+      dfa.s0.load(std::memory_order_relaxed)->configs = startConfigs; // not used for prediction but useful to know start configs anyway
       s0 = addDFAState(dfa, newState);
       dfa.setPrecedenceStartState(parser->getPrecedence(), s0);
       if (s0 != newState) {
@@ -150,8 +176,10 @@ int ParserATNSimulator::adaptivePredict(TokenStream *input, int decision, Ref<Pa
       }
     } else {
       dfa::DFAState *newState = new dfa::DFAState(s0_closure); /* mem-check: managed by the DFA or deleted below */
+
+      std::lock_guard<std::recursive_mutex> lck(dfa.getLock());
       s0 = addDFAState(dfa, newState);
-      dfa.s0 = s0;
+      dfa.s0.store(s0, std::memory_order_release);
       if (s0 != newState) {
         delete newState; // If there was already a state with this config set we don't need the new one.
       }
@@ -197,13 +225,18 @@ int ParserATNSimulator::execATN(dfa::DFA &dfa, dfa::DFAState *s0, TokenStream *i
       // ATN states in SLL implies LL will also get nowhere.
       // If conflict in states that dip out, choose min since we
       // will get error no matter what.
-      int alt = getAltThatFinishedDecisionEntryRule(previousD->configs);
+      Ref<ATNConfigSet> previousConfigs = getSLLConfigs(dfa, previousD);
+      int alt = getAltThatFinishedDecisionEntryRule(previousConfigs);
       if (alt != ATN::INVALID_ALT_NUMBER) {
         // return w/o altering DFA
         return alt;
       }
 
-      throw noViableAlt(input, outerContext, previousD->configs, startIndex);
+      return signalNoViableAlt(noViableAlt(input, outerContext, previousConfigs, startIndex));
+    }
+
+    if (D->requiresFullContext && _diagnostics != nullptr) {
+      _diagnostics->record(PredictionDiagnostics::SLL_CONFLICT, (size_t)dfa.decision, input, startIndex, input->index());
     }
 
     if (D->requiresFullContext && mode != PredictionMode::SLL) {
@@ -253,7 +286,7 @@ int ParserATNSimulator::execATN(dfa::DFA &dfa, dfa::DFAState *s0, TokenStream *i
       BitSet alts = evalSemanticContext(D->predicates, outerContext, true);
       switch (alts.count()) {
         case 0:
-          throw noViableAlt(input, outerContext, D->configs, startIndex);
+          return signalNoViableAlt(noViableAlt(input, outerContext, D->configs, startIndex));
 
         case 1:
           return alts.nextSetBit(0);
@@ -276,16 +309,15 @@ int ParserATNSimulator::execATN(dfa::DFA &dfa, dfa::DFAState *s0, TokenStream *i
 }
 
 dfa::DFAState *ParserATNSimulator::getExistingTargetState(dfa::DFAState *previousD, ssize_t t) {
-  std::vector<dfa::DFAState *> edges = previousD->edges;
-  if (edges.size() == 0 || t + 1 < 0 || t + 1 >= (ssize_t)edges.size()) {
+  if (t + 1 < 0) {
     return nullptr;
   }
 
-  return edges[(size_t)t + 1];
+  return previousD->edges.get((size_t)t + 1);
 }
 
 dfa::DFAState *ParserATNSimulator::computeTargetState(dfa::DFA &dfa, dfa::DFAState *previousD, ssize_t t) {
-  Ref<ATNConfigSet> reach = computeReachSet(previousD->configs, t, false);
+  Ref<ATNConfigSet> reach = computeReachSet(getSLLConfigs(dfa, previousD), t, false);
   if (reach == nullptr) {
     addDFAEdge(dfa, previousD, t, ERROR.get());
     return ERROR.get();
@@ -312,9 +344,9 @@ dfa::DFAState *ParserATNSimulator::computeTargetState(dfa::DFA &dfa, dfa::DFASta
     D->isAcceptState = true;
     D->configs->uniqueAlt = predictedAlt;
     D->prediction = predictedAlt;
-  } else if (PredictionModeClass::hasSLLConflictTerminatingPrediction(mode, reach)) {
+  } else if (PredictionModeClass::hasSLLConflictTerminatingPrediction(mode, reach.get(), _conflictAnalysis)) {
     // MORE THAN ONE VIABLE ALTERNATIVE
-    D->configs->conflictingAlts = getConflictingAlts(reach);
+    D->configs->conflictingAlts = _conflictAnalysis.getAlts();
     D->requiresFullContext = true;
     // in SLL-only mode, we will stop at this state and return the minimum alt
     D->isAcceptState = true;
@@ -336,6 +368,28 @@ dfa::DFAState *ParserATNSimulator::computeTargetState(dfa::DFA &dfa, dfa::DFASta
   return state;
 }
 
+Ref<ATNConfigSet> ParserATNSimulator::getSLLConfigs(dfa::DFA &dfa, dfa::DFAState *state) {
+  Ref<ATNConfigSet> configs = state->getConfigs();
+  if (configs != nullptr) {
+    return configs;
+  }
+
+  // The same steps as in adaptivePredict() and execATN(), but without touching the DFA.
+  size_t index = _input->index();
+  _input->seek((size_t)_startIndex);
+  configs = computeStartState(dfa.atnStartState, ParserRuleContext::EMPTY, false);
+  if (dfa.isPrecedenceDfa()) {
+    configs = applyPrecedenceFilter(configs);
+  }
+  while (_input->index() < index && configs != nullptr) {
+    configs = computeReachSet(configs, _input->LA(1), false);
+    _input->consume();
+  }
+  _input->seek(index);
+
+  return configs;
+}
+
 void ParserATNSimulator::predicateDFAState(dfa::DFAState *dfaState, DecisionState *decisionState) {
   // We need to test all predicates, even in DFA states that
   // uniquely predict alternative.
@@ -386,16 +440,17 @@ int ParserATNSimulator::execATNWithFullContext(dfa::DFA &dfa, dfa::DFAState *D,
       if (alt != ATN::INVALID_ALT_NUMBER) {
         return alt;
       }
-      throw e;
+      return signalNoViableAlt(e);
     }
 
-    std::vector<BitSet> altSubSets =PredictionModeClass::getConflictingAltSubsets(reach);
+    _conflictAnalysis.compute(*reach);
     if (debug) {
+      std::vector<BitSet> altSubSets = _conflictAnalysis.getAltSubsets();
       std::string altSubSetsStr = BitSet::subStringRepresentation(altSubSets.begin(), altSubSets.end());
       std::cout << "LL altSubSets=" << altSubSetsStr << ", predict="
-      << PredictionModeClass::getUniqueAlt(altSubSets)
+      << _conflictAnalysis.getUniqueAlt()
       << ", resolvesToJustOneViableAlt="
-      << PredictionModeClass::resolvesToJustOneViableAlt(altSubSets)
+      << _conflictAnalysis.getSingleViableAlt()
       << std::endl;
     }
 
@@ -406,16 +461,16 @@ int ParserATNSimulator::execATNWithFullContext(dfa::DFA &dfa, dfa::DFAState *D,
       break;
     }
     if (mode != PredictionMode::LL_EXACT_AMBIG_DETECTION) {
-      predictedAlt = PredictionModeClass::resolvesToJustOneViableAlt(altSubSets);
+      predictedAlt = _conflictAnalysis.getSingleViableAlt();
       if (predictedAlt != ATN::INVALID_ALT_NUMBER) {
         break;
       }
     } else {
       // In exact ambiguity mode, we never try to terminate early.
       // Just keeps scarfing until we know what the conflict is
-      if (PredictionModeClass::allSubsetsConflict(altSubSets) && PredictionModeClass::allSubsetsEqual(altSubSets)) {
+      if (_conflictAnalysis.allSubsetsConflict() && _conflictAnalysis.allSubsetsEqual()) {
         foundExactAmbig = true;
-        predictedAlt = PredictionModeClass::getSingleViableAlt(altSubSets);
+        predictedAlt = _conflictAnalysis.getSingleViableAlt();
         break;
       }
       // else there are multiple non-conflicting subsets or
@@ -848,7 +903,20 @@ BitSet ParserATNSimulator::evalSemanticContext(std::vector<dfa::DFAState::PredPr
 
 bool ParserATNSimulator::evalSemanticContext(Ref<SemanticContext> pred, Ref<ParserRuleContext> parserCallStack,
                                              int /*alt*/, bool /*fullCtx*/) {
-  return pred->eval(parser, parserCallStack);
+  // Within a single prediction all predicates are evaluated at the same input position and with the same
+  // outer context, so a result can be reused for every config (and for the LL retry after SLL).
+  if (parserCallStack != _outerContext) {
+    return pred->eval(parser, parserCallStack);
+  }
+
+  auto iterator = _predicateEvaluations.find(pred.get());
+  if (iterator != _predicateEvaluations.end()) {
+    return iterator->second;
+  }
+
+  bool result = pred->eval(parser, parserCallStack);
+  _predicateEvaluations[pred.get()] = result;
+  return result;
 }
 
 void ParserATNSimulator::closure(Ref<ATNConfig> config, Ref<ATNConfigSet> configs, ATNConfig::Set &closureBusy,
@@ -1052,13 +1120,13 @@ Ref<ATNConfig> ParserATNSimulator::precedenceTransition(Ref<ATNConfig> config, P
       // later during conflict resolution.
       size_t currentPosition = _input->index();
       _input->seek((size_t)_startIndex);
-      bool predSucceeds = evalSemanticContext(pt->getPredicate(), _outerContext, config->alt, fullCtx);
+      bool predSucceeds = evalSemanticContext(predicate, _outerContext, config->alt, fullCtx);
       _input->seek(currentPosition);
       if (predSucceeds) {
         c = std::make_shared<ATNConfig>(config, pt->target); // no pred context
       }
     } else {
-      Ref<SemanticContext::AND> newSemCtx = std::make_shared<SemanticContext::AND>(config->semanticContext, predicate);
+      Ref<SemanticContext> newSemCtx = SemanticContext::And(config->semanticContext, predicate);
       c = std::make_shared<ATNConfig>(config, pt->target, newSemCtx);
     }
   } else {
@@ -1090,13 +1158,13 @@ Ref<ATNConfig> ParserATNSimulator::predTransition(Ref<ATNConfig> config, Predica
       // later during conflict resolution.
       size_t currentPosition = _input->index();
       _input->seek((size_t)_startIndex);
-      bool predSucceeds = evalSemanticContext(pt->getPredicate(), _outerContext, config->alt, fullCtx);
+      bool predSucceeds = evalSemanticContext(predicate, _outerContext, config->alt, fullCtx);
       _input->seek(currentPosition);
       if (predSucceeds) {
         c = std::make_shared<ATNConfig>(config, pt->target); // no pred context
       }
     } else {
-      Ref<SemanticContext::AND> newSemCtx = std::make_shared<SemanticContext::AND>(config->semanticContext, predicate);
+      Ref<SemanticContext> newSemCtx = SemanticContext::And(config->semanticContext, predicate);
       c = std::make_shared<ATNConfig>(config, pt->target, newSemCtx);
     }
   } else {
@@ -1120,8 +1188,8 @@ Ref<ATNConfig> ParserATNSimulator::ruleTransition(Ref<ATNConfig> config, RuleTra
 }
 
 BitSet ParserATNSimulator::getConflictingAlts(Ref<ATNConfigSet> configs) {
-  std::vector<BitSet> altsets = PredictionModeClass::getConflictingAltSubsets(configs);
-  return PredictionModeClass::getAlts(altsets);
+  _conflictAnalysis.compute(*configs);
+  return _conflictAnalysis.getAlts();
 }
 
 BitSet ParserATNSimulator::getConflictingAltsOrUniqueAlt(Ref<ATNConfigSet> configs) {
@@ -1178,6 +1246,14 @@ NoViableAltException ParserATNSimulator::noViableAlt(TokenStream *input, Ref<Par
   return NoViableAltException(parser, input, input->get(startIndex), input->LT(1), configs, outerContext);
 }
 
+int ParserATNSimulator::signalNoViableAlt(const NoViableAltException &e) {
+  if (parser == nullptr) {
+    throw e;
+  }
+  parser->signalError(e);
+  return ATN::INVALID_ALT_NUMBER;
+}
+
 int ParserATNSimulator::getUniqueAlt(Ref<ATNConfigSet> configs) {
   int alt = ATN::INVALID_ALT_NUMBER;
   for (auto c : configs->configs) {
@@ -1199,16 +1275,25 @@ dfa::DFAState *ParserATNSimulator::addDFAEdge(dfa::DFA &dfa, dfa::DFAState *from
     return nullptr;
   }
 
+  // Adding the state and the edge to it must not be interrupted by clearing the DFA.
+  std::lock_guard<std::recursive_mutex> lck(dfa.getLock());
+
   to = addDFAState(dfa, to); // used existing if possible not incoming
   if (from == nullptr || t > (int)atn.maxTokenType) {
     return to;
   }
 
-  {
-    std::lock_guard<std::recursive_mutex> lck(mtx);
-    if (from->edges.empty())
-      from->edges.resize(atn.maxTokenType + 1 + 1);
-    from->edges[(size_t)(t + 1)] = to; // connect
+  if (from->edges.empty()) {
+    dfa.addMemoryUsage(from->edges.resize(atn.maxTokenType + 1 + 1));
+  }
+  from->edges.set((size_t)(t + 1), to); // connect
+
+  // The edge for token type 0 (Token::INVALID_TYPE) is never used. Once the targets for all other
+  // token types and EOF are known, the configs are not needed to compute new ones anymore.
+  if (!from->isAcceptState && from->edges.count() + 1 >= from->edges.size()) {
+    size_t memoryUsage = from->getMemoryUsage();
+    from->freezeEdges();
+    dfa.releaseMemoryUsage(memoryUsage - from->getMemoryUsage());
   }
 
   if (debug) {
@@ -1227,8 +1312,15 @@ dfa::DFAState *ParserATNSimulator::addDFAState(dfa::DFA &dfa, dfa::DFAState *D)
     return D;
   }
 
+  // Prediction ends in an accept state without predicates or full context retry, so nothing but
+  // the predicted alt is needed from it and it can share a single frozen state with all others
+  // predicting the same alt.
+  if (D->isAcceptState && !D->requiresFullContext && D->predicates.empty()) {
+    D->freeze();
+  }
+
   {
-    std::lock_guard<std::recursive_mutex> lck(mtx);
+    std::lock_guard<std::recursive_mutex> lck(dfa.getLock());
 
     auto existing = dfa.states.find(D);
     if (existing != dfa.states.end()) {
@@ -1236,11 +1328,13 @@ dfa::DFAState *ParserATNSimulator::addDFAState(dfa::DFA &dfa, dfa::DFAState *D)
     }
 
     D->stateNumber = (int)dfa.states.size();
-    if (!D->configs->isReadonly()) {
+    if (D->configs != nullptr && !D->configs->isReadonly()) {
       D->configs->optimizeConfigs(this);
       D->configs->setReadonly(true);
     }
     dfa.states[D] = D;
+    dfa.addMemoryUsage(D->getMemoryUsage());
+    _dfaGrew = true;
     if (debug) {
       std::cout << "adding new DFA state: " << D << std::endl;
     }
@@ -1254,6 +1348,9 @@ void ParserATNSimulator::reportAttemptingFullContext(dfa::DFA &dfa, const antlrc
     misc::Interval interval = misc::Interval((int)startIndex, (int)stopIndex);
     std::cout << "reportAttemptingFullContext decision=" << dfa.decision << ":" << configs << ", input=" << parser->getTokenStream()->getText(interval) << std::endl;
   }
+  if (_diagnostics != nullptr) {
+    _diagnostics->record(PredictionDiagnostics::LL_FALLBACK, (size_t)dfa.decision, _input, startIndex, stopIndex);
+  }
   if (parser != nullptr) {
     parser->getErrorListenerDispatch().reportAttemptingFullContext(parser, dfa, startIndex, stopIndex, conflictingAlts, configs);
   }
@@ -1265,6 +1362,9 @@ void ParserATNSimulator::reportContextSensitivity(dfa::DFA &dfa, int prediction,
     misc::Interval interval = misc::Interval((int)startIndex, (int)stopIndex);
     std::cout << "reportContextSensitivity decision=" << dfa.decision << ":" << configs << ", input=" << parser->getTokenStream()->getText(interval) << std::endl;
   }
+  if (_diagnostics != nullptr) {
+    _diagnostics->record(PredictionDiagnostics::CONTEXT_SENSITIVITY, (size_t)dfa.decision, _input, startIndex, stopIndex);
+  }
   if (parser != nullptr) {
     parser->getErrorListenerDispatch().reportContextSensitivity(parser, dfa, startIndex, stopIndex, prediction, configs);
   }
@@ -1276,6 +1376,9 @@ void ParserATNSimulator::reportAmbiguity(dfa::DFA &dfa, dfa::DFAState * /*D*/, s
     misc::Interval interval = misc::Interval((int)startIndex, (int)stopIndex);
     std::cout << "reportAmbiguity " << ambigAlts << ":" << configs << ", input=" << parser->getTokenStream()->getText(interval) << std::endl;
   }
+  if (_diagnostics != nullptr) {
+    _diagnostics->record(PredictionDiagnostics::AMBIGUITY, (size_t)dfa.decision, _input, startIndex, stopIndex, exact);
+  }
   if (parser != nullptr) {
     parser->getErrorListenerDispatch().reportAmbiguity(parser, dfa, startIndex, stopIndex, exact, ambigAlts, configs);
   }
@@ -1285,6 +1388,14 @@ void ParserATNSimulator::setPredictionMode(PredictionMode mode) {
   this->mode = mode;
 }
 
+void ParserATNSimulator::setDiagnostics(Ref<PredictionDiagnostics> diagnostics) {
+  _diagnostics = diagnostics;
+}
+
+Ref<PredictionDiagnostics> ParserATNSimulator::getDiagnostics() const {
+  return _diagnostics;
+}
+
 atn::PredictionMode ParserATNSimulator::getPredictionMode() {
   return mode;
 }
@@ -223,6 +223,17 @@ namespace atn {
    * way it will work because it's not doing a test and set operation.</p>
    *
    * <p>
+   * States are only removed by clearing the DFA of a decision as a whole (see
+   * {@link DFA#clear}, used by {@link #clearDFA} and {@link DFAMemoryBudget}).
+   * Each prediction runs in a critical section of the {@link EpochManager}, so
+   * the removed states are freed only once no prediction which might still use
+   * them is running. The same applies to {@link DFAState#edges} tables, which
+   * are replaced (not resized in place) when they grow, as the table of the
+   * precedence start state does. {@link PredictionContext} objects are reference
+   * counted, so the shared {@link PredictionContextCache} is simply emptied by
+   * {@link #clearDFA}.</p>
+   *
+   * <p>
    * <strong>Starting with SLL then failing to combined SLL/LL (Two-Stage
    * Parsing)</strong></p>
    *
@@ -304,6 +315,16 @@ namespace atn {
   protected:
     PredictionContextMergeCache mergeCache;
 
+    /// The results of the predicates evaluated during the current prediction, keyed by the (interned)
+    /// semantic context. Cleared after each prediction, like the merge cache.
+    std::unordered_map<const SemanticContext *, bool> _predicateEvaluations;
+
+    /// Scratch space for the conflict checks of each prediction step.
+    ConflictAnalysis _conflictAnalysis;
+
+    /// Optional collector for conflicts, LL fallbacks and ambiguities, possibly shared with other simulators.
+    Ref<PredictionDiagnostics> _diagnostics;
+
     // LAME globals to avoid parameters!!!!! I need these down deep in predTransition
     TokenStream *_input;
     int _startIndex;
@@ -382,6 +403,14 @@ namespace atn {
     /// returns <seealso cref="#ERROR"/>. </returns>
     virtual dfa::DFAState *computeTargetState(dfa::DFA &dfa, dfa::DFAState *previousD, ssize_t t);
 
+    /// <summary>
+    /// Returns the configs of a DFA state reached by SLL prediction in the current adaptivePredict() call.
+    /// States with complete edges release their configs (see DFAState::freezeEdges()), as only error
+    /// reporting needs them then. In that case they are computed again, by simulating the ATN for the
+    /// input from the start of the prediction up to the current position.
+    /// </summary>
+    Ref<ATNConfigSet> getSLLConfigs(dfa::DFA &dfa, dfa::DFAState *state);
+
     virtual void predicateDFAState(dfa::DFAState *dfaState, DecisionState *decisionState);
 
     // comes back with reach.uniqueAlt set to a valid alt
@@ -795,6 +824,12 @@ namespace atn {
     virtual NoViableAltException noViableAlt(TokenStream *input, Ref<ParserRuleContext> outerContext,
                                               Ref<ATNConfigSet> configs, size_t startIndex);
 
+    /// <summary>
+    /// Throws {@code e}, unless the parser uses exception free error handling. Then the error is left
+    /// pending in the parser (see Parser::signalError) and ATN::INVALID_ALT_NUMBER is returned as prediction.
+    /// </summary>
+    int signalNoViableAlt(const NoViableAltException &e);
+
     static int getUniqueAlt(Ref<ATNConfigSet> configs);
 
     /// <summary>
@@ -852,6 +887,11 @@ namespace atn {
     void setPredictionMode(PredictionMode mode);
     PredictionMode getPredictionMode();
 
+    /// Sets a collector which counts SLL conflicts, LL fallbacks, context sensitivities and ambiguities per
+    /// decision (or nullptr to stop collecting). Unlike error listeners it can stay enabled in production.
+    void setDiagnostics(Ref<PredictionDiagnostics> diagnostics);
+    Ref<PredictionDiagnostics> getDiagnostics() const;
+
     Parser* getParser();
 
   private:
@@ -35,6 +35,8 @@ using namespace org::antlr::v4::runtime::atn;
 
 PrecedencePredicateTransition::PrecedencePredicateTransition(ATNState *target, int precedence)
   : AbstractPredicateTransition(target), precedence(precedence) {
+  _predicate = std::static_pointer_cast<SemanticContext::PrecedencePredicate>(
+    SemanticContext::intern(std::make_shared<SemanticContext::PrecedencePredicate>(precedence)));
 }
 
 int PrecedencePredicateTransition::getSerializationType() const {
@@ -50,7 +52,7 @@ bool PrecedencePredicateTransition::matches(size_t /*symbol*/, size_t /*minVocab
 }
 
 Ref<SemanticContext::PrecedencePredicate> PrecedencePredicateTransition::getPredicate() const {
-  return std::make_shared<SemanticContext::PrecedencePredicate>(precedence);
+  return _predicate;
 }
 
 std::string PrecedencePredicateTransition::toString() const {
@@ -52,6 +52,9 @@ namespace atn {
     Ref<SemanticContext::PrecedencePredicate> getPredicate() const;
     virtual std::string toString() const override;
 
+  private:
+    // The interned predicate for this transition, created once instead of on each request.
+    Ref<SemanticContext::PrecedencePredicate> _predicate;
   };
 
 } // namespace atn
@@ -34,6 +34,8 @@
 using namespace org::antlr::v4::runtime::atn;
 
 PredicateTransition::PredicateTransition(ATNState *target, int ruleIndex, int predIndex, bool isCtxDependent) : AbstractPredicateTransition(target), ruleIndex(ruleIndex), predIndex(predIndex), isCtxDependent(isCtxDependent) {
+  _predicate = std::static_pointer_cast<SemanticContext::Predicate>(
+    SemanticContext::intern(std::make_shared<SemanticContext::Predicate>(ruleIndex, predIndex, isCtxDependent)));
 }
 
 int PredicateTransition::getSerializationType() const {
@@ -49,7 +51,7 @@ bool PredicateTransition::matches(size_t /*symbol*/, size_t /*minVocabSymbol*/,
 }
 
 Ref<SemanticContext::Predicate> PredicateTransition::getPredicate() const {
-  return std::make_shared<SemanticContext::Predicate>(ruleIndex, predIndex, isCtxDependent);
+  return _predicate;
 }
 
 std::string PredicateTransition::toString() const {
@@ -62,6 +62,9 @@ namespace atn {
 
     virtual std::string toString() const override;
 
+  private:
+    // The interned predicate for this transition, created once instead of on each request.
+    Ref<SemanticContext::Predicate> _predicate;
   };
 
 } // namespace atn
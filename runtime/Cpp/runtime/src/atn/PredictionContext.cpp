@@ -32,6 +32,7 @@
 #include "atn/EmptyPredictionContext.h"
 #include "misc/MurmurHash.h"
 #include "atn/ArrayPredictionContext.h"
+#include "atn/SingletonPredictionContext.h"
 #include "RuleContext.h"
 #include "ParserRuleContext.h"
 #include "atn/RuleTransition.h"
@@ -483,11 +484,11 @@ Ref<PredictionContext> PredictionContext::getCachedContext(Ref<PredictionContext
       return iterator->second; // Not necessarly the same as context.
   }
 
-  auto iterator = contextCache->find(context);
-  if (iterator != contextCache->end()) {
-    visited[context] = *iterator;
+  Ref<PredictionContext> cached = contextCache->get(context);
+  if (cached != nullptr) {
+    visited[context] = cached;
 
-    return *iterator;
+    return cached;
   }
 
   bool changed = false;
@@ -510,10 +511,11 @@ Ref<PredictionContext> PredictionContext::getCachedContext(Ref<PredictionContext
   }
 
   if (!changed) {
-    contextCache->insert(context);
-    visited[context] = context;
+    // Another thread may have added an equal context meanwhile.
+    cached = contextCache->add(context);
+    visited[context] = cached;
 
-    return context;
+    return cached;
   }
 
   Ref<PredictionContext> updated;
@@ -525,7 +527,7 @@ Ref<PredictionContext> PredictionContext::getCachedContext(Ref<PredictionContext
     updated = std::make_shared<ArrayPredictionContext>(parents, std::dynamic_pointer_cast<ArrayPredictionContext>(context)->returnStates);
   }
 
-  contextCache->insert(updated);
+  updated = contextCache->add(updated);
   visited[updated] = updated;
   visited[context] = updated;
 
@@ -636,3 +638,49 @@ std::vector<std::string> PredictionContext::toStrings(Recognizer *recognizer, Re
 
   return result;
 }
+
+//------------------ PredictionContextCache ----------------------------------------------------------------------------
+
+Ref<PredictionContext> PredictionContextCache::get(const Ref<PredictionContext> &context) const {
+  std::lock_guard<std::mutex> lock(_lock);
+  auto iterator = _contexts.find(context);
+  if (iterator == _contexts.end()) {
+    return nullptr;
+  }
+  return *iterator;
+}
+
+Ref<PredictionContext> PredictionContextCache::add(const Ref<PredictionContext> &context) {
+  std::lock_guard<std::mutex> lock(_lock);
+  auto result = _contexts.insert(context);
+  if (result.second) {
+    // The hash node and the context with its control block (contexts are created by make_shared).
+    _memoryUsage += sizeof(Ref<PredictionContext>) + 2 * sizeof(void *) + 2 * sizeof(void *);
+    if (context->size() > 1) {
+      _memoryUsage += sizeof(ArrayPredictionContext) + context->size() * (sizeof(Ref<PredictionContext>) + sizeof(int));
+    } else {
+      _memoryUsage += sizeof(SingletonPredictionContext);
+    }
+  }
+  return *result.first;
+}
+
+size_t PredictionContextCache::size() const {
+  std::lock_guard<std::mutex> lock(_lock);
+  return _contexts.size();
+}
+
+size_t PredictionContextCache::getMemoryUsage() const {
+  std::lock_guard<std::mutex> lock(_lock);
+  return _memoryUsage;
+}
+
+void PredictionContextCache::clear() {
+  std::unordered_set<Ref<PredictionContext>, PredictionContextHasher, PredictionContextComparer> contexts;
+  {
+    std::lock_guard<std::mutex> lock(_lock);
+    contexts.swap(_contexts);
+    _memoryUsage = 0;
+  }
+  // The contexts are released here, outside of the lock.
+}
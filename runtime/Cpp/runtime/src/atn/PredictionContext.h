@@ -44,8 +44,6 @@ namespace atn {
   struct PredictionContextHasher;
   struct PredictionContextComparer;
 
-  typedef std::unordered_set<Ref<PredictionContext>, PredictionContextHasher, PredictionContextComparer> PredictionContextCache;
-
   // For the keys we use raw pointers, as we don't need to access them.
   typedef std::map<std::pair<PredictionContext *, PredictionContext *>, Ref<PredictionContext>> PredictionContextMergeCache;
 
@@ -258,6 +256,33 @@ namespace atn {
     }
   };
 
+  /// <summary>
+  /// Maps all equal prediction contexts to a single cached copy (see ATNSimulator::getCachedContext). The cache
+  /// is shared by all simulators of a grammar, which may run in different threads, so all access is locked.
+  /// Contexts are reference counted, hence clearing the cache doesn't affect DFA states which still use them.
+  /// </summary>
+  class ANTLR4CPP_PUBLIC PredictionContextCache {
+  public:
+    /// Returns the cached context equal to the given one, or nullptr if there is none.
+    Ref<PredictionContext> get(const Ref<PredictionContext> &context) const;
+
+    /// Adds the context unless an equal one is cached already. Returns the cached context.
+    Ref<PredictionContext> add(const Ref<PredictionContext> &context);
+
+    size_t size() const;
+
+    /// An estimate of the memory used by the cached contexts in bytes, similar to DFAState::getMemoryUsage().
+    size_t getMemoryUsage() const;
+
+    /// Removes all contexts, e.g. after the DFAs using them were cleared.
+    void clear();
+
+  private:
+    mutable std::mutex _lock;
+    std::unordered_set<Ref<PredictionContext>, PredictionContextHasher, PredictionContextComparer> _contexts;
+    size_t _memoryUsage = 0;
+  };
+
 } // namespace atn
 } // namespace runtime
 } // namespace v4
@@ -0,0 +1,174 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "atn/ATN.h"
+#include "atn/DecisionState.h"
+#include "misc/Interval.h"
+#include "Exceptions.h"
+#include "Token.h"
+#include "TokenStream.h"
+
+#include "atn/PredictionDiagnostics.h"
+
+using namespace org::antlr::v4::runtime;
+using namespace org::antlr::v4::runtime::atn;
+
+PredictionDiagnostics::PredictionDiagnostics(const ATN &atn, size_t samplesPerKind)
+  : _atn(atn), _samplesPerKind(samplesPerKind), _counters(atn.decisionToState.size()) {
+  reset();
+}
+
+void PredictionDiagnostics::record(Kind kind, size_t decision, TokenStream *input, size_t startIndex, size_t stopIndex,
+                                   bool exact) {
+  if (decision >= _counters.size()) {
+    return;
+  }
+
+  Counters &counters = _counters[decision];
+  size_t previous = counters.counts[kind].fetch_add(1, std::memory_order_relaxed);
+  if (kind == AMBIGUITY && exact) {
+    counters.exactAmbiguities.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  if (previous >= _samplesPerKind || input == nullptr) {
+    return;
+  }
+
+  // One of the first events of this kind for the decision, so take a sample.
+  Sample sample;
+  sample.kind = kind;
+  sample.decision = decision;
+  sample.line = 0;
+  sample.charPositionInLine = -1;
+  sample.sourceName = input->getSourceName();
+
+  // Not all streams allow random access: an UnbufferedTokenStream doesn't know its size and only keeps a window of
+  // tokens, which includes the span while predicting (the simulator holds a mark). So only tokens up to the current
+  // one are used (these have been fetched already), and the span is left out if the stream doesn't have it anymore.
+  size_t currentIndex = input->index();
+  if (startIndex <= currentIndex) {
+    try {
+      Ref<Token> start = input->get(startIndex);
+      std::string text = input->getText(misc::Interval((int)startIndex, (int)std::min(stopIndex, currentIndex)));
+      sample.line = start->getLine();
+      sample.charPositionInLine = start->getCharPositionInLine();
+      sample.text = text;
+    } catch (IndexOutOfBoundsException &) {
+    } catch (UnsupportedOperationException &) {
+    }
+  }
+
+  // Parsers running the same input in parallel would otherwise all report the same spans.
+  std::lock_guard<std::mutex> lck(_sampleLock);
+  for (auto &existing : _samples) {
+    if (existing.kind == sample.kind && existing.decision == decision && existing.line == sample.line
+        && existing.charPositionInLine == sample.charPositionInLine && existing.sourceName == sample.sourceName) {
+      return;
+    }
+  }
+  _samples.push_back(std::move(sample));
+}
+
+PredictionDiagnostics::DecisionCounts PredictionDiagnostics::getCounts(size_t decision) const {
+  DecisionCounts result;
+  result.decision = decision;
+  for (size_t i = 0; i < KIND_COUNT; ++i) {
+    result.counts[i] = decision < _counters.size() ? _counters[decision].counts[i].load(std::memory_order_relaxed) : 0;
+  }
+  result.exactAmbiguities = decision < _counters.size() ? _counters[decision].exactAmbiguities.load(std::memory_order_relaxed) : 0;
+  return result;
+}
+
+std::vector<PredictionDiagnostics::DecisionCounts> PredictionDiagnostics::getDecisions() const {
+  std::vector<DecisionCounts> result;
+  for (size_t decision = 0; decision < _counters.size(); ++decision) {
+    DecisionCounts counts = getCounts(decision);
+    for (size_t i = 0; i < KIND_COUNT; ++i) {
+      if (counts.counts[i] > 0) {
+        result.push_back(counts);
+        break;
+      }
+    }
+  }
+
+  std::stable_sort(result.begin(), result.end(), [](const DecisionCounts &lhs, const DecisionCounts &rhs) {
+    if (lhs.counts[LL_FALLBACK] != rhs.counts[LL_FALLBACK]) {
+      return lhs.counts[LL_FALLBACK] > rhs.counts[LL_FALLBACK];
+    }
+    return lhs.counts[SLL_CONFLICT] > rhs.counts[SLL_CONFLICT];
+  });
+  return result;
+}
+
+std::vector<PredictionDiagnostics::Sample> PredictionDiagnostics::getSamples(size_t decision) const {
+  std::vector<Sample> result;
+  std::lock_guard<std::mutex> lck(_sampleLock);
+  for (auto &sample : _samples) {
+    if (sample.decision == decision) {
+      result.push_back(sample);
+    }
+  }
+  return result;
+}
+
+void PredictionDiagnostics::reset() {
+  for (auto &counters : _counters) {
+    for (size_t i = 0; i < KIND_COUNT; ++i) {
+      counters.counts[i].store(0, std::memory_order_relaxed);
+    }
+    counters.exactAmbiguities.store(0, std::memory_order_relaxed);
+  }
+
+  std::lock_guard<std::mutex> lck(_sampleLock);
+  _samples.clear();
+}
+
+std::string PredictionDiagnostics::toString(const std::vector<std::string> &ruleNames) const {
+  static const char *kindNames[] = { "SLL conflict", "LL fallback", "context sensitivity", "ambiguity" };
+
+  std::stringstream ss;
+  for (auto &counts : getDecisions()) {
+    ss << "decision " << counts.decision;
+    size_t ruleIndex = (size_t)_atn.decisionToState[counts.decision]->ruleIndex;
+    if (ruleIndex < ruleNames.size()) {
+      ss << " (rule " << ruleNames[ruleIndex] << ")";
+    }
+    ss << ": " << counts.counts[SLL_CONFLICT] << " SLL conflicts, " << counts.counts[LL_FALLBACK] << " LL fallbacks, "
+      << counts.counts[CONTEXT_SENSITIVITY] << " context sensitivities, " << counts.counts[AMBIGUITY] << " ambiguities ("
+      << counts.exactAmbiguities << " exact)" << std::endl;
+
+    for (auto &sample : getSamples(counts.decision)) {
+      ss << "  " << kindNames[sample.kind] << " at " << sample.sourceName << " " << sample.line << ":"
+        << sample.charPositionInLine << " \"" << sample.text << "\"" << std::endl;
+    }
+  }
+  return ss.str();
+}
@@ -0,0 +1,128 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "antlr4-common.h"
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+namespace atn {
+
+  /// <summary>
+  /// Collects per decision statistics about SLL conflicts, full context (LL) fallbacks, context sensitivities
+  /// and ambiguities, without going through the error listeners. Attach one instance to the
+  /// <seealso cref="ParserATNSimulator"/> of any number of parsers (using the same grammar) with
+  /// <seealso cref="ParserATNSimulator#setDiagnostics"/>, which may run in different threads.
+  /// <p/>
+  /// Recording an event is an atomic increment. Only the first few events of each kind per decision also record
+  /// the input span responsible for them. That makes the collector cheap enough to leave enabled in production,
+  /// unlike <seealso cref="DiagnosticErrorListener"/> or the <seealso cref="ProfilingATNSimulator"/>.
+  /// </summary>
+  class ANTLR4CPP_PUBLIC PredictionDiagnostics {
+  public:
+    enum Kind {
+      /// SLL prediction found a conflict. In SLL mode the minimum alternative is predicted, otherwise this
+      /// is followed by an LL fallback.
+      SLL_CONFLICT = 0,
+
+      /// Prediction fell back to full context (LL) prediction.
+      LL_FALLBACK,
+
+      /// Full context prediction found a unique alternative, i.e. the decision was context sensitive.
+      CONTEXT_SENSITIVITY,
+
+      /// Full context prediction found an ambiguity (see exactAmbiguities for the exact ones).
+      AMBIGUITY,
+
+      KIND_COUNT
+    };
+
+    /// A snapshot of the counters of one decision.
+    struct DecisionCounts {
+      size_t decision;
+      size_t counts[KIND_COUNT];
+      size_t exactAmbiguities;
+    };
+
+    /// An input span which caused an event.
+    struct Sample {
+      Kind kind;
+      size_t decision;
+      std::string sourceName;
+      size_t line;
+      int charPositionInLine;
+      std::string text;
+    };
+
+    /// Creates a collector for the decisions in the given ATN (which must outlive it). At most samplesPerKind
+    /// input spans are kept per decision and kind.
+    PredictionDiagnostics(const ATN &atn, size_t samplesPerKind = 3);
+    virtual ~PredictionDiagnostics() {};
+
+    /// Records an event for the given decision. The span [startIndex, stopIndex] in the token stream is only
+    /// looked at if a sample is taken.
+    void record(Kind kind, size_t decision, TokenStream *input, size_t startIndex, size_t stopIndex, bool exact = false);
+
+    DecisionCounts getCounts(size_t decision) const;
+
+    /// All decisions with at least one event, ordered by the number of LL fallbacks and then SLL conflicts
+    /// (most first).
+    std::vector<DecisionCounts> getDecisions() const;
+
+    std::vector<Sample> getSamples(size_t decision) const;
+
+    void reset();
+
+    /// A human readable report of all decisions with events, including the rule each decision belongs to.
+    std::string toString(const std::vector<std::string> &ruleNames) const;
+
+  private:
+    struct Counters {
+      std::atomic<size_t> counts[KIND_COUNT];
+      std::atomic<size_t> exactAmbiguities;
+    };
+
+    const ATN &_atn;
+    const size_t _samplesPerKind;
+    std::vector<Counters> _counters;
+
+    mutable std::mutex _sampleLock;
+    std::vector<Sample> _samples;
+  };
+
+} // namespace atn
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
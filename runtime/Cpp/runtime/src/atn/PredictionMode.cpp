@@ -32,8 +32,9 @@
 #include "atn/RuleStopState.h"
 #include "atn/ATNConfigSet.h"
 #include "atn/ATNConfig.h"
-#include "misc/MurmurHash.h"
-#include "SemanticContext.h"
+#include "atn/PredictionContext.h"
+#include "atn/SemanticContext.h"
+#include "support/CPPUtils.h"
 
 #include "PredictionMode.h"
 
@@ -41,61 +42,49 @@ using namespace org::antlr::v4::runtime;
 using namespace org::antlr::v4::runtime::atn;
 using namespace antlrcpp;
 
-struct AltAndContextConfigHasher
-{
-  /**
-   * The hash code is only a function of the {@link ATNState#stateNumber}
-   * and {@link ATNConfig#context}.
-   */
-  size_t operator () (const ATNConfig &o) const {
-    size_t hashCode = misc::MurmurHash::initialize(7);
-    hashCode = misc::MurmurHash::update(hashCode, (size_t)o.state->stateNumber);
-    hashCode = misc::MurmurHash::update(hashCode, o.context->hashCode());
-    return misc::MurmurHash::finish(hashCode, 2);
-  }
-};
-
-struct AltAndContextConfigComparer {
-  bool operator()(const ATNConfig &a, const ATNConfig &b) const
-  {
-    if (&a == &b) {
-      return true;
-    }
-    return a.state->stateNumber == b.state->stateNumber && a.context == b.context;
-  }
-};
-
 bool PredictionModeClass::hasSLLConflictTerminatingPrediction(PredictionMode mode, Ref<ATNConfigSet> configs) {
+  ConflictAnalysis analysis;
+  return hasSLLConflictTerminatingPrediction(mode, configs.get(), analysis);
+}
+
+bool PredictionModeClass::hasSLLConflictTerminatingPrediction(PredictionMode mode, ATNConfigSet *configs,
+                                                              ConflictAnalysis &analysis) {
   /* Configs in rule stop states indicate reaching the end of the decision
    * rule (local context) or end of start rule (full context). If all
    * configs meet this condition, then none of the configurations is able
    * to match additional input so we terminate prediction.
    */
-  if (allConfigsInRuleStopStates(configs)) {
+  bool allInStopStates = true;
+  for (auto &config : configs->configs) {
+    if (!is<RuleStopState *>(config->state)) {
+      allInStopStates = false;
+      break;
+    }
+  }
+  if (allInStopStates) {
+    analysis.compute(*configs);
     return true;
   }
 
   // pure SLL mode parsing
-  if (mode == PredictionMode::SLL) {
+  if (mode == PredictionMode::SLL && configs->hasSemanticContext) {
     // Don't bother with combining configs from different semantic
     // contexts if we can fail over to full LL; costs more time
     // since we'll often fail over anyway.
-    if (configs->hasSemanticContext) {
-      // dup configs, tossing out semantic predicates
-      Ref<ATNConfigSet> dup = std::make_shared<ATNConfigSet>(true);
-      for (auto config : configs->configs) {
-        Ref<ATNConfig> c = std::make_shared<ATNConfig>(config, SemanticContext::NONE);
-        dup->add(c);
-      }
-      configs = dup;
+    // dup configs, tossing out semantic predicates. Adding them merges the contexts of configs which are
+    // then equal, which yields other alt subsets than the original configs.
+    ATNConfigSet dup(true);
+    for (auto &config : configs->configs) {
+      dup.add(std::make_shared<ATNConfig>(config, SemanticContext::NONE));
     }
+    analysis.compute(dup);
     // now we have combined contexts for configs with dissimilar preds
+  } else {
+    analysis.compute(*configs);
   }
 
   // pure SLL or combined SLL+LL mode parsing
-  std::vector<antlrcpp::BitSet> altsets = getConflictingAltSubsets(configs);
-  bool heuristic = hasConflictingAltSet(altsets) && !hasStateAssociatedWithOneAlt(configs);
-  return heuristic;
+  return analysis.hasConflictingAltSet() && !analysis.hasStateAssociatedWithOneAlt();
 }
 
 bool PredictionModeClass::hasConfigInRuleStopState(Ref<ATNConfigSet> configs) {
@@ -184,15 +173,9 @@ antlrcpp::BitSet PredictionModeClass::getAlts(Ref<ATNConfigSet> configs) {
 }
 
 std::vector<antlrcpp::BitSet> PredictionModeClass::getConflictingAltSubsets(Ref<ATNConfigSet> configs) {
-  std::unordered_map<Ref<ATNConfig>, antlrcpp::BitSet, AltAndContextConfigHasher, AltAndContextConfigComparer> configToAlts;
-  for (auto config : configs->configs) {
-    configToAlts[config].set(config->alt);
-  }
-  std::vector<antlrcpp::BitSet> values;
-  for (auto it : configToAlts) {
-    values.push_back(it.second);
-  }
-  return values;
+  ConflictAnalysis analysis;
+  analysis.compute(*configs);
+  return analysis.getAltSubsets();
 }
 
 std::map<ATNState*, antlrcpp::BitSet> PredictionModeClass::getStateToAltMap(Ref<ATNConfigSet> configs) {
@@ -204,11 +187,9 @@ std::map<ATNState*, antlrcpp::BitSet> PredictionModeClass::getStateToAltMap(Ref<
 }
 
 bool PredictionModeClass::hasStateAssociatedWithOneAlt(Ref<ATNConfigSet> configs) {
-  std::map<ATNState*, antlrcpp::BitSet> x = getStateToAltMap(configs);
-  for (std::map<ATNState*, antlrcpp::BitSet>::iterator it = x.begin(); it != x.end(); it++){
-    if (it->second.count() == 1) return true;
-  }
-  return false;
+  ConflictAnalysis analysis;
+  analysis.compute(*configs);
+  return analysis.hasStateAssociatedWithOneAlt();
 }
 
 int PredictionModeClass::getSingleViableAlt(const std::vector<antlrcpp::BitSet>& altsets) {
@@ -225,3 +206,198 @@ int PredictionModeClass::getSingleViableAlt(const std::vector<antlrcpp::BitSet>&
 
   return viableAlts.nextSetBit(0);
 }
+
+//----------------- ConflictAnalysis -----------------------------------------------------------------------------------
+
+void ConflictAnalysis::compute(const ATNConfigSet &configs) {
+  _entries.clear();
+  _subsets.clear();
+  _stateWithOneAlt = false;
+
+  for (auto &config : configs.configs) {
+    PredictionContext *context = config->context.get();
+    _entries.push_back({ (size_t)config->state->stateNumber, context != nullptr ? context->hashCode() : 0, context,
+      (size_t)config->alt, 0 });
+  }
+
+  // Sorting by context pointer too keeps configs with the same context together, so that deep comparisons
+  // are only needed at the borders of such runs.
+  std::less<PredictionContext *> pointerLess;
+  std::sort(_entries.begin(), _entries.end(), [pointerLess](const Entry &a, const Entry &b) {
+    if (a.state != b.state) {
+      return a.state < b.state;
+    }
+    if (a.contextHash != b.contextHash) {
+      return a.contextHash < b.contextHash;
+    }
+    if (a.context != b.context) {
+      return pointerLess(a.context, b.context);
+    }
+    return a.alt < b.alt;
+  });
+
+  // Assign subsets, which are runs of equal (state, context) pairs. Different context objects can be equal, in
+  // which case the alts of a subset are no longer contiguous and need another sort.
+  size_t subsetCount = 0;
+  bool needsRegroup = false;
+  size_t stateStart = 0;
+  bool stateHasOneAlt = true;
+  for (size_t i = 0; i < _entries.size(); ++i) {
+    Entry &entry = _entries[i];
+    if (i == 0 || entry.state != _entries[i - 1].state) {
+      stateStart = i;
+      stateHasOneAlt = true;
+    } else if (entry.alt != _entries[stateStart].alt) {
+      stateHasOneAlt = false;
+    }
+    if (stateHasOneAlt && (i + 1 == _entries.size() || _entries[i + 1].state != entry.state)) {
+      _stateWithOneAlt = true;
+    }
+
+    if (i > 0 && entry.state == _entries[i - 1].state && entry.context == _entries[i - 1].context) {
+      entry.subset = _entries[i - 1].subset;
+      continue;
+    }
+
+    entry.subset = subsetCount;
+    for (size_t j = i; j > 0; --j) {
+      const Entry &other = _entries[j - 1];
+      if (other.state != entry.state || other.contextHash != entry.contextHash) {
+        break;
+      }
+      if (entry.context != nullptr && other.context != nullptr && *entry.context == *other.context) {
+        entry.subset = other.subset;
+        needsRegroup = true;
+        break;
+      }
+    }
+    if (entry.subset == subsetCount) {
+      ++subsetCount;
+    }
+  }
+
+  if (needsRegroup) {
+    std::sort(_entries.begin(), _entries.end(), [](const Entry &a, const Entry &b) {
+      if (a.subset != b.subset) {
+        return a.subset < b.subset;
+      }
+      return a.alt < b.alt;
+    });
+  }
+
+  for (size_t i = 0; i < _entries.size(); ++i) {
+    if (i == 0 || _entries[i].subset != _entries[i - 1].subset) {
+      _subsets.push_back({ i, i + 1, false });
+    } else {
+      Subset &subset = _subsets.back();
+      subset.end = i + 1;
+      if (_entries[i].alt != _entries[subset.begin].alt) {
+        subset.conflicting = true;
+      }
+    }
+  }
+}
+
+size_t ConflictAnalysis::getSubsetCount() const {
+  return _subsets.size();
+}
+
+bool ConflictAnalysis::hasConflictingAltSet() const {
+  for (auto &subset : _subsets) {
+    if (subset.conflicting) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ConflictAnalysis::hasNonConflictingAltSet() const {
+  for (auto &subset : _subsets) {
+    if (!subset.conflicting) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ConflictAnalysis::allSubsetsConflict() const {
+  return !hasNonConflictingAltSet();
+}
+
+bool ConflictAnalysis::allSubsetsEqual() const {
+  for (size_t i = 1; i < _subsets.size(); ++i) {
+    if (!equalAlts(_subsets[0], _subsets[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int ConflictAnalysis::getSingleViableAlt() const {
+  if (_subsets.empty()) {
+    return -1;
+  }
+
+  // The alts of a subset are sorted, so its first entry is the minimum alt.
+  size_t minAlt = _entries[_subsets[0].begin].alt;
+  for (auto &subset : _subsets) {
+    if (_entries[subset.begin].alt != minAlt) {
+      return ATN::INVALID_ALT_NUMBER;
+    }
+  }
+  return (int)minAlt;
+}
+
+int ConflictAnalysis::getUniqueAlt() const {
+  if (_entries.empty()) {
+    return ATN::INVALID_ALT_NUMBER;
+  }
+
+  for (auto &entry : _entries) {
+    if (entry.alt != _entries[0].alt) {
+      return ATN::INVALID_ALT_NUMBER;
+    }
+  }
+  return (int)_entries[0].alt;
+}
+
+bool ConflictAnalysis::hasStateAssociatedWithOneAlt() const {
+  return _stateWithOneAlt;
+}
+
+antlrcpp::BitSet ConflictAnalysis::getAlts() const {
+  antlrcpp::BitSet alts;
+  for (auto &entry : _entries) {
+    alts.set(entry.alt);
+  }
+  return alts;
+}
+
+std::vector<antlrcpp::BitSet> ConflictAnalysis::getAltSubsets() const {
+  std::vector<antlrcpp::BitSet> result(_subsets.size());
+  for (size_t i = 0; i < _subsets.size(); ++i) {
+    for (size_t j = _subsets[i].begin; j < _subsets[i].end; ++j) {
+      result[i].set(_entries[j].alt);
+    }
+  }
+  return result;
+}
+
+bool ConflictAnalysis::equalAlts(const Subset &a, const Subset &b) const {
+  // Both ranges are sorted but may contain duplicates (configs which differ only in their semantic context).
+  size_t i = a.begin;
+  size_t j = b.begin;
+  while (i < a.end && j < b.end) {
+    if (_entries[i].alt != _entries[j].alt) {
+      return false;
+    }
+    size_t alt = _entries[i].alt;
+    while (i < a.end && _entries[i].alt == alt) {
+      ++i;
+    }
+    while (j < b.end && _entries[j].alt == alt) {
+      ++j;
+    }
+  }
+  return i == a.end && j == b.end;
+}
@@ -204,6 +204,14 @@ namespace atn {
      */
     static bool hasSLLConflictTerminatingPrediction(PredictionMode mode, Ref<ATNConfigSet> configs);
 
+    /// <summary>
+    /// The same as hasSLLConflictTerminatingPrediction(mode, configs), but uses (and fills) the given analysis
+    /// instead of building alt subsets. On return {@code analysis} describes {@code configs} (in SLL mode with their
+    /// predicates stripped, which doesn't change the union of the alts).
+    /// </summary>
+    static bool hasSLLConflictTerminatingPrediction(PredictionMode mode, ATNConfigSet *configs,
+                                                    ConflictAnalysis &analysis);
+
     /// <summary>
     /// Checks if any configuration in {@code configs} is in a
     /// <seealso cref="RuleStopState"/>. Configurations meeting this condition have
@@ -461,6 +469,56 @@ namespace atn {
     static int getSingleViableAlt(const std::vector<antlrcpp::BitSet> &altsets);
   };
 
+  /// <summary>
+  /// The conflicting alt subsets of a configuration set (see PredictionModeClass::getConflictingAltSubsets) and its
+  /// state to alt mapping in a flat form. compute() collects a (state, context, alt) tuple per configuration and sorts
+  /// them, so that each alt subset is a contiguous, sorted range of alts. The buffers are kept between calls, which
+  /// means an analysis doesn't allocate memory once they have grown to the size of the largest set seen. Reuse one
+  /// instance per simulator, like the merge cache.
+  ///
+  /// The queries correspond to the PredictionModeClass functions taking alt subsets.
+  /// </summary>
+  class ANTLR4CPP_PUBLIC ConflictAnalysis {
+  public:
+    void compute(const ATNConfigSet &configs);
+
+    size_t getSubsetCount() const;
+    bool hasConflictingAltSet() const;
+    bool hasNonConflictingAltSet() const;
+    bool allSubsetsConflict() const;
+    bool allSubsetsEqual() const;
+    int getSingleViableAlt() const;
+    int getUniqueAlt() const;
+    bool hasStateAssociatedWithOneAlt() const;
+
+    /// The union of all alt subsets.
+    antlrcpp::BitSet getAlts() const;
+
+    /// The alt subsets as bit sets, in state order.
+    std::vector<antlrcpp::BitSet> getAltSubsets() const;
+
+  private:
+    struct Entry {
+      size_t state;
+      size_t contextHash;
+      PredictionContext *context;
+      size_t alt;
+      size_t subset;
+    };
+
+    struct Subset {
+      size_t begin; // Range in _entries.
+      size_t end;
+      bool conflicting;
+    };
+
+    std::vector<Entry> _entries;
+    std::vector<Subset> _subsets;
+    bool _stateWithOneAlt = false;
+
+    bool equalAlts(const Subset &a, const Subset &b) const;
+  };
+
 } // namespace atn
 } // namespace runtime
 } // namespace v4
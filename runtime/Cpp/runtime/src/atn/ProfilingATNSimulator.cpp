@@ -67,6 +67,11 @@ int ProfilingATNSimulator::adaptivePredict(TokenStream *input, int decision, Ref
   _decisions[decision].timeInPrediction += duration_cast<nanoseconds>(stop - start).count();
   _decisions[decision].invocations++;
 
+  if (_sllStopIndex < 0) {
+    // Predicted by the LL(1) table, which looks at a single token only.
+    _sllStopIndex = _startIndex;
+  }
+
   long long SLL_k = _sllStopIndex - _startIndex + 1;
   _decisions[decision].SLL_TotalLook += SLL_k;
   _decisions[decision].SLL_MinLook = _decisions[decision].SLL_MinLook == 0 ? SLL_k : std::min(_decisions[decision].SLL_MinLook, SLL_k);
@@ -98,7 +103,7 @@ DFAState* ProfilingATNSimulator::getExistingTargetState(DFAState *previousD, ssi
     _decisions[_currentDecision].SLL_DFATransitions++; // count only if we transition over a DFA state
     if (existingTargetState == ERROR.get()) {
       _decisions[_currentDecision].errors.push_back(
-        ErrorInfo(_currentDecision, previousD->configs, _input, _startIndex, _sllStopIndex, false)
+        ErrorInfo(_currentDecision, getSLLConfigs(*_dfa, previousD), _input, _startIndex, _sllStopIndex, false)
       );
     }
   }
@@ -38,6 +38,181 @@ using namespace org::antlr::v4::runtime;
 using namespace org::antlr::v4::runtime::atn;
 using namespace antlrcpp;
 
+namespace {
+
+  struct SemanticContextHasher {
+    size_t operator () (const Ref<SemanticContext> &context) const {
+      return context->hashCode();
+    }
+  };
+
+  struct SemanticContextComparer {
+    bool operator () (const Ref<SemanticContext> &lhs, const Ref<SemanticContext> &rhs) const {
+      return lhs == rhs || *lhs == *rhs;
+    }
+  };
+
+  // The key for combinations of two contexts in the interning table. Combinations are looked up by
+  // the addresses of their operands, which stay valid as the entry also holds references to them.
+  struct Combination {
+    bool isAnd;
+    const SemanticContext *a;
+    const SemanticContext *b;
+
+    bool operator == (const Combination &other) const {
+      return isAnd == other.isAnd && a == other.a && b == other.b;
+    }
+  };
+
+  struct CombinationHasher {
+    size_t operator () (const Combination &combination) const {
+      size_t hash = misc::MurmurHash::initialize(combination.isAnd ? 1 : 0);
+      hash = misc::MurmurHash::update(hash, (size_t)combination.a);
+      hash = misc::MurmurHash::update(hash, (size_t)combination.b);
+      return misc::MurmurHash::finish(hash, 2);
+    }
+  };
+
+  struct CombinationResult {
+    Ref<SemanticContext> a;
+    Ref<SemanticContext> b;
+    Ref<SemanticContext> result;
+  };
+
+  // The interning table is split into shards, each with its own lock, so parser threads which combine
+  // different contexts don't all wait for a single lock. Contexts and combinations are sharded by their
+  // hash codes. A combination shard is locked before a context shard, never the other way around.
+  const size_t INTERN_SHARD_COUNT = 16;
+
+  // Combinations are only a cache, a shard is simply emptied when it gets full. Contexts are only dropped
+  // when nothing but the table uses them anymore, which is checked whenever a shard doubled in size.
+  const size_t MAX_COMBINATIONS_PER_SHARD = 2048;
+  const size_t MIN_CONTEXT_PURGE_SIZE = 256;
+
+  struct ContextShard {
+    std::mutex lock;
+    std::unordered_set<Ref<SemanticContext>, SemanticContextHasher, SemanticContextComparer> contexts;
+    size_t purgeSize = MIN_CONTEXT_PURGE_SIZE;
+
+    // Must be called while holding the lock. Nobody can get hold of a context used only by the table
+    // without taking the lock, so such a context can't become used meanwhile.
+    size_t purge() {
+      size_t count = 0;
+      for (auto iterator = contexts.begin(); iterator != contexts.end();) {
+        if (iterator->use_count() == 1) {
+          iterator = contexts.erase(iterator);
+          ++count;
+        } else {
+          ++iterator;
+        }
+      }
+      purgeSize = std::max(MIN_CONTEXT_PURGE_SIZE, 2 * contexts.size());
+      return count;
+    }
+  };
+
+  struct CombinationShard {
+    std::mutex lock;
+    std::unordered_map<Combination, CombinationResult, CombinationHasher> combinations;
+  };
+
+  // SemanticContext::NONE is created on first use, as the interning table may be used during static
+  // initialization (e.g. for a static ATN in another translation unit), before NONE is initialized.
+  const Ref<SemanticContext>& getNone() {
+    static const Ref<SemanticContext> none = std::make_shared<SemanticContext::Predicate>(-1, -1, false);
+    return none;
+  }
+
+  class InternTable {
+  public:
+    InternTable() {
+      intern(getNone());
+    }
+
+    Ref<SemanticContext> intern(const Ref<SemanticContext> &context) {
+      ContextShard &shard = _contextShards[context->hashCode() % INTERN_SHARD_COUNT];
+      std::lock_guard<std::mutex> lck(shard.lock);
+      if (shard.contexts.size() >= shard.purgeSize) {
+        shard.purge();
+      }
+      return *shard.contexts.insert(context).first;
+    }
+
+    template <typename Operator>
+    Ref<SemanticContext> combine(bool isAnd, const Ref<SemanticContext> &a, const Ref<SemanticContext> &b) {
+      Combination key = { isAnd, a.get(), b.get() };
+      CombinationShard &shard = _combinationShards[CombinationHasher()(key) % INTERN_SHARD_COUNT];
+      std::lock_guard<std::mutex> lck(shard.lock);
+      if (shard.combinations.size() >= MAX_COMBINATIONS_PER_SHARD && shard.combinations.count(key) == 0) {
+        shard.combinations.clear();
+      }
+
+      CombinationResult &combination = shard.combinations[key];
+      if (combination.result == nullptr) {
+        Ref<Operator> result = std::make_shared<Operator>(a, b);
+        combination.a = a;
+        combination.b = b;
+        if (result->opnds.size() == 1) {
+          combination.result = result->opnds[0];
+        } else {
+          combination.result = intern(result);
+        }
+      }
+
+      return combination.result;
+    }
+
+    size_t purge() {
+      for (auto &shard : _combinationShards) {
+        std::lock_guard<std::mutex> lck(shard.lock);
+        shard.combinations.clear();
+      }
+
+      // Dropping an operator can leave its operands unused, so repeat until nothing changes.
+      size_t count = 0;
+      size_t dropped;
+      do {
+        dropped = 0;
+        for (auto &shard : _contextShards) {
+          std::lock_guard<std::mutex> lck(shard.lock);
+          dropped += shard.purge();
+        }
+        count += dropped;
+      } while (dropped > 0);
+      return count;
+    }
+
+    size_t size() {
+      size_t count = 0;
+      for (auto &shard : _contextShards) {
+        std::lock_guard<std::mutex> lck(shard.lock);
+        count += shard.contexts.size();
+      }
+      return count;
+    }
+
+  private:
+    ContextShard _contextShards[INTERN_SHARD_COUNT];
+    CombinationShard _combinationShards[INTERN_SHARD_COUNT];
+  };
+
+  InternTable& getInternTable() {
+    static InternTable table;
+    return table;
+  }
+
+  // Operands are unique within an operator.
+  void addOperand(std::vector<Ref<SemanticContext>> &operands, const Ref<SemanticContext> &operand) {
+    for (auto &existing : operands) {
+      if (existing == operand || *existing == *operand) {
+        return;
+      }
+    }
+    operands.push_back(operand);
+  }
+
+}
+
 //------------------ Predicate -----------------------------------------------------------------------------------------
 
 SemanticContext::Predicate::Predicate() : Predicate(-1, -1, false) {
@@ -45,6 +220,11 @@ SemanticContext::Predicate::Predicate() : Predicate(-1, -1, false) {
 
 SemanticContext::Predicate::Predicate(int ruleIndex, int predIndex, bool isCtxDependent)
 : ruleIndex(ruleIndex), predIndex(predIndex), isCtxDependent(isCtxDependent) {
+  size_t hashCode = misc::MurmurHash::initialize();
+  hashCode = misc::MurmurHash::update(hashCode, (size_t)ruleIndex);
+  hashCode = misc::MurmurHash::update(hashCode, (size_t)predIndex);
+  hashCode = misc::MurmurHash::update(hashCode, isCtxDependent ? 1 : 0);
+  _hashCode = misc::MurmurHash::finish(hashCode, 3);
 }
 
 
@@ -56,12 +236,7 @@ bool SemanticContext::Predicate::eval(Recognizer *parser, Ref<RuleContext> parse
 }
 
 size_t SemanticContext::Predicate::hashCode() const {
-  size_t hashCode = misc::MurmurHash::initialize();
-  hashCode = misc::MurmurHash::update(hashCode, (size_t)ruleIndex);
-  hashCode = misc::MurmurHash::update(hashCode, (size_t)predIndex);
-  hashCode = misc::MurmurHash::update(hashCode, isCtxDependent ? 1 : 0);
-  hashCode = misc::MurmurHash::finish(hashCode, 3);
-  return hashCode;
+  return _hashCode;
 }
 
 bool SemanticContext::Predicate::operator == (const SemanticContext &other) const {
@@ -85,10 +260,11 @@ std::string SemanticContext::Predicate::toString() const {
 
 //------------------ PrecedencePredicate -------------------------------------------------------------------------------
 
-SemanticContext::PrecedencePredicate::PrecedencePredicate() : precedence(0) {
+SemanticContext::PrecedencePredicate::PrecedencePredicate() : PrecedencePredicate(0) {
 }
 
 SemanticContext::PrecedencePredicate::PrecedencePredicate(int precedence) : precedence(precedence) {
+  _hashCode = 31 + (size_t)precedence;
 }
 
 bool SemanticContext::PrecedencePredicate::eval(Recognizer *parser, Ref<RuleContext> parserCallStack) {
@@ -109,9 +285,7 @@ int SemanticContext::PrecedencePredicate::compareTo(PrecedencePredicate *o) {
 }
 
 size_t SemanticContext::PrecedencePredicate::hashCode() const {
-  size_t hashCode = 1;
-  hashCode = 31 * hashCode + (size_t)precedence;
-  return hashCode;
+  return _hashCode;
 }
 
 bool SemanticContext::PrecedencePredicate::operator == (const SemanticContext &other) const {
@@ -134,25 +308,22 @@ std::string SemanticContext::PrecedencePredicate::toString() const {
 
 SemanticContext::AND::AND(Ref<SemanticContext> a, Ref<SemanticContext> b) {
   if (is<AND>(a)) {
-    const std::vector<Ref<SemanticContext>> op = ((AND*)a.get())->opnds;
-    for (auto var : op) {
-      opnds.push_back(var);
+    for (auto &operand : ((AND*)a.get())->opnds) {
+      addOperand(opnds, operand);
     }
   } else {
-    opnds.push_back(a);
+    addOperand(opnds, a);
   }
 
   if (is<AND>(b)) {
-    const std::vector<Ref<SemanticContext>> op = ((AND*)b.get())->opnds;
-    for (auto var : op) {
-      opnds.push_back(var);
+    for (auto &operand : ((AND*)b.get())->opnds) {
+      addOperand(opnds, operand);
     }
   } else {
-    opnds.push_back(b);
+    addOperand(opnds, b);
   }
 
   std::vector<Ref<PrecedencePredicate>> precedencePredicates = filterPrecedencePredicates(opnds);
-
   if (!precedencePredicates.empty()) {
     // interested in the transition with the lowest precedence
     auto predicate = [](Ref<PrecedencePredicate> a, Ref<PrecedencePredicate> b) {
@@ -162,6 +333,7 @@ SemanticContext::AND::AND(Ref<SemanticContext> a, Ref<SemanticContext> b) {
     opnds.push_back(*reduced);
   }
 
+  _hashCode = misc::MurmurHash::hashCode(opnds, typeid(AND).hash_code());
 }
 
 std::vector<Ref<SemanticContext>> SemanticContext::AND::getOperands() const {
@@ -181,7 +353,7 @@ bool SemanticContext::AND::operator == (const SemanticContext &other) const {
 }
 
 size_t SemanticContext::AND::hashCode() const {
-  return misc::MurmurHash::hashCode(opnds, typeid(AND).hash_code());
+  return _hashCode;
 }
 
 bool SemanticContext::AND::eval(Recognizer *parser, Ref<RuleContext> parserCallStack) {
@@ -237,21 +409,19 @@ std::string SemanticContext::AND::toString() const {
 
 SemanticContext::OR::OR(Ref<SemanticContext> a, Ref<SemanticContext> b) {
   if (is<OR>(a)) {
-    const std::vector<Ref<SemanticContext>> op = ((OR*)a.get())->opnds;
-    for (auto var : op) {
-      opnds.push_back(var);
+    for (auto &operand : ((OR*)a.get())->opnds) {
+      addOperand(opnds, operand);
     }
   } else {
-    opnds.push_back(a);
+    addOperand(opnds, a);
   }
 
   if (is<OR>(b)) {
-    const std::vector<Ref<SemanticContext>> op = ((OR*)b.get())->opnds;
-    for (auto var : op) {
-      opnds.push_back(var);
+    for (auto &operand : ((OR*)b.get())->opnds) {
+      addOperand(opnds, operand);
     }
   } else {
-    opnds.push_back(b);
+    addOperand(opnds, b);
   }
 
   std::vector<Ref<PrecedencePredicate>> precedencePredicates = filterPrecedencePredicates(opnds);
@@ -263,6 +433,8 @@ SemanticContext::OR::OR(Ref<SemanticContext> a, Ref<SemanticContext> b) {
     auto reduced = std::min_element(precedencePredicates.begin(), precedencePredicates.end(), predicate);
     opnds.push_back(*reduced);
   }
+
+  _hashCode = misc::MurmurHash::hashCode(opnds, typeid(OR).hash_code());
 }
 
 std::vector<Ref<SemanticContext>> SemanticContext::OR::getOperands() const {
@@ -282,7 +454,7 @@ bool SemanticContext::OR::operator == (const SemanticContext &other) const {
 }
 
 size_t SemanticContext::OR::hashCode() const {
-  return misc::MurmurHash::hashCode(opnds, typeid(OR).hash_code());
+  return _hashCode;
 }
 
 bool SemanticContext::OR::eval(Recognizer *parser, Ref<RuleContext> parserCallStack) {
@@ -336,7 +508,7 @@ std::string SemanticContext::OR::toString() const {
 
 //------------------ SemanticContext -----------------------------------------------------------------------------------
 
-const Ref<SemanticContext> SemanticContext::NONE = std::make_shared<Predicate>(-1, -1, false);
+const Ref<SemanticContext> SemanticContext::NONE = getNone();
 
 Ref<SemanticContext> SemanticContext::evalPrecedence(Recognizer * /*parser*/, Ref<RuleContext> /*parserCallStack*/) {
   return shared_from_this();
@@ -351,12 +523,7 @@ Ref<SemanticContext> SemanticContext::And(Ref<SemanticContext> a, Ref<SemanticCo
     return a;
   }
 
-  Ref<AND> result = std::make_shared<AND>(a, b);
-  if (result->opnds.size() == 1) {
-    return result->opnds[0];
-  }
-
-  return result;
+  return getInternTable().combine<AND>(true, a, b);
 }
 
 Ref<SemanticContext> SemanticContext::Or(Ref<SemanticContext> a, Ref<SemanticContext> b) {
@@ -371,10 +538,21 @@ Ref<SemanticContext> SemanticContext::Or(Ref<SemanticContext> a, Ref<SemanticCon
     return NONE;
   }
 
-  Ref<OR> result = std::make_shared<OR>(a, b);
-  if (result->opnds.size() == 1) {
-    return result->opnds[0];
+  return getInternTable().combine<OR>(false, a, b);
+}
+
+Ref<SemanticContext> SemanticContext::intern(const Ref<SemanticContext> &context) {
+  if (context == nullptr) {
+    return context;
   }
 
-  return result;
+  return getInternTable().intern(context);
+}
+
+size_t SemanticContext::purgeInternTable() {
+  return getInternTable().purge();
+}
+
+size_t SemanticContext::getInternTableSize() {
+  return getInternTable().size();
 }
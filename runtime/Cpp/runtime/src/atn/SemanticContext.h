@@ -95,24 +95,48 @@ namespace atn {
      */
     virtual Ref<SemanticContext> evalPrecedence(Recognizer *parser, Ref<RuleContext> parserCallStack);
 
+    /// Combines both contexts. The result is interned (see intern()), so combining the same contexts
+    /// again returns the same instance without constructing a new operator.
     static Ref<SemanticContext> And(Ref<SemanticContext> a, Ref<SemanticContext> b);
 
     /// See also: ParserATNSimulator::getPredsForAmbigAlts.
     static Ref<SemanticContext> Or(Ref<SemanticContext> a, Ref<SemanticContext> b);
 
+    /// Returns the canonical instance for the given context, which is the first context ever passed in here
+    /// comparing equal to it. All contexts created by the runtime (predicate transitions, And(), Or()) are interned,
+    /// which means for them pointer equality is the same as semantic equality. The table keeps the contexts
+    /// only as long as they are used elsewhere too (by the ATN, DFA states etc.), it drops the others from time
+    /// to time. The cache of And()/Or() results is bounded.
+    static Ref<SemanticContext> intern(const Ref<SemanticContext> &context);
+
+    /// Drops the cached And()/Or() results and all interned contexts which are not used anywhere else. Called by
+    /// the <seealso cref="dfa::DFAMemoryBudget"/> after clearing DFAs. Returns the number of dropped contexts.
+    static size_t purgeInternTable();
+
+    /// The number of interned contexts.
+    static size_t getInternTableSize();
+
     class Predicate;
     class PrecedencePredicate;
     class Operator;
     class AND;
     class OR;
 
+  protected:
+    /// Computed once in the constructors, as it is needed for every lookup in the interning table.
+    size_t _hashCode = 0;
+
   private:
+    /// Removes all precedence predicates from the given collection and returns them.
     template<typename T1> // where T1 : SemanticContext>
-    static std::vector<Ref<PrecedencePredicate>> filterPrecedencePredicates(const std::vector<T1> &collection) {
+    static std::vector<Ref<PrecedencePredicate>> filterPrecedencePredicates(std::vector<T1> &collection) {
       std::vector<Ref<PrecedencePredicate>> result;
-      for (auto context : collection) {
-        if (antlrcpp::is<PrecedencePredicate>(context)) {
-          result.push_back(std::dynamic_pointer_cast<PrecedencePredicate>(context));
+      for (auto iterator = collection.begin(); iterator != collection.end();) {
+        if (antlrcpp::is<PrecedencePredicate>(*iterator)) {
+          result.push_back(std::dynamic_pointer_cast<PrecedencePredicate>(*iterator));
+          iterator = collection.erase(iterator);
+        } else {
+          ++iterator;
         }
       }
 
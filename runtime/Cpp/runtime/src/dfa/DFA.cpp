@@ -34,6 +34,7 @@
 #include "support/CPPUtils.h"
 #include "atn/StarLoopEntryState.h"
 #include "atn/ATNConfigSet.h"
+#include "misc/EpochManager.h"
 
 #include "dfa/DFA.h"
 
@@ -45,36 +46,44 @@ DFA::DFA(atn::DecisionState *atnStartState) : DFA(atnStartState, 0) {
 }
 
 DFA::DFA(atn::DecisionState *atnStartState, int decision)
-  : atnStartState(atnStartState), s0(nullptr), decision(decision) {
+  : atnStartState(atnStartState), s0(nullptr), decision(decision), _memoryUsage(0) {
 
   _precedenceDfa = false;
   if (is<atn::StarLoopEntryState *>(atnStartState)) {
     if (static_cast<atn::StarLoopEntryState *>(atnStartState)->isPrecedenceDecision) {
       _precedenceDfa = true;
-      DFAState *precedenceState = new DFAState(std::make_shared<atn::ATNConfigSet>()); // TODO: mem leak
-      precedenceState->isAcceptState = false;
-      precedenceState->requiresFullContext = false;
-      s0 = precedenceState;
+      s0 = createPrecedenceStartState();
     }
   }
 }
 
-DFA::DFA(DFA &&other) : atnStartState(std::move(other.atnStartState)), decision(std::move(other.decision)) {
-  states = std::move(other.states);
-  s0 = std::move(other.s0);
-  _precedenceDfa = std::move(other._precedenceDfa);
+DFA::DFA(DFA &&other) NOEXCEPT : atnStartState(other.atnStartState), states(std::move(other.states)),
+  s0(other.s0.load()), decision(other.decision), _memoryUsage(other._memoryUsage.load()) {
+  _precedenceDfa = other._precedenceDfa;
+
+  // The states (and the precedence start state) now belong to this DFA.
+  other.states.clear();
+  other.s0 = nullptr;
+  other._memoryUsage = 0;
 }
 
-DFA::DFA(const DFA &other) : atnStartState(other.atnStartState), decision(other.decision) {
-  states = other.states;
-  s0 = other.s0;
+DFA::DFA(const DFA &other) : atnStartState(other.atnStartState), s0(nullptr), decision(other.decision),
+  _memoryUsage(0) {
   _precedenceDfa = other._precedenceDfa;
+  if (_precedenceDfa) {
+    s0 = createPrecedenceStartState();
+  }
 }
 
 DFA::~DFA() {
   for (auto state : states) {
     delete state.second;
   }
+
+  // The precedence start state is not in the states map.
+  if (_precedenceDfa) {
+    delete s0.load();
+  }
 }
 
 bool DFA::isPrecedenceDfa() const {
@@ -86,12 +95,12 @@ DFAState* DFA::getPrecedenceStartState(int precedence) const {
     throw IllegalStateException("Only precedence DFAs may contain a precedence start state.");
   }
 
-  // s0.edges is never null for a precedence DFA
-  if (precedence < 0 || precedence >= (int)s0->edges.size()) {
+  if (precedence < 0) {
     return nullptr;
   }
 
-  return s0->edges[precedence];
+  // s0 is never null for a precedence DFA. It's replaced when the DFA is cleared, so read it only once.
+  return s0.load(std::memory_order_acquire)->edges.get((size_t)precedence);
 }
 
 void DFA::setPrecedenceStartState(int precedence, DFAState *startState) {
@@ -107,12 +116,11 @@ void DFA::setPrecedenceStartState(int precedence, DFAState *startState) {
   // precedence DFA, s0 will be initialized once and not updated again
   std::unique_lock<std::recursive_mutex> lock(_lock);
   {
-    // s0.edges is never null for a precedence DFA
-    if (precedence >= (int)s0->edges.size()) {
-      s0->edges.resize(precedence + 1);
-    }
-
-    s0->edges[precedence] = startState;
+    // s0 is never null for a precedence DFA and doesn't change while we hold the lock. Growing its edge table
+    // retires the old one.
+    DFAState *start = s0.load(std::memory_order_relaxed);
+    _memoryUsage += start->edges.resize((size_t)precedence + 1);
+    start->edges.set((size_t)precedence, startState);
   }
 }
 
@@ -128,6 +136,55 @@ std::vector<DFAState *> DFA::getStates() const {
   return result;
 }
 
+size_t DFA::clear() {
+  std::vector<DFAState *> retired;
+  size_t count;
+  {
+    std::unique_lock<std::recursive_mutex> lock(_lock);
+    count = states.size();
+    retired.reserve(count + 1);
+    for (auto &state : states) {
+      retired.push_back(state.first);
+    }
+    states.clear();
+
+    if (_precedenceDfa) {
+      // The start states for the precedence levels are edges of s0, so it's replaced as a whole.
+      retired.push_back(s0.load(std::memory_order_relaxed));
+      s0.store(createPrecedenceStartState(), std::memory_order_release);
+    } else {
+      s0.store(nullptr, std::memory_order_release);
+    }
+    _memoryUsage = 0;
+  }
+
+  if (!retired.empty()) {
+    misc::EpochManager::getDefault().retire([retired]() {
+      for (auto state : retired) {
+        delete state;
+      }
+    });
+  }
+
+  return count;
+}
+
+size_t DFA::getMemoryUsage() const {
+  return _memoryUsage.load(std::memory_order_relaxed);
+}
+
+void DFA::addMemoryUsage(size_t bytes) {
+  _memoryUsage.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void DFA::releaseMemoryUsage(size_t bytes) {
+  _memoryUsage.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+std::recursive_mutex& DFA::getLock() const {
+  return _lock;
+}
+
 std::string DFA::toString(const std::vector<std::string> &tokenNames) {
   if (s0 == nullptr) {
     return "";
@@ -155,3 +212,9 @@ std::string DFA::toLexerString() {
   return serializer.toString();
 }
 
+DFAState* DFA::createPrecedenceStartState() {
+  DFAState *precedenceState = new DFAState(std::make_shared<atn::ATNConfigSet>());
+  precedenceState->isAcceptState = false;
+  precedenceState->requiresFullContext = false;
+  return precedenceState;
+}
@@ -47,13 +47,20 @@ namespace dfa {
     /// From which ATN state did we create this DFA?
     atn::DecisionState *const atnStartState;
     std::unordered_map<DFAState *, DFAState *, DFAState::Hasher, DFAState::Comparer> states; // States are owned by this class.
-    DFAState *s0;
+
+    /// The start state. Simulators read it without locking, so it's stored with release and loaded with acquire
+    /// semantics, which makes the state it points to visible completely.
+    std::atomic<DFAState *> s0;
     const int decision;
 
     DFA(atn::DecisionState *atnStartState);
     DFA(atn::DecisionState *atnStartState, int decision);
+
+    /// Copies the decision, but not the states. States belong to exactly one DFA, which deletes them.
     DFA(const DFA &other);
-    DFA(DFA &&other);
+
+    /// Takes over the states of the other DFA, which ends up empty.
+    DFA(DFA &&other) NOEXCEPT;
     virtual ~DFA();
 
     /**
@@ -96,6 +103,27 @@ namespace dfa {
     /// Return a list of all states in this DFA, ordered by state number.
     virtual std::vector<DFAState *> getStates() const;
 
+    /// <summary>
+    /// Drops all states, e.g. to bound the memory use of the DFA. Other threads may still be predicting with
+    /// this DFA, so the states are not deleted right away but retired to the default <seealso cref="misc::EpochManager"/>,
+    /// which frees them once no simulator can use them anymore. Returns the number of dropped states.
+    /// </summary>
+    size_t clear();
+
+    /// The estimated memory used by the states of this DFA in bytes (see DFAState::getMemoryUsage()).
+    size_t getMemoryUsage() const;
+
+    /// Called by the simulators for each new state or edge table.
+    void addMemoryUsage(size_t bytes);
+
+    /// Called by the simulators when parts of a state are released (see DFAState::freezeEdges()).
+    void releaseMemoryUsage(size_t bytes);
+
+    /// All changes of the states, their edges and s0 must be made while holding this lock. Readers on the
+    /// prediction path don't lock, they are protected by the <seealso cref="misc::EpochManager"/>. Code which
+    /// iterates over the states map must hold the lock, as the map itself is not safe for concurrent use.
+    std::recursive_mutex& getLock() const;
+
     /**
      * @deprecated Use {@link #toString(Vocabulary)} instead.
      */
@@ -111,7 +139,10 @@ namespace dfa {
      */
     bool _precedenceDfa;
 
-    std::recursive_mutex _lock; // To synchronize access to s0.
+    mutable std::recursive_mutex _lock;
+    std::atomic<size_t> _memoryUsage;
+
+    static DFAState* createPrecedenceStartState();
   };
 
 } // namespace atn
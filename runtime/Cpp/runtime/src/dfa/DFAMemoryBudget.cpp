@@ -0,0 +1,157 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "atn/PredictionContext.h"
+#include "atn/SemanticContext.h"
+#include "dfa/DFA.h"
+
+#include "dfa/DFAMemoryBudget.h"
+
+using namespace org::antlr::v4::runtime::dfa;
+
+DFAMemoryBudget::DFAMemoryBudget(std::vector<DFA> &decisionToDFA, size_t limit, double lowWaterMark,
+                                 Ref<atn::PredictionContextCache> contextCache)
+  : decisionToDFA(decisionToDFA), contextCache(contextCache), _limit(limit), _lowWaterMark(std::min(std::max(lowWaterMark, 0.0), 1.0)),
+    _peakMemoryUsage(0), _evictions(0), _evictedStates(0), _evictedBytes(0) {
+}
+
+size_t DFAMemoryBudget::getLimit() const {
+  return _limit;
+}
+
+void DFAMemoryBudget::setLimit(size_t limit) {
+  _limit = limit;
+}
+
+size_t DFAMemoryBudget::getMemoryUsage() const {
+  size_t result = 0;
+  for (auto &dfa : decisionToDFA) {
+    result += dfa.getMemoryUsage();
+  }
+  if (contextCache != nullptr) {
+    result += contextCache->getMemoryUsage();
+  }
+  return result;
+}
+
+std::vector<size_t> DFAMemoryBudget::getMemoryUsagePerDecision() const {
+  std::vector<size_t> result;
+  result.reserve(decisionToDFA.size());
+  for (auto &dfa : decisionToDFA) {
+    result.push_back(dfa.getMemoryUsage());
+  }
+  return result;
+}
+
+size_t DFAMemoryBudget::getPeakMemoryUsage() const {
+  return _peakMemoryUsage;
+}
+
+size_t DFAMemoryBudget::getEvictions() const {
+  return _evictions;
+}
+
+size_t DFAMemoryBudget::getEvictedStates() const {
+  return _evictedStates;
+}
+
+size_t DFAMemoryBudget::getEvictedBytes() const {
+  return _evictedBytes;
+}
+
+size_t DFAMemoryBudget::enforce() {
+  size_t usage = getMemoryUsage();
+  size_t peak = _peakMemoryUsage;
+  while (usage > peak && !_peakMemoryUsage.compare_exchange_weak(peak, usage)) {
+  }
+
+  if (usage <= _limit) {
+    return 0;
+  }
+
+  std::unique_lock<std::mutex> lock(_enforceLock, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    return 0;
+  }
+
+  // Largest first. That frees the most memory with the fewest DFAs to rebuild, and the DFAs which grow without
+  // bound are usually those of a few decisions only.
+  // The cached contexts of the states which are cleared below are not needed anymore. Those still in use
+  // are kept alive by the remaining states.
+  if (contextCache != nullptr) {
+    size_t bytes = contextCache->getMemoryUsage();
+    contextCache->clear();
+    _evictedBytes += bytes;
+    usage -= std::min(usage, bytes);
+  }
+
+  std::vector<size_t> order(decisionToDFA.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::vector<size_t> sizes = getMemoryUsagePerDecision();
+  std::sort(order.begin(), order.end(), [&sizes](size_t lhs, size_t rhs) {
+    return sizes[lhs] > sizes[rhs];
+  });
+
+  size_t target = (size_t)(_lowWaterMark * _limit);
+  size_t count = 0;
+  for (size_t decision : order) {
+    if (usage <= target || sizes[decision] == 0) {
+      break;
+    }
+
+    DFA &dfa = decisionToDFA[decision];
+    std::lock_guard<std::recursive_mutex> dfaLock(dfa.getLock());
+    size_t bytes = dfa.getMemoryUsage();
+    _evictedStates += dfa.clear();
+    _evictedBytes += bytes;
+    usage -= std::min(usage, bytes);
+    ++count;
+  }
+  _evictions += count;
+
+  // The semantic contexts of the cleared states can go once the states are freed, which happens later (see
+  // DFA::clear()). Those of states cleared before are dropped now, as are the cached combinations.
+  if (count > 0) {
+    atn::SemanticContext::purgeInternTable();
+  }
+
+  return count;
+}
+
+std::string DFAMemoryBudget::toString() const {
+  std::stringstream ss;
+  ss << "DFA memory: " << getMemoryUsage() / 1024 << " KB of " << _limit / 1024 << " KB (peak " << _peakMemoryUsage / 1024
+    << " KB), " << _evictions << " eviction(s), " << _evictedStates << " state(s) with " << _evictedBytes / 1024
+    << " KB evicted";
+  return ss.str();
+}
@@ -0,0 +1,110 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "antlr4-common.h"
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+namespace dfa {
+
+  /// <summary>
+  /// Bounds the memory used by the DFAs of a grammar (the decisionToDFA list shared by all its recognizers).
+  /// Without a budget the DFA grows until all relevant input has been seen, which for some grammars and
+  /// inputs (generated code, fuzzed input) can take gigabytes.
+  /// <p/>
+  /// The simulators which were given the budget (see atn::ATNSimulator::setMemoryBudget) check it after each
+  /// prediction which added states. If the limit is exceeded, the largest decision DFAs are cleared until the
+  /// memory use is below the low water mark (a fraction of the limit). They are rebuilt on demand afterwards.
+  /// If the budget is given the context cache of the simulators, the cached prediction contexts count as well.
+  /// The cache is emptied before any DFA is cleared. The contexts still used by DFA states stay alive (they are
+  /// reference counted), but are no longer counted then. Clearing DFAs also purges the interning table of the
+  /// semantic contexts (see atn::SemanticContext::purgeInternTable()).
+  /// Clearing is safe while other threads are predicting, as the states are freed through the
+  /// <seealso cref="misc::EpochManager"/>.
+  /// <p/>
+  /// The memory use is an estimate, see DFAState::getMemoryUsage().
+  /// </summary>
+  class ANTLR4CPP_PUBLIC DFAMemoryBudget {
+  public:
+    /// The budget must not outlive the DFA list. Without a context cache only the DFA states are counted.
+    DFAMemoryBudget(std::vector<DFA> &decisionToDFA, size_t limit, double lowWaterMark = 0.5,
+                    Ref<atn::PredictionContextCache> contextCache = nullptr);
+    virtual ~DFAMemoryBudget() {};
+
+    size_t getLimit() const;
+    void setLimit(size_t limit);
+
+    /// The memory use of all DFAs and the context cache in bytes.
+    size_t getMemoryUsage() const;
+
+    /// The memory use of each DFA (indexed by decision or lexer mode) in bytes.
+    std::vector<size_t> getMemoryUsagePerDecision() const;
+
+    /// The highest memory use seen when checking the budget.
+    size_t getPeakMemoryUsage() const;
+
+    /// How many DFAs have been cleared, how many states they had and how much memory they used (including
+    /// the memory of the context cache).
+    size_t getEvictions() const;
+    size_t getEvictedStates() const;
+    size_t getEvictedBytes() const;
+
+    /// Clears the context cache and DFAs if the limit is exceeded. Returns the number of cleared DFAs. Does nothing
+    /// if another thread is doing the same already.
+    virtual size_t enforce();
+
+    std::string toString() const;
+
+  protected:
+    std::vector<DFA> &decisionToDFA;
+    const Ref<atn::PredictionContextCache> contextCache;
+
+  private:
+    std::atomic<size_t> _limit;
+    const double _lowWaterMark;
+
+    std::atomic<size_t> _peakMemoryUsage;
+    std::atomic<size_t> _evictions;
+    std::atomic<size_t> _evictedStates;
+    std::atomic<size_t> _evictedBytes;
+
+    std::mutex _enforceLock;
+  };
+
+} // namespace dfa
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
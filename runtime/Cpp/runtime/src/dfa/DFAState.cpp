@@ -33,12 +33,54 @@
 #include "SemanticContext.h"
 #include "atn/ATNConfig.h"
 #include "misc/MurmurHash.h"
+#include "misc/EpochManager.h"
 
 #include "dfa/DFAState.h"
 
 using namespace org::antlr::v4::runtime::dfa;
 using namespace org::antlr::v4::runtime::atn;
 
+EdgeTable::EdgeTable() : _targets(nullptr), _size(0), _count(0) {
+}
+
+EdgeTable::~EdgeTable() {
+  delete[] _targets.load();
+}
+
+size_t EdgeTable::resize(size_t size) {
+  size_t oldSize = _size.load(std::memory_order_relaxed);
+  if (size <= oldSize) {
+    return 0;
+  }
+
+  std::atomic<DFAState *> *oldTargets = _targets.load(std::memory_order_relaxed);
+  std::atomic<DFAState *> *targets = new std::atomic<DFAState *>[size];
+  for (size_t i = 0; i < size; ++i) {
+    targets[i].store(i < oldSize ? oldTargets[i].load(std::memory_order_relaxed) : nullptr, std::memory_order_relaxed);
+  }
+
+  // Readers which still see the old size may continue with either table.
+  _targets.store(targets, std::memory_order_release);
+  _size.store(size, std::memory_order_release);
+
+  if (oldTargets != nullptr) {
+    misc::EpochManager::getDefault().retire([oldTargets]() {
+      delete[] oldTargets;
+    });
+  }
+
+  return (size - oldSize) * sizeof(std::atomic<DFAState *>);
+}
+
+void EdgeTable::set(size_t index, DFAState *target) {
+  assert(index < _size.load(std::memory_order_relaxed));
+  std::atomic<DFAState *> &entry = _targets.load(std::memory_order_relaxed)[index];
+  if (entry.load(std::memory_order_relaxed) == nullptr && target != nullptr) {
+    _count.fetch_add(1, std::memory_order_relaxed);
+  }
+  entry.store(target, std::memory_order_release);
+}
+
 DFAState::PredPrediction::PredPrediction(Ref<SemanticContext> pred, int alt) : pred(pred) {
   InitializeInstanceFields();
   this->alt = alt;
@@ -80,9 +122,60 @@ std::set<int> DFAState::getAltSet() {
   return alts;
 }
 
+void DFAState::freeze() {
+  assert(isAcceptState && !requiresFullContext && predicates.empty());
+
+  configs.reset();
+  _isFrozen = true;
+}
+
+bool DFAState::isFrozen() const {
+  return _isFrozen;
+}
+
+void DFAState::freezeEdges() {
+  assert(!isAcceptState);
+
+  if (_hasFrozenEdges) {
+    return;
+  }
+
+  // The hash code must not change, as the state is in the DFA's state map. The fingerprint stands in for
+  // the configs when comparing, so that a new state with the same configs is still found in the map.
+  _configsHashCode = configs->hashCode();
+  _configsFingerprint = getFingerprint(*configs);
+  _hasFrozenEdges = true;
+  std::atomic_store(&configs, Ref<ATNConfigSet>());
+}
+
+bool DFAState::hasFrozenEdges() const {
+  return _hasFrozenEdges;
+}
+
+Ref<ATNConfigSet> DFAState::getConfigs() const {
+  return std::atomic_load(&configs);
+}
+
+size_t DFAState::getMemoryUsage() const {
+  size_t result = sizeof(DFAState) + edges.size() * sizeof(DFAState *) + loopExitChars.capacity();
+  result += predicates.size() * (sizeof(PredPrediction *) + sizeof(PredPrediction));
+  if (configs != nullptr) {
+    // Each config is allocated separately and held by a shared pointer (with its control block).
+    result += sizeof(ATNConfigSet) + configs->configs.capacity() * sizeof(Ref<ATNConfig>);
+    result += configs->configs.size() * (sizeof(ATNConfig) + 2 * sizeof(void *));
+  }
+  return result;
+}
+
 size_t DFAState::hashCode() const {
   size_t hash = misc::MurmurHash::initialize(7);
-  hash = misc::MurmurHash::update(hash, configs->hashCode());
+  if (_isFrozen) {
+    hash = misc::MurmurHash::update(hash, (size_t)prediction);
+  } else if (_hasFrozenEdges) {
+    hash = misc::MurmurHash::update(hash, _configsHashCode);
+  } else {
+    hash = misc::MurmurHash::update(hash, configs->hashCode());
+  }
   hash = misc::MurmurHash::finish(hash, 1);
   return hash;
 }
@@ -93,7 +186,23 @@ bool DFAState::operator == (const DFAState &o) const {
     return true;
   }
 
-  return configs == o.configs;
+  if (_isFrozen || o._isFrozen) {
+    return _isFrozen == o._isFrozen && prediction == o.prediction;
+  }
+
+  // Without its configs, a state with frozen edges is compared by the hash code and fingerprint of its configs.
+  if (_hasFrozenEdges || o._hasFrozenEdges) {
+    size_t hashCode = _hasFrozenEdges ? _configsHashCode : configs->hashCode();
+    size_t otherHashCode = o._hasFrozenEdges ? o._configsHashCode : o.configs->hashCode();
+    if (hashCode != otherHashCode) {
+      return false;
+    }
+
+    size_t fingerprint = _hasFrozenEdges ? _configsFingerprint : getFingerprint(*configs);
+    return fingerprint == (o._hasFrozenEdges ? o._configsFingerprint : getFingerprint(*o.configs));
+  }
+
+  return *configs == *o.configs;
 }
 
 std::string DFAState::toString() {
@@ -115,9 +224,32 @@ std::string DFAState::toString() {
   return ss.str();
 }
 
+size_t DFAState::getFingerprint(ATNConfigSet &configs) {
+  // Independent of ATNConfigSet::hashCode() (other seed, other order of the values), and covering
+  // everything ATNConfigSet::operator == compares.
+  size_t hash = misc::MurmurHash::initialize(31);
+  for (auto &config : configs.configs) {
+    hash = misc::MurmurHash::update(hash, config->context ? config->context->hashCode() : 0);
+    hash = misc::MurmurHash::update(hash, config->semanticContext->hashCode());
+    hash = misc::MurmurHash::update(hash, (size_t)config->state->stateNumber);
+    hash = misc::MurmurHash::update(hash, (size_t)config->alt);
+    hash = misc::MurmurHash::update(hash, config->isPrecedenceFilterSuppressed() ? 1 : 0);
+  }
+  size_t flags = (configs.fullCtx ? 1 : 0) | (configs.hasSemanticContext ? 2 : 0) | (configs.dipsIntoOuterContext ? 4 : 0);
+  hash = misc::MurmurHash::update(hash, flags);
+  hash = misc::MurmurHash::update(hash, (size_t)configs.uniqueAlt);
+  hash = misc::MurmurHash::update(hash, std::hash<std::bitset<1024>>()(configs.conflictingAlts));
+  return misc::MurmurHash::finish(hash, 5 * configs.configs.size() + 3);
+}
+
 void DFAState::InitializeInstanceFields() {
   stateNumber = -1;
   isAcceptState = false;
   prediction = 0;
   requiresFullContext = false;
+  loopState = LOOP_UNKNOWN;
+  _isFrozen = false;
+  _hasFrozenEdges = false;
+  _configsHashCode = 0;
+  _configsFingerprint = 0;
 }
@@ -39,6 +39,61 @@ namespace v4 {
 namespace runtime {
 namespace dfa {
 
+  /// <summary>
+  /// The outgoing edges of a DFA state. The simulators read edges without locking, while other threads
+  /// sharing the DFA add new ones. Hence a table is never resized in place. Growing it publishes a new table
+  /// and retires the old one to the default <seealso cref="misc::EpochManager"/>, which frees it once no
+  /// reader can still use it. Tables only grow, so an index below a size read earlier stays valid.
+  /// All changes must be made while holding the lock of the owning DFA (see DFA::getLock()).
+  /// </summary>
+  class ANTLR4CPP_PUBLIC EdgeTable {
+  public:
+    EdgeTable();
+    EdgeTable(const EdgeTable &other) = delete;
+    ~EdgeTable();
+
+    EdgeTable& operator = (const EdgeTable &other) = delete;
+
+    size_t size() const {
+      return _size.load(std::memory_order_acquire);
+    }
+
+    bool empty() const {
+      return size() == 0;
+    }
+
+    /// The number of edges with a target (which may be the error state).
+    size_t count() const {
+      return _count.load(std::memory_order_relaxed);
+    }
+
+    /// Returns the target of the given edge, or nullptr if there is no such edge (yet).
+    DFAState* get(size_t index) const {
+      // The size is stored after the targets it belongs to, so read it first.
+      if (index >= _size.load(std::memory_order_acquire)) {
+        return nullptr;
+      }
+      return _targets.load(std::memory_order_acquire)[index].load(std::memory_order_acquire);
+    }
+
+    DFAState* operator [] (size_t index) const {
+      return get(index);
+    }
+
+    /// Grows the table to the given size (smaller sizes are ignored), keeping all existing edges.
+    /// Returns the number of bytes added, for the memory accounting of the DFA.
+    size_t resize(size_t size);
+
+    /// Sets the target of an edge. The index must be less than size(). The target must be fully
+    /// initialized, as readers can use it right away.
+    void set(size_t index, DFAState *target);
+
+  private:
+    std::atomic<std::atomic<DFAState *> *> _targets;
+    std::atomic<size_t> _size;
+    std::atomic<size_t> _count;
+  };
+
   /// <summary>
   /// A DFA state represents a set of possible ATN configurations.
   ///  As Aho, Sethi, Ullman p. 117 says "The DFA uses its state
@@ -80,17 +135,14 @@ namespace dfa {
       void InitializeInstanceFields();
     };
 
-    int stateNumber;
-
-    Ref<atn::ATNConfigSet> configs;
+    // The fields are ordered by access frequency. Those needed when walking an existing DFA come first,
+    // so they share a cache line. Everything after stateNumber is only used when computing new states.
 
     /// <summary>
     /// {@code edges[symbol]} points to target of symbol. Shift up by 1 so (-1)
     ///  <seealso cref="Token#EOF"/> maps to {@code edges[0]}.
     /// </summary>
-    std::vector<DFAState *> edges;
-
-    bool isAcceptState;
+    EdgeTable edges;
 
     /// <summary>
     /// if accept state, what ttype do we match or alt do we predict?
@@ -99,7 +151,7 @@ namespace dfa {
     /// </summary>
     int prediction;
 
-    Ref<atn::LexerActionExecutor> lexerActionExecutor;
+    bool isAcceptState;
 
     /// <summary>
     /// Indicates that this state was created during SLL prediction that
@@ -109,6 +161,19 @@ namespace dfa {
     /// </summary>
     bool requiresFullContext;
 
+    /// Lexer only: whether this state loops back to itself on all but a few chars (see loopExitChars).
+    /// Computed on first use by the LexerATNSimulator, which sets it after loopExitChars.
+    enum LoopState : unsigned char { LOOP_UNKNOWN, LOOP_NONE, LOOP_SKIPPABLE };
+    std::atomic<LoopState> loopState;
+
+    int stateNumber;
+
+    /// The ATN configurations this state represents. This is null for frozen states (see freeze() and
+    /// freezeEdges()). Code which doesn't hold the DFA lock must read it through getConfigs().
+    Ref<atn::ATNConfigSet> configs;
+
+    Ref<atn::LexerActionExecutor> lexerActionExecutor;
+
     /// <summary>
     /// During SLL parsing, this is a list of predicates associated with the
     ///  ATN configurations of the DFA state. When we have predicates,
@@ -124,19 +189,50 @@ namespace dfa {
     /// </summary>
     std::vector<PredPrediction *> predicates;
 
+    /// Lexer only: if loopState is LOOP_SKIPPABLE, the ASCII chars which leave this state. All other ASCII
+    /// chars lead back to it, which is typical for the body of a comment, string literal or whitespace run.
+    /// Chars outside of the DFA edge range always leave the state.
+    std::vector<unsigned char> loopExitChars;
+
     /// Map a predicate to a predicted alternative.
     DFAState();
     DFAState(int state);
     DFAState(Ref<atn::ATNConfigSet> configs);
-    virtual ~DFAState();
+    ~DFAState();
 
     /// <summary>
     /// Get the set of all alts mentioned by all ATN configurations in this
     ///  DFA state.
     /// </summary>
-    virtual std::set<int> getAltSet();
+    std::set<int> getAltSet();
+
+    /// Releases the config set of a parser accept state which predicts an alternative unconditionally
+    /// (no predicates, no full context retry). Prediction stops in such a state and never reads more
+    /// than the predicted alternative from it, so the configs (usually by far the largest part of a
+    /// DFA) are not needed anymore. A frozen state is equal to any other frozen state with the same
+    /// prediction, which means a decision DFA ends up with a single final state per alternative.
+    /// Lexer DFA states must not be frozen, as the lexer continues matching from accept states.
+    void freeze();
+    bool isFrozen() const;
+
+    /// Releases the config set of a parser state which is not an accept state, once the targets for all
+    /// token types are known. The configs are only needed to compute the targets of missing edges,
+    /// so a complete state is a plain row of the dense edge table from now on. Other threads may still be
+    /// reading the configs, so they are released atomically (see getConfigs()). The state keeps the hash
+    /// code and a fingerprint of its configs, which replace the configs in comparisons from now on. Must be
+    /// called while holding the DFA lock.
+    void freezeEdges();
+    bool hasFrozenEdges() const;
 
-    virtual size_t hashCode() const;
+    /// Reads the configs atomically, for threads which don't hold the DFA lock while freezeEdges() may
+    /// run. The result is null for frozen states.
+    Ref<atn::ATNConfigSet> getConfigs() const;
+
+    /// An estimate of the memory used by this state (the state itself, its edges and its configs) in bytes.
+    /// Prediction contexts are shared through the context cache, so they are not included.
+    size_t getMemoryUsage() const;
+
+    size_t hashCode() const;
 
     /// Two DFAState instances are equal if their ATN configuration sets
     /// are the same. This method is used to see if a state already exists.
@@ -151,7 +247,7 @@ namespace dfa {
     /// stateNumber is irrelevant.
     bool operator == (const DFAState &o) const;
 
-    virtual std::string toString();
+    std::string toString();
 
     struct Hasher
     {
@@ -168,6 +264,13 @@ namespace dfa {
     };
     
   private:
+    bool _isFrozen;
+    bool _hasFrozenEdges;
+    size_t _configsHashCode; // Only for states with frozen edges.
+    size_t _configsFingerprint; // Ditto.
+
+    static size_t getFingerprint(atn::ATNConfigSet &configs);
+
     void InitializeInstanceFields();
   };
 
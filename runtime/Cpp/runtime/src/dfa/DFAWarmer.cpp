@@ -0,0 +1,399 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "BaseErrorListener.h"
+#include "CommonTokenStream.h"
+#include "Exceptions.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "ParserRuleContext.h"
+#include "atn/ATN.h"
+#include "atn/DecisionInfo.h"
+#include "atn/DecisionState.h"
+#include "atn/LexerATNSimulator.h"
+#include "atn/ParseInfo.h"
+#include "atn/ParserATNSimulator.h"
+#include "dfa/DFA.h"
+
+#include <iomanip>
+
+#include "dfa/DFAWarmer.h"
+
+using namespace org::antlr::v4::runtime;
+using namespace org::antlr::v4::runtime::dfa;
+
+namespace {
+
+  class CountingErrorListener : public BaseErrorListener {
+  public:
+    size_t errors = 0;
+
+    virtual void syntaxError(IRecognizer * /*recognizer*/, Ref<Token> /*offendingSymbol*/, size_t /*line*/,
+                             int /*charPositionInLine*/, const std::string &/*msg*/, std::exception_ptr /*e*/) override {
+      ++errors;
+    }
+  };
+
+  size_t countEdges(const DFAState *state) {
+    size_t result = 0;
+    for (size_t i = 0; i < state->edges.size(); ++i) {
+      if (state->edges[i] != nullptr) {
+        ++result;
+      }
+    }
+    return result;
+  }
+
+}
+
+size_t DFAWarmer::Coverage::getStates() const {
+  size_t result = 0;
+  for (auto &entry : lexerModes) {
+    result += entry.states;
+  }
+  for (auto &entry : parserDecisions) {
+    result += entry.states;
+  }
+  return result;
+}
+
+size_t DFAWarmer::Coverage::getEdges() const {
+  size_t result = 0;
+  for (auto &entry : lexerModes) {
+    result += entry.edges;
+  }
+  for (auto &entry : parserDecisions) {
+    result += entry.edges;
+  }
+  return result;
+}
+
+size_t DFAWarmer::Coverage::getUnvisitedDecisions() const {
+  size_t result = 0;
+  for (auto &entry : parserDecisions) {
+    if (!entry.hasStartState) {
+      ++result;
+    }
+  }
+  return result;
+}
+
+size_t DFAWarmer::Coverage::getColdDecisions() const {
+  size_t result = 0;
+  for (auto &entry : lexerModes) {
+    if (entry.atnTransitions > 0) {
+      ++result;
+    }
+  }
+  for (auto &entry : parserDecisions) {
+    if (entry.atnTransitions > 0) {
+      ++result;
+    }
+  }
+  return result;
+}
+
+std::string DFAWarmer::Coverage::toString(const std::vector<std::string> &modeNames,
+                                          const std::vector<std::string> &ruleNames, const atn::ATN *atn) const {
+  std::stringstream ss;
+  ss << "DFA warm-up: " << inputs << " input(s), " << failedInputs << " failed, " << tokens << " tokens, "
+    << passes << " pass(es) in " << std::fixed << std::setprecision(3) << milliseconds << " ms" << std::endl;
+  ss << "  " << getStates() << " states, " << getEdges() << " edges, " << getUnvisitedDecisions() << " of "
+    << parserDecisions.size() << " decision(s) unvisited, " << getColdDecisions() << " still using the ATN" << std::endl;
+
+  ss << "  mode                  states    edges  ATN transitions" << std::endl;
+  for (auto &entry : lexerModes) {
+    std::string name = entry.decision < modeNames.size() ? modeNames[entry.decision] : std::to_string(entry.decision);
+    ss << "  " << std::left << std::setw(20) << name << std::right << std::setw(8) << entry.states
+      << std::setw(9) << entry.edges << std::setw(17) << entry.atnTransitions << std::endl;
+  }
+
+  // Only the decisions which didn't converge are listed, as there can be hundreds of them.
+  bool hasHeader = false;
+  for (auto &entry : parserDecisions) {
+    if (entry.atnTransitions == 0) {
+      continue;
+    }
+
+    if (!hasHeader) {
+      ss << "  decision  rule                  states    edges  ATN transitions" << std::endl;
+      hasHeader = true;
+    }
+
+    std::string rule;
+    if (atn != nullptr && entry.decision < atn->decisionToState.size()) {
+      size_t ruleIndex = atn->decisionToState[entry.decision]->ruleIndex;
+      rule = ruleIndex < ruleNames.size() ? ruleNames[ruleIndex] : std::to_string(ruleIndex);
+    }
+    ss << "  " << std::setw(8) << entry.decision << "  " << std::left << std::setw(20) << rule << std::right
+      << std::setw(8) << entry.states << std::setw(9) << entry.edges << std::setw(17) << entry.atnTransitions << std::endl;
+  }
+
+  return ss.str();
+}
+
+DFAWarmer::DFAWarmer(LexerFactory lexerFactory, ParserFactory parserFactory, const std::string &startRuleName,
+                     RuleInvoker ruleInvoker)
+  : lexerFactory(lexerFactory), parserFactory(parserFactory), startRuleName(startRuleName), ruleInvoker(ruleInvoker),
+    passes(2), _started(false), _running(false), _ready(false) {
+}
+
+DFAWarmer::~DFAWarmer() {
+  if (_thread.joinable()) {
+    _thread.join();
+  }
+}
+
+void DFAWarmer::addInput(const std::string &text, const std::string &sourceName) {
+  inputs.push_back({ text, sourceName, false });
+}
+
+void DFAWarmer::addFile(const std::string &fileName) {
+  inputs.push_back({ "", fileName, true });
+}
+
+void DFAWarmer::setPasses(size_t passes) {
+  this->passes = std::max(passes, (size_t)1);
+}
+
+void DFAWarmer::setReadyCallback(std::function<void (const Coverage &coverage)> callback) {
+  _readyCallback = callback;
+}
+
+DFAWarmer::Coverage DFAWarmer::run() {
+  if (_running.exchange(true)) {
+    throw IllegalStateException("The DFA warm-up is running already.");
+  }
+
+  Coverage coverage = doRun();
+  std::exception_ptr callbackException = setReady(coverage);
+  _running = false;
+  if (callbackException) {
+    std::rethrow_exception(callbackException);
+  }
+
+  return coverage;
+}
+
+DFAWarmer::Coverage DFAWarmer::doRun() {
+  auto start = std::chrono::steady_clock::now();
+
+  Coverage coverage;
+  coverage.inputs = inputs.size();
+  coverage.passes = passes;
+
+  // Declared first, so the listener outlives the recognizers.
+  CountingErrorListener errorListener;
+  std::vector<DecisionCoverage> lexerCoverage;
+  std::unique_ptr<misc::RecognizerDriver> driver;
+  Lexer *lexer = nullptr;
+  Parser *parser = nullptr;
+
+  try {
+    driver.reset(new misc::RecognizerDriver(lexerFactory, parserFactory, ruleInvoker));
+    lexer = driver->getLexer();
+    lexer->removeErrorListeners();
+    lexer->addErrorListener(&errorListener);
+    parser = driver->getParser();
+    if (parser != nullptr) {
+      parser->removeErrorListeners();
+      parser->addErrorListener(&errorListener);
+    }
+
+    for (size_t pass = 0; pass < passes; ++pass) {
+      if (pass + 1 == passes) {
+        coverage.failedInputs = 0;
+        coverage.tokens = 0;
+        lexerCoverage = getCoverage(lexer->getInterpreter<atn::LexerATNSimulator>()->_decisionToDFA, _participant);
+        if (parser != nullptr) {
+          parser->setProfile(true);
+        }
+      }
+
+      for (auto &entry : inputs) {
+        std::string text = entry.text;
+        if (entry.isFile) {
+          std::ifstream stream(entry.sourceName, std::ios::binary);
+          if (!stream) {
+            ++coverage.failedInputs;
+            continue;
+          }
+          text.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+        }
+
+        driver->load(text, entry.sourceName);
+        if (!process(*driver, coverage)) {
+          ++coverage.failedInputs;
+        }
+      }
+    }
+  } catch (...) {
+    // Whatever was learned so far stays in the DFA. Report all remaining input as failed.
+    coverage.failedInputs = inputs.size();
+  }
+
+  if (lexer != nullptr) {
+    // The lexer has a DFA per mode, but the list is sized by the number of decisions.
+    coverage.lexerModes = getCoverage(lexer->getInterpreter<atn::LexerATNSimulator>()->_decisionToDFA, _participant);
+    coverage.lexerModes.resize(std::min(coverage.lexerModes.size(), lexer->getATN().modeToStartState.size()));
+    for (size_t i = 0; i < coverage.lexerModes.size(); ++i) {
+      size_t edgesBefore = i < lexerCoverage.size() ? lexerCoverage[i].edges : 0;
+      coverage.lexerModes[i].atnTransitions = coverage.lexerModes[i].edges - edgesBefore;
+    }
+  }
+
+  if (parser != nullptr) {
+    coverage.parserDecisions = getCoverage(parser->getInterpreter<atn::ParserATNSimulator>()->decisionToDFA, _participant);
+    Ref<atn::ParseInfo> parseInfo = parser->getParseInfo();
+    if (parseInfo != nullptr) {
+      std::vector<atn::DecisionInfo> decisionInfo = parseInfo->getDecisionInfo();
+      for (size_t i = 0; i < coverage.parserDecisions.size() && i < decisionInfo.size(); ++i) {
+        coverage.parserDecisions[i].atnTransitions =
+          (size_t)(decisionInfo[i].SLL_ATNTransitions + decisionInfo[i].LL_ATNTransitions);
+      }
+    }
+    parser->setProfile(false);
+  }
+
+  coverage.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  return coverage;
+}
+
+void DFAWarmer::start() {
+  if (_running.exchange(true)) {
+    throw IllegalStateException("The DFA warm-up is running already.");
+  }
+  if (_started.exchange(true)) {
+    _running = false;
+    throw IllegalStateException("The DFA warm-up has already been started.");
+  }
+
+  _thread = std::thread([this]() {
+    // Nobody could handle an exception of the callback here.
+    setReady(doRun());
+    _running = false;
+  });
+}
+
+bool DFAWarmer::isReady() const {
+  return _ready;
+}
+
+void DFAWarmer::wait() {
+  std::unique_lock<std::mutex> lock(_lock);
+  _readyCondition.wait(lock, [this]() { return _ready.load(); });
+}
+
+bool DFAWarmer::waitFor(std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(_lock);
+  return _readyCondition.wait_for(lock, timeout, [this]() { return _ready.load(); });
+}
+
+DFAWarmer::Coverage DFAWarmer::getCoverage() const {
+  std::lock_guard<std::mutex> lock(_lock);
+  if (!_ready) {
+    throw IllegalStateException("The DFA warm-up has not finished yet.");
+  }
+  return _coverage;
+}
+
+std::vector<DFAWarmer::DecisionCoverage> DFAWarmer::getCoverage(const std::vector<DFA> &decisionToDFA) {
+  misc::EpochManager::Participant participant;
+  return getCoverage(decisionToDFA, participant);
+}
+
+std::vector<DFAWarmer::DecisionCoverage> DFAWarmer::getCoverage(const std::vector<DFA> &decisionToDFA,
+                                                                misc::EpochManager::Participant &participant) {
+  std::vector<DecisionCoverage> result;
+  for (size_t i = 0; i < decisionToDFA.size(); ++i) {
+    const DFA &dfa = decisionToDFA[i];
+
+    // The lock keeps the states map stable (a memory budget may clear the DFA from another thread), the guard
+    // the edge tables, which are replaced when they grow.
+    std::lock_guard<std::recursive_mutex> lock(dfa.getLock());
+    misc::EpochManager::Guard guard(participant);
+
+    DecisionCoverage entry = { i, dfa.states.size(), 0, false, 0 };
+    for (auto &state : dfa.states) {
+      entry.edges += countEdges(state.first);
+    }
+
+    // The start state of a precedence DFA isn't part of the state set and holds a start state per precedence.
+    const DFAState *start = dfa.s0.load(std::memory_order_acquire);
+    if (dfa.isPrecedenceDfa()) {
+      entry.hasStartState = start != nullptr && countEdges(start) > 0;
+    } else {
+      entry.hasStartState = start != nullptr;
+    }
+    result.push_back(entry);
+  }
+
+  return result;
+}
+
+bool DFAWarmer::process(misc::RecognizerDriver &driver, Coverage &coverage) {
+  driver.lex();
+  coverage.tokens += driver.getTokens().size();
+
+  Parser *parser = driver.getParser();
+  if (parser == nullptr) {
+    return true;
+  }
+
+  ssize_t ruleIndex = driver.getRuleIndex(startRuleName);
+  if (ruleIndex < 0) {
+    return false;
+  }
+
+  int errors = parser->getNumberOfSyntaxErrors();
+  Ref<ParserRuleContext> tree = driver.parse((size_t)ruleIndex);
+  return tree != nullptr && parser->getNumberOfSyntaxErrors() == errors;
+}
+
+std::exception_ptr DFAWarmer::setReady(const Coverage &coverage) {
+  std::exception_ptr callbackException;
+  if (_readyCallback) {
+    try {
+      _readyCallback(coverage);
+    } catch (...) {
+      callbackException = std::current_exception();
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(_lock);
+    _coverage = coverage;
+    _ready = true;
+  }
+  _readyCondition.notify_all();
+
+  return callbackException;
+}
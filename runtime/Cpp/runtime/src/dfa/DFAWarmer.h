@@ -0,0 +1,200 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "misc/EpochManager.h"
+#include "misc/RecognizerDriver.h"
+
+#include <condition_variable>
+#include <thread>
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+namespace dfa {
+
+  /// <summary>
+  /// Trains the decision DFAs of a lexer/parser combo by running a representative corpus through them, so
+  /// that the first real requests don't pay for the DFA construction. Generated recognizers share their DFAs
+  /// (the static _decisionToDFA of each recognizer class), so warming up one instance benefits all instances
+  /// created later. Interpreters own their DFAs, so for them only the warmed up instances profit.
+  /// <p/>
+  /// The warm-up can run synchronously (e.g. in a build step, to check the coverage of a corpus) or in a
+  /// background thread, while the application starts up:
+  ///
+  /// <pre>
+  /// DFAWarmer warmer([](CharStream *input) { return std::make_shared<MyLexer>(input); },
+  ///   [](TokenStream *input) { return std::make_shared<MyParser>(input); },
+  ///   [](Parser *parser, size_t) -> Ref<ParserRuleContext> { return static_cast<MyParser *>(parser)->prog(); });
+  /// warmer.addFile("corpus/sample1.txt");
+  /// warmer.start();
+  /// ...
+  /// warmer.wait(); // Or poll isReady() from a health check.
+  /// std::cout << warmer.getCoverage().toString();
+  /// </pre>
+  ///
+  /// The DFA is extended under its own lock (DFA::getLock()), while lookups go without locking, so other
+  /// recognizers sharing the DFA can run while it still grows. They just don't profit from the states which
+  /// were not added yet. The corpus itself is processed by a single thread, as the warmer reuses one lexer/parser
+  /// pair for all inputs (see misc::RecognizerDriver). Lexers which run concurrently add their edges to the ATN
+  /// transition counts of the lexer modes, so the coverage is only exact if nothing else uses the lexer DFA.
+  /// The coverage is read under the lock of each DFA, so a memory budget may clear DFAs meanwhile.
+  /// Warmers for the same or different grammars can run in parallel, but a single warmer runs only once at a time.
+  /// </summary>
+  class ANTLR4CPP_PUBLIC DFAWarmer {
+  public:
+    typedef misc::RecognizerDriver::LexerFactory LexerFactory;
+    typedef misc::RecognizerDriver::ParserFactory ParserFactory;
+    typedef misc::RecognizerDriver::RuleInvoker RuleInvoker;
+
+    /// The coverage of a single parser decision or lexer mode.
+    struct DecisionCoverage {
+      size_t decision; // The mode for lexer DFAs.
+      size_t states;
+      size_t edges;
+      bool hasStartState;
+
+      /// How often the ATN had to be used in the last pass over the corpus. For parser decisions these are the
+      /// SLL and LL ATN transitions (LL fallbacks always use the ATN), for lexer modes the number of edges added.
+      /// Non-zero values mean the DFA has not converged for the corpus.
+      size_t atnTransitions;
+    };
+
+    struct Coverage {
+      std::vector<DecisionCoverage> lexerModes;
+      std::vector<DecisionCoverage> parserDecisions;
+
+      size_t inputs = 0;
+      size_t failedInputs = 0; // Inputs which couldn't be read or contained syntax errors.
+      size_t tokens = 0;
+      size_t passes = 0;
+      double milliseconds = 0;
+
+      size_t getStates() const;
+      size_t getEdges() const;
+
+      /// The number of parser decisions without a DFA start state (never predicted by the corpus).
+      size_t getUnvisitedDecisions() const;
+
+      /// The number of lexer modes and parser decisions which still used the ATN in the last pass.
+      size_t getColdDecisions() const;
+
+      std::string toString(const std::vector<std::string> &modeNames = {},
+                           const std::vector<std::string> &ruleNames = {}, const atn::ATN *atn = nullptr) const;
+    };
+
+    /// The parser factory can be empty to warm up only the lexer. The start rule is given by name and
+    /// run through the rule invoker (or ParserInterpreter::parse for interpreters).
+    DFAWarmer(LexerFactory lexerFactory, ParserFactory parserFactory = nullptr, const std::string &startRuleName = "",
+              RuleInvoker ruleInvoker = nullptr);
+    virtual ~DFAWarmer();
+
+    void addInput(const std::string &text, const std::string &sourceName = "<string>");
+
+    /// The file is read when the warm-up runs.
+    void addFile(const std::string &fileName);
+
+    /// How often the corpus is processed (at least 1, default 2). The last pass measures the coverage.
+    void setPasses(size_t passes);
+
+    /// Called from the warm-up thread once it finished, before isReady() returns true. If the callback throws,
+    /// run() passes the exception on (once the warmer is ready). For start() it is ignored.
+    void setReadyCallback(std::function<void (const Coverage &coverage)> callback);
+
+    /// Runs the warm-up in the calling thread and returns the coverage. The warmer is ready afterwards.
+    /// Throws an IllegalStateException while the warm-up is running already (e.g. after start()).
+    Coverage run();
+
+    /// Runs the warm-up in a background thread. Throws an IllegalStateException if it was already started.
+    void start();
+
+    /// True once the warm-up finished (successfully or not).
+    bool isReady() const;
+
+    /// Blocks until the warm-up finished.
+    void wait();
+
+    /// Blocks at most for the given time. Returns true if the warm-up finished.
+    bool waitFor(std::chrono::milliseconds timeout);
+
+    /// The coverage of the finished warm-up. Throws an IllegalStateException if it's not ready yet.
+    Coverage getCoverage() const;
+
+    /// The coverage of the given DFAs, without ATN transition counts. Takes the lock of each DFA, so other threads
+    /// may extend or clear the DFAs meanwhile.
+    static std::vector<DecisionCoverage> getCoverage(const std::vector<DFA> &decisionToDFA);
+
+  protected:
+    struct Input {
+      std::string text;
+      std::string sourceName;
+      bool isFile;
+    };
+
+    LexerFactory lexerFactory;
+    ParserFactory parserFactory;
+    std::string startRuleName;
+    RuleInvoker ruleInvoker;
+    std::vector<Input> inputs;
+    size_t passes;
+
+    /// Runs the current input of the driver through lexer and parser (if any). Returns false on errors.
+    virtual bool process(misc::RecognizerDriver &driver, Coverage &coverage);
+
+    static std::vector<DecisionCoverage> getCoverage(const std::vector<DFA> &decisionToDFA,
+                                                     misc::EpochManager::Participant &participant);
+
+  private:
+    std::function<void (const Coverage &coverage)> _readyCallback;
+    std::thread _thread;
+    std::atomic<bool> _started;
+    std::atomic<bool> _running;
+    std::atomic<bool> _ready;
+
+    // Only used by the thread which runs the warm-up.
+    misc::EpochManager::Participant _participant;
+    mutable std::mutex _lock;
+    std::condition_variable _readyCondition;
+    Coverage _coverage;
+
+    Coverage doRun();
+
+    /// Returns the exception thrown by the ready callback, if any.
+    std::exception_ptr setReady(const Coverage &coverage);
+  };
+
+} // namespace dfa
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
@@ -0,0 +1,189 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "misc/EpochManager.h"
+
+using namespace org::antlr::v4::runtime::misc;
+
+EpochManager::Participant::Participant(EpochManager &manager)
+  : _manager(manager), _slot(manager.acquireSlot()), _nesting(0) {
+}
+
+EpochManager::Participant::~Participant() {
+  _manager.releaseSlot(_slot);
+}
+
+void EpochManager::Participant::enter() {
+  if (_nesting++ == 0) {
+    // The fence keeps the reads of the protected data from moving before the store. Together with the fence
+    // in collect() either the reclaimer sees this epoch or this reader sees the data already unlinked.
+    // An outdated epoch only delays reclamation.
+    _slot->epoch.store(_manager._epoch.load(), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+}
+
+void EpochManager::Participant::leave() {
+  if (--_nesting == 0) {
+    uint64_t epoch = _slot->epoch.load(std::memory_order_relaxed);
+    _slot->epoch.store(0, std::memory_order_release);
+
+    // Only readers which entered before the last retirement can have blocked reclamation.
+    if (_manager._pendingCount.load(std::memory_order_relaxed) > 0 &&
+        epoch <= _manager._lastRetiredEpoch.load(std::memory_order_relaxed)) {
+      _manager.collect(false);
+    }
+  }
+}
+
+bool EpochManager::Participant::isActive() const {
+  return _nesting > 0;
+}
+
+//----------------- EpochManager ---------------------------------------------------------------------------------------
+
+EpochManager::EpochManager() : _epoch(1), _lastRetiredEpoch(0), _pendingCount(0), _reclaimedCount(0) {
+}
+
+EpochManager::~EpochManager() {
+  for (auto &retired : _retired) {
+    retired.reclaim();
+  }
+  for (auto slot : _slots) {
+    delete slot;
+  }
+}
+
+EpochManager& EpochManager::getDefault() {
+  // Never deleted, so it can be used by static recognizers during shutdown.
+  static EpochManager *instance = new EpochManager();
+  return *instance;
+}
+
+void EpochManager::retire(std::function<void ()> reclaim) {
+  {
+    std::lock_guard<std::mutex> lock(_retiredLock);
+
+    // Readers which enter from now on get a newer epoch and can't see the (already unlinked) data.
+    uint64_t epoch = _epoch.fetch_add(1);
+    _retired.push_back({ epoch, reclaim });
+    _lastRetiredEpoch.store(epoch);
+    ++_pendingCount;
+  }
+
+  collect(true);
+}
+
+size_t EpochManager::collect() {
+  return collect(true);
+}
+
+uint64_t EpochManager::getEpoch() const {
+  return _epoch.load();
+}
+
+size_t EpochManager::getPendingCount() const {
+  return _pendingCount.load();
+}
+
+size_t EpochManager::getReclaimedCount() const {
+  return _reclaimedCount.load();
+}
+
+EpochManager::Participant::Slot* EpochManager::acquireSlot() {
+  std::lock_guard<std::mutex> lock(_slotLock);
+  if (!_freeSlots.empty()) {
+    Participant::Slot *slot = _freeSlots.back();
+    _freeSlots.pop_back();
+    return slot;
+  }
+
+  Participant::Slot *slot = new Participant::Slot();
+  slot->epoch.store(0);
+  _slots.push_back(slot);
+  return slot;
+}
+
+void EpochManager::releaseSlot(Participant::Slot *slot) {
+  slot->epoch.store(0);
+
+  std::lock_guard<std::mutex> lock(_slotLock);
+  _freeSlots.push_back(slot);
+}
+
+size_t EpochManager::collect(bool wait) {
+  std::vector<std::function<void ()>> reclaimable;
+  {
+    std::unique_lock<std::mutex> lock(_retiredLock, std::defer_lock);
+    if (wait) {
+      lock.lock();
+    } else if (!lock.try_lock()) {
+      return 0; // Someone else is collecting already.
+    }
+
+    if (_retired.empty()) {
+      return 0;
+    }
+
+    // The scan must happen after all the entries considered here were retired (guaranteed by the lock),
+    // as readers entering afterwards then have a newer epoch than any of them. The fence pairs with the one
+    // in Participant::enter(), so the unlinking of the data cannot move past the scan.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint64_t oldest = UINT64_MAX;
+    {
+      std::lock_guard<std::mutex> slotLock(_slotLock);
+      for (auto slot : _slots) {
+        uint64_t epoch = slot->epoch.load(std::memory_order_acquire); // Pairs with the release in leave().
+        if (epoch != 0 && epoch < oldest) {
+          oldest = epoch;
+        }
+      }
+    }
+
+    std::vector<Retired> remaining;
+    for (auto &retired : _retired) {
+      if (retired.epoch < oldest) {
+        reclaimable.push_back(std::move(retired.reclaim));
+      } else {
+        remaining.push_back(std::move(retired));
+      }
+    }
+    _retired.swap(remaining);
+    _pendingCount -= reclaimable.size();
+  }
+
+  for (auto &reclaim : reclaimable) {
+    reclaim();
+  }
+  _reclaimedCount += reclaimable.size();
+
+  return reclaimable.size();
+}
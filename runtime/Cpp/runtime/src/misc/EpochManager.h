@@ -0,0 +1,150 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "antlr4-common.h"
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+namespace misc {
+
+  /// <summary>
+  /// Epoch based reclamation for data which is read without locks by several threads, like the states of a
+  /// shared DFA. Readers announce that they might hold pointers into such data by entering a critical section
+  /// (see Guard), which costs an atomic store and a memory fence. A writer which unlinks an object doesn't delete it but
+  /// hands it to retire(). It is deleted once all readers which were in a critical section at that time have
+  /// left it. Readers which enter later cannot reach the object anymore.
+  /// <p/>
+  /// Each reading thread needs its own Participant. The ATN simulators own one each (a recognizer is only
+  /// used by one thread at a time), so this works without thread local storage.
+  /// </summary>
+  class ANTLR4CPP_PUBLIC EpochManager {
+  public:
+    class ANTLR4CPP_PUBLIC Participant {
+    public:
+      Participant(EpochManager &manager = EpochManager::getDefault());
+      ~Participant();
+
+      Participant(const Participant &) = delete;
+      Participant& operator = (const Participant &) = delete;
+
+      /// Critical sections can be nested, only the outermost one counts.
+      void enter();
+      void leave();
+      bool isActive() const;
+
+    private:
+      friend class EpochManager;
+
+      struct Slot {
+        std::atomic<uint64_t> epoch; // 0 while not in a critical section.
+        char padding[64 - sizeof(std::atomic<uint64_t>)]; // Keep the slots of different threads on different cache lines.
+      };
+
+      EpochManager &_manager;
+      Slot *_slot;
+      size_t _nesting;
+    };
+
+    /// Keeps a participant in a critical section for the lifetime of the guard.
+    class ANTLR4CPP_PUBLIC Guard {
+    public:
+      Guard(Participant &participant) : _participant(participant) {
+        _participant.enter();
+      };
+      ~Guard() {
+        _participant.leave();
+      };
+
+    private:
+      Participant &_participant;
+    };
+
+    EpochManager();
+
+    /// Reclaims all objects which are still pending. No participant may be in a critical section anymore.
+    virtual ~EpochManager();
+
+    /// The manager used by the runtime. It lives until the process ends.
+    static EpochManager& getDefault();
+
+    /// Schedules the reclaim function to run once no reader can use the retired data anymore. The data must
+    /// have been unlinked already (no new reader can find it).
+    void retire(std::function<void ()> reclaim);
+
+    template<typename T>
+    void retire(T *object) {
+      retire([object]() { delete object; });
+    }
+
+    /// Runs the reclaim functions which are safe to run now. Returns how many ran.
+    /// This happens automatically when retiring data and when the last blocking reader leaves.
+    size_t collect();
+
+    uint64_t getEpoch() const;
+
+    /// The number of retired objects which are not yet reclaimed.
+    size_t getPendingCount() const;
+
+    /// The number of retired objects which have been reclaimed.
+    size_t getReclaimedCount() const;
+
+  private:
+    struct Retired {
+      uint64_t epoch;
+      std::function<void ()> reclaim;
+    };
+
+    std::atomic<uint64_t> _epoch;
+    std::atomic<uint64_t> _lastRetiredEpoch;
+    std::atomic<size_t> _pendingCount;
+    std::atomic<size_t> _reclaimedCount;
+
+    std::mutex _slotLock;
+    std::vector<Participant::Slot *> _slots; // All slots ever handed out. They are reused, but never freed before the manager.
+    std::vector<Participant::Slot *> _freeSlots;
+
+    std::mutex _retiredLock;
+    std::vector<Retired> _retired;
+
+    Participant::Slot* acquireSlot();
+    void releaseSlot(Participant::Slot *slot);
+    size_t collect(bool wait);
+  };
+
+} // namespace misc
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
@@ -481,9 +481,8 @@ size_t IntervalSet::size() const {
 std::vector<int> IntervalSet::toList() const {
   std::vector<int> result;
   for (auto &interval : _intervals) {
-    size_t a = (size_t)interval.a;
-    size_t b = (size_t)interval.b;
-    for (size_t v = a; v <= b; v++) {
+    // Signed, because sets can contain negative values (e.g. EOF).
+    for (ssize_t v = interval.a; v <= interval.b; v++) {
       result.push_back((int)v);
     }
   }
@@ -493,9 +492,8 @@ std::vector<int> IntervalSet::toList() const {
 std::set<int> IntervalSet::toSet() const {
   std::set<int> result;
   for (auto &interval : _intervals) {
-    size_t a = (size_t)interval.a;
-    size_t b = (size_t)interval.b;
-    for (size_t v = a; v <= b; v++) {
+    // Signed, because sets can contain negative values (e.g. EOF).
+    for (ssize_t v = interval.a; v <= interval.b; v++) {
       result.insert((int)v);
     }
   }
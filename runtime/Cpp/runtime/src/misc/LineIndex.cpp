@@ -0,0 +1,113 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "support/SIMD.h"
+
+#include "misc/LineIndex.h"
+
+using namespace org::antlr::v4::runtime::misc;
+using namespace antlrcpp;
+
+namespace {
+
+#ifdef ANTLR4CPP_USE_SSE2
+  // Adds a line start after each newline flagged in mask, where bit i stands for the char at base + i.
+  inline void addLineStarts(std::vector<size_t> &lineStarts, size_t base, unsigned int mask) {
+    for (; mask != 0; mask &= mask - 1) {
+      lineStarts.push_back(base + (size_t)countTrailingZeros(mask) + 1);
+    }
+  }
+#endif
+
+}
+
+LineIndex::LineIndex(const char *data, size_t size) {
+  _lineStarts.push_back(0);
+
+  size_t i = 0;
+#ifdef ANTLR4CPP_USE_SSE2
+  const __m128i newline = _mm_set1_epi8('\n');
+  for (; i + 16 <= size; i += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+    addLineStarts(_lineStarts, i, (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)));
+  }
+#endif
+
+  for (; i < size; ++i) {
+    if (data[i] == '\n') {
+      _lineStarts.push_back(i + 1);
+    }
+  }
+}
+
+LineIndex::LineIndex(const std::u32string &data) {
+  _lineStarts.push_back(0);
+
+  size_t i = 0;
+  size_t size = data.size();
+#ifdef ANTLR4CPP_USE_SSE2
+  const __m128i newline = _mm_set1_epi32('\n');
+  for (; i + 4 <= size; i += 4) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data.data() + i));
+    __m128i matches = _mm_cmpeq_epi32(chunk, newline);
+    addLineStarts(_lineStarts, i, (unsigned int)_mm_movemask_ps(_mm_castsi128_ps(matches)));
+  }
+#endif
+
+  for (; i < size; ++i) {
+    if (data[i] == '\n') {
+      _lineStarts.push_back(i + 1);
+    }
+  }
+}
+
+size_t LineIndex::getLineCount() const {
+  return _lineStarts.size();
+}
+
+size_t LineIndex::findLine(size_t index, size_t hint) const {
+  size_t count = _lineStarts.size();
+  if (hint < count && _lineStarts[hint] <= index) {
+    if (hint + 1 == count || index < _lineStarts[hint + 1]) {
+      return hint;
+    }
+    if (hint + 2 == count || index < _lineStarts[hint + 2]) {
+      return hint + 1;
+    }
+  }
+
+  // The first line start after index, minus one.
+  return (size_t)(std::upper_bound(_lineStarts.begin(), _lineStarts.end(), index) - _lineStarts.begin()) - 1;
+}
+
+size_t LineIndex::getLineStart(size_t line) const {
+  return _lineStarts[line];
+}
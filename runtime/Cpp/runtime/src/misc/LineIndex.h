@@ -0,0 +1,73 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "antlr4-common.h"
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+namespace misc {
+
+  /// The start indexes of all lines of an input, found with a single (vectorized) scan for newlines. This allows
+  /// to compute line and column of any char index on demand, instead of tracking them char by char while lexing.
+  /// See LexerATNSimulator::setLazyLineTracking.
+  class ANTLR4CPP_PUBLIC LineIndex {
+  public:
+    /// Indexes 8 bit input (one char per byte).
+    LineIndex(const char *data, size_t size);
+
+    /// Indexes UTF-32 input.
+    LineIndex(const std::u32string &data);
+
+    virtual ~LineIndex() {};
+
+    /// The number of lines (at least 1, even for empty input).
+    size_t getLineCount() const;
+
+    /// Returns the 0-based line which contains the char with the given index. Lookups for increasing indexes
+    /// (as done by a lexer) are O(1) if the result of the previous lookup is passed in as hint.
+    size_t findLine(size_t index, size_t hint = 0) const;
+
+    /// The index of the first char of the given 0-based line.
+    size_t getLineStart(size_t line) const;
+
+  private:
+    std::vector<size_t> _lineStarts;
+  };
+
+} // namespace misc
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
@@ -0,0 +1,109 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "CommonTokenStream.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "ParserInterpreter.h"
+#include "ParserRuleContext.h"
+#include "support/CPPUtils.h"
+
+#include "misc/RecognizerDriver.h"
+
+using namespace org::antlr::v4::runtime;
+using namespace org::antlr::v4::runtime::misc;
+using namespace antlrcpp;
+
+RecognizerDriver::RecognizerDriver(LexerFactory lexerFactory, ParserFactory parserFactory, RuleInvoker ruleInvoker)
+  : _ruleInvoker(ruleInvoker) {
+  _lexer = lexerFactory(&_input);
+  _tokens.reset(new CommonTokenStream(_lexer.get()));
+  if (parserFactory) {
+    _parser = parserFactory(_tokens.get());
+  }
+}
+
+RecognizerDriver::~RecognizerDriver() {
+}
+
+ANTLRInputStream& RecognizerDriver::getInput() {
+  return _input;
+}
+
+CommonTokenStream& RecognizerDriver::getTokens() {
+  return *_tokens;
+}
+
+Lexer* RecognizerDriver::getLexer() const {
+  return _lexer.get();
+}
+
+Parser* RecognizerDriver::getParser() const {
+  return _parser.get();
+}
+
+void RecognizerDriver::load(const std::string &text, const std::string &sourceName) {
+  _input.load(text);
+  _input.name = sourceName;
+}
+
+void RecognizerDriver::lex() {
+  _lexer->setInputStream(&_input);
+  _tokens->setTokenSource(_lexer.get());
+  _tokens->fill();
+
+  if (_parser != nullptr) {
+    _parser->setTokenStream(_tokens.get());
+  }
+}
+
+ssize_t RecognizerDriver::getRuleIndex(const std::string &ruleName) const {
+  if (_parser == nullptr) {
+    return -1;
+  }
+
+  std::map<std::string, size_t> ruleIndexMap = _parser->getRuleIndexMap();
+  auto iterator = ruleIndexMap.find(ruleName);
+  if (iterator == ruleIndexMap.end()) {
+    return -1;
+  }
+  return (ssize_t)iterator->second;
+}
+
+Ref<ParserRuleContext> RecognizerDriver::parse(size_t ruleIndex) {
+  if (_ruleInvoker) {
+    return _ruleInvoker(_parser.get(), ruleIndex);
+  }
+  if (is<ParserInterpreter *>(_parser.get())) {
+    return static_cast<ParserInterpreter *>(_parser.get())->parse((int)ruleIndex);
+  }
+  return nullptr;
+}
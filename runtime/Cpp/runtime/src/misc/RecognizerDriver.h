@@ -0,0 +1,101 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "ANTLRInputStream.h"
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+namespace misc {
+
+  /// <summary>
+  /// Runs inputs through a lexer/parser combo which is created by factories, for tools like TestRig and
+  /// dfa::DFAWarmer. The recognizers are created once and then reused for all inputs, so their DFA stays warm.
+  /// The driver owns the input and token streams the recognizers work on, and each input is loaded into the same
+  /// input stream. That keeps the streams alive as long as the recognizers which refer to them (switching to the
+  /// next input resets the current input stream, for instance).
+  ///
+  /// Error listeners or other objects attached to the recognizers must outlive the driver.
+  /// </summary>
+  class ANTLR4CPP_PUBLIC RecognizerDriver {
+  public:
+    typedef std::function<Ref<Lexer> (CharStream *input)> LexerFactory;
+    typedef std::function<Ref<Parser> (TokenStream *input)> ParserFactory;
+
+    /// Invokes the rule with the given index on the parser and returns the resulting tree or nullptr
+    /// if the rule cannot be invoked. Not needed for parser interpreters.
+    typedef std::function<Ref<ParserRuleContext> (Parser *parser, size_t ruleIndex)> RuleInvoker;
+
+    /// Creates the recognizers (the parser only if there's a factory for it), so they can be configured before
+    /// the first input is processed.
+    RecognizerDriver(LexerFactory lexerFactory, ParserFactory parserFactory = nullptr, RuleInvoker ruleInvoker = nullptr);
+    virtual ~RecognizerDriver();
+
+    RecognizerDriver(const RecognizerDriver &) = delete;
+    RecognizerDriver& operator = (const RecognizerDriver &) = delete;
+
+    ANTLRInputStream& getInput();
+    CommonTokenStream& getTokens();
+    Lexer* getLexer() const;
+
+    /// nullptr if there's no parser factory.
+    Parser* getParser() const;
+
+    /// Makes the given text the current input.
+    void load(const std::string &text, const std::string &sourceName);
+
+    /// Tokenizes the current input from its start and resets the parser (if any) to the resulting tokens.
+    void lex();
+
+    /// The index of the parser rule with the given name, or -1 if there is no parser or no such rule.
+    ssize_t getRuleIndex(const std::string &ruleName) const;
+
+    /// Runs the parser rule with the given index on the tokens of the last lex() call. Returns nullptr if the
+    /// rule cannot be invoked (no rule invoker and the parser is not a ParserInterpreter).
+    Ref<ParserRuleContext> parse(size_t ruleIndex);
+
+  private:
+    // Declaration order matters: the recognizers refer to the streams.
+    ANTLRInputStream _input;
+    std::unique_ptr<CommonTokenStream> _tokens;
+    Ref<Lexer> _lexer;
+    Ref<Parser> _parser;
+    RuleInvoker _ruleInvoker;
+  };
+
+} // namespace misc
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
@@ -29,208 +29,390 @@
  *  THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include "CommonTokenStream.h"
+#include "DiagnosticErrorListener.h"
+#include "Lexer.h"
+#include "LexerInterpreter.h"
+#include "Parser.h"
+#include "ParserInterpreter.h"
+#include "ParserRuleContext.h"
+#include "Token.h"
+#include "atn/LexerATNSimulator.h"
+#include "atn/ParserATNSimulator.h"
+#include "atn/PredictionMode.h"
+#include "atn/PredictionDiagnostics.h"
+#include "atn/DecisionReport.h"
+#include "dfa/DFA.h"
+#include "tree/ParseTreeListener.h"
+#include "tree/ParseTreeWalker.h"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+
+#ifdef _WIN32
+  #ifndef NOMINMAX
+    #define NOMINMAX // Keep std::min/std::max usable.
+  #endif
+  #include <windows.h>
+  #include <psapi.h>
+  #pragma comment(lib, "psapi.lib")
+#else
+  #include <sys/resource.h>
+#endif
+
 #include "misc/TestRig.h"
 
+using namespace org::antlr::v4::runtime;
 using namespace org::antlr::v4::runtime::misc;
+using namespace antlrcpp;
+
+namespace {
+
+  // Visits every node without doing anything, to measure the cost of a tree walk.
+  class NullListener : public tree::ParseTreeListener {
+  public:
+    virtual void visitTerminal(Ref<tree::TerminalNode> /*node*/) override {};
+    virtual void visitErrorNode(Ref<tree::ErrorNode> /*node*/) override {};
+    virtual void enterEveryRule(Ref<ParserRuleContext> /*ctx*/) override {};
+    virtual void exitEveryRule(Ref<ParserRuleContext> /*ctx*/) override {};
+  };
+
+  double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  size_t countStates(const std::vector<dfa::DFA> &decisionToDFA) {
+    size_t result = 0;
+    for (auto &dfa : decisionToDFA) {
+      result += dfa.states.size();
+    }
+    return result;
+  }
+
+  // The peak resident memory of the process in KB (0 if unknown).
+  size_t peakMemory() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+      return counters.PeakWorkingSetSize / 1024;
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+      return 0;
+    }
+  #ifdef __APPLE__
+    return (size_t)usage.ru_maxrss / 1024; // Bytes on OS X.
+  #else
+    return (size_t)usage.ru_maxrss;
+  #endif
+#endif
+  }
+
+}
 
-#ifdef TODO
 const std::string TestRig::LEXER_START_RULE_NAME = "tokens";
 
-TestRig::TestRig(std::string args[]) throw(std::exception) : inputFiles(new java::util::ArrayList<String>()) {
+TestRig::TestRig(const std::vector<std::string> &args, LexerFactory lexerFactory, ParserFactory parserFactory,
+                 RuleInvoker ruleInvoker, std::ostream &output, std::ostream &errorOutput)
+  : lexerFactory(lexerFactory), parserFactory(parserFactory), ruleInvoker(ruleInvoker), output(output),
+    errorOutput(errorOutput) {
+
   InitializeInstanceFields();
-  if (sizeof(args) / sizeof(args[0]) < 2) {
-    System::err::println(std::string("java org.antlr.v4.runtime.misc.TestRig GrammarName startRuleName\n") + std::string("  [-tokens] [-tree] [-gui] [-ps file.ps] [-encoding encodingname]\n") + std::string("  [-trace] [-diagnostics] [-SLL]\n") + std::string("  [input-filename(s)]"));
-    System::err::println("Use startRuleName='tokens' if GrammarName is a lexer grammar.");
-    System::err::println("Omitting input-filename makes rig read from stdin.");
+
+  if (args.empty()) {
+    errorOutput << "driver startRuleName" << std::endl
+      << "  [-tokens] [-tree] [-trace] [-diagnostics] [-decisions] [-profile] [-SLL]" << std::endl
+      << "  [-repeat N] [-cold] [-benchmark]" << std::endl
+      << "  [input-filename(s)]" << std::endl;
+    errorOutput << "Use startRuleName='tokens' if the grammar is a lexer grammar." << std::endl;
+    errorOutput << "Omitting input-filename makes rig read from stdin." << std::endl;
     return;
   }
-  int i = 0;
-  grammarName = args[i];
-  i++;
-  startRuleName = args[i];
-  i++;
-  while (i < sizeof(args) / sizeof(args[0])) {
-    std::string arg = args[i];
-    i++;
-    if (arg[0] != '-') { // input file name
+
+  size_t i = 0;
+  startRuleName = args[i++];
+  while (i < args.size()) {
+    const std::string &arg = args[i++];
+    if (arg.empty() || arg[0] != '-') { // input file name
       inputFiles.push_back(arg);
       continue;
     }
+
     if (arg == "-tree") {
       printTree = true;
-    }
-    if (arg == "-gui") {
-      gui = true;
-    }
-    if (arg == "-tokens") {
+    } else if (arg == "-tokens") {
       showTokens = true;
     } else if (arg == "-trace") {
       trace = true;
-    } else if (arg == "-SL") {
+    } else if (arg == "-SLL") {
       SLL = true;
     } else if (arg == "-diagnostics") {
       diagnostics = true;
-    } else if (arg == "-encoding") {
-      if (i >= sizeof(args) / sizeof(args[0])) {
-        System::err::println("missing encoding on -encoding");
+    } else if (arg == "-decisions") {
+      decisions = true;
+    } else if (arg == "-profile") {
+      profile = true;
+    } else if (arg == "-cold") {
+      cold = true;
+    } else if (arg == "-benchmark") {
+      benchmark = true;
+    } else if (arg == "-repeat") {
+      if (i >= args.size()) {
+        errorOutput << "missing count on -repeat" << std::endl;
         return;
       }
-      encoding = args[i];
-      i++;
-    } else if (arg == "-ps") {
-      if (i >= sizeof(args) / sizeof(args[0])) {
-        System::err::println("missing filename on -ps");
+      char *end;
+      repeat = (size_t)strtoul(args[i].c_str(), &end, 10);
+      if (*end != '\0' || repeat == 0) {
+        errorOutput << "invalid count on -repeat: " << args[i] << std::endl;
         return;
       }
-      psFile = args[i];
       i++;
+    } else {
+      errorOutput << "unknown option " << arg << std::endl;
+      return;
     }
   }
+
+  if (startRuleName != LEXER_START_RULE_NAME && !parserFactory) {
+    errorOutput << "No parser available for start rule " << startRuleName << std::endl;
+    return;
+  }
+
+  _valid = true;
 }
 
-void TestRig::main(std::string args[]) throw(std::exception) {
-  TestRig *testRig = new TestRig(args);
-  if (sizeof(args) / sizeof(args[0]) >= 2) {
-    testRig->process();
+int TestRig::main(int argc, const char *argv[], LexerFactory lexerFactory, ParserFactory parserFactory,
+                  RuleInvoker ruleInvoker) {
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; ++i) {
+    args.push_back(argv[i]);
+  }
+
+  TestRig rig(args, lexerFactory, parserFactory, ruleInvoker);
+  if (!rig.isValid()) {
+    return 1;
   }
+  return rig.process();
 }
 
-void TestRig::process() throw(std::exception) {
-  //		System.out.println("exec "+grammarName+"."+startRuleName);
-  std::string lexerName = grammarName + std::string("Lexer");
-  ClassLoader *cl = Thread::currentThread()->getContextClassLoader();
-  Class *lexerClass = nullptr;
-  try {
-    lexerClass = cl->loadClass(lexerName)->asSubclass(Lexer::typeid);
-  } catch (java::lang::ClassNotFoundException cnfe) {
-    // might be pure lexer grammar; no Lexer suffix then
-    lexerName = grammarName;
-    try {
-      lexerClass = cl->loadClass(lexerName)->asSubclass(Lexer::typeid);
-    } catch (ClassNotFoundException cnfe2) {
-      System::err::println(std::string("Can't load ") + lexerName + std::string(" as lexer or parser"));
-      return;
-    }
+TestRig::LexerFactory TestRig::createLexerInterpreterFactory(const std::string &grammarFileName,
+  Ref<dfa::Vocabulary> vocabulary, const std::vector<std::string> &ruleNames, const std::vector<std::string> &modeNames,
+  const atn::ATN &atn) {
+  const atn::ATN *grammarATN = &atn;
+  return [=](CharStream *input) {
+    return std::make_shared<LexerInterpreter>(grammarFileName, vocabulary, ruleNames, modeNames, *grammarATN, input);
+  };
+}
+
+TestRig::ParserFactory TestRig::createParserInterpreterFactory(const std::string &grammarFileName,
+  Ref<dfa::Vocabulary> vocabulary, const std::vector<std::string> &ruleNames, const atn::ATN &atn) {
+  const atn::ATN *grammarATN = &atn;
+  return [=](TokenStream *input) {
+    return std::make_shared<ParserInterpreter>(grammarFileName, vocabulary, ruleNames, *grammarATN, input);
+  };
+}
+
+bool TestRig::isValid() const {
+  return _valid;
+}
+
+int TestRig::process() {
+  if (!_valid) {
+    return 1;
   }
 
-  //JAVA TO C++ CONVERTER TODO TASK: Java wildcard generics are not converted to C++:
-  //ORIGINAL LINE: Constructor<? extends org.antlr.v4.runtime.Lexer> lexerCtor = lexerClass.getConstructor(org.antlr.v4.runtime.CharStream.class);
-  Constructor<? extends Lexer> *lexerCtor = lexerClass->getConstructor(CharStream::typeid);
-  Lexer *lexer = lexerCtor->newInstance(static_cast<CharStream*>(nullptr));
+  // The recognizers are reused for all inputs, so their DFA stays warm between runs.
+  // Declared first, so the listener outlives the parser.
+  DiagnosticErrorListener diagnosticListener;
+  Ref<atn::PredictionDiagnostics> predictionDiagnostics;
+  RecognizerDriver driver(lexerFactory, startRuleName != LEXER_START_RULE_NAME ? parserFactory : nullptr, ruleInvoker);
+  Lexer *lexer = driver.getLexer();
+  Parser *parser = driver.getParser();
 
-  Class *parserClass = nullptr;
-  Parser *parser = nullptr;
-  if (startRuleName != LEXER_START_RULE_NAME) {
-    std::string parserName = grammarName + std::string("Parser");
-    parserClass = cl->loadClass(parserName)->asSubclass(Parser::typeid);
-    if (parserClass == nullptr) {
-      System::err::println(std::string("Can't load ") + parserName);
+  if (parser != nullptr) {
+    if (diagnostics) {
+      parser->addErrorListener(&diagnosticListener);
+      parser->getInterpreter<atn::ParserATNSimulator>()->setPredictionMode(atn::PredictionMode::LL_EXACT_AMBIG_DETECTION);
+    }
+    if (SLL) { // overrides diagnostics
+      parser->getInterpreter<atn::ParserATNSimulator>()->setPredictionMode(atn::PredictionMode::SLL);
+    }
+    parser->setBuildParseTree(true);
+    parser->setProfile(profile);
+    if (decisions) {
+      predictionDiagnostics = std::make_shared<atn::PredictionDiagnostics>(parser->getATN());
+      parser->getInterpreter<atn::ParserATNSimulator>()->setDiagnostics(predictionDiagnostics);
     }
-    //JAVA TO C++ CONVERTER TODO TASK: Java wildcard generics are not converted to C++:
-    //ORIGINAL LINE: Constructor<? extends org.antlr.v4.runtime.Parser> parserCtor = parserClass.getConstructor(org.antlr.v4.runtime.TokenStream.class);
-    Constructor<? extends Parser> *parserCtor = parserClass->getConstructor(TokenStream::typeid);
-    parser = parserCtor->newInstance(static_cast<TokenStream*>(nullptr));
   }
 
-  if (inputFiles.empty()) {
-    InputStream *is = System::in;
-    Reader *r;
-    if (encoding != "") {
-      r = new InputStreamReader(is, encoding);
+  std::vector<std::string> sources = inputFiles;
+  if (sources.empty()) {
+    sources.push_back(""); // stdin
+  }
+
+  bool failed = false;
+  for (auto &source : sources) {
+    std::string text;
+    if (source.empty()) {
+      text.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
     } else {
-      r = new InputStreamReader(is);
+      std::ifstream stream(source, std::ios::binary);
+      if (!stream) {
+        errorOutput << "Can't open " << source << std::endl;
+        failed = true;
+        continue;
+      }
+      text.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+      if (inputFiles.size() > 1) {
+        errorOutput << source << std::endl;
+      }
     }
 
-    process(lexer, parserClass, parser, is, r);
-    return;
-  }
-  for (auto inputFile : inputFiles) {
-    InputStream *is = System::in;
-    if (inputFile != nullptr) {
-      is = new FileInputStream(inputFile);
+    driver.load(text, source.empty() ? "<stdin>" : source);
+
+    std::vector<Timing> timings;
+    for (size_t run = 0; run < repeat; ++run) {
+      if (cold) {
+        lexer->getInterpreter<atn::LexerATNSimulator>()->clearDFA();
+        if (parser != nullptr) {
+          parser->getInterpreter<atn::ParserATNSimulator>()->clearDFA();
+        }
+      }
+
+      Timing timing;
+      if (!process(driver, run == 0, timing)) {
+        failed = true;
+        break;
+      }
+      if (run == 0 && parser != nullptr && parser->getNumberOfSyntaxErrors() > 0) {
+        failed = true;
+      }
+      timings.push_back(timing);
     }
-    Reader *r;
-    if (encoding != "") {
-      r = new InputStreamReader(is, encoding);
-    } else {
-      r = new InputStreamReader(is);
+
+    if (benchmark && !timings.empty()) {
+      printBenchmark(driver.getInput().getSourceName(), lexer, parser, timings, driver.getTokens().size());
     }
 
-    if (inputFiles.size() > 1) {
-      System::err::println(inputFile);
+    if (profile && parser != nullptr) {
+      // The examples in the report refer to the current token stream content, so print it now and start
+      // over for the next input (switching profiling off and on again creates a new profiling simulator).
+      output << "decisions of " << driver.getInput().getSourceName() << ":" << std::endl;
+      output << atn::DecisionReport(parser).toString();
+      parser->setProfile(false);
+      parser->setProfile(true);
+      parser->getInterpreter<atn::ParserATNSimulator>()->setDiagnostics(predictionDiagnostics);
     }
-    process(lexer, parserClass, parser, is, r);
   }
-}
 
-void TestRig::process(Lexer *lexer, Class *parserClass, Parser *parser, InputStream *is, Reader *r) throw(IOException, IllegalAccessException, InvocationTargetException, PrintException) {
-  try {
-    ANTLRInputStream *input = new ANTLRInputStream(r);
-    lexer->setInputStream(input);
-    CommonTokenStream *tokens = new CommonTokenStream(lexer);
+  if (predictionDiagnostics != nullptr) {
+    output << predictionDiagnostics->toString(parser->getRuleNames());
+  }
 
-    tokens->fill();
+  return failed ? 1 : 0;
+}
 
-    if (showTokens) {
-      for (auto tok : tokens->getTokens()) {
-        std::cout << tok << std::endl;
-      }
-    }
+bool TestRig::process(RecognizerDriver &driver, bool isFirstRun, Timing &timing) {
+  auto start = std::chrono::steady_clock::now();
+  driver.lex();
+  timing.lex = millisecondsSince(start);
 
-    if (startRuleName == LEXER_START_RULE_NAME) {
-      return;
+  if (showTokens && isFirstRun) {
+    for (auto &token : driver.getTokens().getTokens()) {
+      output << token->toString() << std::endl;
     }
+  }
 
-    if (diagnostics) {
-      parser->addErrorListener(new DiagnosticErrorListener());
-      parser->getInterpreter()->setPredictionMode(PredictionMode::LL_EXACT_AMBIG_DETECTION);
-    }
+  if (startRuleName == LEXER_START_RULE_NAME) {
+    return true;
+  }
 
-    if (printTree || gui || psFile != "") {
-      parser->setBuildParseTree(true);
-    }
+  ssize_t ruleIndex = driver.getRuleIndex(startRuleName);
+  if (ruleIndex < 0) {
+    errorOutput << "No rule " << startRuleName << std::endl;
+    return false;
+  }
 
-    if (SLL) { // overrides diagnostics
-      parser->getInterpreter()->setPredictionMode(PredictionMode::SLL);
-    }
+  Parser *parser = driver.getParser();
+  parser->setTrace(trace && isFirstRun);
 
-    parser->setTokenStream(tokens);
-    parser->setTrace(trace);
+  start = std::chrono::steady_clock::now();
+  Ref<ParserRuleContext> tree = driver.parse((size_t)ruleIndex);
+  timing.parse = millisecondsSince(start);
 
-    try {
-      Method *startRule = parserClass->getMethod(startRuleName);
-      ParserRuleContext *tree = static_cast<ParserRuleContext*>(startRule->invoke(parser, static_cast<Object[]>(nullptr)));
+  if (tree == nullptr) {
+    errorOutput << "No method for rule " << startRuleName << " or it has arguments" << std::endl;
+    return false;
+  }
 
-      if (printTree) {
-        std::cout << tree->toStringTree(parser) << std::endl;
-      }
-      if (gui) {
-        tree->inspect(parser);
-      }
-      if (psFile != "") {
-        tree->save(parser, psFile); // Generate postscript
-      }
-    } catch (NoSuchMethodException nsme) {
-      System::err::println(std::string("No method for rule ") + startRuleName + std::string(" or it has arguments"));
-    }
-  } finally {
-    if (r != nullptr) {
-      r->close();
-    }
-    if (is != nullptr) {
-      is->close();
-    }
+  if (printTree && isFirstRun) {
+    output << tree->toStringTree(parser) << std::endl;
+  }
+
+  if (benchmark) {
+    start = std::chrono::steady_clock::now();
+    tree::ParseTreeWalker::DEFAULT->walk(std::make_shared<NullListener>(), tree);
+    timing.walk = millisecondsSince(start);
   }
+
+  return true;
+}
+
+void TestRig::printBenchmark(const std::string &sourceName, Lexer *lexer, Parser *parser,
+                             const std::vector<Timing> &timings, size_t tokenCount) {
+  Timing best = timings[0];
+  Timing total;
+  for (auto &timing : timings) {
+    best.lex = std::min(best.lex, timing.lex);
+    best.parse = std::min(best.parse, timing.parse);
+    best.walk = std::min(best.walk, timing.walk);
+    total.lex += timing.lex;
+    total.parse += timing.parse;
+    total.walk += timing.walk;
+  }
+  double count = (double)timings.size();
+
+  output << sourceName << ": " << tokenCount << " tokens, " << timings.size() << " run(s), "
+    << (cold ? "cold" : "warm") << " DFA" << std::endl;
+  output << std::fixed << std::setprecision(3);
+  output << "  phase        first         best      average (ms)" << std::endl;
+  auto printPhase = [&](const char *name, double first, double min, double sum) {
+    output << "  " << std::left << std::setw(6) << name << std::right << std::setw(12) << first
+      << std::setw(13) << min << std::setw(13) << sum / count << std::endl;
+  };
+  printPhase("lex", timings[0].lex, best.lex, total.lex);
+  if (parser != nullptr) {
+    printPhase("parse", timings[0].parse, best.parse, total.parse);
+    printPhase("walk", timings[0].walk, best.walk, total.walk);
+  }
+
+  double bestRun = best.lex + best.parse;
+  if (bestRun > 0) {
+    output << std::setprecision(0) << "  throughput: " << (double)tokenCount / bestRun * 1000 << " tokens/s" << std::endl;
+  }
+  output << "  DFA states: lexer " << countStates(lexer->getInterpreter<atn::LexerATNSimulator>()->_decisionToDFA);
+  if (parser != nullptr) {
+    output << ", parser " << countStates(parser->getInterpreter<atn::ParserATNSimulator>()->decisionToDFA);
+  }
+  output << std::endl;
+  output << "  peak memory: " << peakMemory() << " KB" << std::endl;
+  output.unsetf(std::ios::floatfield);
 }
 
 void TestRig::InitializeInstanceFields() {
   printTree = false;
-  gui = false;
-  psFile = "";
   showTokens = false;
   trace = false;
   diagnostics = false;
-  encoding = "";
+  decisions = false;
+  profile = false;
   SLL = false;
+  cold = false;
+  benchmark = false;
+  repeat = 1;
+  _valid = false;
 }
-#endif
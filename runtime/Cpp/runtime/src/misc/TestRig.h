@@ -31,7 +31,7 @@
 
 #pragma once
 
-#include "antlr4-common.h"
+#include "misc/RecognizerDriver.h"
 
 namespace org {
 namespace antlr {
@@ -40,52 +40,115 @@ namespace runtime {
 namespace misc {
 
   /// <summary>
-  /// Run a lexer/parser combo, optionally printing tree string or generating
-  ///  postscript file. Optionally taking input file.
+  /// Run a lexer/parser combo, optionally printing the tokens or the tree string and measuring
+  /// how long each phase takes. Optionally taking input files, otherwise reads stdin.
   ///
-  ///  $ java org.antlr.v4.runtime.misc.TestRig GrammarName startRuleName
-  ///        [-tree]
-  ///        [-tokens] [-gui] [-ps file.ps]
-  ///        [-trace]
-  ///        [-diagnostics]
-  ///        [-SLL]
+  /// The C++ runtime cannot load recognizers by name, so the rig is given factories for them (see RecognizerDriver). These
+  /// can create generated recognizers linked into the driver or interpreters for a deserialized ATN
+  /// (see createLexerInterpreterFactory and createParserInterpreterFactory). A driver is then just:
+  ///
+  /// <pre>
+  /// int main(int argc, const char *argv[]) {
+  ///   return TestRig::main(argc, argv,
+  ///     [](CharStream *input) { return std::make_shared<MyLexer>(input); },
+  ///     [](TokenStream *input) { return std::make_shared<MyParser>(input); },
+  ///     [](Parser *parser, size_t ruleIndex) -> Ref<ParserRuleContext> {
+  ///       switch (ruleIndex) {
+  ///         case MyParser::RuleProg: return static_cast<MyParser *>(parser)->prog();
+  ///         default: return nullptr;
+  ///       }
+  ///     });
+  /// }
+  ///
+  ///  $ driver startRuleName
+  ///        [-tokens] [-tree] [-trace] [-diagnostics] [-decisions] [-profile] [-SLL]
+  ///        [-repeat N] [-cold] [-benchmark]
   ///        [input-filename(s)]
+  /// </pre>
+  ///
+  /// -repeat N processes each input N times with the same recognizers, so later runs use the DFA
+  /// built by earlier ones (warm). With -cold the DFA is cleared before each run. -benchmark prints
+  /// per phase timing (lex, parse, walk), the token throughput, the DFA size and the peak memory use.
+  /// -decisions prints the decisions which caused SLL conflicts, LL fallbacks or ambiguities (see
+  /// atn::PredictionDiagnostics) after all input was processed. -profile prints the decisions of each input
+  /// ranked by prediction time (see atn::DecisionReport).
+  ///
+  /// The rig is not part of the runtime library. Link the antlr4_testrig library (CMake) or compile TestRig.cpp
+  /// into the driver.
   /// </summary>
+
   class ANTLR4CPP_PUBLIC TestRig {
   public:
     static const std::string LEXER_START_RULE_NAME;
 
+    typedef RecognizerDriver::LexerFactory LexerFactory;
+    typedef RecognizerDriver::ParserFactory ParserFactory;
+    typedef RecognizerDriver::RuleInvoker RuleInvoker;
+
+    /// The arguments don't include the program name. The parser factory can be empty if only the
+    /// lexer is used (start rule "tokens"). Tokens, trees and reports are written to output, usage and
+    /// error messages to errorOutput.
+    TestRig(const std::vector<std::string> &args, LexerFactory lexerFactory, ParserFactory parserFactory = nullptr,
+            RuleInvoker ruleInvoker = nullptr, std::ostream &output = std::cout, std::ostream &errorOutput = std::cerr);
     virtual ~TestRig() {};
 
+    /// Parses the command line and runs the rig. Returns the exit code for the process.
+    static int main(int argc, const char *argv[], LexerFactory lexerFactory, ParserFactory parserFactory = nullptr,
+                    RuleInvoker ruleInvoker = nullptr);
+
+    /// Factories for interpreters of a deserialized ATN. The ATN must outlive the rig.
+    static LexerFactory createLexerInterpreterFactory(const std::string &grammarFileName, Ref<dfa::Vocabulary> vocabulary,
+      const std::vector<std::string> &ruleNames, const std::vector<std::string> &modeNames, const atn::ATN &atn);
+    static ParserFactory createParserInterpreterFactory(const std::string &grammarFileName, Ref<dfa::Vocabulary> vocabulary,
+      const std::vector<std::string> &ruleNames, const atn::ATN &atn);
+
+    /// False if the arguments couldn't be parsed. The usage has been printed then.
+    bool isValid() const;
+
+    /// Processes all input files (or stdin). Returns 0 if there were no syntax errors.
+    virtual int process();
+
   protected:
-    std::string grammarName;
+    struct Timing {
+      double lex = 0;
+      double parse = 0;
+      double walk = 0;
+    };
+
     std::string startRuleName;
-    const std::vector<std::string> inputFiles;
+    std::vector<std::string> inputFiles;
     bool printTree;
-    bool gui;
-    std::string psFile;
     bool showTokens;
     bool trace;
     bool diagnostics;
-    std::string encoding;
+    bool decisions;
+    bool profile;
     bool SLL;
+    bool cold;
+    bool benchmark;
+    size_t repeat;
 
-  public:
-    TestRig(std::string args[]);
+    LexerFactory lexerFactory;
+    ParserFactory parserFactory;
+    RuleInvoker ruleInvoker;
 
-    static void main(std::string args[]);
+    std::ostream &output;
+    std::ostream &errorOutput;
 
-    virtual void process();
+    /// Runs the current input of the driver once through lexer and parser (if any). Returns false if the start rule
+    /// could not be run.
+    virtual bool process(RecognizerDriver &driver, bool isFirstRun, Timing &timing);
+
+    virtual void printBenchmark(const std::string &sourceName, Lexer *lexer, Parser *parser,
+                                const std::vector<Timing> &timings, size_t tokenCount);
 
-  protected:
-#ifdef TODO
-    virtual void process(Lexer *lexer, Class *parserClass, Parser *parser, InputStream *is, Reader *r) throw(IOException, IllegalAccessException, InvocationTargetException, PrintException);
-#endif
   private:
+    bool _valid;
+
     void InitializeInstanceFields();
   };
 
-} // namespace atn
+} // namespace misc
 } // namespace runtime
 } // namespace v4
 } // namespace antlr
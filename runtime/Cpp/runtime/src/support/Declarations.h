@@ -58,7 +58,9 @@ namespace org {
         class BailErrorStrategy;
         class BaseErrorListener;
         class BufferedTokenStream;
+        class ByteCharStream;
         class CharStream;
+        class CodeCompletionCore;
         class CommonToken;
         class CommonTokenFactory;
         class CommonTokenStream;
@@ -92,10 +94,13 @@ namespace org {
         class WritableToken;
 
         namespace misc {
+          class EpochManager;
           class Interval;
           class IntervalSet;
+          class LineIndex;
           class MurmurHash;
           class ParseCancellationException;
+          class RecognizerDriver;
           class Utils;
           template <typename T> class Predicate;
         }
@@ -119,6 +124,8 @@ namespace org {
           class BlockEndState;
           class BlockStartState;
           class ConfigLookup;
+          class ConflictAnalysis;
+          class DecisionReport;
           class DecisionState;
           class EmptyPredictionContext;
           class EpsilonTransition;
@@ -141,6 +148,8 @@ namespace org {
           class PrecedencePredicateTransition;
           class PredicateTransition;
           class PredictionContext;
+          class PredictionContextCache;
+          class PredictionDiagnostics;
           enum class PredictionMode;
           class PredictionModeClass;
           class RangeTransition;
@@ -159,7 +168,9 @@ namespace org {
         }
         namespace dfa {
           class DFA;
+          class DFAMemoryBudget;
           class DFASerializer;
+          class DFAWarmer;
           class DFAState;
           class LexerDFASerializer;
           class Vocabulary;
@@ -185,12 +196,25 @@ namespace org {
             class ParseTreeMatch;
             class ParseTreePattern;
             class ParseTreePatternMatcher;
+            class ParseTreePatternSet;
             class RuleTagToken;
             class TagChunk;
             class TextChunk;
             class TokenTagToken;
           }
 
+          namespace xpath {
+            class XPath;
+            class XPathElement;
+            class XPathIndex;
+            class XPathRuleAnywhereElement;
+            class XPathRuleElement;
+            class XPathTokenAnywhereElement;
+            class XPathTokenElement;
+            class XPathWildcardAnywhereElement;
+            class XPathWildcardElement;
+          }
+
         }
       }
     }
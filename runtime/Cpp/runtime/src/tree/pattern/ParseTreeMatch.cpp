@@ -45,6 +45,13 @@ ParseTreeMatch::ParseTreeMatch(Ref<ParseTree> tree, const ParseTreePattern &patt
   }
 }
 
+ParseTreeMatch::ParseTreeMatch(Ref<ParseTree> tree, Ref<ParseTreePattern> pattern,
+                               const std::map<std::string, std::vector<Ref<ParseTree>>> &labels,
+                               Ref<ParseTree> mismatchedNode)
+  : ParseTreeMatch(tree, *pattern, labels, mismatchedNode) {
+  _sharedPattern = pattern;
+}
+
 Ref<ParseTree> ParseTreeMatch::get(const std::string &label) {
   auto iterator = _labels.find(label);
   if (iterator == _labels.end() || iterator->second.empty()) {
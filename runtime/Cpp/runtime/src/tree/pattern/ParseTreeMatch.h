@@ -49,6 +49,10 @@ namespace pattern {
     /// This is the backing field for getPattern().
     const ParseTreePattern &_pattern;
 
+    /// Keeps the pattern alive if the match was created from a shared pattern (like the ones the
+    /// ParseTreePatternMatcher compiles for its string based match functions).
+    Ref<ParseTreePattern> _sharedPattern;
+
     /// This is the backing field for getLabels().
     std::map<std::string, std::vector<Ref<ParseTree>>> _labels;
 
@@ -73,6 +77,11 @@ namespace pattern {
     ParseTreeMatch(Ref<ParseTree> tree, const ParseTreePattern &pattern,
                    const std::map<std::string, std::vector<Ref<ParseTree>>> &labels,
                    Ref<ParseTree> mismatchedNode);
+
+    /// Same as above, but the match shares ownership of the pattern.
+    ParseTreeMatch(Ref<ParseTree> tree, Ref<ParseTreePattern> pattern,
+                   const std::map<std::string, std::vector<Ref<ParseTree>>> &labels,
+                   Ref<ParseTree> mismatchedNode);
     virtual ~ParseTreeMatch() {};
     
     /// <summary>
@@ -31,16 +31,29 @@
 
 #include "tree/pattern/ParseTreePatternMatcher.h"
 #include "tree/pattern/ParseTreeMatch.h"
-//#include "XPath.h"
+#include "tree/pattern/RuleTagToken.h"
+#include "tree/pattern/TokenTagToken.h"
+#include "tree/TerminalNode.h"
+#include "tree/xpath/XPath.h"
+#include "ParserRuleContext.h"
+#include "Exceptions.h"
+#include "support/CPPUtils.h"
 
 #include "tree/pattern/ParseTreePattern.h"
 
+using namespace org::antlr::v4::runtime;
 using namespace org::antlr::v4::runtime::tree;
 using namespace org::antlr::v4::runtime::tree::pattern;
+using namespace antlrcpp;
 
 ParseTreePattern::ParseTreePattern(ParseTreePatternMatcher *matcher, const std::string &pattern, int patternRuleIndex,
   Ref<ParseTree> patternTree)
   : patternRuleIndex(patternRuleIndex), pattern(pattern), patternTree(patternTree), matcher(matcher) {
+  _firstTokenType = Token::INVALID_TYPE;
+  if (patternTree != nullptr) {
+    bool seenTag = false;
+    compileNode(patternTree, seenTag);
+  }
 }
 
 ParseTreeMatch ParseTreePattern::match(Ref<ParseTree> tree) {
@@ -48,22 +61,23 @@ ParseTreeMatch ParseTreePattern::match(Ref<ParseTree> tree) {
 }
 
 bool ParseTreePattern::matches(Ref<ParseTree> tree) {
-  return matcher->match(tree, *this).succeeded();
+  if (tree == nullptr) {
+    throw IllegalArgumentException("tree cannot be nul");
+  }
+  return !_nodes.empty() && matchNode(tree, 0, nullptr);
 }
 
-/*
-std::vector<ParseTreeMatch*> ParseTreePattern::findAll(ParseTree *tree, const std::string &xpath) {
-  std::vector<ParseTree*> subtrees = xpath::XPath::findAll(tree, xpath, matcher->getParser());
-  std::vector<ParseTreeMatch*> matches = std::vector<ParseTreeMatch*>();
-  for (auto t : subtrees) {
-    ParseTreeMatch *aMatch = match(t);
-    if (aMatch->succeeded()) {
+std::vector<ParseTreeMatch> ParseTreePattern::findAll(Ref<ParseTree> tree, const std::string &xpath) {
+  std::vector<Ref<ParseTree>> subtrees = xpath::XPath::findAll(tree, xpath, matcher->getParser());
+  std::vector<ParseTreeMatch> matches;
+  for (auto &t : subtrees) {
+    ParseTreeMatch aMatch = match(t);
+    if (aMatch.succeeded()) {
       matches.push_back(aMatch);
     }
   }
   return matches;
 }
-*/
 
 ParseTreePatternMatcher *ParseTreePattern::getMatcher() const {
   return matcher;
@@ -80,3 +94,132 @@ int ParseTreePattern::getPatternRuleIndex() const {
 Ref<ParseTree> ParseTreePattern::getPatternTree() const {
   return patternTree;
 }
+
+ssize_t ParseTreePattern::getFirstTokenType() const {
+  return _firstTokenType;
+}
+
+void ParseTreePattern::compileNode(Ref<ParseTree> t, bool &seenTag) {
+  size_t index = _nodes.size();
+  _nodes.push_back({ NodeKind::Token, 0, 0, 0, "", NO_SLOT, NO_SLOT });
+
+  // Same distinction as in ParseTreePatternMatcher::matchImpl().
+  if (is<TerminalNode>(t)) {
+    Ref<Token> symbol = std::static_pointer_cast<TerminalNode>(t)->getSymbol();
+    PatternNode &node = _nodes[index];
+    node.type = symbol->getType();
+    if (is<TokenTagToken>(symbol)) {
+      Ref<TokenTagToken> tokenTagToken = std::static_pointer_cast<TokenTagToken>(symbol);
+      node.kind = NodeKind::TokenTag;
+      node.nameSlot = getLabelSlot(tokenTagToken->getTokenName());
+      if (!tokenTagToken->getLabel().empty()) {
+        node.labelSlot = getLabelSlot(tokenTagToken->getLabel());
+      }
+    } else {
+      node.text = t->getText();
+    }
+
+    // A token can only be the first one of a matching tree if no rule tag comes before it.
+    if (!seenTag && _firstTokenType == Token::INVALID_TYPE) {
+      _firstTokenType = node.type;
+    }
+  } else if (is<ParserRuleContext>(t)) {
+    Ref<ParserRuleContext> ctx = std::static_pointer_cast<ParserRuleContext>(t);
+
+    // (expr <expr>) is a rule tag.
+    Ref<RuleTagToken> ruleTagToken;
+    if (ctx->children.size() == 1 && is<TerminalNode>(ctx->children[0])) {
+      Ref<Token> symbol = std::static_pointer_cast<TerminalNode>(ctx->children[0])->getSymbol();
+      if (is<RuleTagToken>(symbol)) {
+        ruleTagToken = std::static_pointer_cast<RuleTagToken>(symbol);
+      }
+    }
+
+    _nodes[index].type = ctx->getRuleIndex();
+    if (ruleTagToken != nullptr) {
+      PatternNode &node = _nodes[index];
+      node.kind = NodeKind::RuleTag;
+      node.nameSlot = getLabelSlot(ruleTagToken->getRuleName());
+      if (!ruleTagToken->getLabel().empty()) {
+        node.labelSlot = getLabelSlot(ruleTagToken->getLabel());
+      }
+      seenTag = true;
+    } else {
+      _nodes[index].kind = NodeKind::Rule;
+      _nodes[index].childCount = ctx->children.size();
+      for (auto &child : ctx->children) {
+        compileNode(child, seenTag);
+      }
+    }
+  } else {
+    throw IllegalArgumentException("Unsupported node type in pattern: " + pattern);
+  }
+
+  _nodes[index].subtreeEnd = _nodes.size();
+}
+
+size_t ParseTreePattern::getLabelSlot(const std::string &name) {
+  for (size_t i = 0; i < _labelNames.size(); ++i) {
+    if (_labelNames[i] == name) {
+      return i;
+    }
+  }
+  _labelNames.push_back(name);
+  return _labelNames.size() - 1;
+}
+
+bool ParseTreePattern::matchNode(const Ref<ParseTree> &tree, size_t index, LabelList *labels) const {
+  const PatternNode &node = _nodes[index];
+  switch (node.kind) {
+    case NodeKind::Token:
+    case NodeKind::TokenTag: {
+      TerminalNode *terminal = dynamic_cast<TerminalNode *>(tree.get());
+      if (terminal == nullptr || terminal->getSymbol()->getType() != node.type) {
+        return false;
+      }
+      if (node.kind == NodeKind::Token) {
+        return terminal->getText() == node.text;
+      }
+      break;
+    }
+
+    case NodeKind::RuleTag:
+    case NodeKind::Rule: {
+      ParserRuleContext *ctx = dynamic_cast<ParserRuleContext *>(tree.get());
+      if (ctx == nullptr || ctx->getRuleIndex() != node.type) {
+        return false;
+      }
+      if (node.kind == NodeKind::Rule) {
+        if (ctx->children.size() != node.childCount) {
+          return false;
+        }
+        size_t childIndex = index + 1;
+        for (auto &child : ctx->children) {
+          if (!matchNode(child, childIndex, labels)) {
+            return false;
+          }
+          childIndex = _nodes[childIndex].subtreeEnd;
+        }
+        return true;
+      }
+      break;
+    }
+  }
+
+  // A tag matched.
+  if (labels != nullptr) {
+    labels->push_back({ node.nameSlot, tree });
+    if (node.labelSlot != NO_SLOT) {
+      labels->push_back({ node.labelSlot, tree });
+    }
+  }
+  return true;
+}
+
+std::map<std::string, std::vector<Ref<ParseTree>>> ParseTreePattern::createLabelMap(const LabelList &labels) const {
+  std::map<std::string, std::vector<Ref<ParseTree>>> result;
+  for (auto &entry : labels) {
+    result[_labelNames[entry.first]].push_back(entry.second);
+  }
+  return result;
+}
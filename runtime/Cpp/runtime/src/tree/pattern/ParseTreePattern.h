@@ -43,6 +43,10 @@ namespace pattern {
   /// <summary>
   /// A pattern like {@code <ID> = <expr>;} converted to a <seealso cref="ParseTree"/> by
   /// <seealso cref="ParseTreePatternMatcher#compile(String, int)"/>.
+  /// <p/>
+  /// Besides the pattern tree a pattern keeps a flat (preorder) form of it, which is what <seealso cref="#matches"/>
+  /// and <seealso cref="ParseTreePatternSet"/> test trees against. That avoids walking and casting the pattern tree
+  /// for each candidate node and collects tag labels in a flat list instead of a map.
   /// </summary>
   class ANTLR4CPP_PUBLIC ParseTreePattern {
   public:
@@ -84,10 +88,7 @@ namespace pattern {
     /// @returns A collection of ParseTreeMatch objects describing the
     /// successful matches. Unsuccessful matches are omitted from the result,
     /// regardless of the reason for the failure.
-
-    // A full blown XPath implementation just for this single function which is nowhere used?
-    // Readd the XPath stuff from ANTLR if you really need that.
-    //virtual std::vector<ParseTreeMatch*> findAll(ParseTree *tree, const std::string &xpath);
+    virtual std::vector<ParseTreeMatch> findAll(Ref<ParseTree> tree, const std::string &xpath);
 
     /// <summary>
     /// Get the <seealso cref="ParseTreePatternMatcher"/> which created this tree pattern.
@@ -118,7 +119,39 @@ namespace pattern {
     /// <returns> The tree pattern as a <seealso cref="ParseTree"/>. </returns>
     virtual Ref<ParseTree> getPatternTree() const;
 
+    /// <summary>
+    /// Get the type of the first token a tree must start with to match this pattern.
+    /// </summary>
+    /// <returns> The type of the first token in the pattern, or Token::INVALID_TYPE if the
+    /// pattern starts with a rule tag (or contains no token at all). </returns>
+    virtual ssize_t getFirstTokenType() const;
+
   private:
+    friend class ParseTreePatternSet;
+
+    enum class NodeKind {
+      Rule,     // A rule context, compared by rule index and then child by child.
+      RuleTag,  // <expr>, matches any context of the same rule.
+      TokenTag, // <ID>, matches any token of the same type.
+      Token     // Matches a token with the same type and text.
+    };
+
+    struct PatternNode {
+      NodeKind kind;
+      ssize_t type; // Rule index or token type.
+      size_t childCount;
+      size_t subtreeEnd; // Index of the next node which is not in the subtree of this one.
+      std::string text;
+
+      // Label slots (see _labelNames) for tags: the rule/token name and the label, if any.
+      size_t nameSlot;
+      size_t labelSlot;
+    };
+
+    typedef std::vector<std::pair<size_t, Ref<ParseTree>>> LabelList;
+
+    static const size_t NO_SLOT = (size_t)-1;
+
     const int patternRuleIndex;
 
     /// <summary>
@@ -133,6 +166,18 @@ namespace pattern {
     /// This is the backing field for <seealso cref="#getMatcher()"/>.
     /// </summary>
     ParseTreePatternMatcher *const matcher;
+
+    std::vector<PatternNode> _nodes;
+    std::vector<std::string> _labelNames;
+    ssize_t _firstTokenType;
+
+    void compileNode(Ref<ParseTree> t, bool &seenTag);
+    size_t getLabelSlot(const std::string &name);
+
+    /// Tests {@code tree} against the flat pattern, starting at pattern node {@code index}. Matched tags are
+    /// appended to {@code labels}, if given.
+    bool matchNode(const Ref<ParseTree> &tree, size_t index, LabelList *labels) const;
+    std::map<std::string, std::vector<Ref<ParseTree>>> createLabelMap(const LabelList &labels) const;
   };
 
 } // namespace pattern
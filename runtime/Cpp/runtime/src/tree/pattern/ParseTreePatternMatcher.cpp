@@ -33,6 +33,7 @@
 #include "tree/pattern/ParseTreeMatch.h"
 #include "tree/TerminalNode.h"
 #include "CommonTokenStream.h"
+#include "CommonToken.h"
 #include "ParserInterpreter.h"
 #include "tree/pattern/TokenTagToken.h"
 #include "ParserRuleContext.h"
@@ -57,6 +58,14 @@ using namespace org::antlr::v4::runtime::tree;
 using namespace org::antlr::v4::runtime::tree::pattern;
 using namespace antlrcpp;
 
+namespace {
+
+  // The string based match functions compile each pattern only once. Patterns built on the fly (e.g. with
+  // an identifier in them) would fill the cache forever, so it is emptied when it gets full.
+  const size_t MAX_CACHED_PATTERNS = 256;
+
+}
+
 ParseTreePatternMatcher::CannotInvokeStartRule::CannotInvokeStartRule(const RuntimeException &e) : RuntimeException(e.what()) {
 }
 
@@ -73,14 +82,13 @@ void ParseTreePatternMatcher::setDelimiters(const std::string &start, const std:
     throw IllegalArgumentException("stop cannot be null or empty");
   }
 
- _start = start;
+  _start = start;
   _stop = stop;
   _escape = escapeLeft;
 }
 
 bool ParseTreePatternMatcher::matches(Ref<ParseTree> tree, const std::string &pattern, int patternRuleIndex) {
-  ParseTreePattern p = compile(pattern, patternRuleIndex);
-  return matches(tree, p);
+  return matches(tree, *getCachedPattern(pattern, patternRuleIndex));
 }
 
 bool ParseTreePatternMatcher::matches(Ref<ParseTree> tree, const ParseTreePattern &pattern) {
@@ -90,8 +98,11 @@ bool ParseTreePatternMatcher::matches(Ref<ParseTree> tree, const ParseTreePatter
 }
 
 ParseTreeMatch ParseTreePatternMatcher::match(Ref<ParseTree> tree, const std::string &pattern, int patternRuleIndex) {
-  ParseTreePattern p = compile(pattern, patternRuleIndex);
-  return match(tree, p);
+  // The match shares the pattern, which keeps it alive when it is dropped from the cache.
+  Ref<ParseTreePattern> compiled = getCachedPattern(pattern, patternRuleIndex);
+  std::map<std::string, std::vector<Ref<ParseTree>>> labels;
+  Ref<tree::ParseTree> mismatchedNode = matchImpl(tree, compiled->getPatternTree(), labels);
+  return ParseTreeMatch(tree, compiled, labels, mismatchedNode);
 }
 
 ParseTreeMatch ParseTreePatternMatcher::match(Ref<ParseTree> tree, const ParseTreePattern &pattern) {
@@ -242,6 +253,22 @@ Ref<ParseTree> ParseTreePatternMatcher::matchImpl(Ref<ParseTree> tree,
   return tree;
 }
 
+Ref<ParseTreePattern> ParseTreePatternMatcher::getCachedPattern(const std::string &pattern, int patternRuleIndex) {
+  // Cached patterns are kept when the delimiters change (matches may still refer to them), so they are part of the key.
+  std::string key = _start + '\0' + _stop + '\0' + _escape + '\0' + pattern;
+  auto iterator = _patternCache.find({ key, patternRuleIndex });
+  if (iterator != _patternCache.end()) {
+    return iterator->second;
+  }
+
+  Ref<ParseTreePattern> compiled = std::make_shared<ParseTreePattern>(compile(pattern, patternRuleIndex));
+  if (_patternCache.size() >= MAX_CACHED_PATTERNS) {
+    _patternCache.clear();
+  }
+  _patternCache[{ key, patternRuleIndex }] = compiled;
+  return compiled;
+}
+
 Ref<RuleTagToken> ParseTreePatternMatcher::getRuleTagToken(Ref<ParseTree> t) {
   if (is<RuleNode>(t)) {
     Ref<RuleNode> r = std::dynamic_pointer_cast<RuleNode>(t);
@@ -257,13 +284,13 @@ Ref<RuleTagToken> ParseTreePatternMatcher::getRuleTagToken(Ref<ParseTree> t) {
 
 std::vector<Ref<Token>> ParseTreePatternMatcher::tokenize(const std::string &pattern) {
   // split pattern into chunks: sea (raw input) and islands (<ID>, <expr>)
-  std::vector<Chunk> chunks = split(pattern);
+  std::vector<Ref<Chunk>> chunks = split(pattern);
 
   // create token stream from text and tags
   std::vector<Ref<Token>> tokens;
-  for (auto chunk : chunks) {
+  for (auto &chunk : chunks) {
     if (is<TagChunk>(chunk)) {
-      TagChunk &tagChunk = (TagChunk&)chunk;
+      TagChunk &tagChunk = static_cast<TagChunk &>(*chunk);
       // add special rule token or conjure up new token from name
       if (isupper(tagChunk.getTag()[0])) {
         size_t ttype = _parser->getTokenType(tagChunk.getTag());
@@ -283,12 +310,15 @@ std::vector<Ref<Token>> ParseTreePatternMatcher::tokenize(const std::string &pat
         throw IllegalArgumentException("invalid tag: " + tagChunk.getTag() + " in pattern: " + pattern);
       }
     } else {
-      TextChunk &textChunk = (TextChunk&)chunk;
+      TextChunk &textChunk = static_cast<TextChunk &>(*chunk);
       ANTLRInputStream input(textChunk.getText());
       _lexer->setInputStream(&input);
       Ref<Token> t = _lexer->nextToken();
       while (t->getType() != Token::EOF) {
-        tokens.push_back(t);
+        // The input is gone after this chunk, so the token must carry its own text.
+        Ref<CommonToken> token = std::make_shared<CommonToken>(t.get());
+        token->setText(t->getText());
+        tokens.push_back(token);
         t = _lexer->nextToken();
       }
       _lexer->setInputStream(nullptr);
@@ -298,10 +328,10 @@ std::vector<Ref<Token>> ParseTreePatternMatcher::tokenize(const std::string &pat
   return tokens;
 }
 
-std::vector<Chunk> ParseTreePatternMatcher::split(const std::string &pattern) {
+std::vector<Ref<Chunk>> ParseTreePatternMatcher::split(const std::string &pattern) {
   size_t p = 0;
   size_t n = pattern.length();
-  std::vector<Chunk> chunks;
+  std::vector<Ref<Chunk>> chunks;
   
   // find all start and stop indexes first, then collect
   std::vector<size_t> starts;
@@ -340,12 +370,12 @@ std::vector<Chunk> ParseTreePatternMatcher::split(const std::string &pattern) {
   // collect into chunks now
   if (ntags == 0) {
     std::string text = pattern.substr(0, n);
-    chunks.push_back(TextChunk(text));
+    chunks.push_back(std::make_shared<TextChunk>(text));
   }
 
   if (ntags > 0 && starts[0] > 0) { // copy text up to first tag into chunks
     std::string text = pattern.substr(0, starts[0]);
-    chunks.push_back(TextChunk(text));
+    chunks.push_back(std::make_shared<TextChunk>(text));
   }
   for (size_t i = 0; i < ntags; i++) {
     // copy inside of <tag>
@@ -357,30 +387,29 @@ std::vector<Chunk> ParseTreePatternMatcher::split(const std::string &pattern) {
       label = tag.substr(0,colon);
       ruleOrToken = tag.substr(colon + 1, tag.length() - (colon + 1));
     }
-    chunks.push_back(TagChunk(label, ruleOrToken));
+    chunks.push_back(std::make_shared<TagChunk>(label, ruleOrToken));
     if (i + 1 < ntags) {
       // copy from end of <tag> to start of next
       std::string text = pattern.substr(stops[i] + _stop.length(), starts[i + 1] - (stops[i] + _stop.length()));
-      chunks.push_back(TextChunk(text));
+      chunks.push_back(std::make_shared<TextChunk>(text));
     }
   }
   if (ntags > 0) {
     size_t afterLastTag = stops[ntags - 1] + _stop.length();
     if (afterLastTag < n) { // copy text from end of last tag to end
       std::string text = pattern.substr(afterLastTag, n - afterLastTag);
-      chunks.push_back(TextChunk(text));
+      chunks.push_back(std::make_shared<TextChunk>(text));
     }
   }
 
   // strip out all backslashes from text chunks but not tags
   for (size_t i = 0; i < chunks.size(); i++) {
-    Chunk &c = chunks[i];
-    if (is<TextChunk>(c)) {
-      TextChunk &tc = (TextChunk&)c;
+    if (is<TextChunk>(chunks[i])) {
+      TextChunk &tc = static_cast<TextChunk &>(*chunks[i]);
       std::string unescaped = tc.getText();
       unescaped.erase(std::remove(unescaped.begin(), unescaped.end(), '\\'), unescaped.end());
       if (unescaped.length() < tc.getText().length()) {
-        chunks[i] = TextChunk(unescaped);
+        chunks[i] = std::make_shared<TextChunk>(unescaped);
       }
     }
   }
@@ -129,7 +129,8 @@ namespace pattern {
     virtual void setDelimiters(const std::string &start, const std::string &stop, const std::string &escapeLeft);
 
     /// <summary>
-    /// Does {@code pattern} matched as rule {@code patternRuleIndex} match {@code tree}? </summary>
+    /// Does {@code pattern} matched as rule {@code patternRuleIndex} match {@code tree}? The pattern is compiled
+    /// only once per matcher (and set of delimiters). </summary>
     virtual bool matches(Ref<ParseTree> tree, const std::string &pattern, int patternRuleIndex);
 
     /// <summary>
@@ -141,7 +142,8 @@ namespace pattern {
     /// <summary>
     /// Compare {@code pattern} matched as rule {@code patternRuleIndex} against
     /// {@code tree} and return a <seealso cref="ParseTreeMatch"/> object that contains the
-    /// matched elements, or the node at which the match failed.
+    /// matched elements, or the node at which the match failed. The pattern is compiled
+    /// only once per matcher (and set of delimiters) and kept alive by the matcher.
     /// </summary>
     virtual ParseTreeMatch match(Ref<ParseTree> tree, const std::string &pattern, int patternRuleIndex);
 
@@ -176,7 +178,7 @@ namespace pattern {
     virtual std::vector<Ref<Token>> tokenize(const std::string &pattern);
 
     /// Split "<ID> = <e:expr>;" into 4 chunks for tokenizing by tokenize().
-    virtual std::vector<Chunk> split(const std::string &pattern);
+    virtual std::vector<Ref<Chunk>> split(const std::string &pattern);
     
   protected:
     std::string _start;
@@ -196,9 +198,16 @@ namespace pattern {
     /// Is t <expr> subtree?
     virtual Ref<RuleTagToken> getRuleTagToken(Ref<ParseTree> t);
 
+    /// Returns the compiled form of the given pattern, compiling it on first use. The cache is bounded,
+    /// so a pattern must be held by the caller as long as it is in use.
+    Ref<ParseTreePattern> getCachedPattern(const std::string &pattern, int patternRuleIndex);
+
   private:
     Lexer *_lexer;
     Parser *_parser;
+
+    /// Patterns compiled for the string based match functions, keyed by delimiters + pattern and rule index.
+    std::map<std::pair<std::string, int>, Ref<ParseTreePattern>> _patternCache;
     
     void InitializeInstanceFields();
   };
@@ -0,0 +1,184 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "tree/pattern/ParseTreeMatch.h"
+#include "tree/pattern/ParseTreePattern.h"
+#include "tree/pattern/ParseTreePatternMatcher.h"
+#include "tree/TerminalNode.h"
+#include "ParserRuleContext.h"
+#include "Token.h"
+
+#include "tree/pattern/ParseTreePatternSet.h"
+
+using namespace org::antlr::v4::runtime;
+using namespace org::antlr::v4::runtime::tree;
+using namespace org::antlr::v4::runtime::tree::pattern;
+
+namespace {
+
+  // Type of the first token in the subtree of t, or Token::INVALID_TYPE if there is none. Results are kept
+  // for all subtrees on the way, so a walk over the whole tree visits each node only once here.
+  ssize_t getFirstTokenType(ParseTree *t, std::unordered_map<ParseTree *, ssize_t> &firstTokenTypes) {
+    TerminalNode *terminal = dynamic_cast<TerminalNode *>(t);
+    if (terminal != nullptr) {
+      return terminal->getSymbol()->getType();
+    }
+
+    auto iterator = firstTokenTypes.find(t);
+    if (iterator != firstTokenTypes.end()) {
+      return iterator->second;
+    }
+
+    ssize_t result = Token::INVALID_TYPE;
+    ParserRuleContext *ctx = dynamic_cast<ParserRuleContext *>(t);
+    if (ctx != nullptr) {
+      for (auto &child : ctx->children) {
+        result = getFirstTokenType(child.get(), firstTokenTypes);
+        if (result != Token::INVALID_TYPE) {
+          break;
+        }
+      }
+    }
+    firstTokenTypes[t] = result;
+    return result;
+  }
+
+}
+
+ParseTreePatternSet::ParseTreePatternSet(ParseTreePatternMatcher *matcher) : _matcher(matcher) {
+}
+
+size_t ParseTreePatternSet::add(const std::string &pattern, int patternRuleIndex) {
+  return add(_matcher->compile(pattern, patternRuleIndex));
+}
+
+size_t ParseTreePatternSet::add(const ParseTreePattern &pattern) {
+  size_t index = _patterns.size();
+  _patterns.push_back(std::make_shared<ParseTreePattern>(pattern));
+
+  RuleCandidates &candidates = _candidates[pattern.getPatternRuleIndex()];
+  ssize_t firstTokenType = pattern.getFirstTokenType();
+  if (firstTokenType == Token::INVALID_TYPE) {
+    candidates.any.push_back(index);
+  } else {
+    candidates.byFirstToken[firstTokenType].push_back(index);
+  }
+  return index;
+}
+
+size_t ParseTreePatternSet::size() const {
+  return _patterns.size();
+}
+
+const ParseTreePattern& ParseTreePatternSet::getPattern(size_t index) const {
+  return *_patterns[index];
+}
+
+std::vector<size_t> ParseTreePatternSet::getMatchingPatterns(Ref<ParseTree> tree) const {
+  std::vector<size_t> result;
+  FirstTokenTypes firstTokenTypes;
+  forEachCandidate(tree.get(), firstTokenTypes, [&](size_t index) {
+    const ParseTreePattern &pattern = *_patterns[index];
+    if (!pattern._nodes.empty() && pattern.matchNode(tree, 0, nullptr)) {
+      result.push_back(index);
+    }
+  });
+  return result;
+}
+
+std::vector<ParseTreeMatch> ParseTreePatternSet::findAll(Ref<ParseTree> tree) const {
+  std::vector<ParseTreeMatch> result;
+  if (_patterns.empty()) {
+    return result;
+  }
+
+  ParseTreePattern::LabelList labels;
+  FirstTokenTypes firstTokenTypes;
+  std::vector<Ref<ParseTree>> stack = { tree };
+  while (!stack.empty()) {
+    Ref<ParseTree> node = std::move(stack.back());
+    stack.pop_back();
+
+    forEachCandidate(node.get(), firstTokenTypes, [&](size_t index) {
+      const ParseTreePattern &pattern = *_patterns[index];
+      labels.clear();
+      if (!pattern._nodes.empty() && pattern.matchNode(node, 0, &labels)) {
+        result.push_back(ParseTreeMatch(node, pattern, pattern.createLabelMap(labels), nullptr));
+      }
+    });
+
+    ParserRuleContext *ctx = dynamic_cast<ParserRuleContext *>(node.get());
+    if (ctx != nullptr) {
+      stack.insert(stack.end(), ctx->children.rbegin(), ctx->children.rend());
+    }
+  }
+  return result;
+}
+
+void ParseTreePatternSet::forEachCandidate(ParseTree *tree, FirstTokenTypes &firstTokenTypes,
+                                           const std::function<void (size_t)> &action) const {
+  ParserRuleContext *ctx = dynamic_cast<ParserRuleContext *>(tree);
+  if (ctx == nullptr) {
+    return; // Patterns always have a rule context at their root.
+  }
+
+  auto iterator = _candidates.find(ctx->getRuleIndex());
+  if (iterator == _candidates.end()) {
+    return;
+  }
+
+  const RuleCandidates &candidates = iterator->second;
+  const std::vector<size_t> *byToken = nullptr;
+  if (!candidates.byFirstToken.empty()) {
+    auto tokenIterator = candidates.byFirstToken.find(getFirstTokenType(tree, firstTokenTypes));
+    if (tokenIterator != candidates.byFirstToken.end()) {
+      byToken = &tokenIterator->second;
+    }
+  }
+
+  if (byToken == nullptr) {
+    for (size_t index : candidates.any) {
+      action(index);
+    }
+    return;
+  }
+
+  // Merge both (sorted) lists to keep the pattern order.
+  auto i = candidates.any.begin();
+  auto j = byToken->begin();
+  while (i != candidates.any.end() || j != byToken->end()) {
+    if (j == byToken->end() || (i != candidates.any.end() && *i < *j)) {
+      action(*i++);
+    } else {
+      action(*j++);
+    }
+  }
+}
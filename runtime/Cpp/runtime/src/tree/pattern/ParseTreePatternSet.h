@@ -0,0 +1,108 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "antlr4-common.h"
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+namespace tree {
+namespace pattern {
+
+  /// <summary>
+  /// A set of compiled tree patterns which are matched together against all nodes of a parse tree, walking the
+  /// tree only once. For each node only those patterns are tried whose pattern rule is the node's rule and, if the
+  /// pattern starts with a token, whose first token is the first token of the node.
+  /// <p/>
+  /// The set keeps its own copies of the added patterns, which are referenced by the returned
+  /// <seealso cref="ParseTreeMatch"/> objects. So the set must stay alive as long as those are in use.
+  /// </summary>
+  class ANTLR4CPP_PUBLIC ParseTreePatternSet {
+  public:
+    ParseTreePatternSet(ParseTreePatternMatcher *matcher);
+    virtual ~ParseTreePatternSet() {};
+
+    /// <summary>
+    /// Compiles {@code pattern} with the matcher of this set and adds it.
+    /// </summary>
+    /// <returns> The index of the pattern in this set. </returns>
+    virtual size_t add(const std::string &pattern, int patternRuleIndex);
+
+    /// <summary>
+    /// Adds an already compiled pattern.
+    /// </summary>
+    /// <returns> The index of the pattern in this set. </returns>
+    virtual size_t add(const ParseTreePattern &pattern);
+
+    virtual size_t size() const;
+    virtual const ParseTreePattern& getPattern(size_t index) const;
+
+    /// <summary>
+    /// Returns the indices (in ascending order) of all patterns matching the tree rooted at {@code tree}.
+    /// </summary>
+    virtual std::vector<size_t> getMatchingPatterns(Ref<ParseTree> tree) const;
+
+    /// <summary>
+    /// Match all patterns against all nodes of {@code tree}.
+    /// </summary>
+    /// <returns> The successful matches, ordered by node (in preorder) and then by pattern index. </returns>
+    virtual std::vector<ParseTreeMatch> findAll(Ref<ParseTree> tree) const;
+
+  protected:
+    ParseTreePatternMatcher *_matcher;
+    std::vector<Ref<ParseTreePattern>> _patterns;
+
+    struct RuleCandidates {
+      std::unordered_map<ssize_t, std::vector<size_t>> byFirstToken;
+      std::vector<size_t> any; // Patterns starting with a rule tag.
+    };
+
+    /// Candidate patterns by pattern rule index.
+    std::unordered_map<ssize_t, RuleCandidates> _candidates;
+
+    /// The first token type of each subtree visited so far, so a walk over a tree determines them only once.
+    typedef std::unordered_map<ParseTree *, ssize_t> FirstTokenTypes;
+
+    /// Calls {@code action} with the index of each pattern (in ascending order) which might match {@code tree},
+    /// i.e. which has the right rule and first token.
+    void forEachCandidate(ParseTree *tree, FirstTokenTypes &firstTokenTypes,
+                          const std::function<void (size_t)> &action) const;
+  };
+
+} // namespace pattern
+} // namespace tree
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
@@ -0,0 +1,296 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Exceptions.h"
+#include "Parser.h"
+#include "ParserRuleContext.h"
+#include "Token.h"
+#include "tree/xpath/XPathIndex.h"
+#include "tree/xpath/XPathRuleAnywhereElement.h"
+#include "tree/xpath/XPathRuleElement.h"
+#include "tree/xpath/XPathTokenAnywhereElement.h"
+#include "tree/xpath/XPathTokenElement.h"
+#include "tree/xpath/XPathWildcardAnywhereElement.h"
+#include "tree/xpath/XPathWildcardElement.h"
+
+#include "tree/xpath/XPath.h"
+
+using namespace org::antlr::v4::runtime;
+using namespace org::antlr::v4::runtime::tree;
+using namespace org::antlr::v4::runtime::tree::xpath;
+
+const std::string XPath::WILDCARD = "*";
+const std::string XPath::NOT = "!";
+
+namespace {
+
+  // The tokens of a path, as defined in XPathLexer.g4.
+  enum PathTokenType {
+    TOKEN_ANYWHERE, TOKEN_ROOT, TOKEN_WILDCARD, TOKEN_BANG, TOKEN_WORD, TOKEN_END
+  };
+
+  struct PathToken {
+    PathTokenType type;
+    std::string text;
+    size_t start;
+  };
+
+  bool isNameStartChar(char c) {
+    // Everything beyond ASCII is accepted as part of a (UTF-8 encoded) name.
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (unsigned char)c >= 0x80;
+  }
+
+  bool isNameChar(char c) {
+    return isNameStartChar(c) || (c >= '0' && c <= '9') || c == '_';
+  }
+
+  std::vector<PathToken> tokenize(const std::string &path) {
+    std::vector<PathToken> tokens;
+    size_t i = 0;
+    while (i < path.size()) {
+      size_t start = i;
+      char c = path[i];
+      if (c == '/') {
+        if (i + 1 < path.size() && path[i + 1] == '/') {
+          tokens.push_back({ TOKEN_ANYWHERE, "//", start });
+          i += 2;
+        } else {
+          tokens.push_back({ TOKEN_ROOT, "/", start });
+          ++i;
+        }
+      } else if (c == '*') {
+        tokens.push_back({ TOKEN_WILDCARD, XPath::WILDCARD, start });
+        ++i;
+      } else if (c == '!') {
+        tokens.push_back({ TOKEN_BANG, XPath::NOT, start });
+        ++i;
+      } else if (isNameStartChar(c)) {
+        while (i < path.size() && isNameChar(path[i])) {
+          ++i;
+        }
+        tokens.push_back({ TOKEN_WORD, path.substr(start, i - start), start });
+      } else if (c == '\'') {
+        size_t end = path.find('\'', i + 1);
+        if (end == std::string::npos) {
+          throw IllegalArgumentException("Invalid tokens or characters at index " + std::to_string(start) +
+                                         " in path '" + path + "'");
+        }
+        i = end + 1;
+        tokens.push_back({ TOKEN_WORD, path.substr(start, i - start), start });
+      } else {
+        throw IllegalArgumentException("Invalid tokens or characters at index " + std::to_string(start) +
+                                       " in path '" + path + "'");
+      }
+    }
+    tokens.push_back({ TOKEN_END, "<EOF>", path.size() });
+    return tokens;
+  }
+
+}
+
+XPath::XPath(Parser *parser, const std::string &path) : _path(path), _parser(parser) {
+  _elements = split(path);
+}
+
+std::vector<Ref<XPathElement>> XPath::split(const std::string &path) {
+  std::vector<PathToken> tokens = tokenize(path);
+
+  std::vector<Ref<XPathElement>> elements;
+  size_t n = tokens.size();
+  size_t i = 0;
+  while (i < n) {
+    const PathToken &el = tokens[i];
+    switch (el.type) {
+      case TOKEN_ROOT:
+      case TOKEN_ANYWHERE: {
+        bool anywhere = el.type == TOKEN_ANYWHERE;
+        i++;
+        const PathToken *next = &tokens[i];
+        bool invert = next->type == TOKEN_BANG;
+        if (invert) {
+          i++;
+          next = &tokens[i];
+        }
+        if (next->type != TOKEN_WORD && next->type != TOKEN_WILDCARD) {
+          if (next->type == TOKEN_END) {
+            throw IllegalArgumentException("Missing path element at end of path");
+          }
+          throw IllegalArgumentException("Unknown path element " + next->text + " at index " +
+                                         std::to_string(next->start) + " in path '" + path + "'");
+        }
+        Ref<XPathElement> pathElement = getXPathElement(next->text, next->start, anywhere);
+        pathElement->setInvert(invert);
+        elements.push_back(pathElement);
+        i++;
+        break;
+      }
+
+      case TOKEN_WORD:
+      case TOKEN_WILDCARD:
+        elements.push_back(getXPathElement(el.text, el.start, false));
+        i++;
+        break;
+
+      case TOKEN_END:
+        i = n;
+        break;
+
+      default :
+        throw IllegalArgumentException("Unknown path element " + el.text + " at index " + std::to_string(el.start) +
+                                       " in path '" + path + "'");
+    }
+  }
+  return elements;
+}
+
+Ref<XPathElement> XPath::getXPathElement(const std::string &word, size_t start, bool anywhere) {
+  if (word == WILDCARD) {
+    if (anywhere) {
+      return std::make_shared<XPathWildcardAnywhereElement>();
+    }
+    return std::make_shared<XPathWildcardElement>();
+  }
+
+  // Token names start with an upper case letter, token literals are quoted. Everything else is a rule name.
+  if (word[0] == '\'' || (word[0] >= 'A' && word[0] <= 'Z')) {
+    size_t ttype = _parser->getTokenType(word);
+    if (ttype == Token::INVALID_TYPE) {
+      throw IllegalArgumentException(word + " at index " + std::to_string(start) + " isn't a valid token name");
+    }
+    if (anywhere) {
+      return std::make_shared<XPathTokenAnywhereElement>(word, (int)ttype);
+    }
+    return std::make_shared<XPathTokenElement>(word, (int)ttype);
+  }
+
+  ssize_t ruleIndex = _parser->getRuleIndex(word);
+  if (ruleIndex == -1) {
+    throw IllegalArgumentException(word + " at index " + std::to_string(start) + " isn't a valid rule name");
+  }
+  if (anywhere) {
+    return std::make_shared<XPathRuleAnywhereElement>(word, (int)ruleIndex);
+  }
+  return std::make_shared<XPathRuleElement>(word, (int)ruleIndex);
+}
+
+std::vector<Ref<ParseTree>> XPath::findAll(Ref<ParseTree> tree, const std::string &xpath, Parser *parser) {
+  XPath p(parser, xpath);
+  return p.evaluate(tree);
+}
+
+std::vector<Ref<ParseTree>> XPath::evaluate(Ref<ParseTree> t) {
+  Ref<ParserRuleContext> dummyRoot = std::make_shared<ParserRuleContext>();
+  dummyRoot->children.push_back(t); // don't set t's parent.
+
+  std::vector<Ref<ParseTree>> work = { dummyRoot };
+  for (auto &element : _elements) {
+    std::vector<Ref<ParseTree>> next;
+    std::unordered_set<ParseTree *> seen;
+    for (auto &node : work) {
+      if (node->getChildCount() > 0) {
+        // only try to match next element if it has children
+        // e.g., //func/*/stat might have a token node for which
+        // we can't go looking for stat nodes.
+        for (auto &match : element->evaluate(node)) {
+          if (match != dummyRoot && seen.insert(match.get()).second) {
+            next.push_back(match);
+          }
+        }
+      }
+    }
+    work = std::move(next);
+    if (work.empty()) {
+      break;
+    }
+  }
+
+  return work;
+}
+
+std::vector<Ref<ParseTree>> XPath::evaluate(Ref<ParseTree> t, const XPathIndex &index) {
+  size_t root = index.getId(t.get());
+  if (root == XPathIndex::INVALID_ID) {
+    throw IllegalArgumentException("The tree to evaluate is not part of the index.");
+  }
+
+  std::vector<size_t> work;
+  for (size_t i = 0; i < _elements.size(); ++i) {
+    const XPathElement &element = *_elements[i];
+    std::vector<size_t> next;
+    if (i == 0) {
+      // The first element is applied to a (virtual) root whose only child is t.
+      if (element.isAnywhere()) {
+        element.evaluate(index, root, next);
+      } else if (element.matches(index, root)) {
+        next.push_back(root);
+      }
+    } else {
+      // The work list is in preorder. A node within the subtree of a node handled before can only produce
+      // nodes which are already in the result for anywhere elements, so such nodes are skipped.
+      size_t coveredEnd = 0;
+      for (size_t node : work) {
+        size_t end = index.getSubtreeEnd(node);
+        if (end == node + 1) {
+          continue; // no children
+        }
+        if (element.isAnywhere()) {
+          if (node < coveredEnd) {
+            continue;
+          }
+          coveredEnd = end;
+        }
+        element.evaluate(index, node, next);
+      }
+
+      // Children of nested nodes end up out of order.
+      if (!std::is_sorted(next.begin(), next.end())) {
+        std::sort(next.begin(), next.end());
+        next.erase(std::unique(next.begin(), next.end()), next.end());
+      }
+    }
+
+    work.swap(next);
+    if (work.empty()) {
+      break;
+    }
+  }
+
+  std::vector<Ref<ParseTree>> result;
+  result.reserve(work.size());
+  for (size_t id : work) {
+    result.push_back(index.getNode(id));
+  }
+  return result;
+}
+
+const std::vector<Ref<XPathElement>>& XPath::getElements() const {
+  return _elements;
+}
@@ -0,0 +1,130 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "antlr4-common.h"
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+namespace tree {
+namespace xpath {
+
+  /// <summary>
+  /// Represent a subset of XPath XML path syntax for use in identifying nodes in
+  /// parse trees.
+  /// <p/>
+  /// Split path into words and separators {@code /} and {@code //} then walk from left to right.
+  /// At each separator-word pair, find set of nodes. Next stage uses those as
+  /// work list.
+  /// <p/>
+  /// The basic interface is
+  /// <seealso cref="XPath#findAll ParseTree.findAll"/>{@code (tree, pathString, parser)}.
+  /// But that is just shorthand for:
+  ///
+  /// <pre>
+  /// XPath p(parser, pathString);
+  /// return p.evaluate(tree);
+  /// </pre>
+  /// <p/>
+  /// See {@code TestXPath} for descriptions. In short, this allows
+  /// operators:
+  ///
+  /// <dl>
+  /// <dt>/</dt> <dd>root</dd>
+  /// <dt>//</dt> <dd>anywhere</dd>
+  /// <dt>!</dt> <dd>invert; this must appear directly after root or anywhere
+  /// operator</dd>
+  /// </dl>
+  /// <p/>
+  /// and path elements:
+  ///
+  /// <dl>
+  /// <dt>ID</dt> <dd>token name</dd>
+  /// <dt>'string'</dt> <dd>any string literal token from the grammar</dd>
+  /// <dt>expr</dt> <dd>rule name</dd>
+  /// <dt>*</dt> <dd>wildcard matching any node</dd>
+  /// </dl>
+  /// <p/>
+  /// Whitespace is not allowed.
+  /// <p/>
+  /// A path is compiled once, when the XPath is constructed. For running many queries over the same (large)
+  /// tree pass an <seealso cref="XPathIndex"/> of that tree to evaluate(), which answers {@code //name} steps
+  /// from the index instead of walking the tree again for each query. Results are returned in tree (preorder)
+  /// order then.
+  /// </summary>
+  class ANTLR4CPP_PUBLIC XPath {
+  public:
+    static const std::string WILDCARD; // word not operator/separator
+    static const std::string NOT; // word for invert operator
+
+    /// <exception cref="IllegalArgumentException"> if the path is invalid or refers to unknown rules or tokens </exception>
+    XPath(Parser *parser, const std::string &path);
+    virtual ~XPath() {};
+
+    virtual std::vector<Ref<XPathElement>> split(const std::string &path);
+
+    static std::vector<Ref<ParseTree>> findAll(Ref<ParseTree> tree, const std::string &xpath, Parser *parser);
+
+    /// <summary>
+    /// Return a list of all nodes starting at {@code t} as root that satisfy the
+    /// path. The root {@code /} is relative to the node passed to
+    /// <seealso cref="#evaluate"/>.
+    /// </summary>
+    virtual std::vector<Ref<ParseTree>> evaluate(Ref<ParseTree> t);
+
+    /// <summary>
+    /// Same as above, using an index of the tree {@code t} belongs to.
+    /// </summary>
+    /// <exception cref="IllegalArgumentException"> if {@code t} is not part of the indexed tree </exception>
+    virtual std::vector<Ref<ParseTree>> evaluate(Ref<ParseTree> t, const XPathIndex &index);
+
+    const std::vector<Ref<XPathElement>>& getElements() const;
+
+  protected:
+    std::string _path;
+    std::vector<Ref<XPathElement>> _elements;
+    Parser *_parser;
+
+    /// Convert word like {@code *} or {@code ID} or {@code expr} to a path
+    /// element. {@code anywhere} is {@code true} if {@code //} precedes the
+    /// word. {@code start} is the word's position in the path (for error messages).
+    virtual Ref<XPathElement> getXPathElement(const std::string &word, size_t start, bool anywhere);
+  };
+
+} // namespace xpath
+} // namespace tree
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
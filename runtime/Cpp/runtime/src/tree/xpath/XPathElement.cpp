@@ -0,0 +1,71 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "tree/xpath/XPathIndex.h"
+
+#include "tree/xpath/XPathElement.h"
+
+using namespace org::antlr::v4::runtime::tree;
+using namespace org::antlr::v4::runtime::tree::xpath;
+
+XPathElement::XPathElement(const std::string &nodeName) : _nodeName(nodeName), _invert(false) {
+}
+
+std::string XPathElement::toString() const {
+  std::string inv = _invert ? "!" : "";
+  return std::string(isAnywhere() ? "//" : "/") + inv + _nodeName;
+}
+
+void XPathElement::setInvert(bool value) {
+  _invert = value;
+}
+
+bool XPathElement::isInvert() const {
+  return _invert;
+}
+
+void XPathElement::evaluateChildren(const XPathIndex &index, size_t node, std::vector<size_t> &nodes) const {
+  size_t end = index.getSubtreeEnd(node);
+  for (size_t child = node + 1; child < end; child = index.getSubtreeEnd(child)) {
+    if (matches(index, child)) {
+      nodes.push_back(child);
+    }
+  }
+}
+
+void XPathElement::evaluateSubtree(const XPathIndex &index, size_t node, std::vector<size_t> &nodes) const {
+  size_t end = index.getSubtreeEnd(node);
+  for (size_t id = node; id < end; ++id) {
+    if (matches(index, id)) {
+      nodes.push_back(id);
+    }
+  }
+}
@@ -0,0 +1,89 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "antlr4-common.h"
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+namespace tree {
+namespace xpath {
+
+  /// A single step of an <seealso cref="XPath"/>, like {@code /ID}, {@code //expr} or {@code /!*}.
+  class ANTLR4CPP_PUBLIC XPathElement {
+  public:
+    /// Construct element like {@code /ID} or {@code ID} or {@code /*} etc...
+    /// nodeName is the (rule or token) name used in the path, or XPath::WILDCARD.
+    XPathElement(const std::string &nodeName);
+    virtual ~XPathElement() {};
+
+    /// <summary>
+    /// Given tree rooted at {@code t} return all nodes matched by this path element.
+    /// </summary>
+    virtual std::vector<Ref<ParseTree>> evaluate(Ref<ParseTree> t) = 0;
+
+    /// <summary>
+    /// Same as above, but for the node with id {@code node} in {@code index}. The ids of the matched nodes
+    /// are appended to {@code nodes} in preorder.
+    /// </summary>
+    virtual void evaluate(const XPathIndex &index, size_t node, std::vector<size_t> &nodes) const = 0;
+
+    /// Determines if the node with the given id is one this element selects (ignoring where it is located).
+    virtual bool matches(const XPathIndex &index, size_t node) const = 0;
+
+    /// True for elements which select from all descendants of a node ({@code //}), instead of its children only.
+    virtual bool isAnywhere() const = 0;
+
+    virtual std::string toString() const;
+
+    void setInvert(bool value);
+    bool isInvert() const;
+
+  protected:
+    std::string _nodeName;
+    bool _invert;
+
+    /// Appends the ids of all children of {@code node} which this element matches().
+    void evaluateChildren(const XPathIndex &index, size_t node, std::vector<size_t> &nodes) const;
+
+    /// Appends the ids of all nodes in the subtree of {@code node} (including that node) which this element matches().
+    void evaluateSubtree(const XPathIndex &index, size_t node, std::vector<size_t> &nodes) const;
+  };
+
+} // namespace xpath
+} // namespace tree
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
@@ -0,0 +1,132 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ParserRuleContext.h"
+#include "tree/TerminalNode.h"
+#include "Token.h"
+#include "support/CPPUtils.h"
+
+#include "tree/xpath/XPathIndex.h"
+
+using namespace org::antlr::v4::runtime;
+using namespace org::antlr::v4::runtime::tree;
+using namespace org::antlr::v4::runtime::tree::xpath;
+
+using namespace antlrcpp;
+
+namespace {
+  const std::vector<size_t> noNodes;
+}
+
+XPathIndex::XPathIndex(Ref<ParseTree> root) {
+  // Iterative preorder walk, to support deep trees. The stack holds the ids of the nodes whose subtree
+  // is not yet complete, together with the index of the next child to visit.
+  std::vector<std::pair<size_t, size_t>> stack;
+
+  auto add = [this, &stack](Ref<ParseTree> tree) {
+    size_t id = _nodes.size();
+    Node node = { tree, 0, -1, Token::INVALID_TYPE, false };
+    if (is<ParserRuleContext>(tree)) {
+      node.ruleIndex = std::static_pointer_cast<ParserRuleContext>(tree)->getRuleIndex();
+      if (node.ruleIndex >= 0) {
+        _ruleNodes[node.ruleIndex].push_back(id);
+      }
+    } else if (is<TerminalNode>(tree)) {
+      node.isTerminal = true;
+      node.tokenType = std::static_pointer_cast<TerminalNode>(tree)->getSymbol()->getType();
+      _tokenNodes[node.tokenType].push_back(id);
+    }
+    _nodes.push_back(node);
+    _ids[tree.get()] = id;
+    stack.push_back({ id, 0 });
+  };
+
+  add(root);
+  while (!stack.empty()) {
+    size_t id = stack.back().first;
+    size_t childIndex = stack.back().second++;
+    ParseTree *tree = _nodes[id].tree.get();
+    if (childIndex < tree->getChildCount()) {
+      add(std::dynamic_pointer_cast<ParseTree>(tree->getChild(childIndex)));
+    } else {
+      _nodes[id].subtreeEnd = _nodes.size();
+      stack.pop_back();
+    }
+  }
+}
+
+size_t XPathIndex::size() const {
+  return _nodes.size();
+}
+
+size_t XPathIndex::getId(ParseTree *node) const {
+  auto iterator = _ids.find(node);
+  if (iterator == _ids.end()) {
+    return INVALID_ID;
+  }
+  return iterator->second;
+}
+
+Ref<ParseTree> XPathIndex::getNode(size_t id) const {
+  return _nodes[id].tree;
+}
+
+size_t XPathIndex::getSubtreeEnd(size_t id) const {
+  return _nodes[id].subtreeEnd;
+}
+
+ssize_t XPathIndex::getRuleIndex(size_t id) const {
+  return _nodes[id].ruleIndex;
+}
+
+bool XPathIndex::isTerminal(size_t id) const {
+  return _nodes[id].isTerminal;
+}
+
+ssize_t XPathIndex::getTokenType(size_t id) const {
+  return _nodes[id].tokenType;
+}
+
+const std::vector<size_t>& XPathIndex::getRuleNodes(ssize_t ruleIndex) const {
+  auto iterator = _ruleNodes.find(ruleIndex);
+  if (iterator == _ruleNodes.end()) {
+    return noNodes;
+  }
+  return iterator->second;
+}
+
+const std::vector<size_t>& XPathIndex::getTokenNodes(ssize_t tokenType) const {
+  auto iterator = _tokenNodes.find(tokenType);
+  if (iterator == _tokenNodes.end()) {
+    return noNodes;
+  }
+  return iterator->second;
+}
@@ -0,0 +1,105 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include "antlr4-common.h"
+
+namespace org {
+namespace antlr {
+namespace v4 {
+namespace runtime {
+namespace tree {
+namespace xpath {
+
+  /// <summary>
+  /// A flat index over a parse tree, built in a single pass, which lets an <seealso cref="XPath"/> be evaluated
+  /// without walking the tree again for each query. Nodes are numbered in preorder (the root has id 0), so the
+  /// subtree of a node is a contiguous id range and the nodes of a rule or token type within a subtree are a
+  /// contiguous part of the (sorted) node list for that rule or token type.
+  /// <p/>
+  /// The index holds references to the nodes, but it doesn't see later changes to the tree.
+  /// </summary>
+  class ANTLR4CPP_PUBLIC XPathIndex {
+  public:
+    static const size_t INVALID_ID = (size_t)-1;
+
+    XPathIndex(Ref<ParseTree> root);
+    virtual ~XPathIndex() {};
+
+    /// The number of nodes in the indexed tree.
+    size_t size() const;
+
+    /// Returns the id of the given node or INVALID_ID if it isn't part of the indexed tree.
+    size_t getId(ParseTree *node) const;
+
+    Ref<ParseTree> getNode(size_t id) const;
+
+    /// Returns the id following the last node in the subtree of the node with the given id.
+    /// The subtree (including the node itself) is [id, getSubtreeEnd(id)). The children of a node
+    /// are id + 1, getSubtreeEnd(id + 1) and so on.
+    size_t getSubtreeEnd(size_t id) const;
+
+    /// The rule index of the node, if it's a ParserRuleContext, otherwise -1.
+    ssize_t getRuleIndex(size_t id) const;
+
+    bool isTerminal(size_t id) const;
+
+    /// The token type of a terminal node (which includes error nodes).
+    ssize_t getTokenType(size_t id) const;
+
+    /// All nodes for the given rule in preorder.
+    const std::vector<size_t>& getRuleNodes(ssize_t ruleIndex) const;
+
+    /// All terminal nodes with the given token type in preorder.
+    const std::vector<size_t>& getTokenNodes(ssize_t tokenType) const;
+
+  private:
+    struct Node {
+      Ref<ParseTree> tree;
+      size_t subtreeEnd;
+      ssize_t ruleIndex;
+      ssize_t tokenType;
+      bool isTerminal;
+    };
+
+    std::vector<Node> _nodes;
+    std::unordered_map<ParseTree *, size_t> _ids;
+    std::unordered_map<ssize_t, std::vector<size_t>> _ruleNodes;
+    std::unordered_map<ssize_t, std::vector<size_t>> _tokenNodes;
+  };
+
+} // namespace xpath
+} // namespace tree
+} // namespace runtime
+} // namespace v4
+} // namespace antlr
+} // namespace org
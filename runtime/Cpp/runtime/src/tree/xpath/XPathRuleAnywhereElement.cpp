@@ -0,0 +1,85 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "tree/ParseTree.h"
+#include "tree/Trees.h"
+#include "ParserRuleContext.h"
+#include "support/CPPUtils.h"
+#include "tree/xpath/XPathIndex.h"
+
+#include "tree/xpath/XPathRuleAnywhereElement.h"
+
+using namespace org::antlr::v4::runtime;
+using namespace org::antlr::v4::runtime::tree;
+using namespace org::antlr::v4::runtime::tree::xpath;
+
+using namespace antlrcpp;
+
+XPathRuleAnywhereElement::XPathRuleAnywhereElement(const std::string &ruleName, int ruleIndex)
+  : XPathElement(ruleName), _ruleIndex(ruleIndex) {
+}
+
+std::vector<Ref<ParseTree>> XPathRuleAnywhereElement::evaluate(Ref<ParseTree> t) {
+  if (!_invert) {
+    return Trees::findAllRuleNodes(t, _ruleIndex);
+  }
+
+  std::vector<Ref<ParseTree>> nodes;
+  for (auto &node : Trees::getDescendants(t)) {
+    if (is<ParserRuleContext>(node) && std::static_pointer_cast<ParserRuleContext>(node)->getRuleIndex() >= 0 &&
+        std::static_pointer_cast<ParserRuleContext>(node)->getRuleIndex() != _ruleIndex) {
+      nodes.push_back(node);
+    }
+  }
+  return nodes;
+}
+
+void XPathRuleAnywhereElement::evaluate(const XPathIndex &index, size_t node, std::vector<size_t> &nodes) const {
+  if (_invert) {
+    evaluateSubtree(index, node, nodes);
+    return;
+  }
+
+  // The rule's nodes within the subtree of node are a contiguous range of its (preorder) node list.
+  const std::vector<size_t> &candidates = index.getRuleNodes(_ruleIndex);
+  auto begin = std::lower_bound(candidates.begin(), candidates.end(), node);
+  auto end = std::lower_bound(begin, candidates.end(), index.getSubtreeEnd(node));
+  nodes.insert(nodes.end(), begin, end);
+}
+
+bool XPathRuleAnywhereElement::matches(const XPathIndex &index, size_t node) const {
+  ssize_t ruleIndex = index.getRuleIndex(node);
+  return ruleIndex >= 0 && (ruleIndex == _ruleIndex) != _invert;
+}
+
+bool XPathRuleAnywhereElement::isAnywhere() const {
+  return true;
+}
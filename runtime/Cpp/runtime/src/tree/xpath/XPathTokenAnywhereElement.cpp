@@ -0,0 +1,84 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "tree/ParseTree.h"
+#include "tree/Trees.h"
+#include "tree/TerminalNode.h"
+#include "Token.h"
+#include "support/CPPUtils.h"
+#include "tree/xpath/XPathIndex.h"
+
+#include "tree/xpath/XPathTokenAnywhereElement.h"
+
+using namespace org::antlr::v4::runtime;
+using namespace org::antlr::v4::runtime::tree;
+using namespace org::antlr::v4::runtime::tree::xpath;
+
+using namespace antlrcpp;
+
+XPathTokenAnywhereElement::XPathTokenAnywhereElement(const std::string &tokenName, int tokenType)
+  : XPathElement(tokenName), _tokenType(tokenType) {
+}
+
+std::vector<Ref<ParseTree>> XPathTokenAnywhereElement::evaluate(Ref<ParseTree> t) {
+  if (!_invert) {
+    return Trees::findAllTokenNodes(t, _tokenType);
+  }
+
+  std::vector<Ref<ParseTree>> nodes;
+  for (auto &node : Trees::getDescendants(t)) {
+    if (is<TerminalNode>(node) && std::static_pointer_cast<TerminalNode>(node)->getSymbol()->getType() != _tokenType) {
+      nodes.push_back(node);
+    }
+  }
+  return nodes;
+}
+
+void XPathTokenAnywhereElement::evaluate(const XPathIndex &index, size_t node, std::vector<size_t> &nodes) const {
+  if (_invert) {
+    evaluateSubtree(index, node, nodes);
+    return;
+  }
+
+  // The token's nodes within the subtree of node are a contiguous range of its (preorder) node list.
+  const std::vector<size_t> &candidates = index.getTokenNodes(_tokenType);
+  auto begin = std::lower_bound(candidates.begin(), candidates.end(), node);
+  auto end = std::lower_bound(begin, candidates.end(), index.getSubtreeEnd(node));
+  nodes.insert(nodes.end(), begin, end);
+}
+
+bool XPathTokenAnywhereElement::matches(const XPathIndex &index, size_t node) const {
+  return index.isTerminal(node) && (index.getTokenType(node) == _tokenType) != _invert;
+}
+
+bool XPathTokenAnywhereElement::isAnywhere() const {
+  return true;
+}
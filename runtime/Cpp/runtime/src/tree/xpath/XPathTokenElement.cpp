@@ -0,0 +1,75 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "tree/ParseTree.h"
+#include "tree/Trees.h"
+#include "tree/TerminalNode.h"
+#include "Token.h"
+#include "support/CPPUtils.h"
+#include "tree/xpath/XPathIndex.h"
+
+#include "tree/xpath/XPathTokenElement.h"
+
+using namespace org::antlr::v4::runtime;
+using namespace org::antlr::v4::runtime::tree;
+using namespace org::antlr::v4::runtime::tree::xpath;
+
+using namespace antlrcpp;
+
+XPathTokenElement::XPathTokenElement(const std::string &tokenName, int tokenType)
+  : XPathElement(tokenName), _tokenType(tokenType) {
+}
+
+std::vector<Ref<ParseTree>> XPathTokenElement::evaluate(Ref<ParseTree> t) {
+  // return all children of t that match nodeName
+  std::vector<Ref<ParseTree>> nodes;
+  for (auto &c : Trees::getChildren(t)) {
+    if (is<TerminalNode>(c)) {
+      Ref<TerminalNode> tnode = std::static_pointer_cast<TerminalNode>(c);
+      if ((tnode->getSymbol()->getType() == _tokenType && !_invert) || (tnode->getSymbol()->getType() != _tokenType && _invert)) {
+        nodes.push_back(tnode);
+      }
+    }
+  }
+  return nodes;
+}
+
+void XPathTokenElement::evaluate(const XPathIndex &index, size_t node, std::vector<size_t> &nodes) const {
+  evaluateChildren(index, node, nodes);
+}
+
+bool XPathTokenElement::matches(const XPathIndex &index, size_t node) const {
+  return index.isTerminal(node) && (index.getTokenType(node) == _tokenType) != _invert;
+}
+
+bool XPathTokenElement::isAnywhere() const {
+  return false;
+}
@@ -0,0 +1,69 @@
+﻿/*
+ * [The "BSD license"]
+ *  Copyright (c) 2016 Mike Lischke
+ * Copyright (c) 2013 Terence Parr
+ * Copyright (c) 2013 Sam Harwell
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "tree/ParseTree.h"
+#include "tree/Trees.h"
+#include "tree/xpath/XPath.h"
+#include "tree/xpath/XPathIndex.h"
+
+#include "tree/xpath/XPathWildcardElement.h"
+
+using namespace org::antlr::v4::runtime;
+using namespace org::antlr::v4::runtime::tree;
+using namespace org::antlr::v4::runtime::tree::xpath;
+
+XPathWildcardElement::XPathWildcardElement()
+  : XPathElement(XPath::WILDCARD) {
+}
+
+std::vector<Ref<ParseTree>> XPathWildcardElement::evaluate(Ref<ParseTree> t) {
+  if (_invert) {
+    return {}; // !* is weird but valid (empty)
+  }
+
+  std::vector<Ref<ParseTree>> kids;
+  for (auto &c : Trees::getChildren(t)) {
+    kids.push_back(std::static_pointer_cast<ParseTree>(c));
+  }
+  return kids;
+}
+
+void XPathWildcardElement::evaluate(const XPathIndex &index, size_t node, std::vector<size_t> &nodes) const {
+  evaluateChildren(index, node, nodes);
+}
+
+bool XPathWildcardElement::matches(const XPathIndex &/*index*/, size_t /*node*/) const {
+  return !_invert;
+}
+
+bool XPathWildcardElement::isAnywhere() const {
+  return false;
+}